@@ -23,4 +23,8 @@ DEFINE_string(socket_family, "AF_INET", "Socket family (AF_UNIX, AF_INET)");
 DEFINE_uint64(stats_mode, peloton::STATS_TYPE_INVALID,
               "Enable statistics collection (default: STATS_TYPE_INVALID)");
 
+DEFINE_uint64(query_parallelism, 1,
+              "Threads the executors of a query may use, 0 for one per "
+              "hardware thread (default: 1)");
+
 DEFINE_bool(h, false, "Show help");
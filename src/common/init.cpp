@@ -40,7 +40,10 @@ void PelotonInit::Initialize() {
   EPOCH_THREAD_COUNT = 1;
 
   // set max thread number.
-  thread_pool.Initialize(0, std::thread::hardware_concurrency() + 3);
+  // the worker threads run the intra-query tasks of parallel executors.
+  // they only start once the first parallel executor submits a task.
+  thread_pool.Initialize(QUERY_THREAD_COUNT,
+                         std::thread::hardware_concurrency() + 3);
 
   int parallelism = (std::thread::hardware_concurrency() + 1) / 2;
   storage::DataTable::SetActiveTileGroupCount(parallelism);
@@ -0,0 +1,295 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// thread_pool.cpp
+//
+// Identification: src/common/thread_pool.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/thread_pool.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "common/logger.h"
+
+namespace peloton {
+
+namespace {
+
+// the pool and index of the worker running on this thread.
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker_id = 0;
+
+// the cpus of every NUMA node, as listed by the kernel. empty if the kernel
+// does not report NUMA nodes.
+std::vector<std::vector<int>> GetNodeCpus() {
+  std::vector<std::vector<int>> node_cpus;
+  for (size_t node = 0;; node++) {
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                       "/cpulist");
+    if (!file) break;
+
+    // e.g., "0-7,16-23"
+    std::string cpu_list;
+    std::getline(file, cpu_list);
+    std::vector<int> cpus;
+    std::stringstream ranges(cpu_list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+      if (range.empty()) continue;
+      auto dash = range.find('-');
+      int first = std::stoi(range.substr(0, dash));
+      int last = (dash == std::string::npos)
+                     ? first
+                     : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+    }
+    if (!cpus.empty()) node_cpus.push_back(cpus);
+  }
+  return node_cpus;
+}
+
+void BindToCpus(std::thread &thread, const std::vector<int> &cpus) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+  }
+  // the binding only helps locality, so the threads run anyway without it.
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set),
+                             &cpu_set) != 0) {
+    LOG_DEBUG("Failed to bind a worker thread to its NUMA node");
+  }
+}
+
+}  // namespace
+
+void ThreadPool::Initialize(const size_t &pool_size,
+                            const size_t &dedicated_thread_count) {
+  pool_size_ = pool_size;
+  // PL_ASSERT(pool_size_ != 0);
+
+  dedicated_thread_count_ = dedicated_thread_count;
+  shutdown_ = false;
+  started_ = false;
+
+  dedicated_threads_.resize(dedicated_thread_count_);
+}
+
+void ThreadPool::StartWorkers() {
+  if (started_.load(std::memory_order_acquire) == true) return;
+
+  std::lock_guard<std::mutex> lock(start_mutex_);
+  if (started_.load(std::memory_order_relaxed) == true) return;
+
+  // spread the workers over the NUMA nodes.
+  auto node_cpus = GetNodeCpus();
+  node_count_ = std::max<size_t>(std::min(node_cpus.size(), pool_size_), 1);
+
+  queues_.clear();
+  for (size_t i = 0; i < pool_size_; ++i) {
+    queues_.emplace_back(new WorkerQueue());
+    queues_.back()->node = i % node_count_;
+  }
+
+  for (size_t i = 0; i < pool_size_; ++i) {
+    // add thread to thread pool.
+    workers_.emplace_back(&ThreadPool::RunWorker, this, i);
+    if (node_count_ > 1) {
+      BindToCpus(workers_.back(), node_cpus[queues_[i]->node]);
+    }
+  }
+
+  started_.store(true, std::memory_order_release);
+}
+
+void ThreadPool::Shutdown() {
+  // always join lastly created threads first.
+  for (size_t i = 0; i < current_thread_count_; ++i) {
+    dedicated_threads_[(current_thread_count_ - 1 - i)]->join();
+  }
+  current_thread_count_ = 0;
+
+  // the workers stop after their current task, queued tasks are dropped.
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    shutdown_ = true;
+  }
+  idle_cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+  workers_.clear();
+
+  // allow the pool to be initialized again (e.g., by another test case).
+  queues_.clear();
+  queued_task_count_ = 0;
+  started_ = false;
+  pool_size_ = 0;
+  node_count_ = 1;
+}
+
+void ThreadPool::ExecuteTasks(std::vector<std::function<void()>> &tasks) {
+  if (tasks.empty()) return;
+
+  // shared with the helpers, which may start after this call returns.
+  struct TaskBatch {
+    std::vector<std::function<void()>> tasks;
+    std::atomic<size_t> next_task;
+    size_t finished_count;
+    std::exception_ptr exception;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  std::shared_ptr<TaskBatch> batch(new TaskBatch());
+  batch->tasks.swap(tasks);
+  batch->next_task = 0;
+  batch->finished_count = 0;
+
+  auto run_batch = [](std::shared_ptr<TaskBatch> batch) {
+    size_t task_count = batch->tasks.size();
+    size_t task_itr;
+    while ((task_itr = batch->next_task.fetch_add(1)) < task_count) {
+      std::exception_ptr exception;
+      try {
+        batch->tasks[task_itr]();
+      } catch (...) {
+        exception = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      if (exception != nullptr) batch->exception = exception;
+      if (++batch->finished_count == task_count) batch->cv.notify_all();
+    }
+  };
+
+  size_t helper_count = std::min(pool_size_, batch->tasks.size() - 1);
+  for (size_t i = 0; i < helper_count; ++i) {
+    PushTask(std::bind(run_batch, batch));
+  }
+  run_batch(batch);
+
+  // every task of the batch has started. run queued tasks until the last
+  // ones finish, instead of blocking a thread the pool may need.
+  size_t worker_id = GetWorkerId();
+  std::function<void()> task;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      if (batch->finished_count == batch->tasks.size()) break;
+    }
+    if (PopTask(worker_id, task) == false) {
+      std::unique_lock<std::mutex> lock(batch->mutex);
+      batch->cv.wait(lock, [&batch] {
+        return batch->finished_count == batch->tasks.size();
+      });
+      break;
+    }
+    task();
+    task = nullptr;
+  }
+
+  // rethrow the failure of any task on the calling thread.
+  if (batch->exception != nullptr) std::rethrow_exception(batch->exception);
+}
+
+void ThreadPool::PushTask(std::function<void()> task) {
+  StartWorkers();
+
+  // a pool without workers (e.g., after Shutdown()) runs the task right
+  // away, so that nothing waits for a task that never runs.
+  if (queues_.empty()) {
+    task();
+    return;
+  }
+
+  // a worker keeps the tasks it submits, others are dealt out in turn.
+  size_t queue_id = GetWorkerId();
+  if (queue_id == pool_size_) {
+    queue_id = next_queue_.fetch_add(1, std::memory_order_relaxed) % pool_size_;
+  }
+  {
+    auto &queue = *queues_[queue_id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    queued_task_count_++;
+  }
+
+  // wake an idle worker. taking the lock orders the wakeup after the check
+  // of a worker that is about to sleep.
+  { std::lock_guard<std::mutex> lock(idle_mutex_); }
+  idle_cv_.notify_one();
+}
+
+bool ThreadPool::PopTask(size_t worker_id, std::function<void()> &task) {
+  // nothing was queued before the workers start.
+  if (started_.load(std::memory_order_acquire) == false) return false;
+
+  // the newest task of the own queue, its data is most likely still cached.
+  if (worker_id < pool_size_) {
+    auto &queue = *queues_[worker_id];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty() == false) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      queued_task_count_--;
+      return true;
+    }
+  }
+
+  // steal the oldest task of another worker, of the same NUMA node first.
+  for (int same_node = 1; same_node >= 0; same_node--) {
+    for (size_t i = 1; i <= pool_size_; ++i) {
+      size_t victim = (worker_id + i) % pool_size_;
+      if (victim == worker_id) continue;
+      bool is_same_node = (worker_id == pool_size_ ||
+                           queues_[victim]->node == queues_[worker_id]->node);
+      if (is_same_node != (same_node == 1)) continue;
+
+      auto &queue = *queues_[victim];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty() == false) {
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued_task_count_--;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void ThreadPool::RunWorker(size_t worker_id) {
+  current_pool = this;
+  current_worker_id = worker_id;
+
+  std::function<void()> task;
+  while (shutdown_ == false) {
+    if (PopTask(worker_id, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cv_.wait(lock, [this] {
+      return shutdown_ == true || queued_task_count_ > 0;
+    });
+  }
+
+  current_pool = nullptr;
+}
+
+size_t ThreadPool::GetWorkerId() const {
+  return (current_pool == this) ? current_worker_id : pool_size_;
+}
+
+}  // End peloton namespace
@@ -756,6 +756,9 @@ std::string PlanNodeTypeToString(PlanNodeType type) {
     case PLAN_NODE_TYPE_HASHJOIN: {
       return ("HASHJOIN");
     }
+    case PLAN_NODE_TYPE_BANDJOIN: {
+      return ("BANDJOIN");
+    }
     case PLAN_NODE_TYPE_UPDATE: {
       return ("UPDATE");
     }
@@ -846,6 +849,8 @@ PlanNodeType StringToPlanNodeType(const std::string& str) {
     return PLAN_NODE_TYPE_MERGEJOIN;
   } else if (str == "HASHJOIN") {
     return PLAN_NODE_TYPE_HASHJOIN;
+  } else if (str == "BANDJOIN") {
+    return PLAN_NODE_TYPE_BANDJOIN;
   } else if (str == "UPDATE") {
     return PLAN_NODE_TYPE_UPDATE;
   } else if (str == "INSERT") {
@@ -18,18 +18,97 @@
 #include <vector>
 
 #include "common/types.h"
+#include "executor/executor_context.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
 #include "expression/abstract_expression.h"
+#include "expression/constant_value_expression.h"
+#include "expression/expression_util.h"
+#include "expression/parameter_value_expression.h"
+#include "expression/tuple_value_expression.h"
 #include "common/container_tuple.h"
 #include "storage/data_table.h"
 #include "storage/tile_group.h"
+#include "storage/zone_map.h"
 
 #include "common/logger.h"
+#include "util/flat_hash_table.h"
 
 namespace peloton {
 namespace executor {
 
+namespace {
+
+/**
+ * @brief Whether the expression may be true for a tuple of a tile group with
+ * the given zone map. Only AND/OR of comparisons between a column and a
+ * constant or a parameter can rule out a tile group.
+ */
+bool MayMatch(const expression::AbstractExpression *expr,
+              const storage::ZoneMap &zone_map,
+              const std::vector<common::Value> *params) {
+  auto type = expr->GetExpressionType();
+  switch (type) {
+    case EXPRESSION_TYPE_CONJUNCTION_AND:
+      return MayMatch(expr->GetChild(0), zone_map, params) &&
+             MayMatch(expr->GetChild(1), zone_map, params);
+    case EXPRESSION_TYPE_CONJUNCTION_OR:
+      return MayMatch(expr->GetChild(0), zone_map, params) ||
+             MayMatch(expr->GetChild(1), zone_map, params);
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+    case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+      break;
+    default:
+      return true;
+  }
+
+  if (expr->GetChildrenSize() != 2) return true;
+
+  // Put the column on the left
+  auto left = expr->GetChild(0);
+  auto right = expr->GetChild(1);
+  if (left->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) {
+    std::swap(left, right);
+    type = expression::ExpressionUtil::SwapComparison(type);
+  }
+  if (left->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) return true;
+
+  auto tuple_value =
+      static_cast<const expression::TupleValueExpression *>(left);
+  if (tuple_value->GetTupleId() != 0 || tuple_value->GetColumnId() < 0 ||
+      static_cast<oid_t>(tuple_value->GetColumnId()) >=
+          zone_map.GetColumnCount()) {
+    return true;
+  }
+  oid_t column_id = tuple_value->GetColumnId();
+
+  switch (right->GetExpressionType()) {
+    case EXPRESSION_TYPE_VALUE_CONSTANT:
+      return zone_map.MayMatch(
+          column_id, type,
+          static_cast<const expression::ConstantValueExpression *>(right)
+              ->GetValue());
+    case EXPRESSION_TYPE_VALUE_PARAMETER: {
+      auto param_idx =
+          static_cast<const expression::ParameterValueExpression *>(right)
+              ->GetValueIdx();
+      if (params == nullptr || param_idx < 0 ||
+          static_cast<size_t>(param_idx) >= params->size()) {
+        return true;
+      }
+      return zone_map.MayMatch(column_id, type, (*params)[param_idx]);
+    }
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
 /**
  * @brief Constructor
  * @param node AbstractScanNode node corresponding to this executor.
@@ -53,9 +132,54 @@ bool AbstractScanExecutor::DInit() {
   // auto column_ids = node.GetColumnIds();
 
   column_ids_ = std::move(node.GetColumnIds());
+  probe_filter_ = nullptr;
+  probe_filter_column_ids_.clear();
 
   return true;
 }
 
+void AbstractScanExecutor::SetProbeFilter(
+    const util::BloomFilter *probe_filter,
+    const std::vector<oid_t> &key_column_ids) {
+  probe_filter_ = probe_filter;
+  probe_filter_column_ids_.clear();
+  for (auto column_id : key_column_ids) {
+    PL_ASSERT(column_id < column_ids_.size());
+    probe_filter_column_ids_.push_back(column_ids_[column_id]);
+  }
+}
+
+/**
+ * @brief Check the key of a tuple against the probe filter. The key is
+ * hashed like the build side of a hash join hashes its keys.
+ * @return false if the tuple can be dropped
+ */
+bool AbstractScanExecutor::PassesProbeFilter(storage::TileGroup *tile_group,
+                                             oid_t tuple_id) const {
+  if (probe_filter_ == nullptr) return true;
+
+  // Same as ContainerTuple::HashCode() over the key columns
+  size_t hash = 0;
+  for (auto column_id : probe_filter_column_ids_) {
+    tile_group->GetValue(tuple_id, column_id).HashCombine(hash);
+  }
+  return probe_filter_->MayContain(util::MixHash(hash));
+}
+
+/**
+ * @brief Check the predicate against the zone map of the tile group.
+ * @return false if no tuple of the tile group can satisfy the predicate
+ */
+bool AbstractScanExecutor::MayMatchZoneMap(
+    storage::TileGroup *tile_group) const {
+  if (predicate_ == nullptr) return true;
+
+  const std::vector<common::Value> *params = nullptr;
+  if (executor_context_ != nullptr) {
+    params = &executor_context_->GetParams();
+  }
+  return MayMatch(predicate_, tile_group->GetZoneMap(), params);
+}
+
 }  // namespace executor
 }  // namespace peloton
@@ -11,10 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 #include <concurrency/transaction_manager_factory.h>
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/init.h"
 #include "common/logger.h"
+#include "common/thread_pool.h"
 #include "executor/aggregate_executor.h"
 #include "executor/aggregator.h"
 #include "executor/executor_context.h"
@@ -22,6 +27,8 @@
 #include "common/container_tuple.h"
 #include "planner/aggregate_plan.h"
 #include "storage/table_factory.h"
+#include "util/simd_merge_sort.h"
+#include "util/sort_key_normalizer.h"
 
 namespace peloton {
 namespace executor {
@@ -76,6 +83,216 @@ bool AggregateExecutor::DInit() {
   return true;
 }
 
+void AggregateExecutor::UseParallelAggregation(size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  aggregate_thread_count_ = thread_count;
+}
+
+/**
+ * @brief Create the aggregator of the plan's strategy for the given input.
+ * @return the aggregator, or nullptr for an invalid strategy
+ */
+AbstractAggregator *AggregateExecutor::CreateAggregator(LogicalTile *tile) {
+  const planner::AggregatePlan &node = GetPlanNode<planner::AggregatePlan>();
+
+  switch (node.GetAggregateStrategy()) {
+    case AGGREGATE_TYPE_HASH: {
+      std::unique_ptr<catalog::Schema> input_schema(tile->GetPhysicalSchema());
+      std::vector<common::Type::TypeId> input_types;
+      for (oid_t col = 0; col < input_schema->GetColumnCount(); col++) {
+        input_types.push_back(input_schema->GetType(col));
+      }
+      if (FlatHashAggregator::CanAggregate(&node, input_types)) {
+        LOG_TRACE("Use FlatHashAggregator");
+        return new FlatHashAggregator(&node, output_table, executor_context_,
+                                      input_types);
+      }
+      LOG_TRACE("Use HashAggregator");
+      return new HashAggregator(&node, output_table, executor_context_,
+                                tile->GetColumnCount());
+    }
+    case AGGREGATE_TYPE_SORTED:
+      LOG_TRACE("Use SortedAggregator");
+      return new SortedAggregator(&node, output_table, executor_context_,
+                                  tile->GetColumnCount());
+    case AGGREGATE_TYPE_PLAIN:
+      LOG_TRACE("Use PlainAggregator");
+      return new PlainAggregator(&node, output_table, executor_context_);
+    default:
+      LOG_ERROR("Invalid aggregate type. Return.");
+      return nullptr;
+  }
+}
+
+/**
+ * @brief Buffer the child tiles and aggregate them in two phases.
+ *
+ * Each worker aggregates a contiguous share of the tiles into its own
+ * aggregator. The partial groups of all workers are then merged into one
+ * aggregator per hash partition of the group keys, so every group ends up in
+ * exactly one of them. Plain aggregation has a single group, which is merged
+ * into the first worker.
+ * @return false if a worker failed
+ */
+bool AggregateExecutor::AggregateInParallel(
+    std::vector<std::unique_ptr<AbstractAggregator>> &aggregators) {
+  const planner::AggregatePlan &node = GetPlanNode<planner::AggregatePlan>();
+
+  std::vector<std::unique_ptr<LogicalTile>> tiles;
+  while (children_[0]->Execute() == true) {
+    tiles.emplace_back(children_[0]->GetOutput());
+  }
+  if (tiles.empty()) return true;
+
+  size_t worker_count = std::min(aggregate_thread_count_, tiles.size());
+  std::vector<std::unique_ptr<AbstractAggregator>> workers;
+  for (size_t worker_itr = 0; worker_itr < worker_count; worker_itr++) {
+    workers.emplace_back(CreateAggregator(tiles[0].get()));
+    if (workers.back().get() == nullptr) return false;
+  }
+
+  // First phase: aggregate the tiles
+  std::vector<int> worker_status(worker_count, true);
+  std::vector<std::function<void()>> tasks;
+  for (size_t worker_itr = 0; worker_itr < worker_count; worker_itr++) {
+    tasks.push_back([&, worker_itr] {
+      size_t end = tiles.size() * (worker_itr + 1) / worker_count;
+      for (size_t tile_itr = tiles.size() * worker_itr / worker_count;
+           tile_itr < end; tile_itr++) {
+        if (workers[worker_itr]->AdvanceTile(tiles[tile_itr].get()) == false) {
+          worker_status[worker_itr] = false;
+          return;
+        }
+      }
+    });
+  }
+  if (worker_count > 1) {
+    thread_pool.ExecuteTasks(tasks);
+  } else {
+    tasks[0]();
+  }
+  for (auto status : worker_status) {
+    if (status == false) return false;
+  }
+
+  if (worker_count == 1) {
+    aggregators.push_back(std::move(workers[0]));
+    return true;
+  }
+
+  // Second phase: merge the partial groups
+  if (node.GetAggregateStrategy() == AGGREGATE_TYPE_PLAIN) {
+    for (size_t worker_itr = 1; worker_itr < worker_count; worker_itr++) {
+      workers[0]->Merge(*workers[worker_itr], 0, 1);
+    }
+    aggregators.push_back(std::move(workers[0]));
+    return true;
+  }
+
+  size_t partition_count = worker_count;
+  for (size_t partition_itr = 0; partition_itr < partition_count;
+       partition_itr++) {
+    aggregators.emplace_back(CreateAggregator(tiles[0].get()));
+  }
+  tasks.clear();
+  for (size_t partition_itr = 0; partition_itr < partition_count;
+       partition_itr++) {
+    tasks.push_back([&, partition_itr] {
+      for (auto &worker : workers) {
+        aggregators[partition_itr]->Merge(*worker, partition_itr,
+                                          partition_count);
+      }
+    });
+  }
+  thread_pool.ExecuteTasks(tasks);
+
+  return true;
+}
+
+/**
+ * @brief Buffer the child tiles, sort their rows on the normalized group keys
+ * with the SIMD merge sort, and aggregate the sorted rows in one pass.
+ *
+ * The keys have to be exact, so that every run of equal keys is one group.
+ * Otherwise the buffered tiles are aggregated by hashing.
+ * @return false if the aggregator failed
+ */
+bool AggregateExecutor::AggregateSorted(
+    std::vector<std::unique_ptr<AbstractAggregator>> &aggregators) {
+  const planner::AggregatePlan &node = GetPlanNode<planner::AggregatePlan>();
+
+  std::vector<std::unique_ptr<LogicalTile>> tiles;
+  size_t count = 0;
+  while (children_[0]->Execute() == true) {
+    tiles.emplace_back(children_[0]->GetOutput());
+    count += tiles.back()->GetTupleCount();
+  }
+  if (tiles.empty()) return true;
+
+  auto &group_by_col_ids = node.GetGroupbyColIds();
+  std::unique_ptr<catalog::Schema> input_schema(tiles[0]->GetPhysicalSchema());
+  std::vector<common::Type::TypeId> key_types;
+  for (auto column_id : group_by_col_ids) {
+    key_types.push_back(input_schema->GetType(column_id));
+  }
+  std::unique_ptr<util::SortKeyNormalizer> key_normalizer;
+  if (util::SortKeyNormalizer::CanNormalize(key_types)) {
+    key_normalizer.reset(new util::SortKeyNormalizer(
+        key_types, std::vector<bool>(key_types.size(), false)));
+  }
+
+  if (key_normalizer == nullptr || key_normalizer->IsExact() == false) {
+    LOG_TRACE("Group keys can not be normalized. Hash them.");
+    std::unique_ptr<AbstractAggregator> aggregator(
+        CreateAggregator(tiles[0].get()));
+    if (nullptr == aggregator.get()) return false;
+    for (auto &tile : tiles) {
+      if (aggregator->AdvanceTile(tile.get()) == false) return false;
+    }
+    aggregators.push_back(std::move(aggregator));
+    return true;
+  }
+
+  // Payload: tile in the high 32 bits, row in the low ones
+  std::vector<util::sort_key64_type> keys(count);
+  std::vector<util::sort_payload_type> payloads(count);
+  size_t offset = 0;
+  for (size_t tile_itr = 0; tile_itr < tiles.size(); tile_itr++) {
+    auto tile = tiles[tile_itr].get();
+    for (oid_t row : *tile) {
+      util::sort_key64_type key = 0;
+      for (size_t key_itr = 0; key_itr < group_by_col_ids.size(); key_itr++) {
+        key = key_normalizer->AddColumn(
+            key, key_itr, tile->GetValue(row, group_by_col_ids[key_itr]));
+      }
+      keys[offset] = key;
+      payloads[offset++] =
+          (static_cast<util::sort_payload_type>(tile_itr) << 32) | row;
+    }
+  }
+  util::simd_sort_pairs64(keys.data(), payloads.data(), count);
+
+  // The normalized keys are exact, so a group starts where the key changes.
+  // Value inequality would never split off the group of a null key.
+  LOG_TRACE("Use SortedAggregator over the sorted rows");
+  std::unique_ptr<SortedAggregator> aggregator(new SortedAggregator(
+      &node, output_table, executor_context_, tiles[0]->GetColumnCount()));
+  for (size_t entry_itr = 0; entry_itr < count; entry_itr++) {
+    auto payload = payloads[entry_itr];
+    expression::ContainerTuple<LogicalTile> tuple(
+        tiles[static_cast<size_t>(payload >> 32)].get(),
+        static_cast<oid_t>(payload));
+    bool starts_group =
+        (entry_itr == 0 || keys[entry_itr] != keys[entry_itr - 1]);
+    if (aggregator->AdvanceGroup(&tuple, starts_group) == false) return false;
+  }
+
+  aggregators.push_back(std::move(aggregator));
+  return true;
+}
+
 /**
  * @brief Creates logical tile(s) wrapping the results of aggregation.
  * @return true on success, false otherwise.
@@ -96,52 +313,49 @@ bool AggregateExecutor::DExecute() {
   // Grab info from plan node
   const planner::AggregatePlan &node = GetPlanNode<planner::AggregatePlan>();
 
-  // Get an aggregator
-  std::unique_ptr<AbstractAggregator> aggregator(nullptr);
-
-  // Get input tiles and aggregate them
-  while (children_[0]->Execute() == true) {
-    std::unique_ptr<LogicalTile> tile(children_[0]->GetOutput());
-
-    if (nullptr == aggregator.get()) {
-      // Initialize the aggregator
-      switch (node.GetAggregateStrategy()) {
-        case AGGREGATE_TYPE_HASH:
-          LOG_TRACE("Use HashAggregator");
-          aggregator.reset(new HashAggregator(
-              &node, output_table, executor_context_, tile->GetColumnCount()));
-          break;
-        case AGGREGATE_TYPE_SORTED:
-          LOG_TRACE("Use SortedAggregator");
-          aggregator.reset(new SortedAggregator(
-              &node, output_table, executor_context_, tile->GetColumnCount()));
-          break;
-        case AGGREGATE_TYPE_PLAIN:
-          LOG_TRACE("Use PlainAggregator");
-          aggregator.reset(
-              new PlainAggregator(&node, output_table, executor_context_));
-          break;
-        default:
-          LOG_ERROR("Invalid aggregate type. Return.");
-          return false;
-      }
+  // Aggregate the input tiles
+  std::vector<std::unique_ptr<AbstractAggregator>> aggregators;
+  bool sort_aggregation =
+      (node.GetAggregateStrategy() == AGGREGATE_TYPE_HASH) &&
+      (sort_aggregation_ ||
+       node.GetEstimatedGroupCount() >= SORT_AGGREGATION_MIN_GROUPS);
+  if (sort_aggregation) {
+    if (AggregateSorted(aggregators) == false) {
+      return false;
     }
+  } else if (aggregate_thread_count_ > 1 &&
+      node.GetAggregateStrategy() != AGGREGATE_TYPE_SORTED) {
+    if (AggregateInParallel(aggregators) == false) {
+      return false;
+    }
+  } else {
+    std::unique_ptr<AbstractAggregator> aggregator(nullptr);
+    while (children_[0]->Execute() == true) {
+      std::unique_ptr<LogicalTile> tile(children_[0]->GetOutput());
+
+      if (nullptr == aggregator.get()) {
+        aggregator.reset(CreateAggregator(tile.get()));
+        if (nullptr == aggregator.get()) return false;
+      }
 
-    LOG_TRACE("Looping over tile..");
-
-    for (oid_t tuple_id : *tile) {
-      std::unique_ptr<expression::ContainerTuple<LogicalTile>> cur_tuple(
-          new expression::ContainerTuple<LogicalTile>(tile.get(), tuple_id));
+      LOG_TRACE("Looping over tile..");
 
-      if (aggregator->Advance(cur_tuple.get()) == false) {
+      if (aggregator->AdvanceTile(tile.get()) == false) {
         return false;
       }
+      LOG_TRACE("Finished processing logical tile");
+    }
+    if (aggregator.get() != nullptr) {
+      aggregators.push_back(std::move(aggregator));
     }
-    LOG_TRACE("Finished processing logical tile");
   }
 
   LOG_TRACE("Finalizing..");
-  if (!aggregator.get() || !aggregator->Finalize()) {
+  bool finalized = (aggregators.empty() == false);
+  for (auto &aggregator : aggregators) {
+    if (finalized) finalized = aggregator->Finalize();
+  }
+  if (!finalized) {
     // If there's no tuples and no group-by, count() aggregations should return
     // 0 according to the test in MySQL.
     // TODO: We only checked whether all AggTerms are counts here. If there're
@@ -158,7 +372,7 @@ bool AggregateExecutor::DExecute() {
     // query,
     // we should return a NULL tuple
     // this is required by SQL
-    if (!aggregator.get() && node.GetGroupbyColIds().empty()) {
+    if (aggregators.empty() && node.GetGroupbyColIds().empty()) {
       LOG_TRACE(
           "No tuples received and no group-by. Should insert a NULL tuple "
           "here.");
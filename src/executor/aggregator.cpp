@@ -11,10 +11,13 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
 #include <set>
 
 #include "executor/aggregator.h"
 #include "executor/executor_context.h"
+#include "executor/logical_tile.h"
+#include "expression/tuple_value_expression.h"
 #include "common/logger.h"
 #include "storage/data_table.h"
 #include "concurrency/transaction_manager_factory.h"
@@ -74,6 +77,16 @@ void Agg::Advance(const common::Value val) {
   }
 }
 
+void Agg::Merge(const Agg &other) {
+  if (is_distinct_) {
+    for (auto &val : other.distinct_set_) {
+      distinct_set_.insert(val.Copy());
+    }
+  } else {
+    DMerge(other);
+  }
+}
+
 common::Value Agg::Finalize() {
   if (is_distinct_) {
     for (auto val : distinct_set_) {
@@ -84,35 +97,17 @@ common::Value Agg::Finalize() {
 }
 
 /*
- * Helper method responsible for inserting the results of the aggregation
- * into a new tuple in the output tile group as well as passing through any
- * additional columns from the input tile group.
- *
- * Output tuple is projected from two tuples:
- * Left is the 'delegate' tuple, which is usually the first tuple in the group,
- * used to retrieve pass-through values;
- * Right is the tuple holding all aggregated values.
+ * Insert the output tuple of a group, given its aggregated values, into the
+ * output table, unless it fails the filter predicate. See Helper().
  */
-bool Helper(const planner::AggregatePlan *node, Agg **aggregates,
-            storage::DataTable *output_table,
-            const AbstractTuple *delegate_tuple,
-            executor::ExecutorContext *econtext) {
+bool InsertAggregateTuple(const planner::AggregatePlan *node,
+                          std::vector<common::Value> &aggregate_values,
+                          storage::DataTable *output_table,
+                          const AbstractTuple *delegate_tuple,
+                          executor::ExecutorContext *econtext) {
   auto schema = output_table->GetSchema();
   std::unique_ptr<storage::Tuple> tuple(new storage::Tuple(schema, true));
 
-  /*
-   * 1) Construct a vector of aggregated values
-   */
-  std::vector<common::Value> aggregate_values;
-  auto &aggregate_terms = node->GetUniqueAggTerms();
-  for (oid_t column_itr = 0; column_itr < aggregate_terms.size();
-       column_itr++) {
-    if (aggregates[column_itr] != nullptr) {
-      common::Value final_val = aggregates[column_itr]->Finalize();
-      aggregate_values.push_back(final_val);
-    }
-  }
-
   /*
    * 2) Evaluate filter predicate;
    * if fail, just return
@@ -147,6 +142,45 @@ bool Helper(const planner::AggregatePlan *node, Agg **aggregates,
   return true;
 }
 
+/*
+ * Helper method responsible for inserting the results of the aggregation
+ * into a new tuple in the output tile group as well as passing through any
+ * additional columns from the input tile group.
+ *
+ * Output tuple is projected from two tuples:
+ * Left is the 'delegate' tuple, which is usually the first tuple in the group,
+ * used to retrieve pass-through values;
+ * Right is the tuple holding all aggregated values.
+ */
+bool Helper(const planner::AggregatePlan *node, Agg **aggregates,
+            storage::DataTable *output_table,
+            const AbstractTuple *delegate_tuple,
+            executor::ExecutorContext *econtext) {
+  /*
+   * 1) Construct a vector of aggregated values
+   */
+  std::vector<common::Value> aggregate_values;
+  auto &aggregate_terms = node->GetUniqueAggTerms();
+  for (oid_t column_itr = 0; column_itr < aggregate_terms.size();
+       column_itr++) {
+    if (aggregates[column_itr] != nullptr) {
+      common::Value final_val = aggregates[column_itr]->Finalize();
+      aggregate_values.push_back(final_val);
+    }
+  }
+
+  return InsertAggregateTuple(node, aggregate_values, output_table,
+                              delegate_tuple, econtext);
+}
+
+bool AbstractAggregator::AdvanceTile(LogicalTile *tile) {
+  for (oid_t tuple_id : *tile) {
+    expression::ContainerTuple<LogicalTile> cur_tuple(tile, tuple_id);
+    if (Advance(&cur_tuple) == false) return false;
+  }
+  return true;
+}
+
 //===--------------------------------------------------------------------===//
 // Hash Aggregator
 //===--------------------------------------------------------------------===//
@@ -188,26 +222,13 @@ bool HashAggregator::Advance(AbstractTuple *cur_tuple) {
   // Group not found. Make a new entry in the hash for this new group.
   if (map_itr == aggregates_map.end()) {
     LOG_TRACE("Group-by key not found. Start a new group.");
-    // Allocate new aggregate list
-    aggregate_list = new AggregateList();
-    aggregate_list->aggregates = new Agg *[node->GetUniqueAggTerms().size()];
     // Make a deep copy of the first tuple we meet
+    std::vector<common::Value> first_tuple_values;
     for (size_t col_id = 0; col_id < num_input_columns; col_id++) {
-      // first_tuple_values has the ownership
-      aggregate_list->first_tuple_values.push_back(
-          cur_tuple->GetValue(col_id));
+      first_tuple_values.push_back(cur_tuple->GetValue(col_id));
     };
 
-    for (oid_t aggno = 0; aggno < node->GetUniqueAggTerms().size(); aggno++) {
-      aggregate_list->aggregates[aggno] =
-          GetAggInstance(node->GetUniqueAggTerms()[aggno].aggtype);
-
-      bool distinct = node->GetUniqueAggTerms()[aggno].distinct;
-      aggregate_list->aggregates[aggno]->SetDistinct(distinct);
-    }
-
-    aggregates_map.insert(
-        HashAggregateMapType::value_type(group_by_key_values, aggregate_list));
+    aggregate_list = AddGroup(group_by_key_values, first_tuple_values);
   }
   // Otherwise, the list is the second item of the pair.
   else {
@@ -230,6 +251,53 @@ bool HashAggregator::Advance(AbstractTuple *cur_tuple) {
   return true;
 }
 
+/**
+ * @brief Add a group with new aggregates to the hash table.
+ */
+HashAggregator::AggregateList *HashAggregator::AddGroup(
+    const std::vector<common::Value> &key,
+    const std::vector<common::Value> &first_tuple_values) {
+  // Allocate new aggregate list
+  auto aggregate_list = new AggregateList();
+  aggregate_list->aggregates = new Agg *[node->GetUniqueAggTerms().size()];
+  // first_tuple_values has the ownership
+  aggregate_list->first_tuple_values = first_tuple_values;
+
+  for (oid_t aggno = 0; aggno < node->GetUniqueAggTerms().size(); aggno++) {
+    aggregate_list->aggregates[aggno] =
+        GetAggInstance(node->GetUniqueAggTerms()[aggno].aggtype);
+
+    bool distinct = node->GetUniqueAggTerms()[aggno].distinct;
+    aggregate_list->aggregates[aggno]->SetDistinct(distinct);
+  }
+
+  aggregates_map.insert(HashAggregateMapType::value_type(key, aggregate_list));
+  return aggregate_list;
+}
+
+bool HashAggregator::Merge(const AbstractAggregator &other,
+                           size_t partition_itr, size_t partition_count) {
+  auto &other_hash = static_cast<const HashAggregator &>(other);
+  ValueVectorHasher hasher;
+  for (auto &entry : other_hash.aggregates_map) {
+    if (hasher(entry.first) % partition_count != partition_itr) continue;
+
+    AggregateList *aggregate_list;
+    auto map_itr = aggregates_map.find(entry.first);
+    if (map_itr == aggregates_map.end()) {
+      aggregate_list = AddGroup(entry.first, entry.second->first_tuple_values);
+    } else {
+      aggregate_list = map_itr->second;
+    }
+
+    for (oid_t aggno = 0; aggno < node->GetUniqueAggTerms().size(); aggno++) {
+      aggregate_list->aggregates[aggno]->Merge(
+          *entry.second->aggregates[aggno]);
+    }
+  }
+  return true;
+}
+
 bool HashAggregator::Finalize() {
   for (auto entry : aggregates_map) {
     // Construct a container for the first tuple
@@ -243,6 +311,410 @@ bool HashAggregator::Finalize() {
   return true;
 }
 
+//===--------------------------------------------------------------------===//
+// Flat Hash Aggregator
+//===--------------------------------------------------------------------===//
+
+namespace {
+
+int64_t PeekInteger(const common::Value &value, common::Type::TypeId type_id) {
+  switch (type_id) {
+    case common::Type::TINYINT:
+      return value.GetAs<int8_t>();
+    case common::Type::SMALLINT:
+      return value.GetAs<int16_t>();
+    case common::Type::INTEGER:
+      return value.GetAs<int32_t>();
+    default:
+      return value.GetAs<int64_t>();
+  }
+}
+
+/** Throw like the sum of two Values would, if value is out of the range of
+ * the type */
+void CheckIntegerRange(int64_t value, common::Type::TypeId type_id) {
+  bool in_range;
+  switch (type_id) {
+    case common::Type::TINYINT:
+      in_range = (value == int8_t(value));
+      break;
+    case common::Type::SMALLINT:
+      in_range = (value == int16_t(value));
+      break;
+    case common::Type::INTEGER:
+      in_range = (value == int32_t(value));
+      break;
+    default:
+      in_range = true;
+      break;
+  }
+  if (in_range == false) {
+    throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE, "Numeric value out of range.");
+  }
+}
+
+common::Value GetIntegerValue(int64_t value, common::Type::TypeId type_id) {
+  switch (type_id) {
+    case common::Type::TINYINT:
+      return common::ValueFactory::GetTinyIntValue(value);
+    case common::Type::SMALLINT:
+      return common::ValueFactory::GetSmallIntValue(value);
+    case common::Type::INTEGER:
+      return common::ValueFactory::GetIntegerValue(value);
+    default:
+      return common::ValueFactory::GetBigIntValue(value);
+  }
+}
+
+}  // namespace
+
+FlatHashAggregator::FlatHashAggregator(
+    const planner::AggregatePlan *node, storage::DataTable *output_table,
+    executor::ExecutorContext *econtext,
+    const std::vector<common::Type::TypeId> &input_types)
+    : AbstractAggregator(node, output_table, econtext),
+      num_input_columns_(input_types.size()),
+      key_normalizer_(
+          [&] {
+            std::vector<common::Type::TypeId> key_types;
+            for (auto column_id : node->GetGroupbyColIds()) {
+              key_types.push_back(input_types[column_id]);
+            }
+            return key_types;
+          }(),
+          std::vector<bool>(node->GetGroupbyColIds().size(), false)) {
+  PL_ASSERT(CanAggregate(node, input_types));
+
+  for (auto &agg_term : node->GetUniqueAggTerms()) {
+    if (agg_term.expression == nullptr) {
+      agg_input_columns_.push_back(INVALID_OID);
+      agg_input_types_.push_back(common::Type::INVALID);
+      continue;
+    }
+    auto tuple_value =
+        reinterpret_cast<const expression::TupleValueExpression *>(
+            agg_term.expression);
+    agg_input_columns_.push_back(tuple_value->GetColumnId());
+    agg_input_types_.push_back(input_types[tuple_value->GetColumnId()]);
+  }
+}
+
+bool FlatHashAggregator::CanAggregate(
+    const planner::AggregatePlan *node,
+    const std::vector<common::Type::TypeId> &input_types) {
+  // The packed keys have to be exact to tell the groups apart
+  size_t key_bits = 0;
+  std::vector<common::Type::TypeId> key_types;
+  for (auto column_id : node->GetGroupbyColIds()) {
+    if (column_id >= input_types.size()) return false;
+    key_types.push_back(input_types[column_id]);
+    key_bits += util::SortKeyNormalizer::GetColumnBits(input_types[column_id]);
+  }
+  if (!util::SortKeyNormalizer::CanNormalize(key_types) || key_bits > 64) {
+    return false;
+  }
+
+  for (auto &agg_term : node->GetUniqueAggTerms()) {
+    if (agg_term.distinct) return false;
+
+    bool is_count = (agg_term.aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT ||
+                     agg_term.aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT_STAR);
+    switch (agg_term.aggtype) {
+      case EXPRESSION_TYPE_AGGREGATE_COUNT:
+      case EXPRESSION_TYPE_AGGREGATE_COUNT_STAR:
+      case EXPRESSION_TYPE_AGGREGATE_SUM:
+      case EXPRESSION_TYPE_AGGREGATE_AVG:
+      case EXPRESSION_TYPE_AGGREGATE_MIN:
+      case EXPRESSION_TYPE_AGGREGATE_MAX:
+        break;
+      default:
+        return false;
+    }
+
+    // Without an expression every value is 1, which only counts get right
+    auto expression = agg_term.expression;
+    if (expression == nullptr) {
+      if (is_count) continue;
+      return false;
+    }
+    if (expression->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) {
+      return false;
+    }
+    auto tuple_value =
+        reinterpret_cast<const expression::TupleValueExpression *>(expression);
+    if (tuple_value->GetTupleId() != 0 ||
+        static_cast<size_t>(tuple_value->GetColumnId()) >= input_types.size()) {
+      return false;
+    }
+
+    auto type_id = input_types[tuple_value->GetColumnId()];
+    if (!is_count && !common::Type::IsIntegerType(type_id) &&
+        type_id != common::Type::DECIMAL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Look up the group of a packed key, or add a new group with the
+ * values of tuple as its first tuple.
+ */
+template <typename Tuple>
+uint32_t FlatHashAggregator::FindOrAddGroup(uint64_t key, const Tuple &tuple) {
+  uint32_t group_count = static_cast<uint32_t>(group_keys_.size());
+  auto result = group_table_.FindOrInsert(
+      util::MixHash(key),
+      [this, key](uint32_t group) { return group_keys_[group] == key; },
+      group_count);
+  if (result.second == false) return *result.first;
+
+  LOG_TRACE("Group-by key not found. Start a new group.");
+  group_keys_.push_back(key);
+  for (oid_t col_id = 0; col_id < num_input_columns_; col_id++) {
+    group_tuple_values_.push_back(tuple.GetValue(col_id));
+  }
+  AggregateState state;
+  state.int_value = 0;
+  state.count = 0;
+  states_.resize(states_.size() + agg_input_columns_.size(), state);
+  return group_count;
+}
+
+bool FlatHashAggregator::Advance(AbstractTuple *next_tuple) {
+  auto &group_by_col_ids = node->GetGroupbyColIds();
+  uint64_t key = 0;
+  for (size_t key_itr = 0; key_itr < group_by_col_ids.size(); key_itr++) {
+    key = key_normalizer_.AddColumn(
+        key, key_itr, next_tuple->GetValue(group_by_col_ids[key_itr]));
+  }
+  uint32_t group = FindOrAddGroup(key, *next_tuple);
+
+  for (size_t aggno = 0; aggno < agg_input_columns_.size(); aggno++) {
+    auto column_id = agg_input_columns_[aggno];
+    if (column_id == INVALID_OID) {
+      GetState(group, aggno).count++;
+    } else {
+      AdvanceState(aggno, GetState(group, aggno),
+                   next_tuple->GetValue(column_id));
+    }
+  }
+  return true;
+}
+
+bool FlatHashAggregator::AdvanceTile(LogicalTile *tile) {
+  std::vector<oid_t> rows;
+  rows.reserve(tile->GetTupleCount());
+  for (oid_t tuple_id : *tile) {
+    rows.push_back(tuple_id);
+  }
+
+  // Pack the keys one column at a time
+  auto &group_by_col_ids = node->GetGroupbyColIds();
+  std::vector<uint64_t> keys(rows.size(), 0);
+  for (size_t key_itr = 0; key_itr < group_by_col_ids.size(); key_itr++) {
+    for (size_t row_itr = 0; row_itr < rows.size(); row_itr++) {
+      keys[row_itr] = key_normalizer_.AddColumn(
+          keys[row_itr], key_itr,
+          tile->GetValue(rows[row_itr], group_by_col_ids[key_itr]));
+    }
+  }
+
+  std::vector<uint32_t> groups(rows.size());
+  for (size_t row_itr = 0; row_itr < rows.size(); row_itr++) {
+    expression::ContainerTuple<LogicalTile> tuple(tile, rows[row_itr]);
+    groups[row_itr] = FindOrAddGroup(keys[row_itr], tuple);
+  }
+
+  // Update one aggregate at a time
+  for (size_t aggno = 0; aggno < agg_input_columns_.size(); aggno++) {
+    auto column_id = agg_input_columns_[aggno];
+    if (column_id == INVALID_OID) {
+      for (size_t row_itr = 0; row_itr < rows.size(); row_itr++) {
+        GetState(groups[row_itr], aggno).count++;
+      }
+      continue;
+    }
+    for (size_t row_itr = 0; row_itr < rows.size(); row_itr++) {
+      AdvanceState(aggno, GetState(groups[row_itr], aggno),
+                   tile->GetValue(rows[row_itr], column_id));
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Aggregate a value like the Agg of the aggregate would.
+ */
+void FlatHashAggregator::AdvanceState(size_t aggno, AggregateState &state,
+                                      const common::Value &value) const {
+  auto aggtype = node->GetUniqueAggTerms()[aggno].aggtype;
+  if (aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT_STAR) {
+    state.count++;
+    return;
+  }
+  if (value.IsNull()) return;
+
+  auto type_id = agg_input_types_[aggno];
+  bool first = (state.count == 0);
+  state.count++;
+  if (aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT) return;
+
+  if (type_id == common::Type::DECIMAL) {
+    double number = value.GetAs<double>();
+    if (first) {
+      state.double_value = number;
+    } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MIN) {
+      state.double_value = std::min(state.double_value, number);
+    } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MAX) {
+      state.double_value = std::max(state.double_value, number);
+    } else {
+      state.double_value += number;
+    }
+    return;
+  }
+
+  int64_t number = PeekInteger(value, type_id);
+  if (first) {
+    state.int_value = number;
+  } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MIN) {
+    state.int_value = std::min(state.int_value, number);
+  } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MAX) {
+    state.int_value = std::max(state.int_value, number);
+  } else {
+    // Sums stay in the type of their values, as with Value::Add()
+    int64_t sum;
+    if (__builtin_add_overflow(state.int_value, number, &sum)) {
+      throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                      "Numeric value out of range.");
+    }
+    CheckIntegerRange(sum, type_id);
+    state.int_value = sum;
+  }
+}
+
+bool FlatHashAggregator::Merge(const AbstractAggregator &other,
+                               size_t partition_itr, size_t partition_count) {
+  auto &other_flat = static_cast<const FlatHashAggregator &>(other);
+  std::vector<common::Value> first_tuple_values(num_input_columns_);
+  expression::ContainerTuple<std::vector<common::Value>> first_tuple(
+      &first_tuple_values);
+
+  for (uint32_t other_group = 0; other_group < other_flat.group_keys_.size();
+       other_group++) {
+    uint64_t key = other_flat.group_keys_[other_group];
+    if (util::MixHash(key) % partition_count != partition_itr) continue;
+
+    auto values_begin = other_flat.group_tuple_values_.begin() +
+                        other_group * num_input_columns_;
+    std::copy(values_begin, values_begin + num_input_columns_,
+              first_tuple_values.begin());
+    uint32_t group = FindOrAddGroup(key, first_tuple);
+
+    for (size_t aggno = 0; aggno < agg_input_columns_.size(); aggno++) {
+      MergeState(aggno, GetState(group, aggno),
+                 other_flat.GetState(other_group, aggno));
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Merge the state of the same aggregate over other tuples.
+ */
+void FlatHashAggregator::MergeState(size_t aggno, AggregateState &state,
+                                    const AggregateState &other_state) const {
+  if (other_state.count == 0) return;
+
+  auto aggtype = node->GetUniqueAggTerms()[aggno].aggtype;
+  bool first = (state.count == 0);
+  state.count += other_state.count;
+  if (aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT ||
+      aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT_STAR) {
+    return;
+  }
+
+  auto type_id = agg_input_types_[aggno];
+  if (type_id == common::Type::DECIMAL) {
+    double number = other_state.double_value;
+    if (first) {
+      state.double_value = number;
+    } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MIN) {
+      state.double_value = std::min(state.double_value, number);
+    } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MAX) {
+      state.double_value = std::max(state.double_value, number);
+    } else {
+      state.double_value += number;
+    }
+    return;
+  }
+
+  int64_t number = other_state.int_value;
+  if (first) {
+    state.int_value = number;
+  } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MIN) {
+    state.int_value = std::min(state.int_value, number);
+  } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_MAX) {
+    state.int_value = std::max(state.int_value, number);
+  } else {
+    int64_t sum;
+    if (__builtin_add_overflow(state.int_value, number, &sum)) {
+      throw Exception(EXCEPTION_TYPE_OUT_OF_RANGE,
+                      "Numeric value out of range.");
+    }
+    CheckIntegerRange(sum, type_id);
+    state.int_value = sum;
+  }
+}
+
+common::Value FlatHashAggregator::FinalizeState(
+    size_t aggno, const AggregateState &state) const {
+  auto aggtype = node->GetUniqueAggTerms()[aggno].aggtype;
+  if (aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT ||
+      aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT_STAR) {
+    return common::ValueFactory::GetBigIntValue(state.count);
+  }
+  if (state.count == 0) {
+    return common::ValueFactory::GetNullValueByType(common::Type::INTEGER);
+  }
+
+  auto type_id = agg_input_types_[aggno];
+  bool is_decimal = (type_id == common::Type::DECIMAL);
+  if (aggtype == EXPRESSION_TYPE_AGGREGATE_AVG) {
+    double sum = is_decimal ? state.double_value
+                            : static_cast<double>(state.int_value);
+    return common::ValueFactory::GetDoubleValue(
+        sum / static_cast<double>(state.count));
+  }
+  if (is_decimal) {
+    return common::ValueFactory::GetDoubleValue(state.double_value);
+  }
+  return GetIntegerValue(state.int_value, type_id);
+}
+
+bool FlatHashAggregator::Finalize() {
+  std::vector<common::Value> first_tuple_values(num_input_columns_);
+  expression::ContainerTuple<std::vector<common::Value>> first_tuple(
+      &first_tuple_values);
+  std::vector<common::Value> aggregate_values;
+
+  for (uint32_t group = 0; group < group_keys_.size(); group++) {
+    std::copy(group_tuple_values_.begin() + group * num_input_columns_,
+              group_tuple_values_.begin() + (group + 1) * num_input_columns_,
+              first_tuple_values.begin());
+
+    aggregate_values.clear();
+    for (size_t aggno = 0; aggno < agg_input_columns_.size(); aggno++) {
+      aggregate_values.push_back(FinalizeState(aggno, GetState(group, aggno)));
+    }
+    if (InsertAggregateTuple(node, aggregate_values, output_table,
+                             &first_tuple, this->executor_context) == false) {
+      return false;
+    }
+  }
+  return true;
+}
+
 //===--------------------------------------------------------------------===//
 // Sort Aggregator
 //===--------------------------------------------------------------------===//
@@ -290,21 +762,26 @@ bool SortedAggregator::Advance(AbstractTuple *next_tuple) {
 
       if (not_equal) {
         LOG_TRACE("Group-by columns changed.");
-
-        // Call helper to output the current group result
-        if (!Helper(node, aggregates, output_table, &delegate_tuple_,
-                    this->executor_context)) {
-          return false;
-        }
-
         start_new_agg = true;
         break;
       }
     }
   }
 
+  return AdvanceGroup(next_tuple, start_new_agg);
+}
+
+bool SortedAggregator::AdvanceGroup(AbstractTuple *next_tuple,
+                                    bool starts_group) {
   // If we have started a new aggregate tuple
-  if (start_new_agg) {
+  if (starts_group || delegate_tuple_values_.empty()) {
+    // Call helper to output the current group result
+    if (!delegate_tuple_values_.empty() &&
+        !Helper(node, aggregates, output_table, &delegate_tuple_,
+                this->executor_context)) {
+      return false;
+    }
+
     LOG_TRACE("Started a new group!");
 
     // Create aggregate
@@ -391,6 +868,19 @@ bool PlainAggregator::Advance(AbstractTuple *next_tuple) {
   return true;
 }
 
+bool PlainAggregator::Merge(const AbstractAggregator &other,
+                            size_t partition_itr,
+                            size_t partition_count UNUSED_ATTRIBUTE) {
+  // The single group is in the first partition
+  if (partition_itr != 0) return true;
+
+  auto &other_plain = static_cast<const PlainAggregator &>(other);
+  for (oid_t aggno = 0; aggno < node->GetUniqueAggTerms().size(); aggno++) {
+    aggregates[aggno]->Merge(*other_plain.aggregates[aggno]);
+  }
+  return true;
+}
+
 bool PlainAggregator::Finalize() {
   if (!Helper(node, aggregates, output_table, nullptr,
               this->executor_context)) {
@@ -0,0 +1,335 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// band_join_executor.cpp
+//
+// Identification: src/executor/band_join_executor.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "common/logger.h"
+#include "executor/band_join_executor.h"
+#include "expression/abstract_expression.h"
+#include "expression/tuple_value_expression.h"
+
+namespace peloton {
+namespace executor {
+
+namespace {
+
+bool IsTupleValue(const expression::AbstractExpression *expr, int tuple_idx) {
+  return expr->GetExpressionType() == EXPRESSION_TYPE_VALUE_TUPLE &&
+         static_cast<const expression::TupleValueExpression *>(expr)
+                 ->GetTupleId() == tuple_idx;
+}
+
+}  // namespace
+
+BandJoinExecutor::BandJoinExecutor(const planner::AbstractPlan *node,
+                                   ExecutorContext *executor_context)
+    : AbstractJoinExecutor(node, executor_context) {}
+
+bool BandJoinExecutor::DInit() {
+  auto status = AbstractJoinExecutor::DInit();
+  if (status == false) return status;
+
+  const planner::BandJoinPlan &node = GetPlanNode<planner::BandJoinPlan>();
+
+  band_clause_ = node.GetBandClause();
+  if (band_clause_ == nullptr || band_clause_->left_ == nullptr) return false;
+
+  InitKeyNormalizer();
+
+  left_sorted_ = false;
+  left_rows_.clear();
+  left_keys_.clear();
+  left_key_values_.clear();
+  buffered_output_tiles_.clear();
+
+  return true;
+}
+
+/**
+ * @brief Buffer and sort the left child on the first call, then probe one
+ * right tile at a time until an output tile is ready. The unmatched rows of
+ * outer joins are returned after the right child is done.
+ * @return true on success, false otherwise.
+ */
+bool BandJoinExecutor::DExecute() {
+  LOG_TRACE("********** Band Join executor :: 2 children ");
+
+  if (left_sorted_ == false) {
+    while (children_[0]->Execute()) {
+      BufferLeftTile(children_[0]->GetOutput());
+    }
+    left_child_done_ = true;
+
+    SortLeftRows();
+    left_sorted_ = true;
+
+    // Without left rows only the unmatched right rows are left to output
+    if (left_rows_.empty() && join_type_ != JOIN_TYPE_RIGHT &&
+        join_type_ != JOIN_TYPE_OUTER) {
+      right_child_done_ = true;
+    }
+  }
+
+  while (buffered_output_tiles_.empty()) {
+    if (right_child_done_) return BuildOuterJoinOutput();
+
+    if (children_[1]->Execute() == false) {
+      right_child_done_ = true;
+      continue;
+    }
+    BufferRightTile(children_[1]->GetOutput());
+    ProbeRightTile(right_result_tiles_.size() - 1);
+  }
+
+  SetOutput(buffered_output_tiles_.front().release());
+  buffered_output_tiles_.pop_front();
+  return true;
+}
+
+/**
+ * @brief Normalize the keys into integers if the key and the bounds are
+ * columns of the left and the right tuple of the same fixed-width type.
+ * Otherwise the keys are compared as values.
+ */
+void BandJoinExecutor::InitKeyNormalizer() {
+  key_normalizer_.reset();
+
+  auto left_expr = band_clause_->left_.get();
+  if (!IsTupleValue(left_expr, 0)) return;
+  auto key_type = left_expr->GetValueType();
+
+  for (auto bound_expr :
+       {band_clause_->lower_.get(), band_clause_->upper_.get()}) {
+    if (bound_expr == nullptr) continue;
+    if (!IsTupleValue(bound_expr, 1) ||
+        bound_expr->GetValueType() != key_type) {
+      return;
+    }
+  }
+
+  std::vector<common::Type::TypeId> key_types = {key_type};
+  if (!util::SortKeyNormalizer::CanNormalize(key_types)) return;
+
+  key_normalizer_.reset(
+      new util::SortKeyNormalizer(key_types, std::vector<bool>({false})));
+  if (!key_normalizer_->IsExact()) key_normalizer_.reset();
+}
+
+/**
+ * @brief Fill left_rows_ with the rows of the buffered left tiles, sorted on
+ * their keys. Rows with a null key never match, so they are left out.
+ */
+void BandJoinExecutor::SortLeftRows() {
+  left_rows_.clear();
+  left_keys_.clear();
+  left_key_values_.clear();
+
+  if (SortNormalizedLeftRows()) return;
+
+  std::vector<RowPosition> rows;
+  std::vector<common::Value> values;
+  for (size_t tile_itr = 0; tile_itr < left_result_tiles_.size(); tile_itr++) {
+    auto tile = left_result_tiles_[tile_itr].get();
+    for (oid_t row : *tile) {
+      expression::ContainerTuple<LogicalTile> tuple(tile, row);
+      auto value =
+          band_clause_->left_->Evaluate(&tuple, &tuple, executor_context_);
+      if (value.IsNull()) continue;
+      rows.emplace_back(tile_itr, row);
+      values.push_back(value);
+    }
+  }
+
+  std::vector<size_t> order(rows.size());
+  for (size_t row_itr = 0; row_itr < order.size(); row_itr++) {
+    order[row_itr] = row_itr;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&values](size_t a, size_t b) {
+                     return values[a].CompareLessThan(values[b]).IsTrue();
+                   });
+
+  left_rows_.reserve(rows.size());
+  left_key_values_.reserve(rows.size());
+  for (auto row_itr : order) {
+    left_rows_.push_back(rows[row_itr]);
+    left_key_values_.push_back(values[row_itr]);
+  }
+
+  LOG_TRACE("Sorted %lu left rows on their key values", left_rows_.size());
+}
+
+/**
+ * @brief Sort the normalized keys of the left rows together with their
+ * encoded row positions with the SIMD merge sort.
+ * @return false if the keys can not be normalized
+ */
+bool BandJoinExecutor::SortNormalizedLeftRows() {
+  if (key_normalizer_ == nullptr) return false;
+
+  auto key_expr = static_cast<const expression::TupleValueExpression *>(
+      band_clause_->left_.get());
+  auto key_column = key_expr->GetColumnId();
+
+  size_t count = 0;
+  for (auto &tile : left_result_tiles_) {
+    count += tile->GetTupleCount();
+  }
+  if (count == 0) return true;
+
+  // Payload: tile in the high 32 bits, row in the low ones
+  std::vector<util::sort_key64_type> keys;
+  std::vector<util::sort_payload_type> payloads;
+  keys.reserve(count);
+  payloads.reserve(count);
+  for (size_t tile_itr = 0; tile_itr < left_result_tiles_.size(); tile_itr++) {
+    auto tile = left_result_tiles_[tile_itr].get();
+    for (oid_t row : *tile) {
+      auto value = tile->GetValue(row, key_column);
+      if (value.IsNull()) continue;
+      if (value.GetTypeId() != key_expr->GetValueType()) {
+        key_normalizer_.reset();
+        return false;
+      }
+      keys.push_back(key_normalizer_->AddColumn(0, 0, value));
+      payloads.push_back(
+          (static_cast<util::sort_payload_type>(tile_itr) << 32) | row);
+    }
+  }
+  util::simd_sort_pairs64(keys.data(), payloads.data(), keys.size());
+
+  left_rows_.reserve(payloads.size());
+  for (auto payload : payloads) {
+    left_rows_.emplace_back(static_cast<size_t>(payload >> 32),
+                            static_cast<oid_t>(payload));
+  }
+  left_keys_ = std::move(keys);
+
+  LOG_TRACE("Sorted %lu normalized left keys", left_rows_.size());
+  return true;
+}
+
+/**
+ * @brief Join the rows of a right tile with the left rows in their bands.
+ * The matches are collected per left tile, since the position lists of an
+ * output tile refer to exactly one left and one right tile.
+ */
+void BandJoinExecutor::ProbeRightTile(size_t right_tile_itr) {
+  LogicalTile *right_tile = right_result_tiles_[right_tile_itr].get();
+  std::vector<std::unique_ptr<LogicalTile::PositionListsBuilder>>
+      pos_lists_builders(left_result_tiles_.size());
+
+  for (oid_t right_row : *right_tile) {
+    expression::ContainerTuple<LogicalTile> right_tuple(right_tile, right_row);
+
+    size_t begin, end;
+    if (FindBand(right_tuple, begin, end) == false) continue;
+
+    for (size_t left_itr = begin; left_itr < end; left_itr++) {
+      auto &left_row = left_rows_[left_itr];
+      LogicalTile *left_tile = left_result_tiles_[left_row.first].get();
+
+      if (predicate_ != nullptr) {
+        expression::ContainerTuple<LogicalTile> left_tuple(left_tile,
+                                                           left_row.second);
+        if (predicate_->Evaluate(&left_tuple, &right_tuple, executor_context_)
+                .IsFalse()) {
+          continue;
+        }
+      }
+
+      auto &pos_lists_builder = pos_lists_builders[left_row.first];
+      if (pos_lists_builder == nullptr) {
+        pos_lists_builder.reset(
+            new LogicalTile::PositionListsBuilder(left_tile, right_tile));
+      }
+      pos_lists_builder->AddRow(left_row.second, right_row);
+
+      RecordMatchedLeftRow(left_row.first, left_row.second);
+      RecordMatchedRightRow(right_tile_itr, right_row);
+    }
+  }
+
+  for (size_t left_tile_itr = 0; left_tile_itr < pos_lists_builders.size();
+       left_tile_itr++) {
+    auto &pos_lists_builder = pos_lists_builders[left_tile_itr];
+    if (pos_lists_builder == nullptr || pos_lists_builder->Size() == 0) {
+      continue;
+    }
+    auto output_tile = BuildOutputLogicalTile(
+        left_result_tiles_[left_tile_itr].get(), right_tile);
+    output_tile->SetPositionListsAndVisibility(pos_lists_builder->Release());
+    buffered_output_tiles_.push_back(std::move(output_tile));
+  }
+}
+
+/**
+ * @brief Find the range [begin, end) of left_rows_ whose keys are within the
+ * bounds of a right row.
+ * @return false if no left row can match, e.g., since a bound is null
+ */
+bool BandJoinExecutor::FindBand(
+    expression::ContainerTuple<LogicalTile> &right_tuple, size_t &begin,
+    size_t &end) {
+  begin = 0;
+  end = left_rows_.size();
+
+  if (band_clause_->lower_ != nullptr) {
+    auto lower = band_clause_->lower_->Evaluate(&right_tuple, &right_tuple,
+                                                executor_context_);
+    if (lower.IsNull()) return false;
+    begin = FindKeyBound(lower, !band_clause_->lower_inclusive_);
+  }
+
+  if (band_clause_->upper_ != nullptr) {
+    auto upper = band_clause_->upper_->Evaluate(&right_tuple, &right_tuple,
+                                                executor_context_);
+    if (upper.IsNull()) return false;
+    end = FindKeyBound(upper, band_clause_->upper_inclusive_);
+  }
+
+  return begin < end;
+}
+
+/**
+ * @brief Binary search a bound in the sorted left keys.
+ * @return the first position whose key is not less than value, or the first
+ * position whose key is greater than value if after_equal is set
+ */
+size_t BandJoinExecutor::FindKeyBound(const common::Value &value,
+                                      bool after_equal) const {
+  if (key_normalizer_ != nullptr) {
+    PL_ASSERT(left_keys_.size() == left_rows_.size());
+    auto key = key_normalizer_->AddColumn(0, 0, value);
+    auto bound = after_equal
+                     ? std::upper_bound(left_keys_.begin(), left_keys_.end(),
+                                        key)
+                     : std::lower_bound(left_keys_.begin(), left_keys_.end(),
+                                        key);
+    return bound - left_keys_.begin();
+  }
+
+  auto less = [](const common::Value &a, const common::Value &b) {
+    return a.CompareLessThan(b).IsTrue();
+  };
+  auto bound = after_equal
+                   ? std::upper_bound(left_key_values_.begin(),
+                                      left_key_values_.end(), value, less)
+                   : std::lower_bound(left_key_values_.begin(),
+                                      left_key_values_.end(), value, less);
+  return bound - left_key_values_.begin();
+}
+
+}  // namespace executor
+}  // namespace peloton
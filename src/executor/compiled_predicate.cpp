@@ -0,0 +1,508 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// compiled_predicate.cpp
+//
+// Identification: src/executor/compiled_predicate.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "executor/compiled_predicate.h"
+#include "expression/abstract_expression.h"
+#include "expression/constant_value_expression.h"
+#include "expression/expression_util.h"
+#include "expression/parameter_value_expression.h"
+#include "expression/tuple_value_expression.h"
+#include "storage/tile.h"
+#include "storage/tile_group.h"
+
+namespace peloton {
+namespace executor {
+
+namespace {
+
+/** The value a column is compared with, an integer unless either side is a
+ * decimal */
+union ScanValue {
+  int64_t integer;
+  double decimal;
+};
+
+/** Keep the selected tuples where the column at base + tuple * stride
+ * compares true with the value, and return how many are kept */
+typedef size_t (*ScanKernel)(const char *base, size_t stride, ScanValue value,
+                             oid_t *selection, size_t count);
+
+/** Keep the selected tuples where the left column compares true with the
+ * right column, and return how many are kept */
+typedef size_t (*ColumnPairKernel)(const char *left_base, size_t left_stride,
+                                   const char *right_base, size_t right_stride,
+                                   oid_t *selection, size_t count);
+
+bool IsCompiledType(common::Type::TypeId type) {
+  return type == common::Type::TINYINT || type == common::Type::SMALLINT ||
+         type == common::Type::INTEGER || type == common::Type::BIGINT ||
+         type == common::Type::DECIMAL;
+}
+
+//===--------------------------------------------------------------------===//
+// Scan kernels
+//===--------------------------------------------------------------------===//
+
+template <typename T>
+T GetNull();
+template <>
+int8_t GetNull<int8_t>() {
+  return common::PELOTON_INT8_NULL;
+}
+template <>
+int16_t GetNull<int16_t>() {
+  return common::PELOTON_INT16_NULL;
+}
+template <>
+int32_t GetNull<int32_t>() {
+  return common::PELOTON_INT32_NULL;
+}
+template <>
+int64_t GetNull<int64_t>() {
+  return common::PELOTON_INT64_NULL;
+}
+template <>
+double GetNull<double>() {
+  return common::PELOTON_DECIMAL_NULL;
+}
+
+template <typename T>
+T GetScanValue(ScanValue value);
+template <>
+int64_t GetScanValue<int64_t>(ScanValue value) {
+  return value.integer;
+}
+template <>
+double GetScanValue<double>(ScanValue value) {
+  return value.decimal;
+}
+
+template <ExpressionType CMP, typename T>
+inline bool Compare(T a, T b) {
+  switch (CMP) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return a == b;
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return a != b;
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return a < b;
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return a <= b;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return a > b;
+    default:
+      return a >= b;
+  }
+}
+
+/**
+ * @brief The scan loop of a column of type ColumnT that is compared as a
+ * ValueT. The position list is compacted in place without branches, the
+ * write position never passes the read position.
+ */
+template <typename ColumnT, typename ValueT, ExpressionType CMP>
+size_t ScanColumn(const char *base, size_t stride, ScanValue value,
+                  oid_t *selection, size_t count) {
+  const ValueT scan_value = GetScanValue<ValueT>(value);
+  const ColumnT null_value = GetNull<ColumnT>();
+
+  size_t selected_count = 0;
+  for (size_t itr = 0; itr < count; itr++) {
+    oid_t tuple_id = selection[itr];
+    ColumnT column_value =
+        *reinterpret_cast<const ColumnT *>(base + tuple_id * stride);
+    selection[selected_count] = tuple_id;
+    selected_count += (column_value != null_value) &
+                      Compare<CMP>(static_cast<ValueT>(column_value),
+                                   scan_value);
+  }
+  return selected_count;
+}
+
+template <typename ColumnT, ExpressionType CMP>
+size_t ScanColumnPair(const char *left_base, size_t left_stride,
+                      const char *right_base, size_t right_stride,
+                      oid_t *selection, size_t count) {
+  const ColumnT null_value = GetNull<ColumnT>();
+
+  size_t selected_count = 0;
+  for (size_t itr = 0; itr < count; itr++) {
+    oid_t tuple_id = selection[itr];
+    ColumnT left_value =
+        *reinterpret_cast<const ColumnT *>(left_base + tuple_id * left_stride);
+    ColumnT right_value = *reinterpret_cast<const ColumnT *>(
+        right_base + tuple_id * right_stride);
+    selection[selected_count] = tuple_id;
+    selected_count += (left_value != null_value) &
+                      (right_value != null_value) &
+                      Compare<CMP>(left_value, right_value);
+  }
+  return selected_count;
+}
+
+template <typename ColumnT, typename ValueT>
+ScanKernel GetScanKernel(ExpressionType compare_type) {
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return ScanColumn<ColumnT, ValueT, EXPRESSION_TYPE_COMPARE_EQUAL>;
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return ScanColumn<ColumnT, ValueT, EXPRESSION_TYPE_COMPARE_NOTEQUAL>;
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return ScanColumn<ColumnT, ValueT, EXPRESSION_TYPE_COMPARE_LESSTHAN>;
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return ScanColumn<ColumnT, ValueT,
+                        EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO>;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return ScanColumn<ColumnT, ValueT, EXPRESSION_TYPE_COMPARE_GREATERTHAN>;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+      return ScanColumn<ColumnT, ValueT,
+                        EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO>;
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * @brief The scan loop of a column type and a comparison. Integer columns
+ * are compared as decimals with decimal values, like Value does.
+ */
+ScanKernel GetScanKernel(common::Type::TypeId column_type, bool decimal_value,
+                         ExpressionType compare_type) {
+  switch (column_type) {
+    case common::Type::TINYINT:
+      return decimal_value ? GetScanKernel<int8_t, double>(compare_type)
+                           : GetScanKernel<int8_t, int64_t>(compare_type);
+    case common::Type::SMALLINT:
+      return decimal_value ? GetScanKernel<int16_t, double>(compare_type)
+                           : GetScanKernel<int16_t, int64_t>(compare_type);
+    case common::Type::INTEGER:
+      return decimal_value ? GetScanKernel<int32_t, double>(compare_type)
+                           : GetScanKernel<int32_t, int64_t>(compare_type);
+    case common::Type::BIGINT:
+      return decimal_value ? GetScanKernel<int64_t, double>(compare_type)
+                           : GetScanKernel<int64_t, int64_t>(compare_type);
+    case common::Type::DECIMAL:
+      return GetScanKernel<double, double>(compare_type);
+    default:
+      return nullptr;
+  }
+}
+
+template <typename ColumnT>
+ColumnPairKernel GetColumnPairKernel(ExpressionType compare_type) {
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return ScanColumnPair<ColumnT, EXPRESSION_TYPE_COMPARE_EQUAL>;
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return ScanColumnPair<ColumnT, EXPRESSION_TYPE_COMPARE_NOTEQUAL>;
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return ScanColumnPair<ColumnT, EXPRESSION_TYPE_COMPARE_LESSTHAN>;
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return ScanColumnPair<ColumnT,
+                            EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO>;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return ScanColumnPair<ColumnT, EXPRESSION_TYPE_COMPARE_GREATERTHAN>;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+      return ScanColumnPair<ColumnT,
+                            EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO>;
+    default:
+      return nullptr;
+  }
+}
+
+/** @brief The scan loop comparing two columns of the same type */
+ColumnPairKernel GetColumnPairKernel(common::Type::TypeId column_type,
+                                     ExpressionType compare_type) {
+  switch (column_type) {
+    case common::Type::TINYINT:
+      return GetColumnPairKernel<int8_t>(compare_type);
+    case common::Type::SMALLINT:
+      return GetColumnPairKernel<int16_t>(compare_type);
+    case common::Type::INTEGER:
+      return GetColumnPairKernel<int32_t>(compare_type);
+    case common::Type::BIGINT:
+      return GetColumnPairKernel<int64_t>(compare_type);
+    case common::Type::DECIMAL:
+      return GetColumnPairKernel<double>(compare_type);
+    default:
+      return nullptr;
+  }
+}
+
+/**
+ * @brief Choose the scan loop for comparing a column with a value, and
+ * convert the value to the type it is compared as.
+ * @return false if the value has a type without scan loops
+ */
+bool BindValue(common::Type::TypeId column_type, ExpressionType compare_type,
+               const common::Value &value, ScanKernel &kernel,
+               ScanValue &scan_value, bool &is_null) {
+  auto value_type = value.GetTypeId();
+  if (!IsCompiledType(value_type)) return false;
+
+  bool decimal_value = (column_type == common::Type::DECIMAL ||
+                        value_type == common::Type::DECIMAL);
+  kernel = GetScanKernel(column_type, decimal_value, compare_type);
+  is_null = value.IsNull();
+  if (is_null) return true;
+
+  int64_t integer = 0;
+  switch (value_type) {
+    case common::Type::TINYINT:
+      integer = value.GetAs<int8_t>();
+      break;
+    case common::Type::SMALLINT:
+      integer = value.GetAs<int16_t>();
+      break;
+    case common::Type::INTEGER:
+      integer = value.GetAs<int32_t>();
+      break;
+    case common::Type::BIGINT:
+      integer = value.GetAs<int64_t>();
+      break;
+    default:
+      scan_value.decimal = value.GetAs<double>();
+      return true;
+  }
+  if (decimal_value) {
+    scan_value.decimal = static_cast<double>(integer);
+  } else {
+    scan_value.integer = integer;
+  }
+  return true;
+}
+
+/** @brief Where the values of a column of the tile group are stored */
+void LocateColumn(storage::TileGroup *tile_group, oid_t column_id,
+                  const char *&base, size_t &stride) {
+  oid_t tile_offset, tile_column_id;
+  tile_group->LocateTileAndColumn(column_id, tile_offset, tile_column_id);
+  auto tile = tile_group->GetTile(tile_offset);
+  auto tile_schema = tile->GetSchema();
+  base = tile->GetTupleLocation(0) + tile_schema->GetOffset(tile_column_id);
+  stride = tile_schema->GetLength();
+}
+
+}  // namespace
+
+/**
+ * @brief A conjunction, or a comparison of a column with a constant, a
+ * parameter or another column.
+ */
+struct CompiledPredicate::PredicateNode {
+  ExpressionType type = EXPRESSION_TYPE_INVALID;
+
+  /** Children of AND and OR */
+  std::unique_ptr<PredicateNode> left;
+  std::unique_ptr<PredicateNode> right;
+
+  /** The compared column */
+  oid_t column_id = INVALID_OID;
+  common::Type::TypeId column_type = common::Type::INVALID;
+
+  /** The column is compared with a parameter if param_idx >= 0, with
+   * right_column_id if pair_kernel is set, or else with the constant */
+  int param_idx = -1;
+  oid_t right_column_id = INVALID_OID;
+  ColumnPairKernel pair_kernel = nullptr;
+  ScanKernel kernel = nullptr;
+  ScanValue value = ScanValue();
+  bool value_is_null = false;
+};
+
+CompiledPredicate::CompiledPredicate(std::unique_ptr<PredicateNode> root)
+    : root_(std::move(root)) {}
+
+CompiledPredicate::~CompiledPredicate() {}
+
+std::unique_ptr<CompiledPredicate> CompiledPredicate::Compile(
+    const expression::AbstractExpression *predicate,
+    const catalog::Schema *schema) {
+  auto root = CompileNode(predicate, schema);
+  if (root == nullptr) return nullptr;
+  return std::unique_ptr<CompiledPredicate>(
+      new CompiledPredicate(std::move(root)));
+}
+
+std::unique_ptr<CompiledPredicate::PredicateNode>
+CompiledPredicate::CompileNode(const expression::AbstractExpression *expr,
+                               const catalog::Schema *schema) {
+  if (expr == nullptr || expr->GetChildrenSize() != 2) return nullptr;
+
+  std::unique_ptr<PredicateNode> node(new PredicateNode());
+  node->type = expr->GetExpressionType();
+
+  if (node->type == EXPRESSION_TYPE_CONJUNCTION_AND ||
+      node->type == EXPRESSION_TYPE_CONJUNCTION_OR) {
+    node->left = CompileNode(expr->GetChild(0), schema);
+    node->right = CompileNode(expr->GetChild(1), schema);
+    if (node->left == nullptr || node->right == nullptr) return nullptr;
+    return node;
+  }
+
+  // The column of a column that is compared with a constant or a parameter
+  // is on the left
+  auto left = expr->GetChild(0);
+  auto right = expr->GetChild(1);
+  if (left->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) {
+    std::swap(left, right);
+    node->type = expression::ExpressionUtil::SwapComparison(node->type);
+  }
+  if (left->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) {
+    return nullptr;
+  }
+
+  // Resolve the columns to their types
+  auto get_column = [schema](const expression::AbstractExpression *expr,
+                             oid_t &column_id,
+                             common::Type::TypeId &column_type) {
+    auto tuple_value =
+        static_cast<const expression::TupleValueExpression *>(expr);
+    if (tuple_value->GetTupleId() != 0 || tuple_value->GetColumnId() < 0) {
+      return false;
+    }
+    column_id = tuple_value->GetColumnId();
+    if (column_id >= schema->GetColumnCount() ||
+        !schema->IsInlined(column_id)) {
+      return false;
+    }
+    column_type = schema->GetType(column_id);
+    return IsCompiledType(column_type);
+  };
+  if (!get_column(left, node->column_id, node->column_type)) return nullptr;
+
+  switch (right->GetExpressionType()) {
+    case EXPRESSION_TYPE_VALUE_TUPLE: {
+      common::Type::TypeId right_column_type;
+      if (!get_column(right, node->right_column_id, right_column_type) ||
+          right_column_type != node->column_type) {
+        return nullptr;
+      }
+      node->pair_kernel = GetColumnPairKernel(node->column_type, node->type);
+      if (node->pair_kernel == nullptr) return nullptr;
+      return node;
+    }
+    case EXPRESSION_TYPE_VALUE_CONSTANT: {
+      auto value =
+          static_cast<const expression::ConstantValueExpression *>(right)
+              ->GetValue();
+      if (!BindValue(node->column_type, node->type, value, node->kernel,
+                     node->value, node->value_is_null) ||
+          node->kernel == nullptr) {
+        return nullptr;
+      }
+      return node;
+    }
+    case EXPRESSION_TYPE_VALUE_PARAMETER: {
+      node->param_idx =
+          static_cast<const expression::ParameterValueExpression *>(right)
+              ->GetValueIdx();
+      if (node->param_idx < 0 ||
+          GetScanKernel(node->column_type, false, node->type) == nullptr) {
+        return nullptr;
+      }
+      return node;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+bool CompiledPredicate::Filter(storage::TileGroup *tile_group,
+                               const std::vector<common::Value> &params,
+                               const std::vector<oid_t> &selection,
+                               std::vector<oid_t> &result) const {
+  result = selection;
+  return FilterNode(*root_, tile_group, params, result);
+}
+
+/**
+ * @brief Narrow the selection down to the tuples where the node is true.
+ * The right side of AND is only scanned for the tuples that pass the left
+ * side, and the right side of OR for the others.
+ */
+bool CompiledPredicate::FilterNode(const PredicateNode &node,
+                                   storage::TileGroup *tile_group,
+                                   const std::vector<common::Value> &params,
+                                   std::vector<oid_t> &selection) const {
+  if (selection.empty()) return true;
+
+  switch (node.type) {
+    case EXPRESSION_TYPE_CONJUNCTION_AND:
+      return FilterNode(*node.left, tile_group, params, selection) &&
+             FilterNode(*node.right, tile_group, params, selection);
+
+    case EXPRESSION_TYPE_CONJUNCTION_OR: {
+      std::vector<oid_t> left_selection(selection);
+      if (!FilterNode(*node.left, tile_group, params, left_selection)) {
+        return false;
+      }
+
+      std::vector<oid_t> right_selection;
+      std::set_difference(selection.begin(), selection.end(),
+                          left_selection.begin(), left_selection.end(),
+                          std::back_inserter(right_selection));
+      if (!FilterNode(*node.right, tile_group, params, right_selection)) {
+        return false;
+      }
+
+      selection.clear();
+      std::merge(left_selection.begin(), left_selection.end(),
+                 right_selection.begin(), right_selection.end(),
+                 std::back_inserter(selection));
+      return true;
+    }
+
+    default:
+      break;
+  }
+
+  const char *base;
+  size_t stride;
+  LocateColumn(tile_group, node.column_id, base, stride);
+
+  size_t selected_count;
+  if (node.pair_kernel != nullptr) {
+    const char *right_base;
+    size_t right_stride;
+    LocateColumn(tile_group, node.right_column_id, right_base, right_stride);
+    selected_count = node.pair_kernel(base, stride, right_base, right_stride,
+                                      selection.data(), selection.size());
+  } else {
+    ScanKernel kernel = node.kernel;
+    ScanValue value = node.value;
+    bool value_is_null = node.value_is_null;
+    if (node.param_idx >= 0) {
+      if (static_cast<size_t>(node.param_idx) >= params.size() ||
+          !BindValue(node.column_type, node.type, params[node.param_idx],
+                     kernel, value, value_is_null)) {
+        return false;
+      }
+    }
+
+    // Comparisons with null are never true
+    selected_count =
+        value_is_null ? 0 : kernel(base, stride, value, selection.data(),
+                                   selection.size());
+  }
+  selection.resize(selected_count);
+  return true;
+}
+
+}  // namespace executor
+}  // namespace peloton
@@ -11,10 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/init.h"
 #include "common/logger.h"
+#include "common/thread_pool.h"
 #include "common/value.h"
 #include "executor/logical_tile.h"
 #include "executor/hash_executor.h"
@@ -24,6 +29,84 @@
 namespace peloton {
 namespace executor {
 
+namespace {
+
+typedef HashExecutor::HashTableType::Entry BuildRow;
+
+// Rows of a partition whose table (at a load factor of 1/2) fits into a
+// 256 KB L2 cache
+const size_t RADIX_PARTITION_ROWS = 256 * 1024 / (2 * sizeof(BuildRow));
+
+// Radix bits of one partitioning pass, a fan-out whose output pages still
+// fit into the TLB
+const size_t RADIX_PASS_BITS = 7;
+
+void RunTasks(std::vector<std::function<void()>> &tasks, bool parallel) {
+  if (parallel && tasks.size() > 1) {
+    thread_pool.ExecuteTasks(tasks);
+  } else {
+    for (auto &task : tasks) task();
+  }
+}
+
+/**
+ * @brief Scatter rows[0, count) into out by the bits [shift, shift + bits)
+ * of their hashes, keeping the order of the rows within a partition.
+ * The rows are split into chunk_count chunks that are counted and scattered
+ * by their own tasks. offsets gets the start of every partition in out,
+ * followed by count.
+ */
+void RadixScatter(const BuildRow *rows, BuildRow *out, size_t count,
+                  size_t shift, size_t bits, size_t chunk_count,
+                  std::vector<size_t> &offsets) {
+  size_t fan_out = size_t(1) << bits;
+  size_t mask = fan_out - 1;
+  chunk_count = std::max(std::min(chunk_count, count), size_t(1));
+
+  std::vector<std::vector<size_t>> histograms(
+      chunk_count, std::vector<size_t>(fan_out, 0));
+  std::vector<std::function<void()>> tasks;
+  for (size_t chunk_itr = 0; chunk_itr < chunk_count; chunk_itr++) {
+    tasks.push_back([&, chunk_itr] {
+      auto &histogram = histograms[chunk_itr];
+      size_t end = count * (chunk_itr + 1) / chunk_count;
+      for (size_t row_itr = count * chunk_itr / chunk_count; row_itr < end;
+           row_itr++) {
+        histogram[(rows[row_itr].hash >> shift) & mask]++;
+      }
+    });
+  }
+  RunTasks(tasks, true);
+
+  // The histograms become the write cursors of the chunks: every partition
+  // holds the rows of the first chunk, then the second chunk, and so on
+  offsets.assign(fan_out + 1, count);
+  size_t offset = 0;
+  for (size_t partition_itr = 0; partition_itr < fan_out; partition_itr++) {
+    offsets[partition_itr] = offset;
+    for (auto &histogram : histograms) {
+      size_t partition_count = histogram[partition_itr];
+      histogram[partition_itr] = offset;
+      offset += partition_count;
+    }
+  }
+
+  tasks.clear();
+  for (size_t chunk_itr = 0; chunk_itr < chunk_count; chunk_itr++) {
+    tasks.push_back([&, chunk_itr] {
+      auto &cursors = histograms[chunk_itr];
+      size_t end = count * (chunk_itr + 1) / chunk_count;
+      for (size_t row_itr = count * chunk_itr / chunk_count; row_itr < end;
+           row_itr++) {
+        out[cursors[(rows[row_itr].hash >> shift) & mask]++] = rows[row_itr];
+      }
+    });
+  }
+  RunTasks(tasks, true);
+}
+
+}  // namespace
+
 /**
  * @brief Constructor
  */
@@ -31,6 +114,13 @@ HashExecutor::HashExecutor(const planner::AbstractPlan *node,
                            ExecutorContext *executor_context)
     : AbstractExecutor(node, executor_context) {}
 
+void HashExecutor::UseParallelBuild(size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  build_thread_count_ = thread_count;
+}
+
 /**
  * @brief Do some basic checks and initialize executor state.
  * @return true on success, false otherwise.
@@ -41,6 +131,17 @@ bool HashExecutor::DInit() {
   // Initialize executor state
   done_ = false;
   result_itr = 0;
+  child_tiles_.clear();
+  build_tiles_.clear();
+  column_ids_.clear();
+  partition_tables_.clear();
+  bloom_filter_ = util::BloomFilter();
+  first_pass_bits_ = 0;
+  second_pass_bits_ = 0;
+  buffered_bytes_ = 0;
+  spilled_ = false;
+  spill_partitions_.clear();
+  spill_schema_.reset();
 
   return true;
 }
@@ -51,16 +152,6 @@ bool HashExecutor::DExecute() {
   if (done_ == false) {
     const planner::HashPlan &node = GetPlanNode<planner::HashPlan>();
 
-    // First, get all the input logical tiles
-    while (children_[0]->Execute()) {
-      child_tiles_.emplace_back(children_[0]->GetOutput());
-    }
-
-    if (child_tiles_.size() == 0) {
-      LOG_TRACE("Hash Executor : false -- no child tiles ");
-      return false;
-    }
-
     /* *
      * HashKeys is a vector of TupleValue expr
      * from which we construct a vector of column ids that represent the
@@ -70,6 +161,7 @@ bool HashExecutor::DExecute() {
     auto &hashkeys = node.GetHashKeys();
 
     // Construct a logical tile
+    column_ids_.clear();
     for (auto &hashkey : hashkeys) {
       PL_ASSERT(hashkey->GetExpressionType() == EXPRESSION_TYPE_VALUE_TUPLE);
       auto tuple_value =
@@ -78,39 +170,207 @@ bool HashExecutor::DExecute() {
       column_ids_.push_back(tuple_value->GetColumnId());
     }
 
-    // Construct the hash table by going over each child logical tile and
-    // hashing
-    for (size_t child_tile_itr = 0; child_tile_itr < child_tiles_.size();
-         child_tile_itr++) {
-      auto tile = child_tiles_[child_tile_itr].get();
+    // First, get all the input logical tiles
+    // Empty tiles are not returned to the parent, so they are dropped here
+    // to keep the tile indexes of the build rows in line with the parent's
+    while (children_[0]->Execute()) {
+      std::unique_ptr<LogicalTile> child_tile(children_[0]->GetOutput());
+      if (child_tile->GetTupleCount() == 0) continue;
+
+      if (spilled_) {
+        SpillTile(child_tile.get(), column_ids_, 0, spill_partitions_);
+        continue;
+      }
+      child_tiles_.push_back(std::move(child_tile));
+      if (memory_budget_ == 0) continue;
 
-      // Go over all tuples in the logical tile
-      for (oid_t tuple_id : *tile) {
-        // Key : container tuple with a subset of tuple attributes
-        // Value : < child_tile offset, tuple offset >
-        hash_table_[HashMapType::key_type(tile, tuple_id, &column_ids_)].insert(
-            std::make_pair(child_tile_itr, tuple_id));
+      if (spill_schema_.get() == nullptr) {
+        spill_schema_.reset(child_tiles_.back()->GetPhysicalSchema());
+      }
+      buffered_bytes_ += child_tiles_.back()->GetEstimatedSize();
+      if (buffered_bytes_ > memory_budget_) {
+        SpillChildTiles();
       }
     }
 
+    if (child_tiles_.size() == 0) {
+      LOG_TRACE("Hash Executor : false -- no child tiles ");
+      done_ = spilled_;
+      return false;
+    }
+
+    BuildHashTable();
+
     done_ = true;
   }
 
   // Return logical tiles one at a time
-  while (result_itr < child_tiles_.size()) {
-    if (child_tiles_[result_itr]->GetTupleCount() == 0) {
-      result_itr++;
-      continue;
-    } else {
-      SetOutput(child_tiles_[result_itr++].release());
-      LOG_TRACE("Hash Executor : true -- return tile one at a time ");
-      return true;
-    }
+  if (result_itr < child_tiles_.size()) {
+    SetOutput(child_tiles_[result_itr++].release());
+    LOG_TRACE("Hash Executor : true -- return tile one at a time ");
+    return true;
   }
 
   LOG_TRACE("Hash Executor : false -- done ");
   return false;
 }
 
+/**
+ * @brief Hash the keys of all rows of the child tiles, partition the rows
+ * and build the table of every partition.
+ */
+void HashExecutor::BuildHashTable() {
+  std::vector<LogicalTile *> tiles;
+  for (auto &child_tile : child_tiles_) {
+    tiles.push_back(child_tile.get());
+  }
+  BuildHashTable(tiles);
+}
+
+void HashExecutor::BuildHashTable(const std::vector<LogicalTile *> &tiles) {
+  bool parallel = (build_thread_count_ > 1);
+
+  build_tiles_ = tiles;
+  partition_tables_.clear();
+  first_pass_bits_ = 0;
+  second_pass_bits_ = 0;
+
+  std::vector<size_t> tile_offsets;
+  size_t row_count = 0;
+  for (auto tile : build_tiles_) {
+    tile_offsets.push_back(row_count);
+    row_count += tile->GetTupleCount();
+  }
+
+  // Key : hash of a container tuple with a subset of tuple attributes
+  // Value : < child_tile offset, tuple offset >
+  std::vector<BuildRow> rows(row_count);
+  std::vector<std::function<void()>> tasks;
+  for (size_t tile_itr = 0; tile_itr < build_tiles_.size(); tile_itr++) {
+    tasks.push_back([this, &rows, &tile_offsets, tile_itr] {
+      auto tile = build_tiles_[tile_itr];
+      size_t offset = tile_offsets[tile_itr];
+      for (oid_t tuple_id : *tile) {
+        expression::ContainerTuple<LogicalTile> key(tile, tuple_id,
+                                                    &column_ids_);
+        rows[offset].hash = HashKey(key);
+        rows[offset++].payload =
+            (static_cast<uint64_t>(tile_itr) << 32) | tuple_id;
+      }
+    });
+  }
+  RunTasks(tasks, parallel);
+
+  // The filter lets the probe side drop rows that can not match early on
+  bloom_filter_.Init(row_count);
+  for (auto &row : rows) {
+    bloom_filter_.Insert(row.hash);
+  }
+
+  std::vector<size_t> partition_offsets;
+  PartitionBuildRows(rows, partition_offsets);
+
+  partition_tables_.resize(partition_offsets.size() - 1);
+  tasks.clear();
+  for (size_t partition_itr = 0; partition_itr < partition_tables_.size();
+       partition_itr++) {
+    tasks.push_back([this, &rows, &partition_offsets, partition_itr] {
+      auto &table = partition_tables_[partition_itr];
+      size_t begin = partition_offsets[partition_itr];
+      size_t end = partition_offsets[partition_itr + 1];
+      table.Init(end - begin);
+      for (size_t row_itr = begin; row_itr < end; row_itr++) {
+        table.Insert(rows[row_itr].hash, rows[row_itr].payload);
+      }
+    });
+  }
+  RunTasks(tasks, parallel);
+
+  LOG_TRACE("Hash Executor : %lu rows in %lu partitions", row_count,
+            partition_tables_.size());
+}
+
+/**
+ * @brief Move the buffered child tiles to the spill partitions, the
+ * remaining child tiles follow them there.
+ */
+void HashExecutor::SpillChildTiles() {
+  LOG_TRACE("Hash Executor : spilling %lu bytes of child tiles",
+            buffered_bytes_);
+  spilled_ = true;
+  for (auto &child_tile : child_tiles_) {
+    SpillTile(child_tile.get(), column_ids_, 0, spill_partitions_);
+  }
+  child_tiles_.clear();
+  buffered_bytes_ = 0;
+}
+
+void HashExecutor::SpillTile(
+    LogicalTile *tile, const std::vector<oid_t> &key_column_ids, size_t level,
+    std::vector<std::unique_ptr<SpillFile>> &partitions) {
+  partitions.resize(size_t(1) << SPILL_PARTITION_BITS);
+  for (oid_t tuple_id : *tile) {
+    expression::ContainerTuple<LogicalTile> key(tile, tuple_id,
+                                                &key_column_ids);
+    auto &partition = partitions[GetSpillPartition(HashKey(key), level)];
+    if (partition.get() == nullptr) partition.reset(new SpillFile());
+    partition->WriteTuple(tile, tuple_id);
+  }
+}
+
+/**
+ * @brief Radix-partition the build rows in place until a partition fits
+ * into the L2 cache, with a second pass if one pass would exceed the TLB.
+ * partition_offsets gets the start of every partition in rows, followed by
+ * the row count.
+ */
+void HashExecutor::PartitionBuildRows(std::vector<BuildRow> &rows,
+                                      std::vector<size_t> &partition_offsets) {
+  size_t radix_bits = 0;
+  while ((rows.size() >> radix_bits) > RADIX_PARTITION_ROWS &&
+         radix_bits < 2 * RADIX_PASS_BITS) {
+    radix_bits++;
+  }
+  first_pass_bits_ = std::min(radix_bits, RADIX_PASS_BITS);
+  second_pass_bits_ = radix_bits - first_pass_bits_;
+
+  if (radix_bits == 0) {
+    partition_offsets = {0, rows.size()};
+    return;
+  }
+
+  std::vector<BuildRow> temp_rows(rows.size());
+  std::vector<size_t> first_offsets;
+  RadixScatter(rows.data(), temp_rows.data(), rows.size(), 0,
+               first_pass_bits_, build_thread_count_, first_offsets);
+
+  if (second_pass_bits_ == 0) {
+    rows.swap(temp_rows);
+    partition_offsets.swap(first_offsets);
+    return;
+  }
+
+  // Every partition of the first pass is partitioned again on its own
+  size_t first_fan_out = size_t(1) << first_pass_bits_;
+  size_t second_fan_out = size_t(1) << second_pass_bits_;
+  partition_offsets.assign(first_fan_out * second_fan_out + 1, rows.size());
+
+  std::vector<std::function<void()>> tasks;
+  for (size_t first_itr = 0; first_itr < first_fan_out; first_itr++) {
+    tasks.push_back([&, first_itr, second_fan_out] {
+      size_t begin = first_offsets[first_itr];
+      std::vector<size_t> second_offsets;
+      RadixScatter(temp_rows.data() + begin, rows.data() + begin,
+                   first_offsets[first_itr + 1] - begin, first_pass_bits_,
+                   second_pass_bits_, 1, second_offsets);
+      for (size_t second_itr = 0; second_itr < second_fan_out; second_itr++) {
+        partition_offsets[first_itr * second_fan_out + second_itr] =
+            begin + second_offsets[second_itr];
+      }
+    });
+  }
+  RunTasks(tasks, build_thread_count_ > 1);
+}
+
 } /* namespace executor */
 } /* namespace peloton */
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include <vector>
 
+#include "common/init.h"
+#include "common/thread_pool.h"
 #include "common/types.h"
 #include "common/logger.h"
+#include "executor/abstract_scan_executor.h"
 #include "executor/logical_tile_factory.h"
 #include "executor/hash_join_executor.h"
 #include "expression/abstract_expression.h"
@@ -41,10 +47,62 @@ bool HashJoinExecutor::DInit() {
             PLAN_NODE_TYPE_HASH);
 
   hash_executor_ = reinterpret_cast<HashExecutor *>(children_[1]);
+  if (probe_thread_count_ > 1) {
+    hash_executor_->UseParallelBuild(probe_thread_count_);
+  }
+  if (memory_budget_ > 0) {
+    hash_executor_->UseMemoryBudget(memory_budget_);
+  }
+
+  grace_join_ = false;
+  spill_partitions_.clear();
+  partition_loaded_ = false;
+  left_spill_file_.reset();
+  left_spill_schema_.reset();
 
   return true;
 }
 
+/**
+ * @brief Let a scan on the left side drop the tuples whose keys are not in the
+ * Bloom filter of the hash table, before they are evaluated and buffered.
+ * Only rows that can not be part of the output are dropped, i.e., for inner
+ * and right outer joins.
+ */
+void HashJoinExecutor::PushProbeFilter() {
+  if (join_type_ != JOIN_TYPE_INNER && join_type_ != JOIN_TYPE_RIGHT) return;
+
+  auto &bloom_filter = hash_executor_->GetBloomFilter();
+  if (bloom_filter.IsEmpty()) return;
+
+  // Hybrid scans have sequential scan plans too. The scan must scan a table,
+  // i.e., it has no child.
+  auto left_node = children_[0]->GetRawNode();
+  if (left_node == nullptr ||
+      left_node->GetPlanNodeType() != PLAN_NODE_TYPE_SEQSCAN ||
+      children_[0]->GetChildren().empty() == false) {
+    return;
+  }
+
+  // Keys of the left tiles are probed at the hash key offsets of the right
+  // tiles, so they are filtered the same way
+  auto scan_executor = dynamic_cast<AbstractScanExecutor *>(children_[0]);
+  if (scan_executor == nullptr) return;
+  scan_executor->SetProbeFilter(&bloom_filter,
+                                hash_executor_->GetHashKeyIds());
+}
+
+void HashJoinExecutor::UseGraceJoin(size_t memory_budget) {
+  memory_budget_ = memory_budget;
+}
+
+void HashJoinExecutor::UseParallelJoin(size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  probe_thread_count_ = thread_count;
+}
+
 /**
  * @brief Creates logical tiles from the two input logical tiles after applying
  * join predicate.
@@ -78,8 +136,17 @@ bool HashJoinExecutor::DExecute() {
         BufferRightTile(children_[1]->GetOutput());
       }
       right_child_done_ = true;
+
+      if (hash_executor_->IsSpilled()) {
+        SpillLeftChild();
+        grace_join_ = true;
+      } else {
+        PushProbeFilter();
+      }
     }
 
+    if (grace_join_) return ExecuteGraceJoin();
+
     // Get next tile from LEFT child
     if (children_[0]->Execute() == false) {
       LOG_TRACE("Did not get left tile \n");
@@ -101,82 +168,295 @@ bool HashJoinExecutor::DExecute() {
     // Build Join Tile
     //===------------------------------------------------------------------===//
 
-    // Get the hash table from the hash executor
-    auto &hash_table = hash_executor_->GetHashTable();
-    auto &hashed_col_ids = hash_executor_->GetHashKeyIds();
+    ProbeLeftTile(left_tile);
 
-    oid_t prev_tile = INVALID_OID;
-    std::unique_ptr<LogicalTile> output_tile;
-    LogicalTile::PositionListsBuilder pos_lists_builder;
+    // Check if we have any buffered output tiles
+    if (buffered_output_tiles.empty() == false) {
+      auto output_tile = buffered_output_tiles.front();
+      SetOutput(output_tile);
+      buffered_output_tiles.pop_front();
 
-    // Go over the left tile
-    for (auto left_tile_itr : *left_tile) {
-      const expression::ContainerTuple<executor::LogicalTile> left_tuple(
-          left_tile, left_tile_itr, &hashed_col_ids);
+      return true;
+    } else {
+      // Try again
+      continue;
+    }
+  }
+}
 
-      // Find matching tuples in the hash table built on top of the right table
-      auto right_tuples = hash_table.find(left_tuple);
+/**
+ * @brief Probe the hash table with every row of a left tile and buffer the
+ * join output, one tile per right tile with matches. The rows are probed in
+ * chunks, by parallel workers if enabled, and the matches are grouped by
+ * their right tile afterwards.
+ */
+void HashJoinExecutor::ProbeLeftTile(LogicalTile *left_tile) {
+  auto &hashed_col_ids = hash_executor_->GetHashKeyIds();
+  size_t left_tile_itr = left_result_tiles_.size() - 1;
+
+  std::vector<oid_t> left_rows(left_tile->begin(), left_tile->end());
+  size_t chunk_count = std::max(
+      std::min(probe_thread_count_, left_rows.size() / PROBE_CHUNK_ROWS),
+      size_t(1));
+
+  // Matches of every chunk: (right tile, right row, left row)
+  std::vector<std::vector<ProbeMatch>> chunk_matches(chunk_count);
+  std::vector<std::function<void()>> probe_tasks;
+  for (size_t chunk_itr = 0; chunk_itr < chunk_count; chunk_itr++) {
+    probe_tasks.push_back([&, chunk_itr] {
+      auto &matches = chunk_matches[chunk_itr];
+      size_t end = left_rows.size() * (chunk_itr + 1) / chunk_count;
+      for (size_t row_itr = left_rows.size() * chunk_itr / chunk_count;
+           row_itr < end; row_itr++) {
+        oid_t left_row = left_rows[row_itr];
+        const expression::ContainerTuple<executor::LogicalTile> left_tuple(
+            left_tile, left_row, &hashed_col_ids);
+
+        // Find matching tuples in the hash table built on top of the right
+        // table
+        hash_executor_->ForEachMatch(
+            HashExecutor::HashKey(left_tuple), left_tuple,
+            [&matches, left_row](size_t right_tile_itr, oid_t right_row) {
+              matches.push_back({right_tile_itr, right_row, left_row});
+            });
+      }
+    });
+  }
+  if (chunk_count > 1) {
+    thread_pool.ExecuteTasks(probe_tasks);
+  } else {
+    probe_tasks[0]();
+  }
 
-      if (right_tuples != hash_table.end()) {
-        RecordMatchedLeftRow(left_result_tiles_.size() - 1, left_tile_itr);
+  // Group the matches by right tile, keeping the order of the left rows
+  std::vector<size_t> right_tile_offsets(right_result_tiles_.size() + 1, 0);
+  for (auto &matches : chunk_matches) {
+    for (auto &match : matches) {
+      right_tile_offsets[match.right_tile + 1]++;
+    }
+  }
+  for (size_t tile_itr = 0; tile_itr < right_result_tiles_.size();
+       tile_itr++) {
+    right_tile_offsets[tile_itr + 1] += right_tile_offsets[tile_itr];
+  }
+  std::vector<ProbeMatch> grouped_matches(right_tile_offsets.back());
+  std::vector<size_t> right_tile_cursors(right_tile_offsets.begin(),
+                                         right_tile_offsets.end() - 1);
+  for (auto &matches : chunk_matches) {
+    for (auto &match : matches) {
+      grouped_matches[right_tile_cursors[match.right_tile]++] = match;
+      // The row sets of the outer joins are not thread-safe
+      RecordMatchedLeftRow(left_tile_itr, match.left_row);
+      RecordMatchedRightRow(match.right_tile, match.right_row);
+    }
+  }
 
-        // Go over the matching right tuples
-        for (auto &location : right_tuples->second) {
-          // Check if we got a new right tile itr
-          if (prev_tile != location.first) {
-            // Check if we have any join tuples
-            if (pos_lists_builder.Size() > 0) {
-              LOG_TRACE("Join tile size : %lu \n", pos_lists_builder.Size());
-              output_tile->SetPositionListsAndVisibility(
-                  pos_lists_builder.Release());
-              buffered_output_tiles.push_back(output_tile.release());
-            }
+  for (size_t tile_itr = 0; tile_itr < right_result_tiles_.size();
+       tile_itr++) {
+    size_t begin = right_tile_offsets[tile_itr];
+    size_t end = right_tile_offsets[tile_itr + 1];
+    if (begin == end) continue;
 
-            // Get the logical tile from right child
-            LogicalTile *right_tile = right_result_tiles_[location.first].get();
+    // Get the logical tile from right child
+    LogicalTile *right_tile = right_result_tiles_[tile_itr].get();
 
-            // Build output logical tile
-            output_tile = BuildOutputLogicalTile(left_tile, right_tile);
+    // Build output logical tile
+    std::unique_ptr<LogicalTile> output_tile =
+        BuildOutputLogicalTile(left_tile, right_tile);
 
-            // Build position lists
-            pos_lists_builder =
-                LogicalTile::PositionListsBuilder(left_tile, right_tile);
+    // Build position lists
+    LogicalTile::PositionListsBuilder pos_lists_builder(left_tile,
+                                                        right_tile);
+    pos_lists_builder.SetRightSource(&right_tile->GetPositionLists());
 
-            pos_lists_builder.SetRightSource(
-                &right_result_tiles_[location.first]->GetPositionLists());
-          }
+    for (size_t match_itr = begin; match_itr < end; match_itr++) {
+      // Add join tuple
+      pos_lists_builder.AddRow(grouped_matches[match_itr].left_row,
+                               grouped_matches[match_itr].right_row);
+    }
 
-          // Add join tuple
-          pos_lists_builder.AddRow(left_tile_itr, location.second);
+    LOG_TRACE("Join tile size : %lu \n", pos_lists_builder.Size());
+    output_tile->SetPositionListsAndVisibility(pos_lists_builder.Release());
+    buffered_output_tiles.push_back(output_tile.release());
+  }
+}
 
-          RecordMatchedRightRow(location.first, location.second);
+/**
+ * @brief Spill the left child to the partitions of the spilled right child,
+ * keyed on the hash key columns of the right tiles like the probe.
+ */
+void HashJoinExecutor::SpillLeftChild() {
+  auto &hashed_col_ids = hash_executor_->GetHashKeyIds();
+  auto right_files = hash_executor_->ReleaseSpillPartitions();
+  std::vector<std::unique_ptr<SpillFile>> left_files;
 
-          // Cache prev logical tile itr
-          prev_tile = location.first;
-        }
-      }
-    }
+  while (children_[0]->Execute()) {
+    std::unique_ptr<LogicalTile> left_tile(children_[0]->GetOutput());
+    if (left_tile->GetTupleCount() == 0) continue;
 
-    // Check if we have any join tuples
-    if (pos_lists_builder.Size() > 0) {
-      LOG_TRACE("Join tile size : %lu \n", pos_lists_builder.Size());
-      output_tile->SetPositionListsAndVisibility(pos_lists_builder.Release());
-      buffered_output_tiles.push_back(output_tile.release());
+    if (left_spill_schema_.get() == nullptr) {
+      left_spill_schema_.reset(left_tile->GetPhysicalSchema());
     }
+    HashExecutor::SpillTile(left_tile.get(), hashed_col_ids, 0, left_files);
+  }
 
-    // Check if we have any buffered output tiles
+  right_files.resize(size_t(1) << HashExecutor::SPILL_PARTITION_BITS);
+  left_files.resize(right_files.size());
+  for (size_t partition_itr = 0; partition_itr < right_files.size();
+       partition_itr++) {
+    SpillPartition partition;
+    partition.right_file = std::move(right_files[partition_itr]);
+    partition.left_file = std::move(left_files[partition_itr]);
+    partition.level = 0;
+    spill_partitions_.push_back(std::move(partition));
+  }
+  LOG_TRACE("Spilled both children to %lu partitions",
+            spill_partitions_.size());
+}
+
+/**
+ * @brief Join the spilled partitions one at a time. The join state of the
+ * parent class only covers the loaded partition, so the outer join output
+ * of a partition is built before the next one is loaded.
+ * @return true on success, false otherwise.
+ */
+bool HashJoinExecutor::ExecuteGraceJoin() {
+  for (;;) {
     if (buffered_output_tiles.empty() == false) {
       auto output_tile = buffered_output_tiles.front();
       SetOutput(output_tile);
       buffered_output_tiles.pop_front();
-
       return true;
-    } else {
-      // Try again
+    }
+
+    if (partition_loaded_) {
+      std::unique_ptr<LogicalTile> left_tile;
+      if (left_spill_file_.get() != nullptr) {
+        left_tile.reset(left_spill_file_->ReadTile(
+            *left_spill_schema_, DEFAULT_TUPLES_PER_TILEGROUP));
+      }
+
+      if (left_tile.get() != nullptr) {
+        BufferLeftTile(left_tile.release());
+        if (right_result_tiles_.empty() == false) {
+          ProbeLeftTile(left_result_tiles_.back().get());
+        }
+        continue;
+      }
+
+      if (BuildOuterJoinOutput()) return true;
+      partition_loaded_ = false;
+    }
+
+    if (spill_partitions_.empty()) return false;
+
+    SpillPartition partition = std::move(spill_partitions_.back());
+    spill_partitions_.pop_back();
+    if (CanSkipSpillPartition(partition)) continue;
+
+    size_t right_bytes = 0;
+    if (partition.right_file.get() != nullptr) {
+      right_bytes = partition.right_file->GetByteCount();
+    }
+    if (right_bytes > memory_budget_ &&
+        partition.level + 1 < HashExecutor::MAX_SPILL_LEVEL) {
+      RepartitionSpillPartition(partition);
       continue;
     }
+
+    LoadSpillPartition(partition);
+  }
+}
+
+/**
+ * @brief Whether a partition can not add to the output, as one of its sides
+ * is empty and the join type does not keep the rows of the other one.
+ */
+bool HashJoinExecutor::CanSkipSpillPartition(
+    const SpillPartition &partition) const {
+  bool has_right = (partition.right_file.get() != nullptr);
+  bool has_left = (partition.left_file.get() != nullptr);
+  switch (join_type_) {
+    case JOIN_TYPE_LEFT:
+      return has_left == false;
+    case JOIN_TYPE_RIGHT:
+      return has_right == false;
+    case JOIN_TYPE_OUTER:
+      return has_left == false && has_right == false;
+    default:
+      return has_left == false || has_right == false;
+  }
+}
+
+/**
+ * @brief Split both files of a partition on the hash bits of the next level
+ * and queue the new partitions in place of it.
+ */
+void HashJoinExecutor::RepartitionSpillPartition(SpillPartition &partition) {
+  auto &hashed_col_ids = hash_executor_->GetHashKeyIds();
+  size_t level = partition.level + 1;
+
+  auto split = [&](SpillFile *file, const catalog::Schema *schema,
+                   std::vector<std::unique_ptr<SpillFile>> &files) {
+    if (file == nullptr) return;
+    file->Rewind();
+    for (;;) {
+      std::unique_ptr<LogicalTile> tile(
+          file->ReadTile(*schema, DEFAULT_TUPLES_PER_TILEGROUP));
+      if (tile.get() == nullptr) break;
+      HashExecutor::SpillTile(tile.get(), hashed_col_ids, level, files);
+    }
+  };
+
+  std::vector<std::unique_ptr<SpillFile>> right_files, left_files;
+  split(partition.right_file.get(), hash_executor_->GetSpillSchema(),
+        right_files);
+  split(partition.left_file.get(), left_spill_schema_.get(), left_files);
+  partition.right_file.reset();
+  partition.left_file.reset();
+
+  right_files.resize(size_t(1) << HashExecutor::SPILL_PARTITION_BITS);
+  left_files.resize(right_files.size());
+  for (size_t partition_itr = 0; partition_itr < right_files.size();
+       partition_itr++) {
+    SpillPartition sub_partition;
+    sub_partition.right_file = std::move(right_files[partition_itr]);
+    sub_partition.left_file = std::move(left_files[partition_itr]);
+    sub_partition.level = level;
+    spill_partitions_.push_back(std::move(sub_partition));
   }
 }
 
+/**
+ * @brief Replace the join state of the previous partition with the right
+ * tiles of a partition and their hash table. The output tiles of the
+ * previous partition keep their base tiles alive.
+ */
+void HashJoinExecutor::LoadSpillPartition(SpillPartition &partition) {
+  left_result_tiles_.clear();
+  right_result_tiles_.clear();
+  no_matching_left_row_sets_.clear();
+  no_matching_right_row_sets_.clear();
+  left_matching_idx = 0;
+  right_matching_idx = 0;
+
+  std::vector<LogicalTile *> right_tiles;
+  if (partition.right_file.get() != nullptr) {
+    partition.right_file->Rewind();
+    LogicalTile *right_tile;
+    while ((right_tile = partition.right_file->ReadTile(
+                *hash_executor_->GetSpillSchema(),
+                DEFAULT_TUPLES_PER_TILEGROUP)) != nullptr) {
+      BufferRightTile(right_tile);
+      right_tiles.push_back(right_tile);
+    }
+  }
+  hash_executor_->BuildHashTable(right_tiles);
+
+  left_spill_file_ = std::move(partition.left_file);
+  if (left_spill_file_.get() != nullptr) left_spill_file_->Rewind();
+  partition_loaded_ = true;
+}
+
 }  // namespace executor
 }  // namespace peloton
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
+#include <functional>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "common/exception.h"
+#include "common/init.h"
 #include "common/logger.h"
+#include "common/thread_pool.h"
 #include "common/value.h"
 #include "executor/logical_tile.h"
 #include "executor/hash_set_op_executor.h"
@@ -24,6 +30,18 @@
 namespace peloton {
 namespace executor {
 
+namespace {
+
+void RunTasks(std::vector<std::function<void()>> &tasks, bool parallel) {
+  if (parallel && tasks.size() > 1) {
+    thread_pool.ExecuteTasks(tasks);
+  } else {
+    for (auto &task : tasks) task();
+  }
+}
+
+}  // namespace
+
 /**
  * @brief Constructor
  */
@@ -31,14 +49,34 @@ HashSetOpExecutor::HashSetOpExecutor(const planner::AbstractPlan *node,
                                      ExecutorContext *executor_context)
     : AbstractExecutor(node, executor_context) {}
 
+void HashSetOpExecutor::UseParallelBuild(size_t thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  build_thread_count_ = thread_count;
+}
+
 /**
  * @brief Do some basic checks and initialize executor state.
  * @return true on success, false otherwise.
  */
 bool HashSetOpExecutor::DInit() {
   PL_ASSERT(children_.size() == 2);
-  PL_ASSERT(!hash_done_);
-  PL_ASSERT(set_op_ == SETOP_TYPE_INVALID);
+
+  // The result of a union is not a subset of the left child
+  auto set_op = GetPlanNode<planner::SetOpPlan>().GetSetOp();
+  if (set_op == SETOP_TYPE_UNION || set_op == SETOP_TYPE_UNION_ALL) {
+    throw ExecutorException(
+        "Hash set op does not support UNION, use the merge set op");
+  }
+
+  hash_done_ = false;
+  set_op_ = SETOP_TYPE_INVALID;
+  partitions_.clear();
+  left_hashes_.clear();
+  left_groups_.clear();
+  left_tiles_.clear();
+  next_tile_to_return_ = 0;
 
   return true;
 }
@@ -76,113 +114,243 @@ bool HashSetOpExecutor::ExecuteHelper() {
     left_tiles_.emplace_back(children_[0]->GetOutput());
   }
 
-  if (left_tiles_.size() == 0) return false;
-
-  // Scan the left child's input and update the counters
-  for (auto &tile : left_tiles_) {
-    for (oid_t tuple_id : *tile) {
-      htable_[HashSetOpMapType::key_type(tile.get(), tuple_id)].left++;
-    }
+  if (left_tiles_.size() == 0) {
+    hash_done_ = true;
+    return false;
   }
 
+  // Group the left rows and count them
+  BuildPartitions();
+
   // Scan the right child's input and update counter when appropriate
   while (children_[1]->Execute()) {
     // Each right tile can be destroyed after processing
     std::unique_ptr<LogicalTile> tile(children_[1]->GetOutput());
-
-    for (oid_t tuple_id : *tile) {
-      auto it = htable_.find(HashSetOpMapType::key_type(tile.get(), tuple_id));
-      // Do nothing if this key never appears in the left child
-      // because it shouldn't show up in the result anyway
-      if (it != htable_.end()) {
-        it->second.right++;
-      }
-    }
+    CountRightTile(tile.get());
   }
 
   // Calculate the output number for each key
   switch (set_op_) {
     case SETOP_TYPE_INTERSECT:
-      CalculateCopies<SETOP_TYPE_INTERSECT>(htable_);
+      CalculateCopies<SETOP_TYPE_INTERSECT>();
       break;
     case SETOP_TYPE_INTERSECT_ALL:
-      CalculateCopies<SETOP_TYPE_INTERSECT_ALL>(htable_);
+      CalculateCopies<SETOP_TYPE_INTERSECT_ALL>();
       break;
     case SETOP_TYPE_EXCEPT:
-      CalculateCopies<SETOP_TYPE_EXCEPT>(htable_);
+      CalculateCopies<SETOP_TYPE_EXCEPT>();
       break;
     case SETOP_TYPE_EXCEPT_ALL:
-      CalculateCopies<SETOP_TYPE_EXCEPT_ALL>(htable_);
+      CalculateCopies<SETOP_TYPE_EXCEPT_ALL>();
       break;
+    case SETOP_TYPE_UNION:
+    case SETOP_TYPE_UNION_ALL:
     case SETOP_TYPE_INVALID:
+      // Rejected in DInit()
+      PL_ASSERT(false);
+      hash_done_ = true;
       return false;
   }
 
-  /*
-   * A bit cumbersome here:
-   * Since the first tuple of each group is used as the representative key
-   * in the hash table,
-   * we cannot invalidate it otherwise subsequent key comparison will fail
-   * (due to safety check in LogicalTile::GetValue()).
-   * Instead, we skip the first tuple and process it in a second round.
-   */
-
-  // 1st round
+  // Every left row knows its group, so no lookup (and no comparison with an
+  // invalidated representative) is needed any more: the first copies of a
+  // group stay visible, the others are invalidated
+  size_t row_itr = 0;
   for (auto &tile : left_tiles_) {
     for (oid_t tuple_id : *tile) {
-      auto it = htable_.find(HashSetOpMapType::key_type(tile.get(), tuple_id));
-
-      PL_ASSERT(it != htable_.end());
-
-      if (it->first.GetContainer() == tile.get() &&
-          it->first.GetTupleId() == tuple_id)
-        continue;
-      else if (it->second.left > 0)
-        it->second.left--;
+      auto group_id = left_groups_[row_itr++];
+      auto &group = partitions_[static_cast<size_t>(group_id >> 32)]
+                        .groups[static_cast<uint32_t>(group_id)];
+      if (group.left > 0)
+        group.left--;
       else
         tile->RemoveVisibility(tuple_id);
     }
   }
 
-  // 2nd round
-  for (auto &item : htable_) {
-    // We should have at most one quota left
-    PL_ASSERT(item.second.left == 1 || item.second.left == 0);
-    if (item.second.left == 0) {
-      item.first.GetContainer()->RemoveVisibility(item.first.GetTupleId());
-    }
-  }
-
   hash_done_ = true;
   next_tile_to_return_ = 0;
   return true;
 }
 
+/**
+ * @brief Fingerprint all left rows and group them by their values, with one
+ * table per hash partition. The rows are scattered by partition once, so
+ * that every partition only walks its own rows. Tiles are fingerprinted and
+ * scattered, and partitions built, by their own tasks when the build is
+ * parallel.
+ */
+void HashSetOpExecutor::BuildPartitions() {
+  bool parallel = (build_thread_count_ > 1);
+
+  size_t partition_count = 1;
+  while (parallel && partition_count < build_thread_count_) {
+    partition_count *= 2;
+  }
+  partitions_.clear();
+  partitions_.resize(partition_count);
+
+  std::vector<size_t> tile_offsets;
+  size_t row_count = 0;
+  for (auto &tile : left_tiles_) {
+    tile_offsets.push_back(row_count);
+    row_count += tile->GetTupleCount();
+  }
+  left_hashes_.assign(row_count, 0);
+  left_groups_.assign(row_count, 0);
+
+  // Fingerprint the rows and count them per partition, one histogram per
+  // tile
+  std::vector<std::vector<size_t>> histograms(
+      left_tiles_.size(), std::vector<size_t>(partition_count, 0));
+  std::vector<std::function<void()>> tasks;
+  for (size_t tile_itr = 0; tile_itr < left_tiles_.size(); tile_itr++) {
+    tasks.push_back([this, &tile_offsets, &histograms, tile_itr] {
+      auto tile = left_tiles_[tile_itr].get();
+      auto &histogram = histograms[tile_itr];
+      size_t offset = tile_offsets[tile_itr];
+      for (oid_t tuple_id : *tile) {
+        expression::ContainerTuple<LogicalTile> row(tile, tuple_id);
+        auto hash = HashRow(row);
+        left_hashes_[offset++] = hash;
+        histogram[GetPartition(hash)]++;
+      }
+    });
+  }
+  RunTasks(tasks, parallel);
+
+  // The histograms become the write cursors of the tiles: every partition
+  // holds the rows of the first tile, then the second tile, and so on
+  std::vector<size_t> partition_offsets(partition_count + 1, row_count);
+  size_t offset = 0;
+  for (size_t partition_itr = 0; partition_itr < partition_count;
+       partition_itr++) {
+    partition_offsets[partition_itr] = offset;
+    for (auto &histogram : histograms) {
+      size_t partition_row_count = histogram[partition_itr];
+      histogram[partition_itr] = offset;
+      offset += partition_row_count;
+    }
+  }
+
+  std::vector<PartitionRow> partition_rows(row_count);
+  tasks.clear();
+  for (size_t tile_itr = 0; tile_itr < left_tiles_.size(); tile_itr++) {
+    tasks.push_back([this, &tile_offsets, &histograms, &partition_rows,
+                     tile_itr] {
+      auto &cursors = histograms[tile_itr];
+      size_t row_itr = tile_offsets[tile_itr];
+      for (oid_t tuple_id : *left_tiles_[tile_itr]) {
+        auto &partition_row =
+            partition_rows[cursors[GetPartition(left_hashes_[row_itr])]++];
+        partition_row.row_itr = row_itr++;
+        partition_row.tile_itr = tile_itr;
+        partition_row.tuple_id = tuple_id;
+      }
+    });
+  }
+  RunTasks(tasks, parallel);
+
+  tasks.clear();
+  for (size_t partition_itr = 0; partition_itr < partition_count;
+       partition_itr++) {
+    tasks.push_back([this, &partition_rows, &partition_offsets,
+                     partition_itr] {
+      BuildPartition(partition_itr,
+                     partition_rows.data() + partition_offsets[partition_itr],
+                     partition_rows.data() +
+                         partition_offsets[partition_itr + 1]);
+    });
+  }
+  RunTasks(tasks, parallel);
+
+  LOG_TRACE("Set Op executor : %lu left rows in %lu partitions", row_count,
+            partition_count);
+}
+
+/**
+ * @brief Add the left rows of a partition to its table, in the order of the
+ * left tiles. Every partition only writes the groups of its own rows.
+ */
+void HashSetOpExecutor::BuildPartition(size_t partition_itr,
+                                       const PartitionRow *begin,
+                                       const PartitionRow *end) {
+  auto &partition = partitions_[partition_itr];
+
+  // Presized for the rows of the partition without duplicates
+  partition.table.Init(static_cast<size_t>(end - begin));
+
+  for (auto partition_row = begin; partition_row != end; partition_row++) {
+    auto hash = left_hashes_[partition_row->row_itr];
+    expression::ContainerTuple<LogicalTile> row(
+        left_tiles_[partition_row->tile_itr].get(), partition_row->tuple_id);
+    auto result = partition.table.FindOrInsert(
+        hash, [this, &partition, &row](uint32_t group_itr) {
+          auto &group = partition.groups[group_itr];
+          expression::ContainerTuple<LogicalTile> other(
+              left_tiles_[group.tile_itr].get(), group.row);
+          return row.EqualsNoSchemaCheck(other);
+        },
+        static_cast<uint32_t>(partition.groups.size()));
+    if (result.second) {
+      partition.groups.emplace_back(partition_row->tile_itr,
+                                    partition_row->tuple_id);
+    }
+
+    auto group_itr = *result.first;
+    partition.groups[group_itr].left++;
+    left_groups_[partition_row->row_itr] =
+        (static_cast<uint64_t>(partition_itr) << 32) | group_itr;
+  }
+}
+
+/**
+ * @brief Count the rows of a right tile in the groups of the left rows.
+ * Rows that never appear in the left child are ignored, because they
+ * shouldn't show up in the result anyway.
+ */
+void HashSetOpExecutor::CountRightTile(LogicalTile *tile) {
+  for (oid_t tuple_id : *tile) {
+    expression::ContainerTuple<LogicalTile> row(tile, tuple_id);
+    auto hash = HashRow(row);
+    auto &partition = partitions_[GetPartition(hash)];
+    auto group_itr = partition.table.Find(
+        hash, [this, &partition, &row](uint32_t group_itr) {
+          auto &group = partition.groups[group_itr];
+          expression::ContainerTuple<LogicalTile> other(
+              left_tiles_[group.tile_itr].get(), group.row);
+          return row.EqualsNoSchemaCheck(other);
+        });
+    if (group_itr != nullptr) partition.groups[*group_itr].right++;
+  }
+}
+
 /**
  * Based on the set-op type,
- * calculate the number of output copies of each tuples
+ * calculate the number of output copies of each group
  * and store it in the left counter.
  */
 template <SetOpType SETOP>
-bool HashSetOpExecutor::CalculateCopies(HashSetOpMapType &htable) {
-  for (auto &item : htable) {
-    switch (SETOP) {
-      case SETOP_TYPE_INTERSECT:
-        item.second.left = (item.second.right > 0) ? 1 : 0;
-        break;
-      case SETOP_TYPE_INTERSECT_ALL:
-        item.second.left = std::min(item.second.left, item.second.right);
-        break;
-      case SETOP_TYPE_EXCEPT:
-        item.second.left = (item.second.right > 0) ? 0 : 1;
-        break;
-      case SETOP_TYPE_EXCEPT_ALL:
-        item.second.left = (item.second.left > item.second.right)
-                               ? (item.second.left - item.second.right)
-                               : 0;
-        break;
-      default:
-        return false;
+bool HashSetOpExecutor::CalculateCopies() {
+  for (auto &partition : partitions_) {
+    for (auto &group : partition.groups) {
+      switch (SETOP) {
+        case SETOP_TYPE_INTERSECT:
+          group.left = (group.right > 0) ? 1 : 0;
+          break;
+        case SETOP_TYPE_INTERSECT_ALL:
+          group.left = std::min(group.left, group.right);
+          break;
+        case SETOP_TYPE_EXCEPT:
+          group.left = (group.right > 0) ? 0 : 1;
+          break;
+        case SETOP_TYPE_EXCEPT_ALL:
+          group.left =
+              (group.left > group.right) ? (group.left - group.right) : 0;
+          break;
+        default:
+          return false;
+      }
     }
   }
   return true;
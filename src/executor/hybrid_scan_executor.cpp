@@ -192,6 +192,12 @@ bool HybridScanExecutor::SeqScanUtil() {
   while (current_tile_group_offset_ < table_tile_group_count_) {
     LOG_TRACE("Current tile group offset : %u", current_tile_group_offset_);
     auto tile_group = table_->GetTileGroup(current_tile_group_offset_++);
+
+    // Skip the tile group if its zone map rules out the predicate
+    if (MayMatchZoneMap(tile_group.get()) == false) {
+      continue;
+    }
+
     auto tile_group_header = tile_group->GetHeader();
 
     oid_t active_tuple_count = tile_group->GetNextTupleSlot();
@@ -216,6 +222,11 @@ bool HybridScanExecutor::SeqScanUtil() {
 
       // Check transaction visibility
       if (transaction_manager.IsVisible(current_txn, tile_group_header, tuple_id) == VISIBILITY_OK) {
+        // Drop the tuple early if its key is not in the probe filter
+        if (PassesProbeFilter(tile_group.get(), tuple_id) == false) {
+          continue;
+        }
+
         // If the tuple is visible, then perform predicate evaluation.
         if (predicate_ == nullptr) {
           position_list.push_back(tuple_id);
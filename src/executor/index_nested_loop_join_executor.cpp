@@ -0,0 +1,467 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// index_nested_loop_join_executor.cpp
+//
+// Identification: src/executor/index_nested_loop_join_executor.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "catalog/manager.h"
+#include "common/container_tuple.h"
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/types.h"
+#include "concurrency/transaction_manager_factory.h"
+#include "executor/executor_context.h"
+#include "executor/index_nested_loop_join_executor.h"
+#include "executor/logical_tile_factory.h"
+#include "expression/abstract_expression.h"
+#include "index/index.h"
+#include "planner/index_scan_plan.h"
+#include "planner/nested_loop_join_plan.h"
+#include "storage/tile_group.h"
+#include "storage/tile_group_header.h"
+#include "storage/tuple.h"
+
+namespace peloton {
+namespace executor {
+
+namespace {
+
+/**
+ * @brief Find the condition of an index scan that compares a column for
+ * equality
+ * @return the offset of the condition, or INVALID_OID if there is none
+ */
+oid_t FindEqualityCondition(const planner::IndexScanPlan &scan_node,
+                            oid_t column_id) {
+  auto &key_column_ids = scan_node.GetKeyColumnIds();
+  auto &expr_types = scan_node.GetExprTypes();
+  for (oid_t condition_itr = 0; condition_itr < key_column_ids.size();
+       condition_itr++) {
+    if (key_column_ids[condition_itr] == column_id &&
+        expr_types[condition_itr] == EXPRESSION_TYPE_COMPARE_EQUAL) {
+      return condition_itr;
+    }
+  }
+  return INVALID_OID;
+}
+
+}  // namespace
+
+/**
+ * @brief Constructor for index nested loop join executor.
+ * @param node Nested loop join node corresponding to this executor.
+ */
+IndexNestedLoopJoinExecutor::IndexNestedLoopJoinExecutor(
+    const planner::AbstractPlan *node, ExecutorContext *executor_context)
+    : AbstractJoinExecutor(node, executor_context) {}
+
+/**
+ * @return true if the plan is an inner or left nested loop join whose right
+ * child is an index scan, and every key column of the index is a join column
+ * or compared for equality by the index scan
+ */
+bool IndexNestedLoopJoinExecutor::CanProbeIndex(
+    const planner::AbstractPlan *node) {
+  if (node == nullptr || node->GetPlanNodeType() != PLAN_NODE_TYPE_NESTLOOP ||
+      node->GetChildren().size() != 2) {
+    return false;
+  }
+  auto join_node = static_cast<const planner::NestedLoopJoinPlan *>(node);
+  if (join_node->GetJoinType() != JOIN_TYPE_INNER &&
+      join_node->GetJoinType() != JOIN_TYPE_LEFT) {
+    return false;
+  }
+
+  auto right_node = join_node->GetChildren()[1].get();
+  if (right_node->GetPlanNodeType() != PLAN_NODE_TYPE_INDEXSCAN) return false;
+  auto scan_node = static_cast<const planner::IndexScanPlan *>(right_node);
+  if (scan_node->GetIndex() == nullptr) return false;
+
+  auto &join_column_ids_right = join_node->GetJoinColumnsRight();
+  auto &key_attrs = scan_node->GetIndex()->GetMetadata()->GetKeyAttrs();
+  for (auto key_column_id : key_attrs) {
+    if (std::find(join_column_ids_right.begin(), join_column_ids_right.end(),
+                  key_column_id) == join_column_ids_right.end() &&
+        FindEqualityCondition(*scan_node, key_column_id) == INVALID_OID) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Pair the key columns of the index of the right child with the left
+ * join columns, and take the key conditions of the index scan.
+ * @return true on success, false otherwise.
+ */
+bool IndexNestedLoopJoinExecutor::DInit() {
+  auto status = AbstractJoinExecutor::DInit();
+  if (status == false) return status;
+
+  PL_ASSERT(children_.size() == 2);
+
+  if (join_type_ != JOIN_TYPE_INNER && join_type_ != JOIN_TYPE_LEFT) {
+    throw ExecutorException(
+        "Index nested loop join only supports inner and left joins");
+  }
+
+  auto right_node = children_[1]->GetRawNode();
+  if (right_node == nullptr ||
+      right_node->GetPlanNodeType() != PLAN_NODE_TYPE_INDEXSCAN) {
+    throw ExecutorException(
+        "Index nested loop join needs an index scan as its right child");
+  }
+  right_node_ = static_cast<const planner::IndexScanPlan *>(right_node);
+  index_ = right_node_->GetIndex();
+  PL_ASSERT(index_ != nullptr);
+
+  const planner::NestedLoopJoinPlan &node =
+      GetPlanNode<planner::NestedLoopJoinPlan>();
+  auto &join_column_ids_left = node.GetJoinColumnsLeft();
+  auto &join_column_ids_right = node.GetJoinColumnsRight();
+  PL_ASSERT(join_column_ids_left.size() == join_column_ids_right.size());
+
+  // Runtime keys replace the values of the conditions, like in the index scan
+  std::vector<common::Value> values;
+  if (right_node_->GetRunTimeKeys().empty()) {
+    values = right_node_->GetValues();
+  } else {
+    PL_ASSERT(right_node_->GetRunTimeKeys().size() ==
+              right_node_->GetValues().size());
+    for (auto expr : right_node_->GetRunTimeKeys()) {
+      values.push_back(
+          expr->Evaluate(nullptr, nullptr, executor_context_).Copy());
+    }
+  }
+
+  // Conditions on join columns are bound to the probe keys
+  auto &key_column_ids = right_node_->GetKeyColumnIds();
+  auto &expr_types = right_node_->GetExprTypes();
+  scan_key_column_ids_.clear();
+  scan_expr_types_.clear();
+  scan_values_.clear();
+  for (oid_t condition_itr = 0; condition_itr < key_column_ids.size();
+       condition_itr++) {
+    if (std::find(join_column_ids_right.begin(), join_column_ids_right.end(),
+                  key_column_ids[condition_itr]) ==
+        join_column_ids_right.end()) {
+      scan_key_column_ids_.push_back(key_column_ids[condition_itr]);
+      scan_expr_types_.push_back(expr_types[condition_itr]);
+      scan_values_.push_back(values[condition_itr]);
+    }
+  }
+
+  left_key_column_ids_.clear();
+  key_values_.clear();
+  for (auto key_column_id : index_->GetMetadata()->GetKeyAttrs()) {
+    auto right_itr = std::find(join_column_ids_right.begin(),
+                               join_column_ids_right.end(), key_column_id);
+    if (right_itr != join_column_ids_right.end()) {
+      left_key_column_ids_.push_back(
+          join_column_ids_left[right_itr - join_column_ids_right.begin()]);
+      key_values_.push_back(common::Value());
+      continue;
+    }
+
+    auto condition_itr = FindEqualityCondition(*right_node_, key_column_id);
+    if (condition_itr == INVALID_OID) {
+      throw ExecutorException(
+          "Index nested loop join needs every key column of the index in the "
+          "join columns or in an equality condition of the index scan");
+    }
+    left_key_column_ids_.push_back(INVALID_OID);
+    key_values_.push_back(values[condition_itr]);
+  }
+
+  right_tile_itrs_.clear();
+  for (auto output_tile : buffered_output_tiles_) {
+    delete output_tile;
+  }
+  buffered_output_tiles_.clear();
+
+  return true;
+}
+
+/**
+ * @brief Probe the index with every left tile, and return the buffered join
+ * output one tile per call.
+ * @return true on success, false otherwise.
+ */
+bool IndexNestedLoopJoinExecutor::DExecute() {
+  LOG_TRACE("********** Index Nested Loop %s Join executor :: 2 children ",
+            GetJoinTypeString());
+
+  for (;;) {
+    if (buffered_output_tiles_.empty() == false) {
+      auto output_tile = buffered_output_tiles_.front();
+      SetOutput(output_tile);
+      buffered_output_tiles_.pop_front();
+      return true;
+    }
+
+    // Build outer join output when done
+    if (left_child_done_ == true) {
+      return BuildOuterJoinOutput();
+    }
+
+    if (children_[0]->Execute() == false) {
+      LOG_TRACE("Left child is exhausted.");
+      left_child_done_ = true;
+      continue;
+    }
+
+    BufferLeftTile(children_[0]->GetOutput());
+    if (ProbeLeftTile(left_result_tiles_.back().get()) == false) {
+      return false;
+    }
+  }
+}
+
+/**
+ * @brief Probe the index with the keys of the rows of a left tile and buffer
+ * the join output, one tile per right tile with matches. Rows with a null key
+ * never match.
+ * @return false if the transaction failed to read a match
+ */
+bool IndexNestedLoopJoinExecutor::ProbeLeftTile(LogicalTile *left_tile) {
+  size_t left_tile_itr = left_result_tiles_.size() - 1;
+
+  std::vector<oid_t> left_rows;
+  for (oid_t left_row : *left_tile) {
+    bool has_null_key = false;
+    for (auto column_id : left_key_column_ids_) {
+      if (column_id == INVALID_OID) continue;
+      if (left_tile->GetValue(left_row, column_id).IsNull()) {
+        has_null_key = true;
+        break;
+      }
+    }
+    if (has_null_key == false) left_rows.push_back(left_row);
+  }
+
+  // Rows with equal keys are probed once, and the keys in order
+  std::sort(left_rows.begin(), left_rows.end(),
+            [this, left_tile](oid_t a, oid_t b) {
+              return CompareLeftKeys(left_tile, a, b) < 0;
+            });
+
+  auto &transaction_manager =
+      concurrency::TransactionManagerFactory::GetInstance();
+  auto current_txn = executor_context_->GetTransaction();
+  auto &manager = catalog::Manager::GetInstance();
+  auto scan_predicate = right_node_->GetPredicate();
+
+  storage::Tuple key(index_->GetKeySchema(), true);
+  std::vector<ProbeMatch> matches;
+  std::vector<ItemPointer *> location_ptrs;
+  size_t run_end;
+  for (size_t run_begin = 0; run_begin < left_rows.size();
+       run_begin = run_end) {
+    run_end = run_begin + 1;
+    while (run_end < left_rows.size() &&
+           CompareLeftKeys(left_tile, left_rows[run_begin],
+                           left_rows[run_end]) == 0) {
+      run_end++;
+    }
+
+    for (size_t key_itr = 0; key_itr < left_key_column_ids_.size();
+         key_itr++) {
+      auto column_id = left_key_column_ids_[key_itr];
+      if (column_id == INVALID_OID) {
+        key.SetValue(key_itr, key_values_[key_itr], index_->GetPool());
+      } else {
+        key.SetValue(key_itr, left_tile->GetValue(left_rows[run_begin],
+                                                  column_id),
+                     index_->GetPool());
+      }
+    }
+    location_ptrs.clear();
+    index_->ScanKey(&key, location_ptrs);
+
+    for (auto location_ptr : location_ptrs) {
+      ItemPointer location = *location_ptr;
+      if (GetVisibleVersion(location) == false) continue;
+
+      auto tile_group = manager.GetTileGroup(location.block);
+      expression::ContainerTuple<storage::TileGroup> tuple(tile_group.get(),
+                                                           location.offset);
+
+      // Check the other key conditions of the index scan on the version
+      if (scan_key_column_ids_.empty() == false) {
+        storage::Tuple version_key(index_->GetKeySchema(), true);
+        auto &indexed_columns = index_->GetKeySchema()->GetIndexedColumns();
+        for (oid_t key_itr = 0; key_itr < indexed_columns.size(); key_itr++) {
+          version_key.SetValue(key_itr,
+                               tuple.GetValue(indexed_columns[key_itr]),
+                               index_->GetPool());
+        }
+        if (index_->Compare(version_key, scan_key_column_ids_,
+                            scan_expr_types_, scan_values_) == false) {
+          continue;
+        }
+      }
+
+      if (scan_predicate != nullptr &&
+          scan_predicate->Evaluate(&tuple, nullptr, executor_context_)
+                  .IsTrue() == false) {
+        continue;
+      }
+
+      if (transaction_manager.PerformRead(current_txn, location, false) ==
+          false) {
+        transaction_manager.SetTransactionResult(current_txn, RESULT_FAILURE);
+        return false;
+      }
+
+      size_t right_tile_itr = GetRightTile(location.block);
+      auto right_tile = right_result_tiles_[right_tile_itr].get();
+      for (size_t row_itr = run_begin; row_itr < run_end; row_itr++) {
+        oid_t left_row = left_rows[row_itr];
+
+        // Join predicate is false. Skip pair and continue.
+        if (predicate_ != nullptr) {
+          expression::ContainerTuple<LogicalTile> left_tuple(left_tile,
+                                                             left_row);
+          expression::ContainerTuple<LogicalTile> right_tuple(
+              right_tile, location.offset);
+          if (predicate_->Evaluate(&left_tuple, &right_tuple,
+                                   executor_context_).IsFalse()) {
+            continue;
+          }
+        }
+
+        RecordMatchedLeftRow(left_tile_itr, left_row);
+        matches.push_back({right_tile_itr, location.offset, left_row});
+      }
+    }
+  }
+
+  // Group the matches by right tile
+  std::stable_sort(matches.begin(), matches.end(),
+                   [](const ProbeMatch &a, const ProbeMatch &b) {
+                     return a.right_tile < b.right_tile;
+                   });
+
+  size_t group_end;
+  for (size_t group_begin = 0; group_begin < matches.size();
+       group_begin = group_end) {
+    group_end = group_begin + 1;
+    while (group_end < matches.size() &&
+           matches[group_end].right_tile == matches[group_begin].right_tile) {
+      group_end++;
+    }
+
+    LogicalTile *right_tile =
+        right_result_tiles_[matches[group_begin].right_tile].get();
+    std::unique_ptr<LogicalTile> output_tile =
+        BuildOutputLogicalTile(left_tile, right_tile);
+    LogicalTile::PositionListsBuilder pos_lists_builder(left_tile,
+                                                        right_tile);
+    pos_lists_builder.SetRightSource(&right_tile->GetPositionLists());
+    for (size_t match_itr = group_begin; match_itr < group_end; match_itr++) {
+      pos_lists_builder.AddRow(matches[match_itr].left_row,
+                               matches[match_itr].right_row);
+    }
+
+    LOG_TRACE("Join tile size : %lu \n", pos_lists_builder.Size());
+    output_tile->SetPositionListsAndVisibility(pos_lists_builder.Release());
+    buffered_output_tiles_.push_back(output_tile.release());
+  }
+
+  return true;
+}
+
+/**
+ * @brief Three-way comparison of the join keys of two rows of a left tile
+ * @return negative if a < b, positive if a > b, 0 otherwise
+ */
+int IndexNestedLoopJoinExecutor::CompareLeftKeys(LogicalTile *left_tile,
+                                                 oid_t a, oid_t b) const {
+  for (auto column_id : left_key_column_ids_) {
+    if (column_id == INVALID_OID) continue;
+    auto a_value = left_tile->GetValue(a, column_id);
+    auto b_value = left_tile->GetValue(b, column_id);
+    if (a_value.CompareLessThan(b_value).IsTrue()) {
+      return -1;
+    } else if (a_value.CompareGreaterThan(b_value).IsTrue()) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Move location along its version chain to the version visible to the
+ * transaction, like the index scan does.
+ * @return false if no version is visible, e.g., the tuple is deleted
+ */
+bool IndexNestedLoopJoinExecutor::GetVisibleVersion(
+    ItemPointer &location) const {
+  auto &transaction_manager =
+      concurrency::TransactionManagerFactory::GetInstance();
+  auto current_txn = executor_context_->GetTransaction();
+  auto &manager = catalog::Manager::GetInstance();
+
+  auto tile_group_header = manager.GetTileGroup(location.block)->GetHeader();
+  for (;;) {
+    auto visibility = transaction_manager.IsVisible(
+        current_txn, tile_group_header, location.offset);
+    if (visibility == VISIBILITY_OK) return true;
+    if (visibility == VISIBILITY_DELETED) return false;
+
+    PL_ASSERT(visibility == VISIBILITY_INVISIBLE);
+    bool is_acquired = (tile_group_header->GetTransactionId(location.offset) ==
+                        INITIAL_TXN_ID);
+    bool is_alive = (tile_group_header->GetEndCommitId(location.offset) <=
+                     current_txn->GetBeginCommitId());
+    if (is_acquired && is_alive) {
+      // The version expired, start again from the head of the chain
+      location = *(tile_group_header->GetIndirection(location.offset));
+    } else {
+      location = tile_group_header->GetNextItemPointer(location.offset);
+    }
+    if (location.IsNull()) return false;
+    tile_group_header = manager.GetTileGroup(location.block)->GetHeader();
+  }
+}
+
+/**
+ * @brief Get the right tile wrapping the output columns of the right child
+ * for a tile group of the inner table, whose rows are the tuple slots.
+ * @return the offset of the tile in right_result_tiles_
+ */
+size_t IndexNestedLoopJoinExecutor::GetRightTile(oid_t tile_group_id) {
+  auto tile_itr = right_tile_itrs_.find(tile_group_id);
+  if (tile_itr != right_tile_itrs_.end()) return tile_itr->second;
+
+  auto tile_group = catalog::Manager::GetInstance().GetTileGroup(tile_group_id);
+  std::vector<oid_t> full_column_ids(
+      right_node_->GetTable()->GetSchema()->GetColumnCount());
+  std::iota(full_column_ids.begin(), full_column_ids.end(), 0);
+
+  std::unique_ptr<LogicalTile> right_tile(LogicalTileFactory::GetTile());
+  right_tile->AddColumns(tile_group, full_column_ids);
+  LogicalTile::PositionList tuple_slots(tile_group->GetAllocatedTupleCount());
+  std::iota(tuple_slots.begin(), tuple_slots.end(), 0);
+  right_tile->AddPositionList(std::move(tuple_slots));
+  if (right_node_->GetColumnIds().empty() == false) {
+    right_tile->ProjectColumns(full_column_ids, right_node_->GetColumnIds());
+  }
+
+  BufferRightTile(right_tile.release());
+  right_tile_itrs_[tile_group_id] = right_result_tiles_.size() - 1;
+  return right_result_tiles_.size() - 1;
+}
+
+}  // namespace executor
+}  // namespace peloton
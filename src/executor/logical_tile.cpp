@@ -199,6 +199,36 @@ size_t LogicalTile::GetTupleCount() { return visible_tuples_; }
  */
 size_t LogicalTile::GetColumnCount() { return schema_.size(); }
 
+/**
+ * @brief Estimates the memory taken up by the visible tuples, i.e., the
+ * fixed width of their columns plus the data of their varlen values.
+ *
+ * @return Size in bytes.
+ */
+size_t LogicalTile::GetEstimatedSize() {
+  size_t tuple_length = 0;
+  std::vector<oid_t> varlen_column_ids;
+  for (oid_t column_id = 0; column_id < schema_.size(); column_id++) {
+    auto &column_info = schema_[column_id];
+    auto base_schema = column_info.base_tile->GetSchema();
+    tuple_length += base_schema->GetLength(column_info.origin_column_id);
+    if (base_schema->IsInlined(column_info.origin_column_id) == false) {
+      varlen_column_ids.push_back(column_id);
+    }
+  }
+
+  size_t size = GetTupleCount() * tuple_length;
+  if (varlen_column_ids.empty()) return size;
+
+  for (oid_t tuple_id : *this) {
+    for (auto column_id : varlen_column_ids) {
+      auto value = GetValue(tuple_id, column_id);
+      if (value.IsNull() == false) size += value.GetLength();
+    }
+  }
+  return size;
+}
+
 /**
  * @brief Returns iterator pointing to first tuple.
  *
@@ -11,19 +11,46 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
 #include <vector>
 #include <chrono>
+#include <functional>
+#include <thread>
 
 #include "common/types.h"
 #include "common/logger.h"
+#include "common/init.h"
+#include "common/thread_pool.h"
 #include "executor/logical_tile_factory.h"
 #include "executor/merge_join_executor.h"
 #include "expression/abstract_expression.h"
+#include "expression/tuple_value_expression.h"
 #include "common/container_tuple.h"
 
 namespace peloton {
 namespace executor {
 
+namespace {
+
+/**
+ * @brief Find the end of the group of equal keys that starts at start in the
+ * sorted keys[start, end): gallop with growing steps past the equal keys, then
+ * binary search the last step.
+ */
+size_t GallopKeyGroupEnd(const util::sort_key64_type *keys, size_t start,
+                         size_t end) {
+  auto key = keys[start];
+  size_t low = start + 1, step = 1;
+  while (low < end && keys[low] == key) {
+    start = low;
+    low = std::min(start + step, end);
+    step *= 2;
+  }
+  return std::upper_bound(keys + start, keys + low, key) - keys;
+}
+
+}  // namespace
+
 /**
  * @brief Constructor for nested loop join executor.
  * @param node Nested loop join node corresponding to this executor.
@@ -44,255 +71,767 @@ bool MergeJoinExecutor::DInit() {
 
   if (join_clauses_ == nullptr) return false;
 
+  InitJoinKeyNormalizer();
+
+  left_cursor_ = MergeCursor();
+  right_cursor_ = MergeCursor();
+  stream_output_tiles_.clear();
+  stream_pos_lists_builder_.reset();
+  stream_left_tile_.reset();
+  stream_right_tile_.reset();
+  stream_started_ = false;
+  stream_done_ = false;
+
+  parallel_merge_done_ = false;
+  left_rows_.clear();
+  right_rows_.clear();
+  left_row_keys_.clear();
+  right_row_keys_.clear();
+  merge_partitions_.clear();
+  output_partition_itr_ = 0;
+  output_tile_itr_ = 0;
+
   return true;
 }
 
+void MergeJoinExecutor::UseParallelMerge(size_t partition_count) {
+  if (partition_count == 0) {
+    partition_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  use_parallel_merge_ = true;
+  merge_partition_count_ = partition_count;
+}
+
 /**
  * @brief Creates logical tiles from the two input logical tiles after applying
  * join predicate.
  * @return true on success, false otherwise.
  */
 bool MergeJoinExecutor::DExecute() {
-  LOG_TRACE(
-      "********** Merge Join executor :: 2 children "
-      "left:: start: %lu, end: %lu, done: %d "
-      "right:: start: %lu, end: %lu, done: %d",
-      left_start_row, left_end_row, left_child_done_, right_start_row,
-      right_end_row, right_child_done_);
-
-  // Build outer join output when done
-  if (right_child_done_ && left_child_done_) {
-    return BuildOuterJoinOutput();
-  }
-
-  //===--------------------------------------------------------------------===//
-  // Pick right and left tiles
-  //===--------------------------------------------------------------------===//
-
-  // Try to get next tile from RIGHT child
-  if (((right_child_done_ == false) && (right_start_row == right_end_row)) ||
-      (left_child_done_ == true)) {
-    if (children_[1]->Execute() == false) {
-      LOG_TRACE("Did not get right tile ");
-      right_child_done_ = true;
-      // Try again
-      return DExecute();
+  LOG_TRACE("********** Merge Join executor :: 2 children ");
+
+  if (use_parallel_merge_) {
+    return DExecuteParallel();
+  }
+
+  if (stream_started_ == false) {
+    // Read the first tile of both children
+    CursorHasRow(right_cursor_, false);
+    CursorHasRow(left_cursor_, true);
+    stream_started_ = true;
+  }
+
+  while (stream_output_tiles_.empty() && stream_done_ == false) {
+    MergeNextRows();
+  }
+
+  if (stream_output_tiles_.empty()) return false;
+
+  SetOutput(stream_output_tiles_.front().release());
+  stream_output_tiles_.pop_front();
+  return true;
+}
+
+/**
+ * @brief One step of the streaming merge: join the next groups of equal keys,
+ * or skip the rows of the side with smaller keys. Unmatched rows of outer
+ * joins are added to the output as soon as they are skipped, so no tile has
+ * to be kept after the cursors moved past it.
+ */
+void MergeJoinExecutor::MergeNextRows() {
+  bool emit_left =
+      (join_type_ == JOIN_TYPE_LEFT || join_type_ == JOIN_TYPE_OUTER);
+  bool emit_right =
+      (join_type_ == JOIN_TYPE_RIGHT || join_type_ == JOIN_TYPE_OUTER);
+
+  bool left_has_row = CursorHasRow(left_cursor_, true);
+  if (left_has_row == false) {
+    if (emit_right && CursorHasRow(right_cursor_, false)) {
+      SkipCursorRows(right_cursor_, false, right_cursor_.rows.size(), true);
+    } else {
+      FinishStreamOutput();
+    }
+    return;
+  }
+
+  bool right_has_row = CursorHasRow(right_cursor_, false);
+  if (right_has_row == false) {
+    if (!emit_left) {
+      // No more left row can join, and inner and right joins drop the rest
+      // of the left child without reading it
+      FinishStreamOutput();
+    } else {
+      // The rest of the left child is kept by left and outer joins
+      SkipCursorRows(left_cursor_, true, left_cursor_.rows.size(), emit_left);
+    }
+    return;
+  }
+
+  int cmp = CompareCursorKeys();
+  if (cmp < 0) {
+    LOG_TRACE("left < right, advance left ");
+    SkipCursorRows(left_cursor_, true, FindLesserRowsEnd(true), emit_left);
+    return;
+  } else if (cmp > 0) {
+    LOG_TRACE("left > right, advance right ");
+    SkipCursorRows(right_cursor_, false, FindLesserRowsEnd(false), emit_right);
+    return;
+  }
+
+  // Both groups may span several tiles
+  JoinKeyGroup left_group, right_group;
+  ReadKeyGroup(left_cursor_, true, left_group);
+  ReadKeyGroup(right_cursor_, false, right_group);
+
+  std::vector<bool> left_matched(left_group.rows.size(), false);
+  std::vector<bool> right_matched(right_group.rows.size(), false);
+
+  // Cartesian product of the two groups
+  for (size_t left_itr = 0; left_itr < left_group.rows.size(); left_itr++) {
+    auto &left_row = left_group.rows[left_itr];
+    auto &left_tile = left_group.tiles[left_row.first];
+    expression::ContainerTuple<executor::LogicalTile> left_tuple(
+        left_tile.get(), left_row.second);
+
+    for (size_t right_itr = 0; right_itr < right_group.rows.size();
+         right_itr++) {
+      auto &right_row = right_group.rows[right_itr];
+      auto &right_tile = right_group.tiles[right_row.first];
+      expression::ContainerTuple<executor::LogicalTile> right_tuple(
+          right_tile.get(), right_row.second);
+
+      if (predicate_ != nullptr &&
+          predicate_->Evaluate(&left_tuple, &right_tuple, executor_context_)
+              .IsFalse()) {
+        continue;
+      }
+
+      AddStreamOutputRow(left_tile, left_row.second, right_tile,
+                         right_row.second);
+      left_matched[left_itr] = true;
+      right_matched[right_itr] = true;
     }
+  }
+
+  for (size_t left_itr = 0; emit_left && left_itr < left_group.rows.size();
+       left_itr++) {
+    if (left_matched[left_itr]) continue;
+    auto &left_row = left_group.rows[left_itr];
+    AddUnmatchedRow(true, left_group.tiles[left_row.first], left_row.second);
+  }
+  for (size_t right_itr = 0;
+       emit_right && right_itr < right_group.rows.size(); right_itr++) {
+    if (right_matched[right_itr]) continue;
+    auto &right_row = right_group.rows[right_itr];
+    AddUnmatchedRow(false, right_group.tiles[right_row.first],
+                    right_row.second);
+  }
+}
 
-    LOG_TRACE("Got right tile ");
+/**
+ * @brief Make sure the cursor points to a row, reading the next tiles of the
+ * child if its current tile is consumed. The previous tile is released then.
+ * @return false if the child has no more rows
+ */
+bool MergeJoinExecutor::CursorHasRow(MergeCursor &cursor, bool is_left) {
+  while (cursor.tile == nullptr || cursor.row_itr >= cursor.rows.size()) {
+    if (cursor.child_done) return false;
+
+    auto &child = children_[is_left ? 0 : 1];
+    if (child->Execute() == false) {
+      LOG_TRACE("Did not get %s tile ", is_left ? "left" : "right");
+      cursor.child_done = true;
+      // the last tile is still needed for the schema of unmatched rows
+      return false;
+    }
 
-    auto right_tile = children_[1]->GetOutput();
-    BufferRightTile(right_tile);
+    LOG_TRACE("Got %s tile ", is_left ? "left" : "right");
+    cursor.tile.reset(child->GetOutput());
+    cursor.rows.assign(cursor.tile->begin(), cursor.tile->end());
+    cursor.row_itr = 0;
+    ExtractJoinKeys(cursor.tile.get(), is_left, cursor.keys);
+  }
+  return true;
+}
 
-    right_start_row = 0;
-    right_end_row = Advance(right_tile, right_start_row, false);
-    LOG_TRACE("size of right tiles: %lu", right_result_tiles_.size());
+/**
+ * @brief Compare the join keys of the current rows of the two cursors
+ * @return negative if left < right, positive if left > right, 0 otherwise
+ */
+int MergeJoinExecutor::CompareCursorKeys() {
+  if (join_key_normalizer_ != nullptr) {
+    auto left_key = left_cursor_.keys[left_cursor_.row_itr];
+    auto right_key = right_cursor_.keys[right_cursor_.row_itr];
+    return left_key < right_key ? -1 : (left_key > right_key ? 1 : 0);
   }
 
-  // Try to get next tile from LEFT child
-  if (((left_child_done_ == false) && (left_start_row == left_end_row)) ||
-      (right_child_done_ == true)) {
+  return CompareTileJoinKeys(left_cursor_.tile.get(),
+                             left_cursor_.rows[left_cursor_.row_itr],
+                             right_cursor_.tile.get(),
+                             right_cursor_.rows[right_cursor_.row_itr]);
+}
 
-    if (children_[0]->Execute() == false) {
-      LOG_TRACE("Did not get left tile ");
-      left_child_done_ = true;
-      // if we know the join type is left join, we don't have to get the
-      // tiles from right child anymore.
-      if (join_type_ == JOIN_TYPE_LEFT || join_type_ == JOIN_TYPE_INNER) {
-        return BuildOuterJoinOutput();
-      } else {
-        // otherwise, try again
-        return DExecute();
+/**
+ * @brief Find the end of the rows of the current tile of one side whose join
+ * keys are less than the current key of the other side. With normalized keys,
+ * this is a binary search over the tile, otherwise only the current row.
+ */
+size_t MergeJoinExecutor::FindLesserRowsEnd(bool is_left) {
+  auto &cursor = is_left ? left_cursor_ : right_cursor_;
+  if (join_key_normalizer_ == nullptr) return cursor.row_itr + 1;
+
+  auto &other_cursor = is_left ? right_cursor_ : left_cursor_;
+  auto other_key = other_cursor.keys[other_cursor.row_itr];
+  return std::lower_bound(cursor.keys.begin() + cursor.row_itr,
+                          cursor.keys.end(), other_key) -
+         cursor.keys.begin();
+}
+
+/**
+ * @brief Move the cursor to the end-th row of its current tile. The skipped
+ * rows are added to the output with nulls if emit_unmatched is set.
+ */
+void MergeJoinExecutor::SkipCursorRows(MergeCursor &cursor, bool is_left,
+                                       size_t end, bool emit_unmatched) {
+  for (; emit_unmatched && cursor.row_itr < end; cursor.row_itr++) {
+    AddUnmatchedRow(is_left, cursor.tile, cursor.rows[cursor.row_itr]);
+  }
+  cursor.row_itr = end;
+}
+
+/**
+ * @brief Read the rows with the same join key as the current row of the
+ * cursor, which may continue in the next tiles of the child, and move the
+ * cursor past them.
+ */
+void MergeJoinExecutor::ReadKeyGroup(MergeCursor &cursor, bool is_left,
+                                     JoinKeyGroup &group) {
+  // The first row of the group, to compare the following rows with
+  std::shared_ptr<LogicalTile> first_tile = cursor.tile;
+  oid_t first_row = cursor.rows[cursor.row_itr];
+  util::sort_key64_type first_key =
+      join_key_normalizer_ != nullptr ? cursor.keys[cursor.row_itr] : 0;
+
+  while (CursorHasRow(cursor, is_left)) {
+    size_t end = cursor.row_itr;
+    if (join_key_normalizer_ != nullptr) {
+      if (cursor.keys[end] == first_key) {
+        end = GallopKeyGroupEnd(cursor.keys.data(), end, cursor.keys.size());
       }
+    } else {
+      while (end < cursor.rows.size() &&
+             HasSameJoinKey(first_tile.get(), first_row, cursor.tile.get(),
+                            cursor.rows[end], is_left)) {
+        end++;
+      }
+    }
+    if (end == cursor.row_itr) break;
 
-      // Try again
-      return DExecute();
+    if (group.tiles.empty() || group.tiles.back() != cursor.tile) {
+      group.tiles.push_back(cursor.tile);
+    }
+    for (; cursor.row_itr < end; cursor.row_itr++) {
+      group.rows.emplace_back(group.tiles.size() - 1,
+                              cursor.rows[cursor.row_itr]);
     }
 
-    LOG_TRACE("Got left tile ");
+    // The group ends within this tile
+    if (end < cursor.rows.size()) break;
+  }
+}
 
-    auto left_tile = children_[0]->GetOutput();
-    BufferLeftTile(left_tile);
+/**
+ * @brief Add a joined row to the output tile of its pair of child tiles. A
+ * row id of NULL_OID adds nulls for that side.
+ */
+void MergeJoinExecutor::AddStreamOutputRow(
+    const std::shared_ptr<LogicalTile> &left_tile, oid_t left_row,
+    const std::shared_ptr<LogicalTile> &right_tile, oid_t right_row) {
+  if (stream_pos_lists_builder_ == nullptr ||
+      stream_left_tile_ != left_tile || stream_right_tile_ != right_tile) {
+    FlushStreamOutputTile();
+    stream_left_tile_ = left_tile;
+    stream_right_tile_ = right_tile;
+    if (left_tile != nullptr && right_tile != nullptr) {
+      stream_pos_lists_builder_.reset(new LogicalTile::PositionListsBuilder(
+          left_tile.get(), right_tile.get()));
+    } else {
+      stream_pos_lists_builder_.reset(new LogicalTile::PositionListsBuilder(
+          left_tile ? &left_tile->GetPositionLists() : nullptr,
+          right_tile ? &right_tile->GetPositionLists() : nullptr));
+    }
+  }
 
-    left_start_row = 0;
-    left_end_row = Advance(left_tile, left_start_row, true);
-    LOG_TRACE("size of left tiles: %lu", left_result_tiles_.size());
+  if (left_row == NULL_OID) {
+    stream_pos_lists_builder_->AddLeftNullRow(right_row);
+  } else if (right_row == NULL_OID) {
+    stream_pos_lists_builder_->AddRightNullRow(left_row);
+  } else {
+    stream_pos_lists_builder_->AddRow(left_row, right_row);
   }
+}
 
-  // Check if we have logical tiles to process
-  if (left_result_tiles_.empty() || right_result_tiles_.empty()) {
-    return BuildOuterJoinOutput();
+/**
+ * @brief Add a row of an outer join without a match. The schema of the other
+ * side is taken from the output tile being built or from the last tile of the
+ * other child, if it had any.
+ */
+void MergeJoinExecutor::AddUnmatchedRow(
+    bool is_left, const std::shared_ptr<LogicalTile> &tile, oid_t row) {
+  if (is_left) {
+    auto right_tile = (stream_pos_lists_builder_ != nullptr &&
+                       stream_left_tile_ == tile && stream_right_tile_)
+                          ? stream_right_tile_
+                          : right_cursor_.tile;
+    AddStreamOutputRow(tile, row, right_tile, NULL_OID);
+  } else {
+    auto left_tile = (stream_pos_lists_builder_ != nullptr &&
+                      stream_right_tile_ == tile && stream_left_tile_)
+                         ? stream_left_tile_
+                         : left_cursor_.tile;
+    AddStreamOutputRow(left_tile, NULL_OID, tile, row);
   }
+}
 
-  LogicalTile *left_tile = left_result_tiles_.back().get();
-  LogicalTile *right_tile = right_result_tiles_.back().get();
+void MergeJoinExecutor::FlushStreamOutputTile() {
+  if (stream_pos_lists_builder_ != nullptr &&
+      stream_pos_lists_builder_->Size() > 0) {
+    std::unique_ptr<LogicalTile> output_tile;
+    if (stream_left_tile_ != nullptr && stream_right_tile_ != nullptr) {
+      output_tile = BuildOutputLogicalTile(stream_left_tile_.get(),
+                                           stream_right_tile_.get());
+    } else {
+      output_tile = BuildOutputLogicalTile(
+          stream_left_tile_.get(), stream_right_tile_.get(), proj_schema_);
+    }
+    output_tile->SetPositionListsAndVisibility(
+        stream_pos_lists_builder_->Release());
+    stream_output_tiles_.push_back(std::move(output_tile));
+  }
+  stream_pos_lists_builder_.reset();
+  stream_left_tile_.reset();
+  stream_right_tile_.reset();
+}
 
-  //===--------------------------------------------------------------------===//
-  // Build Join Tile
-  //===--------------------------------------------------------------------===//
+void MergeJoinExecutor::FinishStreamOutput() {
+  FlushStreamOutputTile();
+  left_cursor_ = MergeCursor();
+  right_cursor_ = MergeCursor();
+  stream_done_ = true;
+}
 
-  // Build output logical tile
-  auto output_tile = BuildOutputLogicalTile(left_tile, right_tile);
+/**
+ * @brief Parallel variant of DExecute. Both children are drained first, and
+ * since they are sorted on the join keys, the rows are range-partitioned on
+ * splitter keys so that every partition pair can be merged on its own worker.
+ * The output tiles are returned in partition order, i.e., in key order.
+ * @return true on success, false otherwise.
+ */
+bool MergeJoinExecutor::DExecuteParallel() {
+  if (parallel_merge_done_ == false) {
+    BufferChildTiles();
 
-  // Build position lists
-  LogicalTile::PositionListsBuilder pos_lists_builder(left_tile, right_tile);
+    BuildJoinRows(true);
+    BuildJoinRows(false);
 
-  while ((left_end_row > left_start_row) && (right_end_row > right_start_row)) {
-    expression::ContainerTuple<executor::LogicalTile> left_tuple(
-        left_tile, left_start_row);
-    expression::ContainerTuple<executor::LogicalTile> right_tuple(
-        right_tile, right_start_row);
-    bool not_matching_tuple_pair = false;
-
-    // Evaluate and compare the join clauses
-    for (auto &clause : *join_clauses_) {
-      auto left_value =
-          clause.left_->Evaluate(&left_tuple, &right_tuple, nullptr);
-      auto right_value =
-          clause.right_->Evaluate(&left_tuple, &right_tuple, nullptr);
-
-      // Compare the values
-      common::Value cmp_less = (
-          left_value.CompareLessThan(right_value));
-      common::Value cmp_greater = (
-        left_value.CompareGreaterThan(right_value));
-
-      // Left key < Right key, advance left
-      if (cmp_less.IsTrue()) {
-        LOG_TRACE("left < right, advance left ");
-        left_start_row = left_end_row;
-        left_end_row = Advance(left_tile, left_start_row, true);
-        not_matching_tuple_pair = true;
-        break;
+    MergeJoinRows();
+    parallel_merge_done_ = true;
+  }
+
+  return ExecuteMergedOutput();
+}
+
+/**
+ * @brief Read all tiles of both children into the result tile buffers.
+ */
+void MergeJoinExecutor::BufferChildTiles() {
+  while (children_[0]->Execute()) {
+    BufferLeftTile(children_[0]->GetOutput());
+  }
+  left_child_done_ = true;
+
+  while (children_[1]->Execute()) {
+    BufferRightTile(children_[1]->GetOutput());
+  }
+  right_child_done_ = true;
+}
+
+/**
+ * @brief Merge left_rows_ with right_rows_, which are sorted on the join
+ * keys, in range partitions. Every partition is merged on its own worker if
+ * there is more than one.
+ */
+void MergeJoinExecutor::MergeJoinRows() {
+  BuildMergePartitions();
+
+  if (merge_partitions_.size() > 1) {
+    std::vector<std::function<void()>> merge_tasks;
+    for (auto &partition : merge_partitions_) {
+      merge_tasks.push_back([this, &partition] {
+        MergePartitionRows(partition);
+      });
+    }
+    thread_pool.ExecuteTasks(merge_tasks);
+  } else if (merge_partitions_.size() == 1) {
+    MergePartitionRows(merge_partitions_[0]);
+  }
+
+  // The row sets of the outer joins are not thread-safe,
+  // so the matched rows are recorded after all workers are done
+  for (auto &partition : merge_partitions_) {
+    for (auto &row : partition.matched_left_rows) {
+      RecordMatchedLeftRow(row.first, row.second);
+    }
+    for (auto &row : partition.matched_right_rows) {
+      RecordMatchedRightRow(row.first, row.second);
+    }
+  }
+
+  LOG_TRACE("Merged %lu left rows and %lu right rows in %lu partitions",
+            left_rows_.size(), right_rows_.size(), merge_partitions_.size());
+}
+
+/**
+ * @brief Return the next output tile of the merged partitions, and then the
+ * rows of the outer joins without a match.
+ */
+bool MergeJoinExecutor::ExecuteMergedOutput() {
+  while (output_partition_itr_ < merge_partitions_.size()) {
+    auto &output_tiles = merge_partitions_[output_partition_itr_].output_tiles;
+    if (output_tile_itr_ < output_tiles.size()) {
+      SetOutput(output_tiles[output_tile_itr_++].release());
+      return true;
+    }
+    output_partition_itr_++;
+    output_tile_itr_ = 0;
+  }
+
+  return BuildOuterJoinOutput();
+}
+
+/**
+ * @brief Split the sorted inputs into at most merge_partition_count_ ranges.
+ * Splitters are picked evenly from the larger input and moved to the start of
+ * their key group, so that all rows with the same key end up in one partition.
+ * The matching range of the other input is found with a binary search.
+ */
+void MergeJoinExecutor::BuildMergePartitions() {
+  bool split_left = (left_rows_.size() >= right_rows_.size());
+  auto &split_rows = split_left ? left_rows_ : right_rows_;
+  auto &other_rows = split_left ? right_rows_ : left_rows_;
+
+  size_t partition_count =
+      std::max(std::min(merge_partition_count_, split_rows.size()), size_t(1));
+
+  size_t split_begin = 0, other_begin = 0;
+  for (size_t partition_itr = 1; partition_itr <= partition_count;
+       partition_itr++) {
+    size_t split_end = split_rows.size() * partition_itr / partition_count;
+    size_t other_end = other_rows.size();
+
+    if (partition_itr < partition_count) {
+      split_end = std::max(split_end, split_begin);
+      if (split_end > 0 && split_end < split_rows.size()) {
+        split_end = FindJoinKeyGroupEnd(split_end - 1, split_rows.size(),
+                                        split_left);
       }
-      // Left key > Right key, advance right
-      else if (cmp_greater.IsTrue()) {
-        LOG_TRACE("left > right, advance right ");
-        right_start_row = right_end_row;
-        right_end_row = Advance(right_tile, right_start_row, false);
-        not_matching_tuple_pair = true;
-        break;
+
+      // first row of the other input that is not less than the splitter key
+      if (split_end < split_rows.size()) {
+        size_t low = other_begin, high = other_rows.size();
+        while (low < high) {
+          size_t mid = low + (high - low) / 2;
+          bool other_less = split_left ? CompareJoinKeys(split_end, mid) > 0
+                                       : CompareJoinKeys(mid, split_end) < 0;
+          if (other_less) {
+            low = mid + 1;
+          } else {
+            high = mid;
+          }
+        }
+        other_end = low;
       }
+    }
 
-      // Left key == Right key, go and check next join clause
+    if (split_end > split_begin || other_end > other_begin) {
+      MergePartition partition;
+      partition.left_begin = split_left ? split_begin : other_begin;
+      partition.left_end = split_left ? split_end : other_end;
+      partition.right_begin = split_left ? other_begin : split_begin;
+      partition.right_end = split_left ? other_end : split_end;
+      merge_partitions_.push_back(std::move(partition));
     }
 
-    // At least one of the join clauses don't match
-    // One of the tile has been advanced
-    if (not_matching_tuple_pair) {
+    split_begin = split_end;
+    other_begin = other_end;
+  }
+}
+
+/**
+ * @brief Merge-join the rows of one partition. This runs on a worker thread,
+ * so it must only touch the partition it is given.
+ */
+void MergeJoinExecutor::MergePartitionRows(MergePartition &partition) {
+  bool record_left =
+      (join_type_ == JOIN_TYPE_LEFT || join_type_ == JOIN_TYPE_OUTER);
+  bool record_right =
+      (join_type_ == JOIN_TYPE_RIGHT || join_type_ == JOIN_TYPE_OUTER);
+
+  // Matches are collected per pair of child tiles, since the position lists
+  // of an output tile refer to exactly one left and one right tile
+  std::unique_ptr<LogicalTile::PositionListsBuilder> pos_lists_builder;
+  size_t builder_left_tile = 0, builder_right_tile = 0;
+
+  auto flush_output_tile = [&]() {
+    if (pos_lists_builder != nullptr && pos_lists_builder->Size() > 0) {
+      auto output_tile =
+          BuildOutputLogicalTile(left_result_tiles_[builder_left_tile].get(),
+                                 right_result_tiles_[builder_right_tile].get());
+      output_tile->SetPositionListsAndVisibility(pos_lists_builder->Release());
+      partition.output_tiles.push_back(std::move(output_tile));
+    }
+    pos_lists_builder.reset();
+  };
+
+  size_t left_itr = partition.left_begin;
+  size_t right_itr = partition.right_begin;
+  while (left_itr < partition.left_end && right_itr < partition.right_end) {
+    int cmp = CompareJoinKeys(left_itr, right_itr);
+    if (cmp < 0) {
+      left_itr++;
+      continue;
+    } else if (cmp > 0) {
+      right_itr++;
       continue;
     }
 
-    // Join clauses matched, try to match predicate
-    LOG_TRACE("one pair of tuples matches join clause ");
-
-    // Join predicate exists
-    if (predicate_ != nullptr) {
-      auto eval = predicate_->Evaluate(&left_tuple,
-                                      &right_tuple, executor_context_);
-      if (eval.IsFalse()) {
-      //if (predicate_->Evaluate(&left_tuple, &right_tuple, executor_context_)
-      //        .IsFalse()) {
-        // Join predicate is false. Advance both.
-        left_start_row = left_end_row;
-        left_end_row = Advance(left_tile, left_start_row, true);
-
-        right_start_row = right_end_row;
-        right_end_row = Advance(right_tile, right_start_row, false);
+    // Find the groups of rows with the same key on both sides
+    size_t left_group_end =
+        FindJoinKeyGroupEnd(left_itr, partition.left_end, true);
+    size_t right_group_end =
+        FindJoinKeyGroupEnd(right_itr, partition.right_end, false);
+
+    // Cartesian product of the two groups
+    for (size_t left_group_itr = left_itr; left_group_itr < left_group_end;
+         left_group_itr++) {
+      auto &left_row = left_rows_[left_group_itr];
+      LogicalTile *left_tile = left_result_tiles_[left_row.first].get();
+      expression::ContainerTuple<executor::LogicalTile> left_tuple(
+          left_tile, left_row.second);
+
+      for (size_t right_group_itr = right_itr;
+           right_group_itr < right_group_end; right_group_itr++) {
+        auto &right_row = right_rows_[right_group_itr];
+        LogicalTile *right_tile = right_result_tiles_[right_row.first].get();
+        expression::ContainerTuple<executor::LogicalTile> right_tuple(
+            right_tile, right_row.second);
+
+        if (predicate_ != nullptr &&
+            predicate_->Evaluate(&left_tuple, &right_tuple, executor_context_)
+                .IsFalse()) {
+          continue;
+        }
+
+        if (pos_lists_builder == nullptr ||
+            builder_left_tile != left_row.first ||
+            builder_right_tile != right_row.first) {
+          flush_output_tile();
+          pos_lists_builder.reset(
+              new LogicalTile::PositionListsBuilder(left_tile, right_tile));
+          builder_left_tile = left_row.first;
+          builder_right_tile = right_row.first;
+        }
+        pos_lists_builder->AddRow(left_row.second, right_row.second);
+
+        if (record_left) partition.matched_left_rows.push_back(left_row);
+        if (record_right) partition.matched_right_rows.push_back(right_row);
       }
     }
 
-    // Sub tile matched, do a Cartesian product
-    // Go over every pair of tuples in left and right logical tiles
-    for (size_t left_tile_row_itr = left_start_row;
-         left_tile_row_itr < left_end_row; left_tile_row_itr++) {
-      for (size_t right_tile_row_itr = right_start_row;
-           right_tile_row_itr < right_end_row; right_tile_row_itr++) {
-        // Insert a tuple into the output logical tile
-        pos_lists_builder.AddRow(left_tile_row_itr, right_tile_row_itr);
-
-        RecordMatchedLeftRow(left_result_tiles_.size() - 1, left_tile_row_itr);
-        RecordMatchedRightRow(right_result_tiles_.size() - 1,
-                              right_tile_row_itr);
-      }
-    }
+    left_itr = left_group_end;
+    right_itr = right_group_end;
+  }
 
-    // Then, advance both if necessary
-    right_start_row = right_end_row;
-    right_end_row = Advance(right_tile, right_start_row, false);
+  flush_output_tile();
+}
 
-    if (right_start_row != right_end_row) {
-      left_start_row = left_end_row;
-      left_end_row = Advance(left_tile, left_start_row, true);
+/**
+ * @brief Normalize the join keys into integers if every join clause compares
+ * a left column with a right column of the same fixed-width type, and all the
+ * columns fit into one key. Otherwise the join keys are compared as values.
+ */
+void MergeJoinExecutor::InitJoinKeyNormalizer() {
+  join_key_normalizer_.reset();
+
+  std::vector<common::Type::TypeId> key_types;
+  for (auto &clause : *join_clauses_) {
+    if (clause.left_->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE ||
+        clause.right_->GetExpressionType() != EXPRESSION_TYPE_VALUE_TUPLE) {
+      return;
+    }
+    auto left_expr =
+        static_cast<const expression::TupleValueExpression *>(
+            clause.left_.get());
+    auto right_expr =
+        static_cast<const expression::TupleValueExpression *>(
+            clause.right_.get());
+    if (left_expr->GetTupleId() != 0 || right_expr->GetTupleId() != 1 ||
+        left_expr->GetValueType() != right_expr->GetValueType()) {
+      return;
     }
+    key_types.push_back(left_expr->GetValueType());
   }
 
-  // Check if we have any join tuples.
-  if (pos_lists_builder.Size() > 0) {
-    output_tile->SetPositionListsAndVisibility(pos_lists_builder.Release());
-    SetOutput(output_tile.release());
-    return true;
-  }
-  // Try again
-  else {
-    // If we are out of any more pairs of child tiles to examine,
-    // then we will return false earlier in this function
-    // So, no need to return false here
-    DExecute();
-  }
+  if (!util::SortKeyNormalizer::CanNormalize(key_types)) return;
 
-  return true;
+  join_key_normalizer_.reset(new util::SortKeyNormalizer(
+      key_types, std::vector<bool>(key_types.size(), false)));
+  if (!join_key_normalizer_->IsExact()) join_key_normalizer_.reset();
 }
 
 /**
- * @brief Advance the row iterator until value changes in terms of the join
- * clauses
- * @return the end row number, [start_row, end_row) are the rows of the same
- * value
- *         if the end_row == start_row, the subset is empty
+ * @brief Normalize the join keys of the visible rows of a tile, in the order
+ * of the rows.
+ * If a key is null or its value does not have the type of the plan, the
+ * normalizer is dropped and the join keys are compared as values from now on.
+ * @return true if the keys were extracted
  */
-size_t MergeJoinExecutor::Advance(LogicalTile *tile, size_t start_row,
-                                  bool is_left) {
-  size_t end_row = start_row + 1;
-  size_t this_row = start_row;
-  size_t tuple_count = tile->GetTupleCount();
-  if (start_row >= tuple_count) return start_row;
-
-  while (end_row < tuple_count) {
-    expression::ContainerTuple<executor::LogicalTile> this_tuple(tile,
-                                                                 this_row);
-    expression::ContainerTuple<executor::LogicalTile> next_tuple(tile, end_row);
-
-    bool diff = false;
-
-    for (auto &clause : *join_clauses_) {
-      // Go through each join clauses
-      auto expr = is_left ? clause.left_.get() : clause.right_.get();
-      auto this_value =
-          expr->Evaluate(&this_tuple, &this_tuple, executor_context_);
-      auto next_value =
-          expr->Evaluate(&next_tuple, &next_tuple, executor_context_);
-
-      common::Value cmp = (
-          this_value.CompareEquals(next_value));
-      if (!cmp.IsTrue()) {
-        diff = true;
-        break;
+bool MergeJoinExecutor::ExtractJoinKeys(
+    LogicalTile *tile, bool is_left, std::vector<util::sort_key64_type> &keys) {
+  keys.clear();
+  if (join_key_normalizer_ == nullptr) return false;
+
+  for (oid_t row : *tile) {
+    util::sort_key64_type key = 0;
+    for (size_t clause_itr = 0; clause_itr < join_clauses_->size();
+         clause_itr++) {
+      auto &clause = (*join_clauses_)[clause_itr];
+      auto expr = static_cast<const expression::TupleValueExpression *>(
+          is_left ? clause.left_.get() : clause.right_.get());
+      auto value = tile->GetValue(row, expr->GetColumnId());
+      if (value.IsNull() || value.GetTypeId() != expr->GetValueType()) {
+        join_key_normalizer_.reset();
+        keys.clear();
+        return false;
       }
+      key = join_key_normalizer_->AddColumn(key, clause_itr, value);
+    }
+    keys.push_back(key);
+  }
+  return true;
+}
+
+/**
+ * @brief Collect the rows of all buffered tiles of a child in order, and
+ * their normalized join keys.
+ */
+void MergeJoinExecutor::BuildJoinRows(bool is_left) {
+  auto &tiles = is_left ? left_result_tiles_ : right_result_tiles_;
+  auto &rows = is_left ? left_rows_ : right_rows_;
+  auto &row_keys = is_left ? left_row_keys_ : right_row_keys_;
+
+  std::vector<util::sort_key64_type> tile_keys;
+  for (size_t tile_itr = 0; tile_itr < tiles.size(); tile_itr++) {
+    if (ExtractJoinKeys(tiles[tile_itr].get(), is_left, tile_keys)) {
+      row_keys.insert(row_keys.end(), tile_keys.begin(), tile_keys.end());
+    }
+    for (oid_t row : *tiles[tile_itr]) {
+      rows.emplace_back(tile_itr, row);
+    }
+  }
+}
+
+/**
+ * @brief Compare the join key values of a left row and a right row
+ * @return negative if left < right, positive if left > right, 0 otherwise
+ */
+int MergeJoinExecutor::CompareTileJoinKeys(LogicalTile *left_tile,
+                                           oid_t left_row,
+                                           LogicalTile *right_tile,
+                                           oid_t right_row) {
+  expression::ContainerTuple<executor::LogicalTile> left_tuple(left_tile,
+                                                               left_row);
+  expression::ContainerTuple<executor::LogicalTile> right_tuple(right_tile,
+                                                                right_row);
+
+  for (auto &clause : *join_clauses_) {
+    auto left_value =
+        clause.left_->Evaluate(&left_tuple, &right_tuple, nullptr);
+    auto right_value =
+        clause.right_->Evaluate(&left_tuple, &right_tuple, nullptr);
+
+    if (left_value.CompareLessThan(right_value).IsTrue()) {
+      return -1;
+    } else if (left_value.CompareGreaterThan(right_value).IsTrue()) {
+      return 1;
     }
+  }
+  return 0;
+}
+
+/**
+ * @brief Compare the join keys of the left_itr-th left row and the
+ * right_itr-th right row
+ * @return negative if left < right, positive if left > right, 0 otherwise
+ */
+int MergeJoinExecutor::CompareJoinKeys(size_t left_itr, size_t right_itr) {
+  if (join_key_normalizer_ != nullptr) {
+    auto left_key = left_row_keys_[left_itr];
+    auto right_key = right_row_keys_[right_itr];
+    return left_key < right_key ? -1 : (left_key > right_key ? 1 : 0);
+  }
 
-    if (diff) {
-      break;
+  auto &left_row = left_rows_[left_itr];
+  auto &right_row = right_rows_[right_itr];
+  return CompareTileJoinKeys(left_result_tiles_[left_row.first].get(),
+                             left_row.second,
+                             right_result_tiles_[right_row.first].get(),
+                             right_row.second);
+}
+
+/**
+ * @brief Check if two rows of the same child have equal join key values
+ */
+bool MergeJoinExecutor::HasSameJoinKey(LogicalTile *tile, oid_t row,
+                                       LogicalTile *other_tile, oid_t other_row,
+                                       bool is_left) {
+  expression::ContainerTuple<executor::LogicalTile> this_tuple(tile, row);
+  expression::ContainerTuple<executor::LogicalTile> other_tuple(other_tile,
+                                                                other_row);
+
+  for (auto &clause : *join_clauses_) {
+    auto expr = is_left ? clause.left_.get() : clause.right_.get();
+    auto this_value = expr->Evaluate(&this_tuple, &this_tuple, nullptr);
+    auto other_value = expr->Evaluate(&other_tuple, &other_tuple, nullptr);
+    if (!this_value.CompareEquals(other_value).IsTrue()) {
+      return false;
     }
+  }
+  return true;
+}
 
-    // the two tuples are the same, we advance by 1
-    this_row = end_row;
-    end_row++;
+/**
+ * @brief Find the end of the group of rows of a child with the same join key
+ * as the row_itr-th row, up to the end-th row
+ */
+size_t MergeJoinExecutor::FindJoinKeyGroupEnd(size_t row_itr, size_t end,
+                                              bool is_left) {
+  if (join_key_normalizer_ != nullptr) {
+    auto &row_keys = is_left ? left_row_keys_ : right_row_keys_;
+    return GallopKeyGroupEnd(row_keys.data(), row_itr, end);
   }
 
-  LOG_TRACE("Advanced %s with subset size %lu ", is_left ? "left" : "right",
-            end_row - start_row);
-  return end_row;
+  auto &tiles = is_left ? left_result_tiles_ : right_result_tiles_;
+  auto &rows = is_left ? left_rows_ : right_rows_;
+  auto &row = rows[row_itr];
+  size_t group_end = row_itr + 1;
+  while (group_end < end &&
+         HasSameJoinKey(tiles[row.first].get(), row.second,
+                        tiles[rows[group_end].first].get(),
+                        rows[group_end].second, is_left)) {
+    group_end++;
+  }
+  return group_end;
 }
 
 }  // namespace executor
@@ -0,0 +1,284 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// merge_set_op_executor.cpp
+//
+// Identification: src/executor/merge_set_op_executor.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <utility>
+#include <vector>
+
+#include "common/logger.h"
+#include "executor/logical_tile_factory.h"
+#include "executor/merge_set_op_executor.h"
+#include "executor/order_by_executor.h"
+#include "planner/order_by_plan.h"
+#include "planner/set_op_plan.h"
+
+namespace peloton {
+namespace executor {
+
+/**
+ * @brief Constructor
+ */
+MergeSetOpExecutor::MergeSetOpExecutor(const planner::AbstractPlan *node,
+                                       ExecutorContext *executor_context)
+    : AbstractExecutor(node, executor_context) {}
+
+MergeSetOpExecutor::~MergeSetOpExecutor() {}
+
+void MergeSetOpExecutor::UseInputSort(oid_t column_count) {
+  PL_ASSERT(children_.size() == 2);
+  PL_ASSERT(sort_executors_.empty());
+
+  std::vector<oid_t> column_ids;
+  for (oid_t column_itr = 0; column_itr < column_count; column_itr++) {
+    column_ids.push_back(column_itr);
+  }
+  sort_plan_.reset(new planner::OrderByPlan(
+      column_ids, std::vector<bool>(column_count, false), column_ids));
+
+  // Put a sort between this executor and each of its children
+  for (auto &child : children_) {
+    sort_executors_.emplace_back(
+        new OrderByExecutor(sort_plan_.get(), executor_context_));
+    sort_executors_.back()->UseAVX2Sort();
+    sort_executors_.back()->AddChild(child);
+    child = sort_executors_.back().get();
+  }
+}
+
+/**
+ * @brief Do some basic checks and initialize executor state.
+ * @return true on success, false otherwise.
+ */
+bool MergeSetOpExecutor::DInit() {
+  PL_ASSERT(children_.size() == 2);
+
+  const planner::SetOpPlan &node = GetPlanNode<planner::SetOpPlan>();
+  set_op_ = node.GetSetOp();
+  if (set_op_ == SETOP_TYPE_INVALID) return false;
+
+  left_cursor_ = SetOpCursor();
+  right_cursor_ = SetOpCursor();
+  merge_done_ = false;
+  output_source_ = nullptr;
+  output_rows_.clear();
+  output_tiles_.clear();
+
+  return true;
+}
+
+bool MergeSetOpExecutor::DExecute() {
+  LOG_TRACE("Merge Set Op executor ");
+
+  while (output_tiles_.empty() && merge_done_ == false) {
+    MergeNextGroup();
+  }
+
+  if (output_tiles_.empty()) return false;
+
+  SetOutput(output_tiles_.front().release());
+  output_tiles_.pop_front();
+  return true;
+}
+
+/**
+ * @brief Consume the group of equal rows with the smallest key of both
+ * children, and select its output rows. The right rows of INTERSECT and
+ * EXCEPT are only counted; the left rows are kept as follows, where the
+ * j-th copy of a group is kept if
+ *   INTERSECT: j = 0 and the right group is not empty
+ *   INTERSECT ALL: j < size of the right group
+ *   EXCEPT: j = 0 and the right group is empty
+ *   EXCEPT ALL: j >= size of the right group
+ * UNION keeps the first left copy, or the first right copy if the left group
+ * is empty, and UNION ALL keeps all of them.
+ */
+void MergeSetOpExecutor::MergeNextGroup() {
+  bool left_has_row = CursorHasRow(left_cursor_, 0);
+  bool right_has_row = CursorHasRow(right_cursor_, 1);
+  if (!left_has_row && !right_has_row) {
+    FlushOutputTile();
+    merge_done_ = true;
+    return;
+  }
+
+  // The key of the group is the smaller current row. It is copied, since
+  // its tile may be released while the group is scanned
+  bool key_from_left =
+      left_has_row && (!right_has_row || CompareCursorRows() <= 0);
+  auto &key_cursor = key_from_left ? left_cursor_ : right_cursor_;
+  auto key_tile = key_cursor.tile.get();
+  auto key_row = key_cursor.rows[key_cursor.row_itr];
+  std::vector<common::Value> key;
+  for (oid_t column_itr = 0; column_itr < key_tile->GetColumnCount();
+       column_itr++) {
+    key.push_back(key_tile->GetValue(key_row, column_itr).Copy());
+  }
+
+  switch (set_op_) {
+    case SETOP_TYPE_UNION:
+    case SETOP_TYPE_UNION_ALL: {
+      bool all = (set_op_ == SETOP_TYPE_UNION_ALL);
+      size_t left_count =
+          ScanGroup(left_cursor_, 0, key,
+                    [all](size_t copy_itr) { return all || copy_itr == 0; });
+      ScanGroup(right_cursor_, 1, key, [all, left_count](size_t copy_itr) {
+        return all || (copy_itr == 0 && left_count == 0);
+      });
+      break;
+    }
+    default: {
+      size_t right_count =
+          ScanGroup(right_cursor_, 1, key, [](size_t) { return false; });
+      auto set_op = set_op_;
+      ScanGroup(left_cursor_, 0, key, [set_op, right_count](size_t copy_itr) {
+        switch (set_op) {
+          case SETOP_TYPE_INTERSECT:
+            return copy_itr == 0 && right_count > 0;
+          case SETOP_TYPE_INTERSECT_ALL:
+            return copy_itr < right_count;
+          case SETOP_TYPE_EXCEPT:
+            return copy_itr == 0 && right_count == 0;
+          case SETOP_TYPE_EXCEPT_ALL:
+            return copy_itr >= right_count;
+          default:
+            return false;
+        }
+      });
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Make sure the cursor points to a row, reading the next non-empty
+ * tile of the child if the current one is used up.
+ * @return false if the child has no more rows
+ */
+bool MergeSetOpExecutor::CursorHasRow(SetOpCursor &cursor, size_t child_itr) {
+  while (cursor.row_itr >= cursor.rows.size()) {
+    if (cursor.child_done) return false;
+
+    // The selected rows of the old tile go out before it is released
+    if (cursor.tile != nullptr && output_source_ == cursor.tile.get()) {
+      FlushOutputTile();
+    }
+    cursor.tile.reset();
+    cursor.rows.clear();
+    cursor.row_itr = 0;
+
+    if (children_[child_itr]->Execute() == false) {
+      cursor.child_done = true;
+      return false;
+    }
+    cursor.tile.reset(children_[child_itr]->GetOutput());
+    for (oid_t row : *cursor.tile) {
+      cursor.rows.push_back(row);
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Compare the current row of a cursor with a key
+ * @return negative if row < key, positive if row > key, 0 otherwise
+ */
+int MergeSetOpExecutor::CompareRow(SetOpCursor &cursor,
+                                   const std::vector<common::Value> &key) {
+  auto row = cursor.rows[cursor.row_itr];
+  for (oid_t column_itr = 0; column_itr < key.size(); column_itr++) {
+    int cmp = OrderByExecutor::CompareSortValues(
+        cursor.tile->GetValue(row, column_itr), key[column_itr]);
+    if (cmp != 0) return cmp;
+  }
+  return 0;
+}
+
+/**
+ * @brief Compare the current rows of the two cursors
+ * @return negative if left < right, positive if left > right, 0 otherwise
+ */
+int MergeSetOpExecutor::CompareCursorRows() {
+  auto left_row = left_cursor_.rows[left_cursor_.row_itr];
+  auto right_row = right_cursor_.rows[right_cursor_.row_itr];
+  for (oid_t column_itr = 0;
+       column_itr < left_cursor_.tile->GetColumnCount(); column_itr++) {
+    int cmp = OrderByExecutor::CompareSortValues(
+        left_cursor_.tile->GetValue(left_row, column_itr),
+        right_cursor_.tile->GetValue(right_row, column_itr));
+    if (cmp != 0) return cmp;
+  }
+  return 0;
+}
+
+/**
+ * @brief Move a cursor past all rows equal to key, which may span several
+ * tiles, and output the copies for which emit(copy index) is true.
+ * @return the number of rows equal to key
+ */
+template <typename Emit>
+size_t MergeSetOpExecutor::ScanGroup(SetOpCursor &cursor, size_t child_itr,
+                                     const std::vector<common::Value> &key,
+                                     Emit emit) {
+  size_t count = 0;
+  while (CursorHasRow(cursor, child_itr) && CompareRow(cursor, key) == 0) {
+    if (emit(count)) {
+      AddOutputRow(cursor.tile.get(), cursor.rows[cursor.row_itr]);
+    }
+    count++;
+    cursor.row_itr++;
+  }
+  return count;
+}
+
+/**
+ * @brief Select a row for the output. Consecutive rows of the same child tile
+ * share an output tile.
+ */
+void MergeSetOpExecutor::AddOutputRow(LogicalTile *tile, oid_t row) {
+  if (output_source_ != tile) {
+    FlushOutputTile();
+    output_source_ = tile;
+  }
+  output_rows_.push_back(row);
+}
+
+/**
+ * @brief Build an output tile over the columns of output_source_ that holds
+ * the selected rows. It refers to the base tiles, so the source tile can be
+ * released afterwards.
+ */
+void MergeSetOpExecutor::FlushOutputTile() {
+  if (output_source_ != nullptr && output_rows_.empty() == false) {
+    auto &source_pos_lists = output_source_->GetPositionLists();
+    LogicalTile::PositionLists pos_lists(source_pos_lists.size());
+    for (size_t list_itr = 0; list_itr < source_pos_lists.size();
+         list_itr++) {
+      auto &source_pos_list = source_pos_lists[list_itr];
+      auto &pos_list = pos_lists[list_itr];
+      pos_list.reserve(output_rows_.size());
+      for (oid_t row : output_rows_) {
+        pos_list.push_back(source_pos_list[row]);
+      }
+    }
+
+    std::unique_ptr<LogicalTile> output_tile(LogicalTileFactory::GetTile());
+    auto schema = output_source_->GetSchema();
+    output_tile->SetSchema(std::move(schema));
+    output_tile->SetPositionListsAndVisibility(std::move(pos_lists));
+    output_tiles_.push_back(std::move(output_tile));
+  }
+
+  output_source_ = nullptr;
+  output_rows_.clear();
+}
+
+}  // namespace executor
+}  // namespace peloton
@@ -11,8 +11,14 @@
 //===----------------------------------------------------------------------===//
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <thread>
 
 #include "common/logger.h"
+#include "common/serializeio.h"
 #include "common/varlen_pool.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
@@ -22,11 +28,59 @@
 #include "planner/order_by_plan.h"
 #include "storage/tile.h"
 
+#include "util/parallel_sort.h"
 #include "util/simd_merge_sort.h"
+#include "util/sort_key_normalizer.h"
 
 namespace peloton {
 namespace executor {
 
+namespace {
+
+/**
+ * @brief Sort keys[0, len) and their payloads without the SIMD kernels.
+ */
+void SortKeysScalar(util::sort_key64_type *keys,
+                    util::sort_payload_type *payloads, size_t len) {
+  std::vector<std::pair<util::sort_key64_type, util::sort_payload_type>>
+      entries(len);
+  for (size_t entry_itr = 0; entry_itr < len; entry_itr++) {
+    entries[entry_itr] = std::make_pair(keys[entry_itr], payloads[entry_itr]);
+  }
+  std::sort(entries.begin(), entries.end());
+  for (size_t entry_itr = 0; entry_itr < len; entry_itr++) {
+    keys[entry_itr] = entries[entry_itr].first;
+    payloads[entry_itr] = entries[entry_itr].second;
+  }
+}
+
+/**
+ * @brief Three-way comparison of two rows in sort order, where get_a(id) and
+ * get_b(id) return the id-th sort key of the rows. Nulls come first in
+ * ascending and last in descending order, like in the normalized keys.
+ */
+template <typename GetA, typename GetB>
+int CompareSortKeys(const std::vector<bool> &descend_flags, GetA get_a,
+                    GetB get_b) {
+  for (oid_t id = 0; id < descend_flags.size(); id++) {
+    int cmp = OrderByExecutor::CompareSortValues(get_a(id), get_b(id));
+    if (cmp != 0) return descend_flags[id] ? -cmp : cmp;
+  }
+  return 0;  // all keys equal
+}
+
+}  // namespace
+
+int OrderByExecutor::CompareSortValues(const common::Value &a,
+                                       const common::Value &b) {
+  if (a.IsNull() || b.IsNull()) {
+    return (a.IsNull() ? 0 : 1) - (b.IsNull() ? 0 : 1);
+  }
+  if (a.CompareLessThan(b).IsTrue()) return -1;
+  if (a.CompareGreaterThan(b).IsTrue()) return 1;
+  return 0;
+}
+
 /**
  * @brief Constructor
  * @param node  OrderByNode plan node corresponding to this executor
@@ -35,91 +89,77 @@ OrderByExecutor::OrderByExecutor(const planner::AbstractPlan *node,
                                  ExecutorContext *executor_context)
     : AbstractExecutor(node, executor_context) {}
 
+void OrderByExecutor::UseExternalSort(size_t memory_budget) {
+  sort_memory_budget_ = memory_budget;
+}
+
 OrderByExecutor::~OrderByExecutor() {}
 
+void OrderByExecutor::UseParallelSort(size_t partition_count) {
+  if (partition_count == 0) {
+    partition_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  sort_partition_count_ = partition_count;
+}
+
 bool OrderByExecutor::DInit() {
   PL_ASSERT(children_.size() == 1);
 
-  use_simd_sort_ = false;
+  // The sort options (SIMD kernel, partitions, memory budget) are set
+  // before Init() and are not reset here
   sort_done_ = false;
   num_tuples_returned_ = 0;
+  sorted_runs_.clear();
+  run_heap_.clear();
+  top_tuples_.clear();
+  spilled_tuple_count_ = 0;
+  buffered_bytes_ = 0;
 
   return true;
 }
 
 bool OrderByExecutor::DExecute() {
-  size_t sort_buffer_size = 0, tile_size = 0;
-  std::shared_ptr<storage::Tile> ptile;
-
   LOG_TRACE("Order By executor ");
 
   if (!sort_done_) DoSort();
 
-  if (int_sort_ == true) {
-    if (!(num_tuples_returned_ < simd_sort_buffer_size_)) {
-      return false;
-    }
+  if (GetPlanNode<planner::OrderByPlan>().HasLimit()) {
+    return ExecuteTopTuples();
+  }
 
-    PL_ASSERT(sort_done_);
-    PL_ASSERT(input_schema_.get());
-    PL_ASSERT(input_tiles_.size() > 0);
-
-    // Returned tiles must be newly created physical tiles,
-    // which have the same physical schema as input tiles.
-    tile_size = std::min(size_t(DEFAULT_TUPLES_PER_TILEGROUP),
-                                simd_sort_buffer_size_ - num_tuples_returned_);
-
-    ptile.reset(storage::TileFactory::GetTile(
-        BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
-        nullptr, *input_schema_, nullptr, tile_size));
-
-    for (size_t id=0; id < tile_size; id++) {
-      oid_t source_tile_id, source_tuple_id;
-      simd_sort_buffer_[num_tuples_returned_ + id].deserialize(source_tile_id,
-                                                               source_tuple_id);
-      // Insert a physical tuple into physical tile
-      for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
-        common::Value val = (
-            input_tiles_[source_tile_id]->GetValue(source_tuple_id, col));
-        ptile.get()->SetValue(val, id, col);
-      }
-    }
-    PL_ASSERT(num_tuples_returned_+tile_size <= simd_sort_buffer_size_);
-  } else {
-    sort_buffer_size = sort_buffer_.size();
-    if (!(num_tuples_returned_ < sort_buffer_size)) {
-      return false;
-    }
+  if (!sorted_runs_.empty()) return ExecuteRunMerge();
 
-    PL_ASSERT(sort_done_);
-    PL_ASSERT(input_schema_.get());
-    PL_ASSERT(input_tiles_.size() > 0);
-
-    // Returned tiles must be newly created physical tiles,
-    // which have the same physical schema as input tiles.
-    tile_size = std::min(size_t(DEFAULT_TUPLES_PER_TILEGROUP),
-                                sort_buffer_size - num_tuples_returned_);
-
-    ptile.reset(storage::TileFactory::GetTile(
-        BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
-        nullptr, *input_schema_, nullptr, tile_size));
-
-    for (size_t id = 0; id < tile_size; id++) {
-      oid_t source_tile_id =
-          sort_buffer_[num_tuples_returned_ + id].item_pointer.block;
-      oid_t source_tuple_id =
-          sort_buffer_[num_tuples_returned_ + id].item_pointer.offset;
-      // Insert a physical tuple into physical tile
-      for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
-        common::Value val = (
-            input_tiles_[source_tile_id]->GetValue(source_tuple_id, col));
-        ptile.get()->SetValue(val, id, col);
-      }
-    }
+  size_t sorted_tuple_count = GetSortedTupleCount();
+  if (!(num_tuples_returned_ < sorted_tuple_count)) {
+    return false;
+  }
 
-    PL_ASSERT(num_tuples_returned_+tile_size <= sort_buffer_size);
+  PL_ASSERT(sort_done_);
+  PL_ASSERT(input_schema_.get());
+  PL_ASSERT(input_tiles_.size() > 0);
+
+  // Returned tiles must be newly created physical tiles,
+  // which have the same physical schema as input tiles.
+  size_t tile_size = std::min(size_t(DEFAULT_TUPLES_PER_TILEGROUP),
+                              sorted_tuple_count - num_tuples_returned_);
+
+  std::shared_ptr<storage::Tile> ptile(storage::TileFactory::GetTile(
+      BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
+      nullptr, *input_schema_, nullptr, tile_size));
+
+  for (size_t id = 0; id < tile_size; id++) {
+    oid_t source_tile_id, source_tuple_id;
+    GetSortedTuple(num_tuples_returned_ + id, source_tile_id, source_tuple_id);
+    // Insert a physical tuple into physical tile
+    for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
+      common::Value val = (
+          input_tiles_[source_tile_id]->GetValue(source_tuple_id, col));
+      ptile.get()->SetValue(val, id, col);
+    }
   }
 
+  PL_ASSERT(num_tuples_returned_+tile_size <= sorted_tuple_count);
+
   // Create an owner wrapper of this physical tile
   std::vector<std::shared_ptr<storage::Tile>> singleton({ptile});
   std::unique_ptr<LogicalTile> ltile(LogicalTileFactory::WrapTiles(singleton));
@@ -132,6 +172,23 @@ bool OrderByExecutor::DExecute() {
   return true;
 }
 
+size_t OrderByExecutor::GetSortedTupleCount() const {
+  return int_sort_ ? simd_sort_buffer_size_ : sort_buffer_.size();
+}
+
+/**
+ * @brief Locate the tuple at the given position of the sorted order.
+ */
+void OrderByExecutor::GetSortedTuple(size_t position, oid_t &tile_id,
+                                     oid_t &tuple_id) const {
+  if (int_sort_) {
+    DecodeSortPayload(simd_sort_payloads_[position], tile_id, tuple_id);
+  } else {
+    tile_id = sort_buffer_[position].item_pointer.block;
+    tuple_id = sort_buffer_[position].item_pointer.offset;
+  }
+}
+
 bool OrderByExecutor::DoSort() {
   PL_ASSERT(children_.size() == 1);
   PL_ASSERT(children_[0] != nullptr);
@@ -142,85 +199,206 @@ bool OrderByExecutor::DoSort() {
       std::chrono::duration_cast<std::chrono::microseconds>(
           std::chrono::steady_clock::now().time_since_epoch()).count());
 
+  // Grab data from plan node
+  const planner::OrderByPlan &node = GetPlanNode<planner::OrderByPlan>();
+  descend_flags_ = node.GetDescendFlags();
+  sort_keys_ = node.GetSortKeys();
+
   // Extract all data from child
+  // With a limit, only the top tuples of every tile are kept.
+  // With a memory budget, the buffered tiles are sorted and spilled to a run
+  // whenever their estimated size exceeds the budget
   while (children_[0]->Execute()) {
     input_tiles_.emplace_back(children_[0]->GetOutput());
+    if (node.HasLimit()) {
+      AddTopTupleCandidates(node.GetLimit());
+      continue;
+    }
+    if (sort_memory_budget_ == 0) continue;
+
+    if (input_schema_.get() == nullptr) {
+      input_schema_.reset(input_tiles_.back()->GetPhysicalSchema());
+    }
+    buffered_bytes_ += input_tiles_.back()->GetEstimatedSize();
+    if (buffered_bytes_ > sort_memory_budget_) {
+      SpillSortedRun();
+    }
   }
 
+  if (node.HasLimit()) {
+    // The heap holds the worst candidate on top, so this sorts it ascending
+    std::sort_heap(top_tuples_.begin(), top_tuples_.end(), TopTupleLess{this});
+  } else if (!sorted_runs_.empty()) {
+    // Spill the rest as well, so that all tuples are merged from the runs
+    if (!input_tiles_.empty()) SpillSortedRun();
+    InitRunMerge();
+  } else {
+    SortInputTiles();
+  }
+
+  sort_done_ = true;
+
+  auto end = static_cast<double>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count());
+
+  LOG_ERROR("Sort time:%f", (end-start)/1000);
+  return true;
+}
+
+/**
+ * @brief Merge the tuples of the last input tile into the max-heap of the
+ * limit best tuples seen so far, and release the tile.
+ * A tuple only has to be copied if it goes before the worst candidate.
+ */
+void OrderByExecutor::AddTopTupleCandidates(size_t limit) {
+  std::unique_ptr<LogicalTile> tile(input_tiles_.back().release());
+  input_tiles_.pop_back();
+
+  if (input_schema_.get() == nullptr) {
+    input_schema_.reset(tile->GetPhysicalSchema());
+  }
+  if (limit == 0) return;
+
+  TopTupleLess comp{this};
+  for (oid_t tuple_id : *tile) {
+    if (top_tuples_.size() == limit) {
+      auto &worst = top_tuples_.front();
+      int cmp = CompareSortKeys(descend_flags_, [&](oid_t id) {
+        return tile->GetValue(tuple_id, sort_keys_[id]);
+      }, [&](oid_t id) { return worst[sort_keys_[id]]; });
+      if (cmp >= 0) continue;
+      std::pop_heap(top_tuples_.begin(), top_tuples_.end(), comp);
+      top_tuples_.pop_back();
+    }
+
+    std::vector<common::Value> tuple;
+    for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
+      tuple.push_back(tile->GetValue(tuple_id, col));
+    }
+    top_tuples_.push_back(std::move(tuple));
+    std::push_heap(top_tuples_.begin(), top_tuples_.end(), comp);
+  }
+}
+
+bool OrderByExecutor::TopTupleLess::operator()(
+    const std::vector<common::Value> &a,
+    const std::vector<common::Value> &b) const {
+  auto &sort_keys = executor->sort_keys_;
+  return CompareSortKeys(executor->descend_flags_, [&](oid_t id) {
+    return a[sort_keys[id]];
+  }, [&](oid_t id) { return b[sort_keys[id]]; }) < 0;
+}
+
+/**
+ * @brief Return the next tile of the sorted top tuples.
+ */
+bool OrderByExecutor::ExecuteTopTuples() {
+  if (!(num_tuples_returned_ < top_tuples_.size())) return false;
+
+  size_t tile_size = std::min(size_t(DEFAULT_TUPLES_PER_TILEGROUP),
+                              top_tuples_.size() - num_tuples_returned_);
+
+  std::shared_ptr<storage::Tile> ptile(storage::TileFactory::GetTile(
+      BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
+      nullptr, *input_schema_, nullptr, tile_size));
+
+  for (size_t id = 0; id < tile_size; id++) {
+    auto &tuple = top_tuples_[num_tuples_returned_ + id];
+    for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
+      ptile.get()->SetValue(tuple[col], id, col);
+    }
+  }
+
+  // Create an owner wrapper of this physical tile
+  std::vector<std::shared_ptr<storage::Tile>> singleton({ptile});
+  std::unique_ptr<LogicalTile> ltile(LogicalTileFactory::WrapTiles(singleton));
+  PL_ASSERT(ltile->GetTupleCount() == tile_size);
+
+  SetOutput(ltile.release());
+
+  num_tuples_returned_ += tile_size;
+
+  return true;
+}
+
+/**
+ * @brief Sort the tuples of all buffered input tiles, either in the SIMD
+ * sort buffer or in the sort buffer.
+ */
+void OrderByExecutor::SortInputTiles() {
   /** Number of valid tuples to be sorted. */
   size_t count = 0;
   for (auto &tile : input_tiles_) {
     count += tile->GetTupleCount();
   }
 
-  if (count == 0) return true;
+  if (count == 0) return;
 
-  // Grab data from plan node
   const planner::OrderByPlan &node = GetPlanNode<planner::OrderByPlan>();
-  descend_flags_ = node.GetDescendFlags();
 
   // Extract the schema for sort keys.
-  input_schema_.reset(input_tiles_[0]->GetPhysicalSchema());
+  if (input_schema_.get() == nullptr) {
+    input_schema_.reset(input_tiles_[0]->GetPhysicalSchema());
+  }
   std::vector<catalog::Column> sort_key_columns;
+  std::vector<common::Type::TypeId> sort_key_types;
   for (auto id : node.GetSortKeys()) {
     sort_key_columns.push_back(input_schema_->GetColumn(id));
+    sort_key_types.push_back(input_schema_->GetColumn(id).GetType());
   }
 
-  // use simd sort if we have a single integer column
-  // being sorted in ascending order
-  if (sort_key_columns.size() == 1  && descend_flags_[0] == false &&
-      sort_key_columns[0].GetType() == common::Type::INTEGER) {
+  // use simd sort if all the sort key columns are integers or timestamps,
+  // which are normalized into unsigned 64-bit keys
+  if (util::SortKeyNormalizer::CanNormalize(sort_key_types)) {
+    util::SortKeyNormalizer normalizer(sort_key_types, descend_flags_);
     int_sort_ = true;
     simd_sort_buffer_size_= count;
-    size_t padded_count = count;
-    simd_sort_entry_t *temp;
-
-    if (count%64 != 0) {
-      padded_count = ((count+64)/64)*64;
-    }
-
-    if (posix_memalign((void **)&simd_sort_buffer_, 32,
-                       padded_count*sizeof(simd_sort_entry_t)) != 0) {
-      throw std::bad_alloc();
-    }
-
-    if (posix_memalign((void **)&temp, 32,
-                       padded_count*sizeof(simd_sort_entry_t)) != 0) {
-      throw std::bad_alloc();
-    }
+    simd_sort_keys_.assign(count, 0);
+    simd_sort_payloads_.assign(count, 0);
 
+    // Every tile is serialized into its own range of the sort buffer,
+    // so the tiles can be extracted in parallel
+    std::vector<std::function<void()>> extract_tasks;
     size_t i=0;
     for (oid_t tile_id = 0; tile_id < input_tiles_.size(); tile_id++) {
-      for (oid_t tuple_id : *input_tiles_[tile_id]) {
-        common::Value value =
-            input_tiles_[tile_id]->GetValue(tuple_id, node.GetSortKeys()[0]);
-        PL_ASSERT(tuple_id < (oid_t)DEFAULT_TUPLES_PER_TILEGROUP);
-        simd_sort_buffer_[i++].serialize(value.GetAs<int32_t>(),
-                                       tile_id, tuple_id);
-      }
+      auto extract_tile = [this, &node, &normalizer, tile_id](size_t offset) {
+        auto &sort_keys = node.GetSortKeys();
+        for (oid_t tuple_id : *input_tiles_[tile_id]) {
+          util::sort_key64_type key = 0;
+          for (size_t key_itr = 0; key_itr < sort_keys.size(); key_itr++) {
+            common::Value value =
+                input_tiles_[tile_id]->GetValue(tuple_id, sort_keys[key_itr]);
+            key = normalizer.AddColumn(key, key_itr, value);
+          }
+          simd_sort_keys_[offset] = key;
+          simd_sort_payloads_[offset++] = EncodeSortPayload(tile_id, tuple_id);
+        }
+      };
+      extract_tasks.push_back(std::bind(extract_tile, i));
+      i += input_tiles_[tile_id]->GetTupleCount();
     }
 
-    while (i < padded_count) {
-      simd_sort_buffer_[i++].serialize_pad();
+    if (sort_partition_count_ > 1) {
+      thread_pool.ExecuteTasks(extract_tasks);
+    } else {
+      for (auto &extract_task : extract_tasks) extract_task();
     }
 
-    PL_ASSERT(simd_sort_buffer_size_ == count);
-
-    if (use_simd_sort_ == true) {
-      // TODO:insert sort function here
-      auto result = util::simd_merge_sort(
-          reinterpret_cast<util::sort_ele_type *>(simd_sort_buffer_),
-          reinterpret_cast<util::sort_ele_type*>(temp), padded_count);
+    PL_ASSERT(i == count);
 
-      simd_sort_buffer_ = reinterpret_cast<simd_sort_entry_t*>(result.first);
-      delete result.second;
+    if (sort_partition_count_ > 1) {
+      ParallelSortSIMDBuffer();
+    } else if (use_simd_sort_ == true) {
+      util::simd_sort_pairs64(simd_sort_keys_.data(),
+                              simd_sort_payloads_.data(), count);
     } else {
-      struct KeyComparer {
-        bool operator ()(const simd_sort_entry_t& a, const simd_sort_entry_t& b) {
-          return a.ele < b.ele;
-        }
-      };
-      std::sort(simd_sort_buffer_, simd_sort_buffer_+padded_count, KeyComparer());
+      SortKeysScalar(simd_sort_keys_.data(), simd_sort_payloads_.data(),
+                     count);
+    }
+
+    if (!normalizer.IsExact()) {
+      SortKeyTies(normalizer, node.GetSortKeys());
     }
 
   } else {
@@ -254,31 +432,9 @@ bool OrderByExecutor::DoSort() {
           : descend_flags(_descend_flags) { }
 
       bool operator()(const storage::Tuple *ta, const storage::Tuple *tb) {
-        for (oid_t id = 0; id < descend_flags.size(); id++) {
-          common::Value va = (ta->GetValue(id));
-          common::Value vb = (tb->GetValue(id));
-          if (!descend_flags[id]) {
-            common::Value cmp_lt = (va.CompareLessThan(vb));
-            if (cmp_lt.IsTrue())
-              return true;
-            else {
-              common::Value cmp_gt = (va.CompareGreaterThan(vb));
-              if (cmp_gt.IsTrue())
-                return false;
-            }
-          }
-          else {
-            common::Value cmp_lt = (vb.CompareLessThan(va));
-            if (cmp_lt.IsTrue())
-              return true;
-            else {
-              common::Value cmp_gt = (vb.CompareGreaterThan(va));
-              if (cmp_gt.IsTrue())
-                return false;
-            }
-          }
-        }
-        return false;  // Will return false if all keys equal
+        return CompareSortKeys(descend_flags,
+                               [ta](oid_t id) { return ta->GetValue(id); },
+                               [tb](oid_t id) { return tb->GetValue(id); }) < 0;
       }
 
       std::vector<bool> descend_flags;
@@ -287,22 +443,265 @@ bool OrderByExecutor::DoSort() {
     TupleComparer comp(descend_flags_);
 
     // Finally ... sort it !
-    std::sort(
-        sort_buffer_.begin(), sort_buffer_.end(),
-        [&comp](const sort_buffer_entry_t &a, const sort_buffer_entry_t &b) {
-          return comp(a.tuple.get(), b.tuple.get());
-        });
+    if (sort_partition_count_ > 1) {
+      // The entries are move-only, so sort their positions in parallel
+      // and then move the entries into the sorted order
+      std::vector<size_t> positions(count), temp_positions(count);
+      std::iota(positions.begin(), positions.end(), 0);
+      auto sorted_positions = util::parallel_sort(
+          positions.data(), temp_positions.data(), count,
+          [this, &comp](size_t a, size_t b) {
+            return comp(sort_buffer_[a].tuple.get(),
+                        sort_buffer_[b].tuple.get());
+          },
+          sort_partition_count_);
+
+      std::vector<sort_buffer_entry_t> sorted_buffer;
+      sorted_buffer.reserve(count);
+      for (size_t position_itr = 0; position_itr < count; position_itr++) {
+        sorted_buffer.emplace_back(
+            std::move(sort_buffer_[sorted_positions[position_itr]]));
+      }
+      sort_buffer_.swap(sorted_buffer);
+    } else {
+      std::sort(
+          sort_buffer_.begin(), sort_buffer_.end(),
+          [&comp](const sort_buffer_entry_t &a, const sort_buffer_entry_t &b) {
+            return comp(a.tuple.get(), b.tuple.get());
+          });
+    }
   }
+}
 
-  sort_done_ = true;
+/**
+ * @brief Sort the buffered input tiles and write their tuples in sorted order
+ * to a new run in a temp file, then release the tiles and the sort buffers.
+ * Every tuple is stored as its serialized size followed by its serialized
+ * values.
+ */
+void OrderByExecutor::SpillSortedRun() {
+  SortInputTiles();
 
-  auto end = static_cast<double>(
-      std::chrono::duration_cast<std::chrono::microseconds>(
-          std::chrono::steady_clock::now().time_since_epoch()).count());
+  std::unique_ptr<SortedRun> run(new SortedRun());
+  run->file = std::tmpfile();
+  if (run->file == nullptr) {
+    throw ExecutorException("Failed to create a temp file for a sorted run");
+  }
 
-  LOG_ERROR("Sort time:%f", (end-start)/1000);
+  CopySerializeOutput output;
+  size_t sorted_tuple_count = GetSortedTupleCount();
+  for (size_t position = 0; position < sorted_tuple_count; position++) {
+    oid_t tile_id, tuple_id;
+    GetSortedTuple(position, tile_id, tuple_id);
+
+    output.Reset();
+    for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
+      input_tiles_[tile_id]->GetValue(tuple_id, col).SerializeTo(output);
+    }
+
+    int32_t tuple_size = static_cast<int32_t>(output.Size());
+    if (fwrite(&tuple_size, sizeof(tuple_size), 1, run->file) != 1 ||
+        fwrite(output.Data(), tuple_size, 1, run->file) != 1) {
+      throw ExecutorException("Failed to write a sorted run");
+    }
+  }
+  std::rewind(run->file);
+
+  LOG_TRACE("Spilled a sorted run of %lu tuples", sorted_tuple_count);
+  spilled_tuple_count_ += sorted_tuple_count;
+  sorted_runs_.push_back(std::move(run));
+
+  // Release the input of this run
+  input_tiles_.clear();
+  sort_buffer_.clear();
+  std::vector<util::sort_key64_type>().swap(simd_sort_keys_);
+  std::vector<util::sort_payload_type>().swap(simd_sort_payloads_);
+  simd_sort_buffer_size_ = 0;
+  int_sort_ = false;
+  buffered_bytes_ = 0;
+}
+
+OrderByExecutor::SortedRun::~SortedRun() {
+  if (file != nullptr) fclose(file);
+}
+
+/**
+ * @brief Read the next tuple of the run into tuple.
+ * @return false if the run has no more tuples
+ */
+bool OrderByExecutor::SortedRun::ReadTuple(const catalog::Schema &schema) {
+  int32_t tuple_size;
+  if (fread(&tuple_size, sizeof(tuple_size), 1, file) != 1) return false;
+
+  tuple_buffer.resize(tuple_size);
+  if (tuple_size > 0 &&
+      fread(tuple_buffer.data(), tuple_size, 1, file) != 1) {
+    throw ExecutorException("Failed to read a sorted run");
+  }
+
+  ReferenceSerializeInput input(tuple_buffer.data(), tuple_size);
+  tuple.clear();
+  for (oid_t col = 0; col < schema.GetColumnCount(); col++) {
+    tuple.push_back(common::Value::DeserializeFrom(input, schema.GetType(col)));
+  }
   return true;
 }
 
+/**
+ * @brief Whether the current tuple of run a goes before the one of run b.
+ */
+bool OrderByExecutor::RunTupleLess(size_t a, size_t b) const {
+  auto &tuple_a = sorted_runs_[a]->tuple;
+  auto &tuple_b = sorted_runs_[b]->tuple;
+  int cmp = CompareSortKeys(descend_flags_, [&](oid_t id) {
+    return tuple_a[sort_keys_[id]];
+  }, [&](oid_t id) { return tuple_b[sort_keys_[id]]; });
+  // Equal tuples are returned in the order of their runs
+  return cmp != 0 ? cmp < 0 : a < b;
+}
+
+/**
+ * @brief Read the first tuple of every run and build the merge heap.
+ */
+void OrderByExecutor::InitRunMerge() {
+  run_heap_.clear();
+  for (size_t run_itr = 0; run_itr < sorted_runs_.size(); run_itr++) {
+    if (sorted_runs_[run_itr]->ReadTuple(*input_schema_)) {
+      run_heap_.push_back(run_itr);
+    }
+  }
+  std::make_heap(run_heap_.begin(), run_heap_.end(), RunHeapGreater{this});
+}
+
+/**
+ * @brief Return the next tile of the k-way merge of the sorted runs.
+ */
+bool OrderByExecutor::ExecuteRunMerge() {
+  if (run_heap_.empty()) return false;
+
+  size_t tile_size = std::min(size_t(DEFAULT_TUPLES_PER_TILEGROUP),
+                              spilled_tuple_count_ - num_tuples_returned_);
+  PL_ASSERT(tile_size > 0);
+
+  std::shared_ptr<storage::Tile> ptile(storage::TileFactory::GetTile(
+      BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
+      nullptr, *input_schema_, nullptr, tile_size));
+
+  for (size_t id = 0; id < tile_size; id++) {
+    PL_ASSERT(!run_heap_.empty());
+    std::pop_heap(run_heap_.begin(), run_heap_.end(), RunHeapGreater{this});
+    auto &run = sorted_runs_[run_heap_.back()];
+
+    for (oid_t col = 0; col < input_schema_->GetColumnCount(); col++) {
+      ptile.get()->SetValue(run->tuple[col], id, col);
+    }
+
+    if (run->ReadTuple(*input_schema_)) {
+      std::push_heap(run_heap_.begin(), run_heap_.end(), RunHeapGreater{this});
+    } else {
+      run_heap_.pop_back();
+    }
+  }
+
+  // Create an owner wrapper of this physical tile
+  std::vector<std::shared_ptr<storage::Tile>> singleton({ptile});
+  std::unique_ptr<LogicalTile> ltile(LogicalTileFactory::WrapTiles(singleton));
+  PL_ASSERT(ltile->GetTupleCount() == tile_size);
+
+  SetOutput(ltile.release());
+
+  num_tuples_returned_ += tile_size;
+
+  return true;
+}
+
+/**
+ * @brief The normalized keys only hold a prefix of the sort keys, so order
+ * every run of equal normalized keys by the remaining sort key columns.
+ */
+void OrderByExecutor::SortKeyTies(const util::SortKeyNormalizer &normalizer,
+                                  const std::vector<oid_t> &sort_keys) {
+  auto tie_comparer = [this, &normalizer, &sort_keys](
+      util::sort_payload_type a, util::sort_payload_type b) {
+    oid_t tile_a, tuple_a, tile_b, tuple_b;
+    DecodeSortPayload(a, tile_a, tuple_a);
+    DecodeSortPayload(b, tile_b, tuple_b);
+    for (size_t key_itr = normalizer.GetFirstInexactColumn();
+         key_itr < sort_keys.size(); key_itr++) {
+      common::Value value_a =
+          input_tiles_[tile_a]->GetValue(tuple_a, sort_keys[key_itr]);
+      common::Value value_b =
+          input_tiles_[tile_b]->GetValue(tuple_b, sort_keys[key_itr]);
+      int cmp = normalizer.CompareColumn(key_itr, value_a, value_b);
+      if (cmp != 0) return cmp < 0;
+    }
+    return false;
+  };
+
+  size_t tie_begin = 0;
+  while (tie_begin < simd_sort_buffer_size_) {
+    size_t tie_end = tie_begin + 1;
+    while (tie_end < simd_sort_buffer_size_ &&
+           simd_sort_keys_[tie_end] == simd_sort_keys_[tie_begin]) {
+      tie_end++;
+    }
+    if (tie_end - tie_begin > 1) {
+      std::sort(simd_sort_payloads_.begin() + tie_begin,
+                simd_sort_payloads_.begin() + tie_end, tie_comparer);
+    }
+    tie_begin = tie_end;
+  }
+}
+
+/**
+ * @brief Sort the SIMD sort buffer with sort_partition_count_ workers.
+ * Every worker sorts a chunk (with the SIMD kernels if they are enabled),
+ * then the chunks are merged into new buffers, which replace the sort
+ * buffer afterwards.
+ */
+void OrderByExecutor::ParallelSortSIMDBuffer() {
+  size_t count = simd_sort_keys_.size();
+  auto keys = simd_sort_keys_.data();
+  auto payloads = simd_sort_payloads_.data();
+  bool use_simd_sort = use_simd_sort_;
+
+  size_t chunk_count =
+      std::max(std::min(sort_partition_count_, count), size_t(1));
+
+  std::vector<util::sorted_run_type<util::sort_key64_type>> runs;
+  std::vector<std::function<void()>> sort_tasks;
+  for (size_t chunk_itr = 0; chunk_itr < chunk_count; chunk_itr++) {
+    size_t chunk_begin = count * chunk_itr / chunk_count;
+    size_t chunk_end = count * (chunk_itr + 1) / chunk_count;
+    runs.emplace_back(keys + chunk_begin, keys + chunk_end);
+
+    sort_tasks.push_back([=] {
+      size_t chunk_size = chunk_end - chunk_begin;
+      if (use_simd_sort) {
+        util::simd_sort_pairs64(keys + chunk_begin, payloads + chunk_begin,
+                                chunk_size);
+      } else {
+        SortKeysScalar(keys + chunk_begin, payloads + chunk_begin, chunk_size);
+      }
+    });
+  }
+  thread_pool.ExecuteTasks(sort_tasks);
+
+  std::vector<util::sort_key64_type> sorted_keys(count);
+  std::vector<util::sort_payload_type> sorted_payloads(count);
+  auto sorted_keys_data = sorted_keys.data();
+  auto sorted_payloads_data = sorted_payloads.data();
+  util::parallel_multiway_merge_emit(
+      runs,
+      [=](size_t out_pos, const util::sort_key64_type *key) {
+        sorted_keys_data[out_pos] = *key;
+        sorted_payloads_data[out_pos] = payloads[key - keys];
+      },
+      std::less<util::sort_key64_type>(), sort_partition_count_);
+
+  simd_sort_keys_.swap(sorted_keys);
+  simd_sort_payloads_.swap(sorted_payloads);
+}
+
 } /* namespace executor */
 } /* namespace peloton */
@@ -0,0 +1,148 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// parallelism_configurator.cpp
+//
+// Identification: src/executor/parallelism_configurator.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "executor/parallelism_configurator.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+#include "common/logger.h"
+#include "executor/aggregate_executor.h"
+#include "executor/hash_executor.h"
+#include "executor/hash_join_executor.h"
+#include "executor/hash_set_op_executor.h"
+#include "executor/limit_executor.h"
+#include "executor/merge_join_executor.h"
+#include "executor/order_by_executor.h"
+#include "executor/seq_scan_executor.h"
+#include "executor/sort_merge_join_executor.h"
+#include "planner/aggregate_plan.h"
+
+namespace peloton {
+namespace executor {
+
+ParallelismConfigurator::ParallelismConfigurator(size_t thread_count)
+    : thread_count_(thread_count) {
+  if (thread_count_ == 0) {
+    thread_count_ = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+}
+
+std::vector<Pipeline> ParallelismConfigurator::SplitPipelines(
+    AbstractExecutor *root) {
+  std::vector<Pipeline> pipelines;
+  if (root == nullptr) return pipelines;
+
+  Pipeline root_pipeline;
+  root_pipeline.executors = CollectPipelines(root, pipelines);
+  pipelines.push_back(std::move(root_pipeline));
+  return pipelines;
+}
+
+/**
+ * @brief Add the pipelines that end below the executor.
+ * @return the executors of the pipeline the executor belongs to, from its
+ * source up to the executor. The first child continues the pipeline unless
+ * the executor is a breaker, the other children feed it from pipelines of
+ * their own.
+ */
+std::vector<AbstractExecutor *> ParallelismConfigurator::CollectPipelines(
+    AbstractExecutor *executor, std::vector<Pipeline> &pipelines) {
+  bool is_breaker = IsPipelineBreaker(executor);
+  auto &children = executor->GetChildren();
+
+  std::vector<AbstractExecutor *> chain;
+  for (size_t child_itr = 0; child_itr < children.size(); child_itr++) {
+    auto child_chain = CollectPipelines(children[child_itr], pipelines);
+    if (child_itr == 0 && is_breaker == false) {
+      chain = std::move(child_chain);
+      continue;
+    }
+
+    Pipeline pipeline;
+    pipeline.executors = std::move(child_chain);
+    pipeline.sink = executor;
+    pipeline.sink_is_breaker = is_breaker;
+    pipelines.push_back(std::move(pipeline));
+  }
+
+  chain.push_back(executor);
+  return chain;
+}
+
+void ParallelismConfigurator::Configure(AbstractExecutor *root) {
+  for (auto &pipeline : SplitPipelines(root)) {
+    // Scan the tile groups of a table on the workers
+    auto scan = dynamic_cast<SeqScanExecutor *>(pipeline.executors.front());
+    if (scan != nullptr && scan->GetChildren().empty()) {
+      scan->UseParallelScan(thread_count_, NeedsOrderedInput(pipeline));
+    }
+
+    for (auto executor : pipeline.executors) {
+      ConfigureExecutor(executor);
+    }
+  }
+}
+
+/**
+ * @brief Whether the executor consumes all of its input before it returns
+ * its first tile.
+ */
+bool ParallelismConfigurator::IsPipelineBreaker(
+    const AbstractExecutor *executor) {
+  return dynamic_cast<const HashExecutor *>(executor) != nullptr ||
+         dynamic_cast<const AggregateExecutor *>(executor) != nullptr ||
+         dynamic_cast<const OrderByExecutor *>(executor) != nullptr ||
+         dynamic_cast<const HashSetOpExecutor *>(executor) != nullptr ||
+         dynamic_cast<const SortMergeJoinExecutor *>(executor) != nullptr;
+}
+
+/**
+ * @brief Whether the source of the pipeline has to return its tiles in
+ * order. Only breakers that hash or sort their input do not care, as long as
+ * no LIMIT in between picks tuples by their position.
+ */
+bool ParallelismConfigurator::NeedsOrderedInput(const Pipeline &pipeline) {
+  if (pipeline.sink_is_breaker == false) return true;
+
+  for (auto executor : pipeline.executors) {
+    if (dynamic_cast<const LimitExecutor *>(executor) != nullptr) return true;
+  }
+
+  // Sorted aggregation expects its input sorted on the group by keys
+  if (dynamic_cast<const AggregateExecutor *>(pipeline.sink) != nullptr) {
+    auto plan = static_cast<const planner::AggregatePlan *>(
+        pipeline.sink->GetRawNode());
+    return plan->GetAggregateStrategy() == AGGREGATE_TYPE_SORTED;
+  }
+  return false;
+}
+
+void ParallelismConfigurator::ConfigureExecutor(AbstractExecutor *executor) {
+  if (auto hash_join = dynamic_cast<HashJoinExecutor *>(executor)) {
+    hash_join->UseParallelJoin(thread_count_);
+  } else if (auto merge_join = dynamic_cast<MergeJoinExecutor *>(executor)) {
+    merge_join->UseParallelMerge(thread_count_);
+  } else if (auto hash = dynamic_cast<HashExecutor *>(executor)) {
+    hash->UseParallelBuild(thread_count_);
+  } else if (auto aggregate = dynamic_cast<AggregateExecutor *>(executor)) {
+    aggregate->UseParallelAggregation(thread_count_);
+  } else if (auto order_by = dynamic_cast<OrderByExecutor *>(executor)) {
+    order_by->UseParallelSort(thread_count_);
+  } else if (auto hash_set_op = dynamic_cast<HashSetOpExecutor *>(executor)) {
+    hash_set_op->UseParallelBuild(thread_count_);
+  }
+}
+
+}  // namespace executor
+}  // namespace peloton
@@ -12,10 +12,12 @@
 
 #include <vector>
 
+#include "common/config.h"
 #include "common/logger.h"
 #include "concurrency/transaction_manager_factory.h"
 #include "executor/executor_context.h"
 #include "executor/executors.h"
+#include "executor/parallelism_configurator.h"
 #include "executor/plan_executor.h"
 #include "optimizer/util.h"
 #include "storage/tuple_iterator.h"
@@ -78,6 +80,12 @@ peloton_status PlanExecutor::ExecutePlan(
   std::unique_ptr<executor::AbstractExecutor> executor_tree(
       BuildExecutorTree(nullptr, plan, executor_context.get()));
 
+  // Let the executors of the tree use the worker threads
+  if (FLAGS_query_parallelism != 1) {
+    executor::ParallelismConfigurator configurator(FLAGS_query_parallelism);
+    configurator.Configure(executor_tree.get());
+  }
+
   LOG_TRACE("Initializing the executor tree");
 
   // Initialize the executor tree
@@ -204,6 +212,12 @@ int PlanExecutor::ExecutePlan(
   std::unique_ptr<executor::AbstractExecutor> executor_tree(
       BuildExecutorTree(nullptr, plan, executor_context.get()));
 
+  // Let the executors of the tree use the worker threads
+  if (FLAGS_query_parallelism != 1) {
+    executor::ParallelismConfigurator configurator(FLAGS_query_parallelism);
+    configurator.Configure(executor_tree.get());
+  }
+
   LOG_TRACE("Initializing the executor tree");
 
   // Initialize the executor tree
@@ -352,6 +366,14 @@ executor::AbstractExecutor *BuildExecutorTree(
       break;
 
     case PLAN_NODE_TYPE_NESTLOOP:
+      // Probe the index of an inner index scan instead of running it again
+      // for every outer row
+      if (executor::IndexNestedLoopJoinExecutor::CanProbeIndex(plan)) {
+        LOG_TRACE("Adding Index Nested Loop Join Executer");
+        child_executor =
+            new executor::IndexNestedLoopJoinExecutor(plan, executor_context);
+        break;
+      }
       LOG_TRACE("Adding Nested Loop Joing Executer");
       child_executor =
           new executor::NestedLoopJoinExecutor(plan, executor_context);
@@ -362,6 +384,11 @@ executor::AbstractExecutor *BuildExecutorTree(
       child_executor = new executor::MergeJoinExecutor(plan, executor_context);
       break;
 
+    case PLAN_NODE_TYPE_BANDJOIN:
+      LOG_TRACE("Adding Band Join Executer");
+      child_executor = new executor::BandJoinExecutor(plan, executor_context);
+      break;
+
     case PLAN_NODE_TYPE_HASH:
       LOG_TRACE("Adding Hash Executer");
       child_executor = new executor::HashExecutor(plan, executor_context);
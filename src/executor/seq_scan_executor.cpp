@@ -12,11 +12,16 @@
 
 #include "executor/seq_scan_executor.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <numeric>
 
+#include "common/init.h"
+#include "common/thread_pool.h"
 #include "common/types.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
@@ -41,6 +46,8 @@ SeqScanExecutor::SeqScanExecutor(const planner::AbstractPlan *node,
                                  ExecutorContext *executor_context)
     : AbstractScanExecutor(node, executor_context) {}
 
+SeqScanExecutor::~SeqScanExecutor() { StopParallelScan(); }
+
 /**
  * @brief Let base class DInit() first, then do mine.
  * @return true on success, false otherwise.
@@ -55,6 +62,7 @@ bool SeqScanExecutor::DInit() {
 
   target_table_ = node.GetTable();
   
+  StopParallelScan();
   current_tile_group_offset_ = START_OID;
 
   if (target_table_ != nullptr) {
@@ -66,6 +74,23 @@ bool SeqScanExecutor::DInit() {
     }
   }
 
+  // Evaluate the predicate over whole tile groups if it is made of
+  // comparisons of fixed-width columns. The AVX2 kernels of the vectorized
+  // predicate are tried first, the compiled scan loops evaluate what they do
+  // not support
+  compiled_predicate_ = nullptr;
+  if (target_table_ != nullptr && predicate_ != nullptr) {
+    compiled_predicate_ = node.GetCompiledPredicate();
+  }
+
+  vectorized_predicate_.reset();
+  if (target_table_ != nullptr && predicate_ != nullptr &&
+      VectorizedPredicate::IsSupported(predicate_,
+                                       target_table_->GetSchema())) {
+    vectorized_predicate_.reset(
+        new VectorizedPredicate(predicate_, executor_context_));
+  }
+
   return true;
 }
 
@@ -115,69 +140,52 @@ bool SeqScanExecutor::DExecute() {
     PL_ASSERT(target_table_ != nullptr);
     PL_ASSERT(column_ids_.size() > 0);
 
-    // Force to use occ txn manager if dirty read is forbidden
-    concurrency::TransactionManager &transaction_manager =
-        concurrency::TransactionManagerFactory::GetInstance();
+    // Scan the tile groups on the worker threads
+    if (scan_thread_count_ > 1) {
+      ScannedTileGroup scanned;
+      while (TakeScannedTileGroup(scanned)) {
+        SelectVisibleTuples(scanned);
+        if (ReadTuples(scanned) == false) return false;
+
+        // Don't return empty tiles
+        if (scanned.position_list.size() == 0) {
+          continue;
+        }
 
-    bool acquire_owner = GetPlanNode<planner::AbstractScan>().IsForUpdate();
-    auto current_txn = executor_context_->GetTransaction();
+        // Construct logical tile.
+        std::unique_ptr<LogicalTile> logical_tile(
+            LogicalTileFactory::GetTile());
+        logical_tile->AddColumns(scanned.tile_group, column_ids_);
+        logical_tile->AddPositionList(std::move(scanned.position_list));
+
+        SetOutput(logical_tile.release());
+        return true;
+      }
+      return false;
+    }
 
     // Retrieve next tile group.
     while (current_tile_group_offset_ < table_tile_group_count_) {
-      auto tile_group =
+      ScannedTileGroup scanned;
+      scanned.offset = current_tile_group_offset_;
+      scanned.tile_group =
           target_table_->GetTileGroup(current_tile_group_offset_++);
-      auto tile_group_header = tile_group->GetHeader();
-
-      oid_t active_tuple_count = tile_group->GetNextTupleSlot();
 
       // Construct position list by looping through tile group
       // and applying the predicate.
-      std::vector<oid_t> position_list;
-      for (oid_t tuple_id = 0; tuple_id < active_tuple_count; tuple_id++) {
-        ItemPointer location(tile_group->GetTileGroupId(), tuple_id);
-
-
-        auto visibility = transaction_manager.IsVisible(current_txn, tile_group_header, tuple_id);
-
-        // check transaction visibility
-        if (visibility == VISIBILITY_OK) {
-          // if the tuple is visible, then perform predicate evaluation.
-          if (predicate_ == nullptr) {
-            position_list.push_back(tuple_id);
-            auto res = transaction_manager.PerformRead(current_txn, location, acquire_owner);
-            if (!res) {
-              transaction_manager.SetTransactionResult(current_txn, RESULT_FAILURE);
-              return res;
-            }
-          } else {
-            expression::ContainerTuple<storage::TileGroup> tuple(
-                tile_group.get(), tuple_id);
-            LOG_TRACE("Evaluate predicate for a tuple");
-            auto eval = predicate_->Evaluate(&tuple, nullptr, executor_context_);
-            LOG_TRACE("Evaluation result: %s", eval.GetInfo().c_str());
-            if (eval.IsTrue()) {
-              position_list.push_back(tuple_id);
-              auto res = transaction_manager.PerformRead(current_txn, location, acquire_owner);
-              if (!res) {
-                transaction_manager.SetTransactionResult(current_txn, RESULT_FAILURE);
-                return res;
-              } else {
-                LOG_TRACE("Sequential Scan Predicate Satisfied");
-              }
-            }
-          }
-        }
-      }
+      ScanTileGroup(scanned.tile_group.get(), vectorized_predicate_.get(),
+                    scanned.position_list);
+      if (ReadTuples(scanned) == false) return false;
 
       // Don't return empty tiles
-      if (position_list.size() == 0) {
+      if (scanned.position_list.size() == 0) {
         continue;
       }
 
       // Construct logical tile.
       std::unique_ptr<LogicalTile> logical_tile(LogicalTileFactory::GetTile());
-      logical_tile->AddColumns(tile_group, column_ids_);
-      logical_tile->AddPositionList(std::move(position_list));
+      logical_tile->AddColumns(scanned.tile_group, column_ids_);
+      logical_tile->AddPositionList(std::move(scanned.position_list));
 
       LOG_TRACE("Information %s", logical_tile->GetInfo().c_str());
       SetOutput(logical_tile.release());
@@ -188,5 +196,340 @@ bool SeqScanExecutor::DExecute() {
   return false;
 }
 
+/**
+ * @brief Select the visible tuples of a tile group that pass the probe filter
+ * and the predicate. Only reads the transaction, the tuples are read for it
+ * by ReadTuples().
+ */
+void SeqScanExecutor::ScanTileGroup(storage::TileGroup *tile_group,
+                                    VectorizedPredicate *vectorized_predicate,
+                                    std::vector<oid_t> &position_list) {
+  // Skip the tile group if its zone map rules out the predicate
+  if (MayMatchZoneMap(tile_group) == false) {
+    return;
+  }
+
+  concurrency::TransactionManager &transaction_manager =
+      concurrency::TransactionManagerFactory::GetInstance();
+  auto current_txn = executor_context_->GetTransaction();
+  auto tile_group_header = tile_group->GetHeader();
+
+  oid_t active_tuple_count = tile_group->GetNextTupleSlot();
+
+  std::vector<oid_t> candidates;
+  for (oid_t tuple_id = 0; tuple_id < active_tuple_count; tuple_id++) {
+    // check transaction visibility
+    auto visibility = transaction_manager.IsVisible(
+        current_txn, tile_group_header, tuple_id);
+    if (visibility != VISIBILITY_OK) continue;
+
+    // drop the tuple early if its key is not in the probe filter
+    if (PassesProbeFilter(tile_group, tuple_id) == false) {
+      continue;
+    }
+    candidates.push_back(tuple_id);
+  }
+
+  // the predicate is evaluated for all the visible tuples at once
+  if (predicate_ == nullptr) {
+    position_list = std::move(candidates);
+  } else {
+    FilterTileGroup(tile_group, vectorized_predicate, candidates,
+                    position_list);
+  }
+}
+
+/**
+ * @brief Apply the vectorized or compiled predicate to the visible tuples of
+ * a tile group. Batches neither can evaluate are evaluated tuple at a time.
+ */
+bool SeqScanExecutor::FilterTileGroup(storage::TileGroup *tile_group,
+                                      VectorizedPredicate *vectorized_predicate,
+                                      const std::vector<oid_t> &candidates,
+                                      std::vector<oid_t> &position_list) {
+  if (FilterInBatch(tile_group, vectorized_predicate, candidates,
+                    position_list)) {
+    return true;
+  }
+
+  LOG_TRACE("Fall back to evaluate the predicate tuple at a time");
+  position_list.clear();
+  for (oid_t tuple_id : candidates) {
+    expression::ContainerTuple<storage::TileGroup> tuple(tile_group, tuple_id);
+    if (predicate_->Evaluate(&tuple, nullptr, executor_context_).IsTrue()) {
+      position_list.push_back(tuple_id);
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Apply the vectorized or compiled predicate to a batch of tuples of a
+ * tile group. Only reads the tile group and the parameters, so workers may
+ * call it.
+ * @return false if neither can evaluate the batch
+ */
+bool SeqScanExecutor::FilterInBatch(storage::TileGroup *tile_group,
+                                    VectorizedPredicate *vectorized_predicate,
+                                    const std::vector<oid_t> &candidates,
+                                    std::vector<oid_t> &position_list) const {
+  if (vectorized_predicate != nullptr &&
+      vectorized_predicate->Filter(tile_group, candidates, position_list)) {
+    return true;
+  }
+  return compiled_predicate_ != nullptr &&
+         compiled_predicate_->Filter(tile_group, executor_context_->GetParams(),
+                                     candidates, position_list);
+}
+
+/**
+ * @brief Read the selected tuples of a tile group for the transaction.
+ * @return false if the transaction fails to read one of them
+ */
+bool SeqScanExecutor::ReadTuples(ScannedTileGroup &scanned) {
+  concurrency::TransactionManager &transaction_manager =
+      concurrency::TransactionManagerFactory::GetInstance();
+  bool acquire_owner = GetPlanNode<planner::AbstractScan>().IsForUpdate();
+  auto current_txn = executor_context_->GetTransaction();
+
+  for (oid_t tuple_id : scanned.position_list) {
+    ItemPointer location(scanned.tile_group->GetTileGroupId(), tuple_id);
+    auto res =
+        transaction_manager.PerformRead(current_txn, location, acquire_owner);
+    if (!res) {
+      transaction_manager.SetTransactionResult(current_txn, RESULT_FAILURE);
+      return res;
+    }
+  }
+  return true;
+}
+
+void SeqScanExecutor::UseParallelScan(size_t thread_count,
+                                      bool preserve_order) {
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  scan_thread_count_ = thread_count;
+  preserve_order_ = preserve_order;
+}
+
+/**
+ * @brief Start the workers of the parallel scan. Execute() counts as one of
+ * the scan threads, since it scans tile groups no worker has taken.
+ */
+void SeqScanExecutor::StartParallelScan() {
+  exchange_.reset(new ScanExchange());
+  exchange_->capacity = 2 * scan_thread_count_;
+
+  // Without workers the tasks would run right here, inside Execute()
+  exchange_->worker_count =
+      std::min(scan_thread_count_ - 1, thread_pool.GetPoolSize());
+  SubmitScanWorkers();
+}
+
+/**
+ * @brief Stop the workers of the parallel scan and wait for the running ones
+ * to return. Workers that have not started yet return as soon as they start.
+ */
+void SeqScanExecutor::StopParallelScan() {
+  if (exchange_ == nullptr) return;
+
+  std::unique_lock<std::mutex> lock(exchange_->mutex);
+  exchange_->stopped = true;
+  exchange_->not_empty.wait(
+      lock, [this] { return exchange_->running_workers == 0; });
+  lock.unlock();
+
+  exchange_.reset();
+}
+
+/**
+ * @brief Submit worker tasks until worker_count of them are queued or
+ * running, if a tile group may be scanned. Called without the exchange
+ * mutex, since a task may run right away.
+ */
+void SeqScanExecutor::SubmitScanWorkers() {
+  std::shared_ptr<ScanExchange> exchange = exchange_;
+  size_t new_workers = 0;
+  {
+    std::lock_guard<std::mutex> lock(exchange->mutex);
+    if (exchange->stopped || CanTakeMorsel(*exchange) == false) return;
+    new_workers = exchange->worker_count - exchange->submitted_workers;
+    exchange->submitted_workers = exchange->worker_count;
+  }
+
+  for (size_t worker_itr = 0; worker_itr < new_workers; worker_itr++) {
+    thread_pool.SubmitTask([this, exchange] {
+      {
+        std::lock_guard<std::mutex> lock(exchange->mutex);
+        if (exchange->stopped) {
+          exchange->submitted_workers--;
+          return;
+        }
+        exchange->running_workers++;
+      }
+      RunScanWorker(*exchange);
+    });
+  }
+}
+
+/**
+ * @brief Scan tile groups and push them into the exchange queue until the
+ * queue is full, the table is exhausted or the scan is stopped. The worker
+ * returns instead of waiting for room in the queue, so that it never holds
+ * a pool thread that Execute() or another parallel phase might wait on.
+ */
+void SeqScanExecutor::RunScanWorker(ScanExchange &exchange) {
+  // The vectorized predicate keeps state per tile group
+  std::unique_ptr<VectorizedPredicate> vectorized_predicate;
+  if (vectorized_predicate_ != nullptr) {
+    vectorized_predicate.reset(
+        new VectorizedPredicate(predicate_, executor_context_));
+  }
+
+  std::unique_lock<std::mutex> lock(exchange.mutex);
+  while (exchange.stopped == false && CanTakeMorsel(exchange)) {
+    oid_t offset = exchange.cursor++;
+    lock.unlock();
+    ScannedTileGroup scanned;
+    ScanMorsel(offset, vectorized_predicate.get(), scanned);
+    lock.lock();
+
+    exchange.tile_groups.push_back(std::move(scanned));
+    exchange.not_empty.notify_all();
+  }
+
+  exchange.submitted_workers--;
+  exchange.running_workers--;
+  exchange.not_empty.notify_all();
+}
+
+/**
+ * @brief Whether the next tile group may be scanned without growing the
+ * exchange queue past its capacity. With preserve_order, only the tile
+ * groups up to capacity past the next one to return may be scanned, so that
+ * the next one is never kept out of a full queue.
+ */
+bool SeqScanExecutor::CanTakeMorsel(const ScanExchange &exchange) const {
+  if (exchange.cursor >= table_tile_group_count_) return false;
+  if (preserve_order_) {
+    return exchange.cursor < exchange.taken_count + exchange.capacity;
+  }
+  return exchange.tile_groups.size() < exchange.capacity;
+}
+
+/**
+ * @brief Apply the predicate to all tuple slots of a tile group, if the
+ * vectorized predicate or the compiled scan loops can. Otherwise all slots
+ * are kept for Execute() to evaluate.
+ */
+void SeqScanExecutor::ScanMorsel(oid_t offset,
+                                 VectorizedPredicate *vectorized_predicate,
+                                 ScannedTileGroup &scanned) const {
+  scanned.offset = offset;
+  scanned.tile_group = target_table_->GetTileGroup(offset);
+  scanned.position_list.clear();
+  scanned.predicate_applied = true;
+
+  // Skip the tile group if its zone map rules out the predicate
+  auto tile_group = scanned.tile_group.get();
+  if (MayMatchZoneMap(tile_group) == false) return;
+
+  std::vector<oid_t> tuple_slots(tile_group->GetNextTupleSlot());
+  std::iota(tuple_slots.begin(), tuple_slots.end(), 0);
+  if (predicate_ != nullptr &&
+      FilterInBatch(tile_group, vectorized_predicate, tuple_slots,
+                    scanned.position_list)) {
+    return;
+  }
+
+  scanned.position_list = std::move(tuple_slots);
+  scanned.predicate_applied = (predicate_ == nullptr);
+}
+
+/**
+ * @brief Pop the next scanned tile group from the exchange queue, scanning
+ * the next one here while none is ready and no worker has taken it.
+ * @return false if all tile groups were returned
+ */
+bool SeqScanExecutor::TakeScannedTileGroup(ScannedTileGroup &scanned) {
+  if (exchange_ == nullptr) StartParallelScan();
+  auto &exchange = *exchange_;
+
+  std::unique_lock<std::mutex> lock(exchange.mutex);
+  while (exchange.taken_count < table_tile_group_count_) {
+    auto ready = exchange.tile_groups.begin();
+    if (preserve_order_) {
+      ready = std::find_if(exchange.tile_groups.begin(),
+                           exchange.tile_groups.end(),
+                           [&exchange](const ScannedTileGroup &tile_group) {
+                             return tile_group.offset == exchange.taken_count;
+                           });
+    }
+
+    if (ready != exchange.tile_groups.end()) {
+      scanned = std::move(*ready);
+      exchange.tile_groups.erase(ready);
+      exchange.taken_count++;
+      lock.unlock();
+
+      // Workers that returned on a full queue may continue now
+      SubmitScanWorkers();
+      return true;
+    }
+
+    if (CanTakeMorsel(exchange)) {
+      oid_t offset = exchange.cursor++;
+      lock.unlock();
+      ScannedTileGroup own_scanned;
+      ScanMorsel(offset, vectorized_predicate_.get(), own_scanned);
+      lock.lock();
+      exchange.tile_groups.push_back(std::move(own_scanned));
+      continue;
+    }
+
+    // The tile groups still to return are being scanned by running workers
+    exchange.not_empty.wait(lock);
+  }
+  return false;
+}
+
+/**
+ * @brief Keep the tuples of a scanned tile group that are visible to the
+ * transaction and pass the probe filter, and evaluate the predicate on them
+ * if the worker could not.
+ */
+void SeqScanExecutor::SelectVisibleTuples(ScannedTileGroup &scanned) {
+  concurrency::TransactionManager &transaction_manager =
+      concurrency::TransactionManagerFactory::GetInstance();
+  auto current_txn = executor_context_->GetTransaction();
+  auto tile_group = scanned.tile_group.get();
+  auto tile_group_header = tile_group->GetHeader();
+
+  size_t selected_count = 0;
+  for (oid_t tuple_id : scanned.position_list) {
+    // check transaction visibility
+    auto visibility = transaction_manager.IsVisible(
+        current_txn, tile_group_header, tuple_id);
+    if (visibility != VISIBILITY_OK) continue;
+
+    // drop the tuple early if its key is not in the probe filter
+    if (PassesProbeFilter(tile_group, tuple_id) == false) {
+      continue;
+    }
+
+    if (scanned.predicate_applied == false) {
+      expression::ContainerTuple<storage::TileGroup> tuple(tile_group,
+                                                           tuple_id);
+      if (predicate_->Evaluate(&tuple, nullptr, executor_context_).IsTrue() ==
+          false) {
+        continue;
+      }
+    }
+    scanned.position_list[selected_count++] = tuple_id;
+  }
+  scanned.position_list.resize(selected_count);
+}
+
 }  // namespace executor
 }  // namespace peloton
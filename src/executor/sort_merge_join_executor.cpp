@@ -0,0 +1,173 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// sort_merge_join_executor.cpp
+//
+// Identification: src/executor/sort_merge_join_executor.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "common/container_tuple.h"
+#include "common/logger.h"
+#include "executor/order_by_executor.h"
+#include "executor/sort_merge_join_executor.h"
+#include "expression/abstract_expression.h"
+
+namespace peloton {
+namespace executor {
+
+SortMergeJoinExecutor::SortMergeJoinExecutor(
+    const planner::AbstractPlan *node, ExecutorContext *executor_context)
+    : MergeJoinExecutor(node, executor_context) {}
+
+bool SortMergeJoinExecutor::DInit() {
+  auto status = MergeJoinExecutor::DInit();
+  if (status == false) return status;
+
+  sort_done_ = false;
+
+  return true;
+}
+
+/**
+ * @brief Buffer and sort both children on the first call, merge them, and
+ * then return one output tile per call.
+ * @return true on success, false otherwise.
+ */
+bool SortMergeJoinExecutor::DExecute() {
+  LOG_TRACE("********** Sort Merge Join executor :: 2 children ");
+
+  if (sort_done_ == false) {
+    BufferChildTiles();
+
+    SortJoinRows(true);
+    SortJoinRows(false);
+
+    MergeJoinRows();
+    sort_done_ = true;
+  }
+
+  return ExecuteMergedOutput();
+}
+
+/**
+ * @brief Fill left_rows_ (right_rows_) with the rows of the buffered tiles of
+ * a child, sorted on their join keys. Normalized keys are sorted with the
+ * SIMD merge sort, otherwise the rows are sorted on their key values.
+ * A null join key never equals another key, so rows with one are left out
+ * and end up with the rows of the outer joins without a match.
+ */
+void SortMergeJoinExecutor::SortJoinRows(bool is_left) {
+  auto &rows = is_left ? left_rows_ : right_rows_;
+  auto &row_keys = is_left ? left_row_keys_ : right_row_keys_;
+  rows.clear();
+  row_keys.clear();
+
+  if (SortNormalizedJoinRows(is_left)) return;
+
+  auto &tiles = is_left ? left_result_tiles_ : right_result_tiles_;
+  for (size_t tile_itr = 0; tile_itr < tiles.size(); tile_itr++) {
+    for (oid_t row : *tiles[tile_itr]) {
+      if (HasNullJoinKey(tiles[tile_itr].get(), row, is_left)) continue;
+      rows.emplace_back(tile_itr, row);
+    }
+  }
+
+  std::stable_sort(rows.begin(), rows.end(),
+                   [this, is_left](const RowPosition &a,
+                                   const RowPosition &b) {
+                     return CompareChildJoinKeys(a, b, is_left) < 0;
+                   });
+}
+
+/**
+ * @brief Extract the normalized join keys of all rows of a child with their
+ * encoded row positions and sort the pairs with the SIMD merge sort.
+ * @return false if the join keys can not be normalized
+ */
+bool SortMergeJoinExecutor::SortNormalizedJoinRows(bool is_left) {
+  if (join_key_normalizer_ == nullptr) return false;
+
+  auto &tiles = is_left ? left_result_tiles_ : right_result_tiles_;
+  size_t count = 0;
+  for (auto &tile : tiles) {
+    count += tile->GetTupleCount();
+  }
+  if (count == 0) return true;
+
+  std::vector<util::sort_key64_type> keys;
+  std::vector<util::sort_payload_type> payloads;
+  keys.reserve(count);
+  payloads.reserve(count);
+  std::vector<util::sort_key64_type> tile_keys;
+  for (size_t tile_itr = 0; tile_itr < tiles.size(); tile_itr++) {
+    if (!ExtractJoinKeys(tiles[tile_itr].get(), is_left, tile_keys)) {
+      return false;
+    }
+    keys.insert(keys.end(), tile_keys.begin(), tile_keys.end());
+    for (oid_t row : *tiles[tile_itr]) {
+      payloads.push_back(EncodeRowPayload(tile_itr, row));
+    }
+  }
+  util::simd_sort_pairs64(keys.data(), payloads.data(), count);
+
+  auto &rows = is_left ? left_rows_ : right_rows_;
+  auto &row_keys = is_left ? left_row_keys_ : right_row_keys_;
+  rows.reserve(count);
+  for (auto payload : payloads) {
+    rows.emplace_back(static_cast<size_t>(payload >> 32),
+                      static_cast<oid_t>(payload));
+  }
+  row_keys = std::move(keys);
+
+  return true;
+}
+
+/**
+ * @brief Compare the join key values of two rows of the same child, with
+ * nulls first like OrderByExecutor sorts them
+ * @return negative if a < b, positive if a > b, 0 otherwise
+ */
+int SortMergeJoinExecutor::CompareChildJoinKeys(const RowPosition &a,
+                                                const RowPosition &b,
+                                                bool is_left) {
+  auto &tiles = is_left ? left_result_tiles_ : right_result_tiles_;
+  expression::ContainerTuple<executor::LogicalTile> a_tuple(
+      tiles[a.first].get(), a.second);
+  expression::ContainerTuple<executor::LogicalTile> b_tuple(
+      tiles[b.first].get(), b.second);
+
+  for (auto &clause : *join_clauses_) {
+    auto expr = is_left ? clause.left_.get() : clause.right_.get();
+    auto a_value = expr->Evaluate(&a_tuple, &a_tuple, nullptr);
+    auto b_value = expr->Evaluate(&b_tuple, &b_tuple, nullptr);
+
+    int cmp = OrderByExecutor::CompareSortValues(a_value, b_value);
+    if (cmp != 0) return cmp;
+  }
+  return 0;
+}
+
+/**
+ * @brief Check if one of the join key values of a row of a child is null
+ */
+bool SortMergeJoinExecutor::HasNullJoinKey(LogicalTile *tile, oid_t row,
+                                           bool is_left) {
+  expression::ContainerTuple<executor::LogicalTile> tuple(tile, row);
+  for (auto &clause : *join_clauses_) {
+    auto expr = is_left ? clause.left_.get() : clause.right_.get();
+    if (expr->Evaluate(&tuple, &tuple, nullptr).IsNull()) return true;
+  }
+  return false;
+}
+
+}  // namespace executor
+}  // namespace peloton
@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// spill_file.cpp
+//
+// Identification: src/executor/spill_file.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+
+#include <memory>
+
+#include "common/exception.h"
+#include "common/value.h"
+#include "executor/logical_tile.h"
+#include "executor/logical_tile_factory.h"
+#include "executor/spill_file.h"
+#include "storage/tile.h"
+
+namespace peloton {
+namespace executor {
+
+SpillFile::SpillFile() {
+  file_ = std::tmpfile();
+  if (file_ == nullptr) {
+    throw ExecutorException("Failed to create a temp file to spill tuples");
+  }
+}
+
+SpillFile::~SpillFile() {
+  if (file_ != nullptr) fclose(file_);
+}
+
+void SpillFile::WriteTuple(LogicalTile *tile, oid_t tuple_id) {
+  output_.Reset();
+  size_t column_count = tile->GetColumnCount();
+  for (oid_t col = 0; col < column_count; col++) {
+    tile->GetValue(tuple_id, col).SerializeTo(output_);
+  }
+
+  int32_t tuple_size = static_cast<int32_t>(output_.Size());
+  if (fwrite(&tuple_size, sizeof(tuple_size), 1, file_) != 1 ||
+      fwrite(output_.Data(), tuple_size, 1, file_) != 1) {
+    throw ExecutorException("Failed to write a spill file");
+  }
+  tuple_count_++;
+  byte_count_ += tuple_size;
+}
+
+void SpillFile::Rewind() { std::rewind(file_); }
+
+LogicalTile *SpillFile::ReadTile(const catalog::Schema &schema,
+                                 size_t max_tuple_count) {
+  std::vector<std::vector<common::Value>> tuples;
+  int32_t tuple_size;
+  while (tuples.size() < max_tuple_count &&
+         fread(&tuple_size, sizeof(tuple_size), 1, file_) == 1) {
+    tuple_buffer_.resize(tuple_size);
+    if (tuple_size > 0 &&
+        fread(tuple_buffer_.data(), tuple_size, 1, file_) != 1) {
+      throw ExecutorException("Failed to read a spill file");
+    }
+
+    ReferenceSerializeInput input(tuple_buffer_.data(), tuple_size);
+    tuples.emplace_back();
+    for (oid_t col = 0; col < schema.GetColumnCount(); col++) {
+      tuples.back().push_back(
+          common::Value::DeserializeFrom(input, schema.GetType(col)));
+    }
+  }
+  if (tuples.empty()) return nullptr;
+
+  std::shared_ptr<storage::Tile> ptile(storage::TileFactory::GetTile(
+      BACKEND_TYPE_MM, INVALID_OID, INVALID_OID, INVALID_OID, INVALID_OID,
+      nullptr, schema, nullptr, tuples.size()));
+  for (oid_t tuple_id = 0; tuple_id < tuples.size(); tuple_id++) {
+    for (oid_t col = 0; col < schema.GetColumnCount(); col++) {
+      ptile->SetValue(tuples[tuple_id][col], tuple_id, col);
+    }
+  }
+
+  // Create an owner wrapper of this physical tile
+  std::vector<std::shared_ptr<storage::Tile>> singleton({ptile});
+  return LogicalTileFactory::WrapTiles(singleton);
+}
+
+}  // namespace executor
+}  // namespace peloton
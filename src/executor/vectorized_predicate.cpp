@@ -0,0 +1,785 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// vectorized_predicate.cpp
+//
+// Identification: src/executor/vectorized_predicate.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "executor/executor_context.h"
+#include "executor/vectorized_predicate.h"
+#include "expression/abstract_expression.h"
+#include "expression/constant_value_expression.h"
+#include "expression/expression_util.h"
+#include "expression/parameter_value_expression.h"
+#include "expression/tuple_value_expression.h"
+#include "storage/tile.h"
+#include "storage/tile_group.h"
+
+namespace peloton {
+namespace executor {
+
+namespace {
+
+/** Null of the integer and timestamp values of a VectorOperand */
+const int64_t kIntegerNull = std::numeric_limits<int64_t>::min();
+
+bool IsSupportedType(common::Type::TypeId type) {
+  return common::Type::IsIntegerType(type) || type == common::Type::DECIMAL ||
+         type == common::Type::TIMESTAMP;
+}
+
+bool IsComparison(ExpressionType type) {
+  switch (type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+    case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsArithmetic(ExpressionType type) {
+  switch (type) {
+    case EXPRESSION_TYPE_OPERATOR_PLUS:
+    case EXPRESSION_TYPE_OPERATOR_MINUS:
+    case EXPRESSION_TYPE_OPERATOR_MULTIPLY:
+    case EXPRESSION_TYPE_OPERATOR_DIVIDE:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsSupportedValue(const expression::AbstractExpression *expr,
+                      const catalog::Schema *schema) {
+  if (expr == nullptr) return false;
+
+  auto type = expr->GetExpressionType();
+  if (type == EXPRESSION_TYPE_VALUE_TUPLE) {
+    auto tuple_value =
+        static_cast<const expression::TupleValueExpression *>(expr);
+    if (tuple_value->GetTupleId() != 0 || tuple_value->GetColumnId() < 0) {
+      return false;
+    }
+    oid_t column_id = tuple_value->GetColumnId();
+    return column_id < schema->GetColumnCount() &&
+           schema->IsInlined(column_id) &&
+           IsSupportedType(schema->GetType(column_id));
+  }
+  if (type == EXPRESSION_TYPE_VALUE_CONSTANT) {
+    return IsSupportedType(expr->GetValueType());
+  }
+  if (type == EXPRESSION_TYPE_VALUE_PARAMETER) {
+    // The type is checked when the parameter is bound
+    return true;
+  }
+  if (IsArithmetic(type)) {
+    return expr->GetChildrenSize() == 2 &&
+           IsSupportedValue(expr->GetChild(0), schema) &&
+           IsSupportedValue(expr->GetChild(1), schema);
+  }
+  return false;
+}
+
+bool IsSupportedFilter(const expression::AbstractExpression *expr,
+                       const catalog::Schema *schema) {
+  if (expr == nullptr || expr->GetChildrenSize() != 2) return false;
+
+  auto type = expr->GetExpressionType();
+  if (type == EXPRESSION_TYPE_CONJUNCTION_AND ||
+      type == EXPRESSION_TYPE_CONJUNCTION_OR) {
+    return IsSupportedFilter(expr->GetChild(0), schema) &&
+           IsSupportedFilter(expr->GetChild(1), schema);
+  }
+  if (IsComparison(type)) {
+    return IsSupportedValue(expr->GetChild(0), schema) &&
+           IsSupportedValue(expr->GetChild(1), schema);
+  }
+  return false;
+}
+
+//===--------------------------------------------------------------------===//
+// Compare kernels
+//===--------------------------------------------------------------------===//
+
+template <ExpressionType CMP, typename T>
+inline bool CompareValues(T a, T b) {
+  switch (CMP) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return a == b;
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return a != b;
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return a < b;
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return a <= b;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return a > b;
+    default:
+      return a >= b;
+  }
+}
+
+inline __m256i LoadInt64x4(const int64_t *values) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values));
+}
+
+inline int MoveMask(__m256i lanes) {
+  return _mm256_movemask_pd(_mm256_castsi256_pd(lanes));
+}
+
+/** @brief Compare four pairs of integers, one bit per lane */
+template <ExpressionType CMP>
+inline int CompareInt64x4(__m256i a, __m256i b) {
+  switch (CMP) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return MoveMask(_mm256_cmpeq_epi64(a, b));
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return ~MoveMask(_mm256_cmpeq_epi64(a, b)) & 0xF;
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return MoveMask(_mm256_cmpgt_epi64(b, a));
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return ~MoveMask(_mm256_cmpgt_epi64(a, b)) & 0xF;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return MoveMask(_mm256_cmpgt_epi64(a, b));
+    default:
+      return ~MoveMask(_mm256_cmpgt_epi64(b, a)) & 0xF;
+  }
+}
+
+/** @brief Compare four pairs of doubles like the C++ operators, one bit per
+ * lane */
+template <ExpressionType CMP>
+inline int CompareDoublex4(__m256d a, __m256d b) {
+  switch (CMP) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_NEQ_UQ));
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ));
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LE_OQ));
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GT_OQ));
+    default:
+      return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_GE_OQ));
+  }
+}
+
+/** @brief Append the tuples of the set bits of mask to the selection. It is
+ * compacted in place, the write position never passes the read position. */
+inline size_t AppendSelected(int mask, const oid_t *tuples, oid_t *selection,
+                             size_t selected_count) {
+  while (mask != 0) {
+    selection[selected_count++] = tuples[__builtin_ctz(mask)];
+    mask &= mask - 1;
+  }
+  return selected_count;
+}
+
+/**
+ * @brief Keep the tuples of the selection where CMP(left, right) is true and
+ * neither side is null. right is a single value if kScalarRight.
+ * @return the number of tuples kept at the front of the selection
+ */
+template <ExpressionType CMP, bool kScalarRight>
+size_t SelectInt64(const int64_t *left, const int64_t *right,
+                   int64_t right_scalar, oid_t *selection, size_t count) {
+  const __m256i nulls = _mm256_set1_epi64x(kIntegerNull);
+  const __m256i scalar = _mm256_set1_epi64x(right_scalar);
+
+  size_t selected_count = 0;
+  size_t itr = 0;
+  for (; itr + 4 <= count; itr += 4) {
+    __m256i a = LoadInt64x4(left + itr);
+    __m256i b = kScalarRight ? scalar : LoadInt64x4(right + itr);
+    __m256i null_lanes = _mm256_cmpeq_epi64(a, nulls);
+    if (!kScalarRight) {
+      null_lanes = _mm256_or_si256(null_lanes, _mm256_cmpeq_epi64(b, nulls));
+    }
+    int mask = CompareInt64x4<CMP>(a, b) & ~MoveMask(null_lanes);
+    selected_count =
+        AppendSelected(mask, selection + itr, selection, selected_count);
+  }
+  for (; itr < count; itr++) {
+    int64_t b = kScalarRight ? right_scalar : right[itr];
+    if (left[itr] != kIntegerNull && b != kIntegerNull &&
+        CompareValues<CMP>(left[itr], b)) {
+      selection[selected_count++] = selection[itr];
+    }
+  }
+  return selected_count;
+}
+
+template <ExpressionType CMP, bool kScalarRight>
+size_t SelectDouble(const double *left, const double *right,
+                    double right_scalar, oid_t *selection, size_t count) {
+  const __m256d nulls = _mm256_set1_pd(common::PELOTON_DECIMAL_NULL);
+  const __m256d scalar = _mm256_set1_pd(right_scalar);
+
+  size_t selected_count = 0;
+  size_t itr = 0;
+  for (; itr + 4 <= count; itr += 4) {
+    __m256d a = _mm256_loadu_pd(left + itr);
+    __m256d b = kScalarRight ? scalar : _mm256_loadu_pd(right + itr);
+    __m256d null_lanes = _mm256_cmp_pd(a, nulls, _CMP_EQ_OQ);
+    if (!kScalarRight) {
+      null_lanes =
+          _mm256_or_pd(null_lanes, _mm256_cmp_pd(b, nulls, _CMP_EQ_OQ));
+    }
+    int mask = CompareDoublex4<CMP>(a, b) & ~_mm256_movemask_pd(null_lanes);
+    selected_count =
+        AppendSelected(mask, selection + itr, selection, selected_count);
+  }
+  for (; itr < count; itr++) {
+    double b = kScalarRight ? right_scalar : right[itr];
+    if (left[itr] != common::PELOTON_DECIMAL_NULL &&
+        b != common::PELOTON_DECIMAL_NULL && CompareValues<CMP>(left[itr], b)) {
+      selection[selected_count++] = selection[itr];
+    }
+  }
+  return selected_count;
+}
+
+template <bool kScalarRight>
+size_t SelectInt64(ExpressionType compare_type, const int64_t *left,
+                   const int64_t *right, int64_t right_scalar,
+                   oid_t *selection, size_t count) {
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_EQUAL, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_NOTEQUAL, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_LESSTHAN, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+                         kScalarRight>(left, right, right_scalar, selection,
+                                       count);
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_GREATERTHAN, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    default:
+      return SelectInt64<EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+                         kScalarRight>(left, right, right_scalar, selection,
+                                       count);
+  }
+}
+
+template <bool kScalarRight>
+size_t SelectDouble(ExpressionType compare_type, const double *left,
+                    const double *right, double right_scalar,
+                    oid_t *selection, size_t count) {
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_EQUAL, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_NOTEQUAL, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_LESSTHAN, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+                          kScalarRight>(left, right, right_scalar, selection,
+                                        count);
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_GREATERTHAN, kScalarRight>(
+          left, right, right_scalar, selection, count);
+    default:
+      return SelectDouble<EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+                          kScalarRight>(left, right, right_scalar, selection,
+                                        count);
+  }
+}
+
+template <typename T>
+bool CompareScalars(ExpressionType compare_type, T a, T b) {
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_EQUAL>(a, b);
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_NOTEQUAL>(a, b);
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_LESSTHAN>(a, b);
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO>(a, b);
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_GREATERTHAN>(a, b);
+    default:
+      return CompareValues<EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO>(a, b);
+  }
+}
+
+//===--------------------------------------------------------------------===//
+// Column loading and arithmetic
+//===--------------------------------------------------------------------===//
+
+/** @brief Load the integers at base + tuple * stride of the selected tuples */
+template <typename T>
+void GatherIntegers(const char *base, size_t stride,
+                    const std::vector<oid_t> &selection, T null_value,
+                    std::vector<int64_t> &result) {
+  result.resize(selection.size());
+  for (size_t itr = 0; itr < selection.size(); itr++) {
+    T value = *reinterpret_cast<const T *>(base + selection[itr] * stride);
+    result[itr] = (value == null_value) ? kIntegerNull : value;
+  }
+}
+
+/** @brief Smallest and largest non-null value of an integer type */
+void GetIntegerRange(common::Type::TypeId type, int64_t &min, int64_t &max) {
+  switch (type) {
+    case common::Type::TINYINT:
+      min = common::PELOTON_INT8_NULL;
+      max = std::numeric_limits<int8_t>::max();
+      break;
+    case common::Type::SMALLINT:
+      min = common::PELOTON_INT16_NULL;
+      max = std::numeric_limits<int16_t>::max();
+      break;
+    case common::Type::INTEGER:
+      min = common::PELOTON_INT32_NULL;
+      max = std::numeric_limits<int32_t>::max();
+      break;
+    default:
+      min = common::PELOTON_INT64_NULL;
+      max = std::numeric_limits<int64_t>::max();
+      break;
+  }
+  min++;
+}
+
+/** @brief a op b, false if it overflows or divides by zero */
+bool ComputeInt64(ExpressionType operator_type, int64_t a, int64_t b,
+                  int64_t &result) {
+  switch (operator_type) {
+    case EXPRESSION_TYPE_OPERATOR_PLUS:
+      return !__builtin_add_overflow(a, b, &result);
+    case EXPRESSION_TYPE_OPERATOR_MINUS:
+      return !__builtin_sub_overflow(a, b, &result);
+    case EXPRESSION_TYPE_OPERATOR_MULTIPLY:
+      return !__builtin_mul_overflow(a, b, &result);
+    default:
+      if (b == 0) return false;
+      result = a / b;
+      return true;
+  }
+}
+
+/** @brief a op b, false if it divides by zero */
+bool ComputeDouble(ExpressionType operator_type, double a, double b,
+                   double &result) {
+  switch (operator_type) {
+    case EXPRESSION_TYPE_OPERATOR_PLUS:
+      result = a + b;
+      return true;
+    case EXPRESSION_TYPE_OPERATOR_MINUS:
+      result = a - b;
+      return true;
+    case EXPRESSION_TYPE_OPERATOR_MULTIPLY:
+      result = a * b;
+      return true;
+    default:
+      if (b == 0) return false;
+      result = a / b;
+      return true;
+  }
+}
+
+}  // namespace
+
+/**
+ * @brief Constructor
+ */
+VectorizedPredicate::VectorizedPredicate(
+    const expression::AbstractExpression *predicate,
+    ExecutorContext *executor_context)
+    : predicate_(predicate), executor_context_(executor_context) {}
+
+bool VectorizedPredicate::IsSupported(
+    const expression::AbstractExpression *predicate,
+    const catalog::Schema *schema) {
+  return IsSupportedFilter(predicate, schema);
+}
+
+bool VectorizedPredicate::Filter(storage::TileGroup *tile_group,
+                                 const std::vector<oid_t> &selection,
+                                 std::vector<oid_t> &result) {
+  tile_group_ = tile_group;
+  result = selection;
+  bool status = FilterExpression(predicate_, result);
+  tile_group_ = nullptr;
+  return status;
+}
+
+/**
+ * @brief Narrow the selection down to the tuples where expr is true. Unlike
+ * Evaluate(), the right side of AND is only computed for the tuples that
+ * pass the left side, and the right side of OR for the others.
+ */
+bool VectorizedPredicate::FilterExpression(
+    const expression::AbstractExpression *expr,
+    std::vector<oid_t> &selection) {
+  if (selection.empty()) return true;
+
+  auto type = expr->GetExpressionType();
+  switch (type) {
+    case EXPRESSION_TYPE_CONJUNCTION_AND:
+      return FilterExpression(expr->GetChild(0), selection) &&
+             FilterExpression(expr->GetChild(1), selection);
+
+    case EXPRESSION_TYPE_CONJUNCTION_OR: {
+      std::vector<oid_t> left_selection(selection);
+      if (!FilterExpression(expr->GetChild(0), left_selection)) return false;
+
+      std::vector<oid_t> right_selection;
+      std::set_difference(selection.begin(), selection.end(),
+                          left_selection.begin(), left_selection.end(),
+                          std::back_inserter(right_selection));
+      if (!FilterExpression(expr->GetChild(1), right_selection)) return false;
+
+      selection.clear();
+      std::merge(left_selection.begin(), left_selection.end(),
+                 right_selection.begin(), right_selection.end(),
+                 std::back_inserter(selection));
+      return true;
+    }
+
+    default: {
+      PL_ASSERT(IsComparison(type));
+      VectorOperand left, right;
+      if (!ComputeExpression(expr->GetChild(0), selection, left) ||
+          !ComputeExpression(expr->GetChild(1), selection, right)) {
+        return false;
+      }
+      return Compare(type, left, right, selection);
+    }
+  }
+}
+
+/**
+ * @brief Compute the values of expr for the tuples of the selection
+ */
+bool VectorizedPredicate::ComputeExpression(
+    const expression::AbstractExpression *expr,
+    const std::vector<oid_t> &selection, VectorOperand &result) {
+  auto type = expr->GetExpressionType();
+  switch (type) {
+    case EXPRESSION_TYPE_VALUE_TUPLE:
+      return LoadColumn(
+          static_cast<const expression::TupleValueExpression *>(expr)
+              ->GetColumnId(),
+          selection, result);
+
+    case EXPRESSION_TYPE_VALUE_CONSTANT:
+      return LoadValue(
+          static_cast<const expression::ConstantValueExpression *>(expr)
+              ->GetValue(),
+          result);
+
+    case EXPRESSION_TYPE_VALUE_PARAMETER: {
+      if (executor_context_ == nullptr) return false;
+      auto &params = executor_context_->GetParams();
+      auto param_idx =
+          static_cast<const expression::ParameterValueExpression *>(expr)
+              ->GetValueIdx();
+      if (param_idx < 0 || static_cast<size_t>(param_idx) >= params.size()) {
+        return false;
+      }
+      return LoadValue(params[param_idx], result);
+    }
+
+    default: {
+      PL_ASSERT(IsArithmetic(type));
+      VectorOperand left, right;
+      if (!ComputeExpression(expr->GetChild(0), selection, left) ||
+          !ComputeExpression(expr->GetChild(1), selection, right)) {
+        return false;
+      }
+      return Compute(type, left, right, selection.size(), result);
+    }
+  }
+}
+
+/**
+ * @brief Load a column of the selected tuples of the current tile group.
+ * The tile holding the column may be in any layout, its tuples are read with
+ * the tile's stride.
+ */
+bool VectorizedPredicate::LoadColumn(oid_t column_id,
+                                     const std::vector<oid_t> &selection,
+                                     VectorOperand &result) {
+  oid_t tile_offset, tile_column_id;
+  tile_group_->LocateTileAndColumn(column_id, tile_offset, tile_column_id);
+  auto tile = tile_group_->GetTile(tile_offset);
+  auto tile_schema = tile->GetSchema();
+
+  const char *base =
+      tile->GetTupleLocation(0) + tile_schema->GetOffset(tile_column_id);
+  size_t stride = tile_schema->GetLength();
+
+  result.type = tile_schema->GetType(tile_column_id);
+  result.is_scalar = false;
+  switch (result.type) {
+    case common::Type::TINYINT:
+      GatherIntegers<int8_t>(base, stride, selection, common::PELOTON_INT8_NULL,
+                             result.ints);
+      return true;
+    case common::Type::SMALLINT:
+      GatherIntegers<int16_t>(base, stride, selection,
+                              common::PELOTON_INT16_NULL, result.ints);
+      return true;
+    case common::Type::INTEGER:
+      GatherIntegers<int32_t>(base, stride, selection,
+                              common::PELOTON_INT32_NULL, result.ints);
+      return true;
+    case common::Type::BIGINT:
+      GatherIntegers<int64_t>(base, stride, selection,
+                              common::PELOTON_INT64_NULL, result.ints);
+      return true;
+    case common::Type::TIMESTAMP: {
+      // Timestamps are compared as signed integers, which agrees with the
+      // unsigned comparisons unless the top bit is set
+      result.ints.resize(selection.size());
+      for (size_t itr = 0; itr < selection.size(); itr++) {
+        uint64_t value = *reinterpret_cast<const uint64_t *>(
+            base + selection[itr] * stride);
+        if (value == common::PELOTON_TIMESTAMP_NULL) {
+          result.ints[itr] = kIntegerNull;
+        } else if (value > static_cast<uint64_t>(
+                               std::numeric_limits<int64_t>::max())) {
+          return false;
+        } else {
+          result.ints[itr] = static_cast<int64_t>(value);
+        }
+      }
+      return true;
+    }
+    case common::Type::DECIMAL:
+      result.doubles.resize(selection.size());
+      for (size_t itr = 0; itr < selection.size(); itr++) {
+        result.doubles[itr] =
+            *reinterpret_cast<const double *>(base + selection[itr] * stride);
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Load a value that is the same for all tuples
+ */
+bool VectorizedPredicate::LoadValue(const common::Value &value,
+                                    VectorOperand &result) {
+  result.type = value.GetTypeId();
+  result.is_scalar = true;
+  bool is_null = value.IsNull();
+  switch (result.type) {
+    case common::Type::TINYINT:
+      result.int_scalar = is_null ? kIntegerNull : value.GetAs<int8_t>();
+      return true;
+    case common::Type::SMALLINT:
+      result.int_scalar = is_null ? kIntegerNull : value.GetAs<int16_t>();
+      return true;
+    case common::Type::INTEGER:
+      result.int_scalar = is_null ? kIntegerNull : value.GetAs<int32_t>();
+      return true;
+    case common::Type::BIGINT:
+      result.int_scalar = is_null ? kIntegerNull : value.GetAs<int64_t>();
+      return true;
+    case common::Type::TIMESTAMP: {
+      uint64_t timestamp = value.GetAs<uint64_t>();
+      if (is_null) {
+        result.int_scalar = kIntegerNull;
+      } else if (timestamp > static_cast<uint64_t>(
+                                 std::numeric_limits<int64_t>::max())) {
+        return false;
+      } else {
+        result.int_scalar = static_cast<int64_t>(timestamp);
+      }
+      return true;
+    }
+    case common::Type::DECIMAL:
+      result.double_scalar =
+          is_null ? common::PELOTON_DECIMAL_NULL : value.GetAs<double>();
+      return true;
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Convert integer values to decimals
+ */
+void VectorizedPredicate::VectorOperand::ConvertToDecimal() {
+  auto convert = [](int64_t value) {
+    return value == kIntegerNull ? common::PELOTON_DECIMAL_NULL
+                                 : static_cast<double>(value);
+  };
+  type = common::Type::DECIMAL;
+  if (is_scalar) {
+    double_scalar = convert(int_scalar);
+    return;
+  }
+  doubles.resize(ints.size());
+  for (size_t itr = 0; itr < ints.size(); itr++) {
+    doubles[itr] = convert(ints[itr]);
+  }
+}
+
+/**
+ * @brief Keep the tuples of the selection where the comparison of left and
+ * right is true. Integers compared with decimals are converted first, like
+ * Value does.
+ */
+bool VectorizedPredicate::Compare(ExpressionType compare_type,
+                                  VectorOperand &left, VectorOperand &right,
+                                  std::vector<oid_t> &selection) {
+  bool left_timestamp = (left.type == common::Type::TIMESTAMP);
+  bool right_timestamp = (right.type == common::Type::TIMESTAMP);
+  if (left_timestamp != right_timestamp) return false;
+
+  bool is_decimal = left.IsDecimal() || right.IsDecimal();
+  for (auto operand : {&left, &right}) {
+    if (is_decimal && !operand->IsDecimal()) operand->ConvertToDecimal();
+  }
+
+  // Put the scalar on the right
+  if (left.is_scalar && !right.is_scalar) {
+    std::swap(left, right);
+    compare_type = expression::ExpressionUtil::SwapComparison(compare_type);
+  }
+
+  if (right.is_scalar) {
+    bool right_null = is_decimal
+                          ? right.double_scalar == common::PELOTON_DECIMAL_NULL
+                          : right.int_scalar == kIntegerNull;
+    if (right_null) {
+      selection.clear();
+      return true;
+    }
+
+    if (left.is_scalar) {
+      bool left_null = is_decimal
+                           ? left.double_scalar == common::PELOTON_DECIMAL_NULL
+                           : left.int_scalar == kIntegerNull;
+      bool passes =
+          !left_null &&
+          (is_decimal ? CompareScalars(compare_type, left.double_scalar,
+                                       right.double_scalar)
+                      : CompareScalars(compare_type, left.int_scalar,
+                                       right.int_scalar));
+      if (!passes) selection.clear();
+      return true;
+    }
+  }
+
+  size_t selected_count;
+  if (is_decimal) {
+    selected_count =
+        right.is_scalar
+            ? SelectDouble<true>(compare_type, left.doubles.data(), nullptr,
+                                 right.double_scalar, selection.data(),
+                                 selection.size())
+            : SelectDouble<false>(compare_type, left.doubles.data(),
+                                  right.doubles.data(), 0, selection.data(),
+                                  selection.size());
+  } else {
+    selected_count =
+        right.is_scalar
+            ? SelectInt64<true>(compare_type, left.ints.data(), nullptr,
+                                right.int_scalar, selection.data(),
+                                selection.size())
+            : SelectInt64<false>(compare_type, left.ints.data(),
+                                 right.ints.data(), 0, selection.data(),
+                                 selection.size());
+  }
+  selection.resize(selected_count);
+  return true;
+}
+
+/**
+ * @brief Compute left op right for count tuples. The result has the type
+ * Value would give it: a decimal if either side is one, else the wider of
+ * the two integer types. Results that overflow that type are left to the
+ * interpreter.
+ */
+bool VectorizedPredicate::Compute(ExpressionType operator_type,
+                                  VectorOperand &left, VectorOperand &right,
+                                  size_t count, VectorOperand &result) {
+  if (left.type == common::Type::TIMESTAMP ||
+      right.type == common::Type::TIMESTAMP) {
+    return false;
+  }
+
+  result.is_scalar = left.is_scalar && right.is_scalar;
+  size_t result_count = result.is_scalar ? 1 : count;
+
+  if (left.IsDecimal() || right.IsDecimal()) {
+    for (auto operand : {&left, &right}) {
+      if (!operand->IsDecimal()) operand->ConvertToDecimal();
+    }
+    result.type = common::Type::DECIMAL;
+    result.doubles.resize(result_count);
+    for (size_t itr = 0; itr < result_count; itr++) {
+      double a = left.is_scalar ? left.double_scalar : left.doubles[itr];
+      double b = right.is_scalar ? right.double_scalar : right.doubles[itr];
+      if (a == common::PELOTON_DECIMAL_NULL ||
+          b == common::PELOTON_DECIMAL_NULL) {
+        result.doubles[itr] = common::PELOTON_DECIMAL_NULL;
+      } else if (!ComputeDouble(operator_type, a, b, result.doubles[itr])) {
+        return false;
+      }
+    }
+    if (result.is_scalar) result.double_scalar = result.doubles[0];
+    return true;
+  }
+
+  PL_ASSERT(common::Type::IsIntegerType(left.type) &&
+            common::Type::IsIntegerType(right.type));
+  result.type = std::max(left.type, right.type);
+  int64_t min, max;
+  GetIntegerRange(result.type, min, max);
+
+  result.ints.resize(result_count);
+  for (size_t itr = 0; itr < result_count; itr++) {
+    int64_t a = left.is_scalar ? left.int_scalar : left.ints[itr];
+    int64_t b = right.is_scalar ? right.int_scalar : right.ints[itr];
+    if (a == kIntegerNull || b == kIntegerNull) {
+      result.ints[itr] = kIntegerNull;
+    } else if (!ComputeInt64(operator_type, a, b, result.ints[itr]) ||
+               result.ints[itr] < min || result.ints[itr] > max) {
+      return false;
+    }
+  }
+  if (result.is_scalar) result.int_scalar = result.ints[0];
+  return true;
+}
+
+}  // namespace executor
+}  // namespace peloton
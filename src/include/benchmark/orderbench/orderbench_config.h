@@ -48,6 +48,15 @@ public:
   // use avx2 sort implementation for ORDER BY
   bool use_avx2_sort;
 
+  // number of partitions sorted in parallel by ORDER BY (0: serial)
+  int sort_partitions;
+
+  // SIMD sort kernel (0: scalar, 1: AVX2, 2: AVX-512, -1: widest supported)
+  int sort_kernel;
+
+  // memory budget of ORDER BY in MB before spilling sorted runs (0: unlimited)
+  int sort_memory_budget;
+
   // time of the sort-merge join in milliseconds
   long execution_time_ms = 0;
 };
@@ -53,6 +53,12 @@ public:
 
   bool use_avx2_sort;
 
+  // number of partitions merged in parallel by the merge join (0: serial)
+  int merge_partitions;
+
+  // sort the inputs inside the sort-merge join executor
+  bool integrated_sort;
+
   // time of the sort-merge join in milliseconds
   long execution_time_ms = 0;
 };
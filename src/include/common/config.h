@@ -26,6 +26,9 @@ DECLARE_string(socket_family);
 // Enable or disable statistics collection
 DECLARE_uint64(stats_mode);
 
+// Threads that run the pipelines of a query
+DECLARE_uint64(query_parallelism);
+
 // Both for showing the help info
 DECLARE_bool(h);
 DECLARE_bool(help);
@@ -13,58 +13,66 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <thread>
 
-#include <boost/asio/io_service.hpp>
-#include <boost/thread/thread.hpp>
-#include <boost/bind.hpp>
-#include <boost/function.hpp>
-
 #include "common/macros.h"
 
 namespace peloton {
-// a wrapper for boost worker thread pool.
+// a work-stealing pool of worker threads.
+//
+// every worker owns a task queue. a task submitted by a worker goes to the
+// back of its own queue and a task submitted by another thread to the queues
+// in turn. a worker runs the tasks of its own queue newest first, and steals
+// the oldest task of another queue when its own is empty, trying the workers
+// of its own NUMA node first.
+//
+// on machines with several NUMA nodes the workers are spread over the nodes
+// and bound to the cpus of their node, so the tasks a worker submits run
+// close to the memory it touched.
+//
+// the workers start when the first task is submitted, so a process that
+// never runs a parallel task does not keep idle threads around.
 class ThreadPool {
  public:
-  ThreadPool() : pool_size_(0), 
-                 dedicated_thread_count_(0),
-                 work_(io_service_) { }
+  ThreadPool() : pool_size_(0), dedicated_thread_count_(0) { }
 
   ~ThreadPool() { }
 
-  void Initialize(const size_t &pool_size, const size_t &dedicated_thread_count) {
-    pool_size_ = pool_size;
-    // PL_ASSERT(pool_size_ != 0);
+  void Initialize(const size_t &pool_size, const size_t &dedicated_thread_count);
 
-    dedicated_thread_count_ = dedicated_thread_count;
+  void Shutdown();
 
-    for (size_t i = 0; i < pool_size_; ++i) {
-      // add thread to thread pool.
-      thread_pool_.create_thread(
-          boost::bind(&boost::asio::io_service::run, &io_service_));
-    }
+  // number of worker threads that serve SubmitTask().
+  size_t GetPoolSize() const { return pool_size_; }
 
-    dedicated_threads_.resize(dedicated_thread_count_);
-  }
-
-  void Shutdown() {
-    // always join lastly created threads first.
-    for (size_t i = 0; i < current_thread_count_; ++i) {
-      dedicated_threads_[(current_thread_count_ - 1 - i)]->join();
-    }
-    io_service_.stop();
-    thread_pool_.join_all();
-  }
+  // number of NUMA nodes the worker threads are spread over.
+  size_t GetNodeCount() const { return node_count_; }
 
   // submit task to thread pool.
   // it accepts a function and a set of function parameters as parameters.
   template <typename FunctionType, typename... ParamTypes>
   void SubmitTask(FunctionType &&func, const ParamTypes &&... params) {
     // add task to thread pool.
-    io_service_.post(std::bind(func, params...));
+    PushTask(std::bind(func, params...));
   }
 
+  // run a batch of tasks on the worker threads and block until all of them
+  // finish. the calling thread also works on the batch, so the call makes
+  // progress even if the pool has no (or only busy) worker threads. while
+  // the last tasks of the batch run elsewhere, the calling thread runs other
+  // queued tasks, so tasks may run batches of their own.
+  // the tasks are moved out of the given vector.
+  void ExecuteTasks(std::vector<std::function<void()>> &tasks);
+
   // submit task to a dedicated thread.
   // it accepts a function and a set of function parameters as parameters.
   template <typename FunctionType, typename... ParamTypes>
@@ -79,6 +87,29 @@ class ThreadPool {
   ThreadPool(const ThreadPool &);
   ThreadPool &operator=(const ThreadPool &);
 
+  // the task queue of a worker.
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+    // NUMA node of the worker.
+    size_t node;
+  };
+
+  void PushTask(std::function<void()> task);
+
+  // take a task from the queue of the given worker, or steal one.
+  // a worker id of pool_size_ takes a task for a thread outside the pool.
+  bool PopTask(size_t worker_id, std::function<void()> &task);
+
+  // start the worker threads, once after every Initialize().
+  void StartWorkers();
+
+  void RunWorker(size_t worker_id);
+
+  // index of the calling thread among the workers, pool_size_ if it is not
+  // a worker of this pool.
+  size_t GetWorkerId() const;
+
  private:
   // number of threads in the thread pool.
   size_t pool_size_;
@@ -87,13 +118,25 @@ class ThreadPool {
   // current number of dedicated threads.
   std::atomic<size_t> current_thread_count_ = ATOMIC_VAR_INIT(0);
 
-  // real thread pool that holds a set of threads.
-  boost::thread_group thread_pool_;
-  // io_service provides IO functionality of asynchronize services.
-  boost::asio::io_service io_service_;
-  // io_service::work is responsible for starting the io_service processing
-  // loop.
-  boost::asio::io_service::work work_;
+  // number of NUMA nodes the workers are spread over.
+  size_t node_count_ = 1;
+
+  // set once the worker threads run.
+  std::atomic<bool> started_ = ATOMIC_VAR_INIT(false);
+  std::mutex start_mutex_;
+
+  // one task queue per worker.
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+
+  // queue that receives the next task from outside the pool.
+  std::atomic<size_t> next_queue_ = ATOMIC_VAR_INIT(0);
+
+  // idle workers sleep until a task is queued or the pool shuts down.
+  std::atomic<size_t> queued_task_count_ = ATOMIC_VAR_INIT(0);
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  std::atomic<bool> shutdown_ = ATOMIC_VAR_INIT(false);
 
   std::vector<std::unique_ptr<std::thread>> dedicated_threads_;
 };
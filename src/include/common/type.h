@@ -51,6 +51,12 @@ class Type {
   // Get the size of this data type in bytes
   static uint64_t GetTypeSize(TypeId type_id);
 
+  // Is this one of the signed integer types (TINYINT to BIGINT)
+  static bool IsIntegerType(TypeId type_id) {
+    return type_id == TINYINT || type_id == SMALLINT || type_id == INTEGER ||
+           type_id == BIGINT;
+  }
+
   // What is the resulting type of performing the templated binary operation
   // on the templated types
   template <typename Op, typename T1, typename T2>
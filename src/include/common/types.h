@@ -420,6 +420,7 @@ enum PlanNodeType {
   PLAN_NODE_TYPE_MERGEJOIN = 22,
   PLAN_NODE_TYPE_HASHJOIN = 23,
   PLAN_NODE_TYPE_SORT_MERGEJOIN = 24,
+  PLAN_NODE_TYPE_BANDJOIN = 25,
 
   // Mutator Nodes
   PLAN_NODE_TYPE_UPDATE = 30,
@@ -640,7 +641,9 @@ enum SetOpType {
   SETOP_TYPE_INTERSECT = 1,
   SETOP_TYPE_INTERSECT_ALL = 2,
   SETOP_TYPE_EXCEPT = 3,
-  SETOP_TYPE_EXCEPT_ALL = 4
+  SETOP_TYPE_EXCEPT_ALL = 4,
+  SETOP_TYPE_UNION = 5,
+  SETOP_TYPE_UNION_ALL = 6
 };
 
 //===--------------------------------------------------------------------===//
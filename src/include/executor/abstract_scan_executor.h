@@ -15,6 +15,7 @@
 #include "planner/abstract_scan_plan.h"
 #include "common/types.h"
 #include "executor/abstract_executor.h"
+#include "util/bloom_filter.h"
 
 namespace peloton {
 namespace executor {
@@ -41,9 +42,22 @@ class AbstractScanExecutor : public AbstractExecutor {
 
   virtual void ResetState() {}
 
+  /**
+   * @brief Drop the tuples whose hash of key_column_ids (columns of the
+   * output tiles) is not in the filter, e.g., probe rows of a hash join that
+   * can not find a match. Only sequential and hybrid scans support it.
+   * The filter must outlive the scan.
+   */
+  void SetProbeFilter(const util::BloomFilter *probe_filter,
+                      const std::vector<oid_t> &key_column_ids);
+
  protected:
   bool DInit();
 
+  bool PassesProbeFilter(storage::TileGroup *tile_group, oid_t tuple_id) const;
+
+  bool MayMatchZoneMap(storage::TileGroup *tile_group) const;
+
   virtual bool DExecute() = 0;
 
  protected:
@@ -56,6 +70,15 @@ class AbstractScanExecutor : public AbstractExecutor {
 
   /** @brief Columns from tile group to be added to logical tile output. */
   std::vector<oid_t> column_ids_;
+
+  //===--------------------------------------------------------------------===//
+  // Probe Filter
+  //===--------------------------------------------------------------------===//
+
+  const util::BloomFilter *probe_filter_ = nullptr;
+
+  /** @brief Tile group columns of the keys of the probe filter */
+  std::vector<oid_t> probe_filter_column_ids_;
 };
 
 }  // namespace executor
@@ -17,11 +17,14 @@
 #include "storage/data_table.h"
 #include "common/varlen_pool.h"
 
+#include <memory>
 #include <vector>
 
 namespace peloton {
 namespace executor {
 
+class AbstractAggregator;
+
 /**
  * The actual executor class templated on the type of aggregation that
  * should be performed.
@@ -46,6 +49,33 @@ class AggregateExecutor : public AbstractExecutor {
 
   ~AggregateExecutor();
 
+  /**
+   * @brief Aggregate in two phases on the shared thread pool.
+   *
+   * Every worker aggregates a share of the child tiles into its own
+   * aggregator, then the partial groups are merged, each hash partition of
+   * the groups by one task, and finalized. Sorted aggregation stays serial.
+   * A thread count of 0 picks one thread per hardware thread.
+   */
+  void UseParallelAggregation(size_t thread_count = 0);
+
+  /**
+   * @brief Aggregate hash strategy plans by sorting instead of hashing.
+   *
+   * The child tiles are buffered, their (normalized group key, row position)
+   * pairs are sorted with the SIMD merge sort, and the rows are aggregated in
+   * key order by a SortedAggregator, so that no hash table has to be probed
+   * at random. This is also picked for plans that expect at least
+   * SORT_AGGREGATION_MIN_GROUPS groups. Group keys that do not normalize
+   * into exact 64-bit keys are still hashed.
+   */
+  void UseSortAggregation(bool sort_aggregation = true) {
+    sort_aggregation_ = sort_aggregation;
+  }
+
+  /** Expected groups above which the hash table no longer fits in cache */
+  static const size_t SORT_AGGREGATION_MIN_GROUPS = size_t(1) << 18;
+
  protected:
   bool DInit();
 
@@ -66,6 +96,19 @@ class AggregateExecutor : public AbstractExecutor {
 
   /** @brief Output table. */
   storage::DataTable *output_table = nullptr;
+
+ private:
+  AbstractAggregator *CreateAggregator(LogicalTile *tile);
+
+  bool AggregateInParallel(
+      std::vector<std::unique_ptr<AbstractAggregator>> &aggregators);
+
+  bool AggregateSorted(
+      std::vector<std::unique_ptr<AbstractAggregator>> &aggregators);
+
+  size_t aggregate_thread_count_ = 1;
+
+  bool sort_aggregation_ = false;
 };
 
 }  // namespace executor
@@ -20,6 +20,8 @@
 #include "executor/abstract_executor.h"
 #include "planner/aggregate_plan.h"
 #include "common/container_tuple.h"
+#include "util/flat_hash_table.h"
+#include "util/sort_key_normalizer.h"
 
 //===--------------------------------------------------------------------===//
 // Aggregate
@@ -46,8 +48,13 @@ class Agg {
   void Advance(const common::Value val);
   common::Value Finalize();
 
+  /** @brief Merge the partial aggregate of other, an Agg of the same type
+   * over other values of the same group */
+  void Merge(const Agg &other);
+
   virtual void DAdvance(const common::Value &val) = 0;
   virtual common::Value DFinalize() = 0;
+  virtual void DMerge(const Agg &other) = 0;
 
  private:
   typedef std::unordered_set<common::Value , common::Value::hash, common::Value::equal_to>
@@ -82,6 +89,11 @@ class SumAgg : public Agg {
     return aggregate;
   }
 
+  void DMerge(const Agg &other) {
+    auto &other_sum = static_cast<const SumAgg &>(other);
+    if (other_sum.have_advanced) DAdvance(other_sum.aggregate);
+  }
+
  private:
   common::Value aggregate;
 
@@ -131,6 +143,18 @@ class AvgAgg : public Agg {
     return final_result;
   }
 
+  // The partial sums are already weighted
+  void DMerge(const Agg &other) {
+    auto &other_avg = static_cast<const AvgAgg &>(other);
+    if (other_avg.count == 0) return;
+    if (count == 0) {
+      aggregate = other_avg.aggregate.Copy();
+    } else {
+      aggregate = aggregate.Add(other_avg.aggregate);
+    }
+    count += other_avg.count;
+  }
+
  private:
   /** @brief aggregate initialized on first advance. */
   common::Value aggregate;
@@ -160,6 +184,10 @@ class CountAgg : public Agg {
     return common::ValueFactory::GetBigIntValue(count);
   }
 
+  void DMerge(const Agg &other) {
+    count += static_cast<const CountAgg &>(other).count;
+  }
+
  private:
   int64_t count;
 };
@@ -174,6 +202,10 @@ class CountStarAgg : public Agg {
     return common::ValueFactory::GetBigIntValue(count);
   }
 
+  void DMerge(const Agg &other) {
+    count += static_cast<const CountStarAgg &>(other).count;
+  }
+
  private:
   int64_t count;
 };
@@ -201,6 +233,11 @@ class MaxAgg : public Agg {
     return aggregate;
   }
 
+  void DMerge(const Agg &other) {
+    auto &other_max = static_cast<const MaxAgg &>(other);
+    if (other_max.have_advanced) DAdvance(other_max.aggregate);
+  }
+
  private:
   common::Value aggregate;
 
@@ -231,6 +268,11 @@ class MinAgg : public Agg {
     return aggregate;
   }
 
+  void DMerge(const Agg &other) {
+    auto &other_min = static_cast<const MinAgg &>(other);
+    if (other_min.have_advanced) DAdvance(other_min.aggregate);
+  }
+
  private:
   common::Value aggregate;
 
@@ -255,6 +297,22 @@ class AbstractAggregator {
 
   virtual bool Advance(AbstractTuple *next_tuple) = 0;
 
+  /** @brief Advance every tuple of a tile, one at a time by default */
+  virtual bool AdvanceTile(LogicalTile *tile);
+
+  /**
+   * @brief Merge the partial aggregates of the groups of other whose keys
+   * hash to partition_itr of partition_count partitions. other must be an
+   * aggregator of the same type and plan over other input tuples, e.g., of
+   * another thread. Merges of different partitions may run concurrently.
+   * @return false if the aggregator does not support merging
+   */
+  virtual bool Merge(const AbstractAggregator &other UNUSED_ATTRIBUTE,
+                     size_t partition_itr UNUSED_ATTRIBUTE,
+                     size_t partition_count UNUSED_ATTRIBUTE) {
+    return false;
+  }
+
   virtual bool Finalize() = 0;
 
   virtual ~AbstractAggregator() {}
@@ -282,6 +340,9 @@ class HashAggregator : public AbstractAggregator {
 
   bool Advance(AbstractTuple *next_tuple) override;
 
+  bool Merge(const AbstractAggregator &other, size_t partition_itr,
+             size_t partition_count) override;
+
   bool Finalize() override;
 
   ~HashAggregator();
@@ -329,6 +390,9 @@ class HashAggregator : public AbstractAggregator {
   typedef std::unordered_map<std::vector<common::Value>, AggregateList *,
                              ValueVectorHasher, ValueVectorCmp> HashAggregateMapType;
 
+  AggregateList *AddGroup(const std::vector<common::Value> &key,
+                          const std::vector<common::Value> &first_tuple_values);
+
   /** @brief Group by key values used */
   std::vector<common::Value> group_by_key_values;
 
@@ -336,6 +400,89 @@ class HashAggregator : public AbstractAggregator {
   HashAggregateMapType aggregates_map;
 };
 
+/**
+ * @brief Used when input is NOT sorted, the group-by keys can be packed into
+ * 64 bits and every aggregate has a fixed-width state, i.e., it is a
+ * non-distinct SUM, COUNT, MIN, MAX or AVG of a numeric column, or a COUNT(*).
+ *
+ * The packed keys are looked up in a flat open addressing table of group
+ * indexes, and the aggregate states of all groups are stored inline in one
+ * array, so no memory is allocated per tuple and only one per new group for
+ * the values of its first tuple. Tiles are aggregated in batches: the keys of
+ * a tile are packed column by column, then its groups are looked up, then
+ * every aggregate is updated in its own loop over the tile.
+ */
+class FlatHashAggregator : public AbstractAggregator {
+ public:
+  FlatHashAggregator(const planner::AggregatePlan *node,
+                     storage::DataTable *output_table,
+                     executor::ExecutorContext *econtext,
+                     const std::vector<common::Type::TypeId> &input_types);
+
+  /** @brief Whether the plan can be aggregated over input columns of the
+   * given types */
+  static bool CanAggregate(const planner::AggregatePlan *node,
+                           const std::vector<common::Type::TypeId> &input_types);
+
+  bool Advance(AbstractTuple *next_tuple) override;
+
+  bool AdvanceTile(LogicalTile *tile) override;
+
+  bool Merge(const AbstractAggregator &other, size_t partition_itr,
+             size_t partition_count) override;
+
+  bool Finalize() override;
+
+ private:
+  /** Inline state of an aggregate of a group */
+  struct AggregateState {
+    union {
+      int64_t int_value;
+      double double_value;
+    };
+    /** Non-null values aggregated, rows for COUNT(*) */
+    int64_t count;
+  };
+
+  template <typename Tuple>
+  uint32_t FindOrAddGroup(uint64_t key, const Tuple &tuple);
+
+  void AdvanceState(size_t aggno, AggregateState &state,
+                    const common::Value &value) const;
+
+  void MergeState(size_t aggno, AggregateState &state,
+                  const AggregateState &other_state) const;
+
+  common::Value FinalizeState(size_t aggno, const AggregateState &state) const;
+
+  inline AggregateState &GetState(uint32_t group, size_t aggno) {
+    return states_[group * agg_input_columns_.size() + aggno];
+  }
+
+  inline const AggregateState &GetState(uint32_t group, size_t aggno) const {
+    return states_[group * agg_input_columns_.size() + aggno];
+  }
+
+  const size_t num_input_columns_;
+
+  util::SortKeyNormalizer key_normalizer_;
+
+  /** Input column and its type of every aggregate (INVALID_OID if none) */
+  std::vector<oid_t> agg_input_columns_;
+  std::vector<common::Type::TypeId> agg_input_types_;
+
+  /** Group index of every packed key */
+  util::FlatHashTable<uint32_t> group_table_;
+
+  std::vector<uint64_t> group_keys_;
+
+  /** Values of the first tuple of every group, one group after the other */
+  std::vector<common::Value> group_tuple_values_;
+
+  /** Aggregate states, one group after the other */
+  std::vector<AggregateState> states_;
+};
+
 /**
  * @brief Used when input is sorted on group-by keys.
  */
@@ -348,6 +495,14 @@ class SortedAggregator : public AbstractAggregator {
 
   bool Advance(AbstractTuple *next_tuple) override;
 
+  /**
+   * @brief Add a row whose group boundary the caller already knows, e.g.,
+   * from exact normalized group keys. Unlike Advance(), this also groups
+   * rows with null group keys.
+   * @param starts_group true if the row is the first row of its group
+   */
+  bool AdvanceGroup(AbstractTuple *next_tuple, bool starts_group);
+
   bool Finalize() override;
 
   ~SortedAggregator();
@@ -371,6 +526,9 @@ class PlainAggregator : public AbstractAggregator {
 
   bool Advance(AbstractTuple *next_tuple) override;
 
+  bool Merge(const AbstractAggregator &other, size_t partition_itr,
+             size_t partition_count) override;
+
   bool Finalize() override;
 
   ~PlainAggregator();
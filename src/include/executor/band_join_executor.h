@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// band_join_executor.h
+//
+// Identification: src/include/executor/band_join_executor.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "common/container_tuple.h"
+#include "executor/abstract_join_executor.h"
+#include "planner/band_join_plan.h"
+#include "util/sort_key_normalizer.h"
+
+namespace peloton {
+namespace executor {
+
+/**
+ * @brief Join on a range predicate (see BandJoinPlan) by sorting instead of
+ * comparing every pair of rows like the nested loop join.
+ *
+ * The left child is buffered and its rows are sorted on their keys, with the
+ * SIMD merge sort if the key and the bounds are columns of the same
+ * fixed-width type. The right child is streamed: the bounds of every right
+ * row are binary searched in the sorted keys, and all the left rows in
+ * between are its matches. This takes O((N + M) log N) plus the output size.
+ *
+ * @warning The left child is a pipeline breaker, it is buffered completely.
+ */
+class BandJoinExecutor : public AbstractJoinExecutor {
+  BandJoinExecutor(const BandJoinExecutor &) = delete;
+  BandJoinExecutor &operator=(const BandJoinExecutor &) = delete;
+
+ public:
+  explicit BandJoinExecutor(const planner::AbstractPlan *node,
+                            ExecutorContext *executor_context);
+
+ protected:
+  bool DInit();
+
+  bool DExecute();
+
+ private:
+  /** Position of a row in the buffered child tiles: (tile index, row id) */
+  typedef std::pair<size_t, oid_t> RowPosition;
+
+  void InitKeyNormalizer();
+
+  void SortLeftRows();
+
+  bool SortNormalizedLeftRows();
+
+  void ProbeRightTile(size_t right_tile_itr);
+
+  bool FindBand(expression::ContainerTuple<LogicalTile> &right_tuple,
+                size_t &begin, size_t &end);
+
+  size_t FindKeyBound(const common::Value &value, bool after_equal) const;
+
+  /** @brief The band predicate, taken from the plan node */
+  const planner::BandJoinPlan::BandClause *band_clause_ = nullptr;
+
+  /** Normalizes the keys into integers that are compared instead of the
+   * values, null if the keys are compared as values */
+  std::unique_ptr<util::SortKeyNormalizer> key_normalizer_;
+
+  bool left_sorted_ = false;
+
+  /** Left rows with a non-null key, sorted on their keys */
+  std::vector<RowPosition> left_rows_;
+
+  /** Keys of left_rows_, normalized or as values */
+  std::vector<util::sort_key64_type> left_keys_;
+  std::vector<common::Value> left_key_values_;
+
+  /** Output tiles that are ready to be returned to the parent */
+  std::deque<std::unique_ptr<LogicalTile>> buffered_output_tiles_;
+};
+
+}  // namespace executor
+}  // namespace peloton
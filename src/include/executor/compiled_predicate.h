@@ -0,0 +1,96 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// compiled_predicate.h
+//
+// Identification: src/include/executor/compiled_predicate.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "common/types.h"
+#include "common/value.h"
+
+namespace peloton {
+
+namespace catalog {
+class Schema;
+}
+
+namespace expression {
+class AbstractExpression;
+}
+
+namespace storage {
+class TileGroup;
+}
+
+namespace executor {
+
+/**
+ * @brief A scan predicate compiled into scan loops over raw tile memory.
+ *
+ * Each comparison of a column with a constant, a parameter or a column of
+ * the same type is bound to a scan loop that is instantiated ahead of time
+ * for every column type, value type and comparison operator. The loop reads
+ * the column with the stride of its tile and compacts the position list in
+ * place, without building a Value or calling Evaluate().
+ *
+ * The predicate is compiled once per plan (see
+ * SeqScanPlan::GetCompiledPredicate()), so repeated executions of a prepared
+ * statement reuse it. Parameters are bound when a tile group is filtered.
+ *
+ * Supported: AND/OR of comparisons (=, <>, <, <=, >, >=) whose columns are
+ * TINYINT, SMALLINT, INTEGER, BIGINT or DECIMAL.
+ */
+class CompiledPredicate {
+ public:
+  CompiledPredicate(const CompiledPredicate &) = delete;
+  CompiledPredicate &operator=(const CompiledPredicate &) = delete;
+
+  ~CompiledPredicate();
+
+  /**
+   * @brief Compile a predicate over tuples of the given schema.
+   * @return null if the predicate is not supported
+   */
+  static std::unique_ptr<CompiledPredicate> Compile(
+      const expression::AbstractExpression *predicate,
+      const catalog::Schema *schema);
+
+  /**
+   * @brief Select the tuples of the tile group for which the predicate is
+   * true. selection must be sorted.
+   * @return false if a parameter has a type that was not compiled for, the
+   * tile group has to be filtered by other means then
+   */
+  bool Filter(storage::TileGroup *tile_group,
+              const std::vector<common::Value> &params,
+              const std::vector<oid_t> &selection,
+              std::vector<oid_t> &result) const;
+
+ private:
+  struct PredicateNode;
+
+  explicit CompiledPredicate(std::unique_ptr<PredicateNode> root);
+
+  static std::unique_ptr<PredicateNode> CompileNode(
+      const expression::AbstractExpression *expr,
+      const catalog::Schema *schema);
+
+  bool FilterNode(const PredicateNode &node, storage::TileGroup *tile_group,
+                  const std::vector<common::Value> &params,
+                  std::vector<oid_t> &selection) const;
+
+  std::unique_ptr<PredicateNode> root_;
+};
+
+}  // namespace executor
+}  // namespace peloton
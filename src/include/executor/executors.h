@@ -25,11 +25,15 @@
 #include "executor/delete_executor.h"
 #include "executor/update_executor.h"
 #include "executor/nested_loop_join_executor.h"
+#include "executor/index_nested_loop_join_executor.h"
 #include "executor/merge_join_executor.h"
+#include "executor/sort_merge_join_executor.h"
 #include "executor/hash_join_executor.h"
+#include "executor/band_join_executor.h"
 #include "executor/hash_executor.h"
 #include "executor/order_by_executor.h"
 #include "executor/hash_set_op_executor.h"
+#include "executor/merge_set_op_executor.h"
 #include "executor/append_executor.h"
 #include "executor/projection_executor.h"
 #include "executor/copy_executor.h"
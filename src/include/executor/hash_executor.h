@@ -13,15 +13,17 @@
 
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
+#include <memory>
+#include <vector>
 
+#include "catalog/schema.h"
 #include "common/types.h"
 #include "executor/abstract_executor.h"
 #include "executor/logical_tile.h"
+#include "executor/spill_file.h"
 #include "common/container_tuple.h"
-
-#include <boost/functional/hash.hpp>
+#include "util/bloom_filter.h"
+#include "util/flat_hash_table.h"
 
 namespace peloton {
 namespace executor {
@@ -29,6 +31,15 @@ namespace executor {
 /**
  * @brief Hash executor.
  *
+ * The build rows are radix-partitioned on the low bits of their hashes, in
+ * up to two passes whose fan-out stays within the TLB, until a partition
+ * fits into the L2 cache. Every partition gets its own flat open addressing
+ * table, so that probes of a partition stay in cache.
+ *
+ * With a memory budget, the child tiles are spilled to partition files on
+ * the bits of their key hashes above the radix bits once their estimated
+ * size exceeds the budget. No table is built and no tile is returned then,
+ * the parent joins the spilled partitions one at a time instead.
  */
 class HashExecutor : public AbstractExecutor {
  public:
@@ -40,32 +51,153 @@ class HashExecutor : public AbstractExecutor {
   explicit HashExecutor(const planner::AbstractPlan *node,
                         ExecutorContext *executor_context);
 
-  /** @brief Type definitions for hash table */
-  typedef std::unordered_map<
-      expression::ContainerTuple<LogicalTile>,
-      std::unordered_set<std::pair<size_t, oid_t>,
-                         boost::hash<std::pair<size_t, oid_t>>>,
-      expression::ContainerTupleHasher<LogicalTile>,
-      expression::ContainerTupleComparator<LogicalTile>> HashMapType;
+  /** @brief Type definitions for hash table
+   * A build row is stored as (child tile index << 32 | row id) */
+  typedef util::FlatHashTable<uint64_t> HashTableType;
+
+  /** @brief Partition the build rows and build the partition tables on the
+   * shared thread pool.
+   * A thread count of 0 picks one thread per hardware thread. */
+  void UseParallelBuild(size_t thread_count = 0);
+
+  /** @brief Spill the child tiles once their estimated size exceeds
+   * memory_budget bytes. A budget of 0 keeps all input in memory. */
+  void UseMemoryBudget(size_t memory_budget) { memory_budget_ = memory_budget; }
+
+  inline size_t GetMemoryBudget() const { return memory_budget_; }
+
+  /** @brief Whether the child tiles were spilled instead of hashed */
+  inline bool IsSpilled() const { return spilled_; }
+
+  /** @brief Hand the spilled partition files over to the caller, a file is
+   * nullptr if its partition is empty */
+  std::vector<std::unique_ptr<SpillFile>> ReleaseSpillPartitions() {
+    return std::move(spill_partitions_);
+  }
+
+  /** @brief Schema of the spilled child tiles */
+  inline const catalog::Schema *GetSpillSchema() const {
+    return spill_schema_.get();
+  }
 
-  inline HashMapType &GetHashTable() { return this->hash_table_; }
+  /**
+   * @brief Build the hash table over tiles owned by the caller, e.g., a
+   * spilled partition that was read back. Their tile indexes in tiles are
+   * the ones passed to ForEachMatch().
+   */
+  void BuildHashTable(const std::vector<LogicalTile *> &tiles);
 
   inline const std::vector<oid_t> &GetHashKeyIds() const {
     return this->column_ids_;
   }
 
+  /** @brief Hash of the key columns of a row */
+  static uint64_t HashKey(const expression::ContainerTuple<LogicalTile> &key) {
+    return util::MixHash(key.HashCode());
+  }
+
+  /**
+   * @brief Call match(tile_itr, row) for every build row whose key equals
+   * key, where tile_itr is the index of the build row's tile among the
+   * tiles returned by this executor. This is safe to call concurrently.
+   */
+  template <typename Match>
+  void ForEachMatch(uint64_t hash,
+                    const expression::ContainerTuple<LogicalTile> &key,
+                    Match match) const {
+    if (partition_tables_.empty()) return;
+    partition_tables_[GetPartition(hash)].ForEachMatch(
+        hash, [this, &key, &match](uint64_t payload) {
+          size_t tile_itr = static_cast<size_t>(payload >> 32);
+          oid_t row = static_cast<oid_t>(payload);
+          expression::ContainerTuple<LogicalTile> build_key(
+              build_tiles_[tile_itr], row, &column_ids_);
+          if (build_key.EqualsNoSchemaCheck(key)) match(tile_itr, row);
+        });
+  }
+
+  inline size_t GetPartitionCount() const { return partition_tables_.size(); }
+
+  //===--------------------------------------------------------------------===//
+  // Spilling
+  //===--------------------------------------------------------------------===//
+
+  /** @brief Hash bits of one level of spill partitions */
+  static const size_t SPILL_PARTITION_BITS = 4;
+
+  /** @brief Spilled partitions are partitioned again up to this level */
+  static const size_t MAX_SPILL_LEVEL = 3;
+
+  /** @brief Spill partition of a hash at a level of repartitioning. The
+   * bits are above those of the radix partitions and below the slot bits of
+   * the tables. */
+  static size_t GetSpillPartition(uint64_t hash, size_t level) {
+    return (hash >> (32 + level * SPILL_PARTITION_BITS)) &
+           ((size_t(1) << SPILL_PARTITION_BITS) - 1);
+  }
+
+  /** @brief Append every row of tile to the file of its spill partition at
+   * the given level, creating the files on demand */
+  static void SpillTile(LogicalTile *tile,
+                        const std::vector<oid_t> &key_column_ids, size_t level,
+                        std::vector<std::unique_ptr<SpillFile>> &partitions);
+
+  /** @brief Bloom filter over the hashes of all build keys (see HashKey()),
+   * empty until the hash table is built */
+  inline const util::BloomFilter &GetBloomFilter() const {
+    return bloom_filter_;
+  }
+
  protected:
   bool DInit();
 
   bool DExecute();
 
  private:
-  /** @brief Hash table */
-  HashMapType hash_table_;
+  typedef HashTableType::Entry BuildRow;
+
+  void BuildHashTable();
+
+  void SpillChildTiles();
+
+  void PartitionBuildRows(std::vector<BuildRow> &rows,
+                          std::vector<size_t> &partition_offsets);
+
+  /** Partition of a hash: its first pass bits, then its second pass bits */
+  inline size_t GetPartition(uint64_t hash) const {
+    size_t first = hash & ((size_t(1) << first_pass_bits_) - 1);
+    size_t second =
+        (hash >> first_pass_bits_) & ((size_t(1) << second_pass_bits_) - 1);
+    return (first << second_pass_bits_) | second;
+  }
+
+  /** @brief Hash tables of the radix partitions */
+  std::vector<HashTableType> partition_tables_;
+
+  util::BloomFilter bloom_filter_;
+
+  size_t first_pass_bits_ = 0;
+  size_t second_pass_bits_ = 0;
+
+  size_t build_thread_count_ = 1;
+
+  size_t memory_budget_ = 0;
+
+  /** @brief Estimated size of the buffered child tiles in bytes */
+  size_t buffered_bytes_ = 0;
+
+  bool spilled_ = false;
+
+  std::vector<std::unique_ptr<SpillFile>> spill_partitions_;
+
+  std::unique_ptr<catalog::Schema> spill_schema_;
 
   /** @brief Input tiles from child node */
   std::vector<std::unique_ptr<LogicalTile>> child_tiles_;
 
+  /** @brief The child tiles, which are owned by the parent once returned */
+  std::vector<LogicalTile *> build_tiles_;
+
   std::vector<oid_t> column_ids_;
 
   bool done_ = false;
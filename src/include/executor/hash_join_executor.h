@@ -31,14 +31,83 @@ class HashJoinExecutor : public AbstractJoinExecutor {
   explicit HashJoinExecutor(const planner::AbstractPlan *node,
                             ExecutorContext *executor_context);
 
+  /** @brief Build the hash table and probe it with every left tile on the
+   * shared thread pool.
+   * A thread count of 0 picks one thread per hardware thread. */
+  void UseParallelJoin(size_t thread_count = 0);
+
+  /**
+   * @brief Join in partitions (grace hash join) once the estimated size of
+   * the right tiles exceeds memory_budget bytes.
+   *
+   * Both children are then spilled to partition files on their key hashes
+   * and every pair of partitions is joined on its own, with the right
+   * partition in memory and the left one read a tile at a time. A right
+   * partition that still exceeds the budget is partitioned again on other
+   * hash bits, up to HashExecutor::MAX_SPILL_LEVEL. A budget of 0 keeps all
+   * input in memory.
+   */
+  void UseGraceJoin(size_t memory_budget);
+
  protected:
   bool DInit();
 
   bool DExecute();
 
  private:
+  /** A right row that matched a left row of the probed tile */
+  struct ProbeMatch {
+    size_t right_tile;
+    oid_t right_row;
+    oid_t left_row;
+  };
+
+  /** Left rows probed by one worker at least */
+  static const size_t PROBE_CHUNK_ROWS = 256;
+
+  void ProbeLeftTile(LogicalTile *left_tile);
+
+  void PushProbeFilter();
+
+  //===--------------------------------------------------------------------===//
+  // Grace Hash Join
+  //===--------------------------------------------------------------------===//
+
+  /** A pair of spilled partitions, a file is nullptr if it is empty */
+  struct SpillPartition {
+    std::unique_ptr<SpillFile> right_file;
+    std::unique_ptr<SpillFile> left_file;
+    size_t level;
+  };
+
+  void SpillLeftChild();
+
+  bool ExecuteGraceJoin();
+
+  bool CanSkipSpillPartition(const SpillPartition &partition) const;
+
+  void RepartitionSpillPartition(SpillPartition &partition);
+
+  void LoadSpillPartition(SpillPartition &partition);
+
+  size_t memory_budget_ = 0;
+
+  bool grace_join_ = false;
+
+  /** @brief Spilled partitions left to join, the last one is next */
+  std::vector<SpillPartition> spill_partitions_;
+
+  bool partition_loaded_ = false;
+
+  /** @brief Left file of the loaded partition */
+  std::unique_ptr<SpillFile> left_spill_file_;
+
+  std::unique_ptr<catalog::Schema> left_spill_schema_;
+
   HashExecutor *hash_executor_ = nullptr;
 
+  size_t probe_thread_count_ = 1;
+
   bool hashed_ = false;
 
   std::deque<LogicalTile *> buffered_output_tiles;
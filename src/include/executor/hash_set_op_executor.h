@@ -13,12 +13,13 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <vector>
 
 #include "common/types.h"
 #include "executor/abstract_executor.h"
 #include "executor/logical_tile.h"
 #include "common/container_tuple.h"
+#include "util/flat_hash_table.h"
 
 namespace peloton {
 namespace executor {
@@ -31,13 +32,18 @@ namespace executor {
  * IMPORTANT: Children must have the same physical schema.
  * TODO: Postgres relaxes this to "compatible schema" (e.g., int -> double).
  *
- * Currently supported: INTERSECT/INTERSECT ALL/EXCEPT/EXCEPT ALL.
+ * Currently supported: INTERSECT/INTERSECT ALL/EXCEPT/EXCEPT ALL. Init()
+ * throws for UNION, which MergeSetOpExecutor supports.
  * We use a similar algorithm to Postgres but more optimized.
  * Since the result of all supported set-op must be a subset
  * of the left child,
  * we can simply massage the validation flags of the left child
  * and forward the (logical tiles) upwards.
  * This avoids materialization.
+ *
+ * The distinct rows of the left child are kept in flat tables keyed by a
+ * 64-bit fingerprint of the row, so the row values are only compared when
+ * two fingerprints are equal.
  */
 class HashSetOpExecutor : public AbstractExecutor {
  public:
@@ -49,32 +55,78 @@ class HashSetOpExecutor : public AbstractExecutor {
   explicit HashSetOpExecutor(const planner::AbstractPlan *node,
                              ExecutorContext *executor_context);
 
+  /** @brief Hash the left rows and build one table per hash partition on
+   * the shared thread pool.
+   * A thread count of 0 picks one thread per hardware thread. */
+  void UseParallelBuild(size_t thread_count = 0);
+
  protected:
   bool DInit();
   bool DExecute();
 
  private:
-  /** @brief Counter-pair type for binary set-op */
-  typedef struct {
+  /** @brief A distinct row of the left child with its counters */
+  struct SetOpGroup {
+    SetOpGroup(size_t tile_itr, oid_t row) : tile_itr(tile_itr), row(row) {}
+
+    /** Representative row: (index into left_tiles_, row id) */
+    size_t tile_itr;
+    oid_t row;
+
     size_t left = 0;
     size_t right = 0;
-  } counter_pair_t;
-
-  /** @brief Type definitions for hash table */
-  typedef std::unordered_map<
-      expression::ContainerTuple<LogicalTile>, counter_pair_t,
-      expression::ContainerTupleHasher<LogicalTile>,
-      expression::ContainerTupleComparator<LogicalTile>> HashSetOpMapType;
+  };
+
+  /** @brief The groups whose fingerprints fall into one partition, and a
+   * table of their indexes */
+  struct SetOpPartition {
+    util::FlatHashTable<uint32_t> table;
+    std::vector<SetOpGroup> groups;
+  };
+
+  /** @brief A left row scattered into the rows of its partition */
+  struct PartitionRow {
+    /** Index of the row in left_hashes_ and left_groups_ */
+    size_t row_itr;
+    size_t tile_itr;
+    oid_t tuple_id;
+  };
 
   /* Helper functions */
 
   bool ExecuteHelper();
 
+  void BuildPartitions();
+
+  void BuildPartition(size_t partition_itr, const PartitionRow *begin,
+                      const PartitionRow *end);
+
+  void CountRightTile(LogicalTile *tile);
+
   template <SetOpType SETOP>
-  bool CalculateCopies(HashSetOpMapType &htable);
+  bool CalculateCopies();
+
+  /** @brief Fingerprint of a row */
+  static uint64_t HashRow(const expression::ContainerTuple<LogicalTile> &row) {
+    return util::MixHash(row.HashCode());
+  }
+
+  /** @brief The slots of a table take the high bits of a fingerprint, its
+   * partition the low bits */
+  size_t GetPartition(uint64_t hash) const {
+    return static_cast<size_t>(hash & (partitions_.size() - 1));
+  }
+
+  /** @brief Hash partitions of the distinct left rows */
+  std::vector<SetOpPartition> partitions_;
+
+  /** @brief Fingerprint of every left row, in the order of left_tiles_ */
+  std::vector<uint64_t> left_hashes_;
+
+  /** @brief Group of every left row: (partition << 32 | group index) */
+  std::vector<uint64_t> left_groups_;
 
-  /** @brief Hash table */
-  HashSetOpMapType htable_;
+  size_t build_thread_count_ = 1;
 
   /** @brief The specified set-op type */
   SetOpType set_op_ = SETOP_TYPE_INVALID;
@@ -0,0 +1,112 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// index_nested_loop_join_executor.h
+//
+// Identification: src/include/executor/index_nested_loop_join_executor.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "executor/abstract_join_executor.h"
+
+namespace peloton {
+
+namespace index {
+class Index;
+}
+
+namespace planner {
+class IndexScanPlan;
+}
+
+namespace executor {
+
+/**
+ * @brief Nested loop join that probes an index of the inner table for the
+ * keys of the outer rows, instead of executing the right child again for
+ * every outer row.
+ *
+ * The right child has to be an index scan. It is never executed, the join
+ * only takes the index, the output columns, the key conditions and the
+ * predicate of its plan. Every key column of the index has to be among the
+ * right join columns of the NestedLoopJoinPlan (physical columns of the
+ * inner table), which are paired with the left join columns (columns of the
+ * left tiles), or be compared for equality by the index scan. Conditions of
+ * the index scan on the join columns are bound to the probe keys, like the
+ * nested loop join does, and all others are checked on every match.
+ *
+ * The rows of a left tile are probed as a batch: they are sorted on their
+ * join keys, so that the index is probed in key order and once per distinct
+ * key. The visible versions of the matches are wrapped in one right tile per
+ * tile group. Only inner and left joins are supported, since the inner rows
+ * without a match are never read.
+ */
+class IndexNestedLoopJoinExecutor : public AbstractJoinExecutor {
+  IndexNestedLoopJoinExecutor(const IndexNestedLoopJoinExecutor &) = delete;
+  IndexNestedLoopJoinExecutor &operator=(const IndexNestedLoopJoinExecutor &) =
+      delete;
+
+ public:
+  explicit IndexNestedLoopJoinExecutor(const planner::AbstractPlan *node,
+                                       ExecutorContext *executor_context);
+
+  /** @brief Whether a nested loop join plan can be executed by probing the
+   * index of its right child */
+  static bool CanProbeIndex(const planner::AbstractPlan *node);
+
+ protected:
+  bool DInit();
+
+  bool DExecute();
+
+ private:
+  /** A right row that matched a left row of the probed tile */
+  struct ProbeMatch {
+    size_t right_tile;
+    oid_t right_row;
+    oid_t left_row;
+  };
+
+  bool ProbeLeftTile(LogicalTile *left_tile);
+
+  int CompareLeftKeys(LogicalTile *left_tile, oid_t a, oid_t b) const;
+
+  bool GetVisibleVersion(ItemPointer &location) const;
+
+  size_t GetRightTile(oid_t tile_group_id);
+
+  std::shared_ptr<index::Index> index_;
+
+  const planner::IndexScanPlan *right_node_ = nullptr;
+
+  /** @brief Left join column of every key column of the index, or
+   * INVALID_OID if the key column is compared with key_values_ */
+  std::vector<oid_t> left_key_column_ids_;
+
+  std::vector<common::Value> key_values_;
+
+  /** @brief Conditions of the index scan that are not on join columns */
+  std::vector<oid_t> scan_key_column_ids_;
+
+  std::vector<ExpressionType> scan_expr_types_;
+
+  std::vector<common::Value> scan_values_;
+
+  /** @brief Right tile of every tile group with matches */
+  std::unordered_map<oid_t, size_t> right_tile_itrs_;
+
+  std::deque<LogicalTile *> buffered_output_tiles_;
+};
+
+}  // namespace executor
+}  // namespace peloton
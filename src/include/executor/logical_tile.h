@@ -90,6 +90,8 @@ class LogicalTile : public Printable {
 
   size_t GetColumnCount();
 
+  size_t GetEstimatedSize();
+
   const std::vector<ColumnInfo> &GetSchema() const;
 
   const ColumnInfo &GetColumnInfo(const oid_t column_id) const;
@@ -13,10 +13,14 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "executor/abstract_join_executor.h"
 #include "planner/merge_join_plan.h"
+#include "util/sort_key_normalizer.h"
 
 namespace peloton {
 namespace executor {
@@ -28,23 +32,163 @@ class MergeJoinExecutor : public AbstractJoinExecutor {
  public:
   explicit MergeJoinExecutor(const planner::AbstractPlan *node,
                              ExecutorContext *executor_context);
+
+  /** @brief Range-partition both sorted inputs and merge the partitions
+   * in parallel on the shared thread pool.
+   * A partition count of 0 picks one partition per hardware thread. */
+  void UseParallelMerge(size_t partition_count = 0);
+
  protected:
   bool DInit();
 
   bool DExecute();
 
- private:
-  size_t Advance(LogicalTile *tile, size_t start_row, bool is_left);
+  /** Position of a row in the buffered child tiles: (tile index, row id) */
+  typedef std::pair<size_t, oid_t> RowPosition;
+
+  void BufferChildTiles();
+
+  void MergeJoinRows();
+
+  bool ExecuteMergedOutput();
+
+  bool ExtractJoinKeys(LogicalTile *tile, bool is_left,
+                       std::vector<util::sort_key64_type> &keys);
 
   /** @brief a vector of join clauses
    * Get this from plan node during initialization */
   const std::vector<planner::MergeJoinPlan::JoinClause> *join_clauses_;
 
-  size_t left_start_row = 0;
-  size_t right_start_row = 0;
+  /** Normalizes fixed-width join keys into integers that are compared
+   * instead of the values, null if the keys are compared as values */
+  std::unique_ptr<util::SortKeyNormalizer> join_key_normalizer_;
+
+  bool use_parallel_merge_ = false;
+
+  size_t merge_partition_count_ = 0;
+
+  /** All rows of each child, in the (sorted) order they are merged in */
+  std::vector<RowPosition> left_rows_;
+  std::vector<RowPosition> right_rows_;
+
+  /** Normalized join keys of left_rows_ and right_rows_ */
+  std::vector<util::sort_key64_type> left_row_keys_;
+  std::vector<util::sort_key64_type> right_row_keys_;
+
+ private:
+  /** A cursor over the visible rows of the current tile of a sorted child.
+   * Only the current tile is kept, earlier tiles are released once the
+   * cursor moved past them (unless a group of equal keys still holds them). */
+  struct MergeCursor {
+    std::shared_ptr<LogicalTile> tile;
+    std::vector<oid_t> rows;
+
+    /** Normalized join keys of rows */
+    std::vector<util::sort_key64_type> keys;
+
+    /** Index of the current row in rows */
+    size_t row_itr = 0;
+
+    bool child_done = false;
+  };
+
+  /** Rows with equal join keys of one child, which may span several tiles */
+  struct JoinKeyGroup {
+    std::vector<std::shared_ptr<LogicalTile>> tiles;
+
+    /** (index into tiles, row id) */
+    std::vector<std::pair<size_t, oid_t>> rows;
+  };
+
+  /** A pair of key ranges of the two inputs that is merged by one worker */
+  struct MergePartition {
+    size_t left_begin = 0;
+    size_t left_end = 0;
+    size_t right_begin = 0;
+    size_t right_end = 0;
+
+    /** Join output of this partition, in key order */
+    std::vector<std::unique_ptr<LogicalTile>> output_tiles;
+
+    /** Rows that found a match, only kept for outer joins */
+    std::vector<RowPosition> matched_left_rows;
+    std::vector<RowPosition> matched_right_rows;
+  };
+
+  void MergeNextRows();
+
+  bool CursorHasRow(MergeCursor &cursor, bool is_left);
+
+  int CompareCursorKeys();
+
+  size_t FindLesserRowsEnd(bool is_left);
+
+  void SkipCursorRows(MergeCursor &cursor, bool is_left, size_t end,
+                      bool emit_unmatched);
+
+  void ReadKeyGroup(MergeCursor &cursor, bool is_left, JoinKeyGroup &group);
+
+  void AddStreamOutputRow(const std::shared_ptr<LogicalTile> &left_tile,
+                          oid_t left_row,
+                          const std::shared_ptr<LogicalTile> &right_tile,
+                          oid_t right_row);
+
+  void AddUnmatchedRow(bool is_left, const std::shared_ptr<LogicalTile> &tile,
+                       oid_t row);
+
+  void FlushStreamOutputTile();
+
+  void FinishStreamOutput();
+
+  bool DExecuteParallel();
+
+  void BuildMergePartitions();
+
+  void MergePartitionRows(MergePartition &partition);
+
+  void BuildJoinRows(bool is_left);
+
+  void InitJoinKeyNormalizer();
+
+  int CompareTileJoinKeys(LogicalTile *left_tile, oid_t left_row,
+                          LogicalTile *right_tile, oid_t right_row);
+
+  int CompareJoinKeys(size_t left_itr, size_t right_itr);
+
+  bool HasSameJoinKey(LogicalTile *tile, oid_t row, LogicalTile *other_tile,
+                      oid_t other_row, bool is_left);
+
+  size_t FindJoinKeyGroupEnd(size_t row_itr, size_t end, bool is_left);
+
+  //===--------------------------------------------------------------------===//
+  // Streaming merge state
+  //===--------------------------------------------------------------------===//
+
+  MergeCursor left_cursor_;
+  MergeCursor right_cursor_;
+
+  bool stream_started_ = false;
+  bool stream_done_ = false;
+
+  /** Output tile being built, for one pair of child tiles */
+  std::unique_ptr<LogicalTile::PositionListsBuilder> stream_pos_lists_builder_;
+  std::shared_ptr<LogicalTile> stream_left_tile_;
+  std::shared_ptr<LogicalTile> stream_right_tile_;
+
+  /** Output tiles that are ready to be returned to the parent */
+  std::deque<std::unique_ptr<LogicalTile>> stream_output_tiles_;
+
+  //===--------------------------------------------------------------------===//
+  // Parallel merge state
+  //===--------------------------------------------------------------------===//
+
+  bool parallel_merge_done_ = false;
+
+  std::vector<MergePartition> merge_partitions_;
 
-  size_t left_end_row = 0;
-  size_t right_end_row = 0;
+  /** Next output tile to return to the parent */
+  size_t output_partition_itr_ = 0;
+  size_t output_tile_itr_ = 0;
 };
 
 }  // namespace executor
@@ -0,0 +1,119 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// merge_set_op_executor.h
+//
+// Identification: src/include/executor/merge_set_op_executor.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "common/types.h"
+#include "common/value.h"
+#include "executor/abstract_executor.h"
+#include "executor/logical_tile.h"
+
+namespace peloton {
+
+namespace planner {
+class OrderByPlan;
+}
+
+namespace executor {
+
+class OrderByExecutor;
+
+/**
+ * @brief Set operation executor over sorted inputs.
+ *
+ * Both children return their rows sorted on all columns in ascending order
+ * (nulls first, like OrderByExecutor sorts them). The executor co-iterates
+ * the two streams one group of equal rows at a time, so it only keeps the
+ * current tile of each child, and the output is sorted as well.
+ *
+ * IMPORTANT: Children must have the same physical schema.
+ *
+ * Currently supported: INTERSECT/INTERSECT ALL/EXCEPT/EXCEPT ALL/UNION/
+ * UNION ALL. The output tiles select rows of the child tiles, so nothing
+ * is materialized.
+ */
+class MergeSetOpExecutor : public AbstractExecutor {
+ public:
+  MergeSetOpExecutor(const MergeSetOpExecutor &) = delete;
+  MergeSetOpExecutor &operator=(const MergeSetOpExecutor &) = delete;
+  MergeSetOpExecutor(const MergeSetOpExecutor &&) = delete;
+  MergeSetOpExecutor &operator=(const MergeSetOpExecutor &&) = delete;
+
+  explicit MergeSetOpExecutor(const planner::AbstractPlan *node,
+                              ExecutorContext *executor_context);
+
+  ~MergeSetOpExecutor();
+
+  /** @brief The children are not sorted yet: sort each of them on its
+   * column_count columns with an OrderByExecutor between the child and this
+   * executor. Call this after both children are added. */
+  void UseInputSort(oid_t column_count);
+
+ protected:
+  bool DInit();
+  bool DExecute();
+
+ private:
+  /** @brief A cursor over the visible rows of the current tile of a child */
+  struct SetOpCursor {
+    std::unique_ptr<LogicalTile> tile;
+    std::vector<oid_t> rows;
+
+    /** Index of the current row in rows */
+    size_t row_itr = 0;
+
+    bool child_done = false;
+  };
+
+  void MergeNextGroup();
+
+  bool CursorHasRow(SetOpCursor &cursor, size_t child_itr);
+
+  int CompareRow(SetOpCursor &cursor, const std::vector<common::Value> &key);
+
+  int CompareCursorRows();
+
+  template <typename Emit>
+  size_t ScanGroup(SetOpCursor &cursor, size_t child_itr,
+                   const std::vector<common::Value> &key, Emit emit);
+
+  void AddOutputRow(LogicalTile *tile, oid_t row);
+
+  void FlushOutputTile();
+
+  /** @brief The specified set-op type */
+  SetOpType set_op_ = SETOP_TYPE_INVALID;
+
+  SetOpCursor left_cursor_;
+  SetOpCursor right_cursor_;
+
+  bool merge_done_ = false;
+
+  /** @brief Selected rows of output_source_ that are not in an output tile
+   * yet, in sort order */
+  LogicalTile *output_source_ = nullptr;
+  std::vector<oid_t> output_rows_;
+
+  /** @brief Output tiles that are ready to be returned to the parent */
+  std::deque<std::unique_ptr<LogicalTile>> output_tiles_;
+
+  /** @brief Sort plan and executors of the children, see UseInputSort() */
+  std::unique_ptr<planner::OrderByPlan> sort_plan_;
+  std::vector<std::unique_ptr<OrderByExecutor>> sort_executors_;
+};
+
+}  // namespace executor
+}  // namespace peloton
@@ -13,10 +13,14 @@
 
 #pragma once
 
+#include <cstdio>
+
 #include "common/types.h"
 #include "common/varlen_pool.h"
 #include "executor/abstract_executor.h"
 #include "storage/tuple.h"
+#include "util/simd_merge_sort.h"
+#include "util/sort_key_normalizer.h"
 
 namespace peloton {
 namespace executor {
@@ -41,8 +45,30 @@ class OrderByExecutor : public AbstractExecutor {
 
   ~OrderByExecutor();
 
+  /** @brief Sort with the widest SIMD kernel of this host (AVX2 or AVX-512,
+   * see util::GetSimdSortKernel()). */
   void UseAVX2Sort() {use_simd_sort_ = true;}
 
+  /** @brief Whether the sort uses the SIMD kernel. Like the other sort
+   * options, it is kept across Init(). */
+  bool UsesAVX2Sort() const { return use_simd_sort_; }
+
+  /** @brief Sort per-thread chunks of the sort buffer in parallel and combine
+   * them with a parallel multiway merge.
+   * A partition count of 0 picks one partition per hardware thread. */
+  void UseParallelSort(size_t partition_count = 0);
+
+  /** @brief Bound the memory of buffered input tuples: whenever their
+   * estimated size exceeds memory_budget bytes, they are sorted and spilled
+   * to a run in a temp file, and the runs are merged while returning tiles.
+   * A budget of 0 keeps all input in memory. */
+  void UseExternalSort(size_t memory_budget);
+
+  /** @brief Three-way comparison of two values in ascending sort order, where
+   * null is smaller than every other value and equal to null. Inputs sorted
+   * by this executor are in this order. */
+  static int CompareSortValues(const common::Value &a, const common::Value &b);
+
  protected:
   bool DInit();
 
@@ -51,6 +77,24 @@ class OrderByExecutor : public AbstractExecutor {
  private:
   bool DoSort();
 
+  void SortInputTiles();
+
+  size_t GetSortedTupleCount() const;
+
+  void GetSortedTuple(size_t position, oid_t &tile_id, oid_t &tuple_id) const;
+
+  void SpillSortedRun();
+
+  void InitRunMerge();
+
+  bool ExecuteRunMerge();
+
+  bool RunTupleLess(size_t a, size_t b) const;
+
+  void AddTopTupleCandidates(size_t limit);
+
+  bool ExecuteTopTuples();
+
   bool sort_done_ = false;
 
   /**
@@ -79,30 +123,49 @@ class OrderByExecutor : public AbstractExecutor {
     sort_buffer_entry_t &operator=(const sort_buffer_entry_t &) = delete;
   };
 
-  struct simd_sort_entry_t {
-    unsigned int ele;
+  /** Payload of a SIMD sort key: the tile id and the tuple id of the key */
+  static util::sort_payload_type EncodeSortPayload(oid_t tile_id,
+                                                   oid_t tuple_id) {
+    return (static_cast<util::sort_payload_type>(tile_id) << 32) | tuple_id;
+  }
 
-    simd_sort_entry_t(int32_t key, oid_t tile_group_id, oid_t tuple_id) {
-      serialize(key, tile_group_id, tuple_id);
-    }
+  static void DecodeSortPayload(util::sort_payload_type payload,
+                                oid_t &tile_id, oid_t &tuple_id) {
+    tile_id = static_cast<oid_t>(payload >> 32);
+    tuple_id = static_cast<oid_t>(payload);
+  }
 
-    void serialize(int32_t key, oid_t tile_group_id, oid_t tuple_id) {
-      ele = (key << ORDER_BY_SHIFT_OFFSET) +
-                   static_cast<unsigned int>(
-                       tile_group_id*DEFAULT_TUPLES_PER_TILEGROUP+tuple_id);
-    }
+  void SortKeyTies(const util::SortKeyNormalizer &normalizer,
+                   const std::vector<oid_t> &sort_keys);
 
-    void serialize_pad() {
-      ele = ~(1 & 0);
-    }
+  void ParallelSortSIMDBuffer();
+
+  /** A sorted run spilled to a temp file, and its current tuple */
+  struct SortedRun {
+    FILE *file = nullptr;
+    std::vector<common::Value> tuple;
+    std::vector<char> tuple_buffer;
+
+    ~SortedRun();
+
+    bool ReadTuple(const catalog::Schema &schema);
+  };
 
-    void deserialize(oid_t& tile_group_id, oid_t& tuple_id) {
-      auto mask = (1 << ORDER_BY_SHIFT_OFFSET) - 1;
-      tuple_id = (ele & mask) % DEFAULT_TUPLES_PER_TILEGROUP;
-      tile_group_id = (ele & mask)/DEFAULT_TUPLES_PER_TILEGROUP;
+  /** Orders the merge heap of runs by their current tuples, smallest on top */
+  struct RunHeapGreater {
+    const OrderByExecutor *executor;
+    bool operator()(size_t a, size_t b) const {
+      return executor->RunTupleLess(b, a);
     }
   };
 
+  /** Orders the tuples of the top tuples heap in sort order */
+  struct TopTupleLess {
+    const OrderByExecutor *executor;
+    bool operator()(const std::vector<common::Value> &a,
+                    const std::vector<common::Value> &b) const;
+  };
+
   /** All tiles returned by child. */
   std::vector<std::unique_ptr<LogicalTile>> input_tiles_;
 
@@ -112,14 +175,18 @@ class OrderByExecutor : public AbstractExecutor {
   /** All valid tuples in sorted order */
   std::vector<sort_buffer_entry_t> sort_buffer_;
 
-  /** All valid tuples in sorted order
-   * Note: Used when the sorting column is an integer
-   * Can only sort tables that have oids <= 2^32
+  /** Normalized sort keys of all valid tuples and their payloads in sorted
+   * order
+   * Note: Used when all the sorting columns are integers or timestamps
    */
-  simd_sort_entry_t *simd_sort_buffer_;
+  std::vector<util::sort_key64_type> simd_sort_keys_;
+  std::vector<util::sort_payload_type> simd_sort_payloads_;
 
   bool use_simd_sort_ = false;
 
+  /** Number of chunks sorted in parallel (0 or 1: single-threaded sort) */
+  size_t sort_partition_count_ = 0;
+
   bool int_sort_ = false;
 
   size_t simd_sort_buffer_size_;
@@ -132,6 +199,27 @@ class OrderByExecutor : public AbstractExecutor {
 
   std::vector<bool> descend_flags_;
 
+  /** Columns of the sort keys in the input schema */
+  std::vector<oid_t> sort_keys_;
+
+  /** Memory budget of buffered input tuples in bytes (0: unlimited) */
+  size_t sort_memory_budget_ = 0;
+
+  /** Estimated size of the buffered input tuples */
+  size_t buffered_bytes_ = 0;
+
+  /** Sorted runs spilled under the memory budget */
+  std::vector<std::unique_ptr<SortedRun>> sorted_runs_;
+
+  /** Heap of the runs that still have tuples to merge */
+  std::vector<size_t> run_heap_;
+
+  size_t spilled_tuple_count_ = 0;
+
+  /** With a limit on the plan, the best tuples seen so far in a max-heap
+   * (worst candidate on top), and in sort order after the input is drained */
+  std::vector<std::vector<common::Value>> top_tuples_;
+
   /** How many tuples have been returned to parent */
   size_t num_tuples_returned_ = 0;
 };
@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// parallelism_configurator.h
+//
+// Identification: src/include/executor/parallelism_configurator.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "common/types.h"
+
+namespace peloton {
+namespace executor {
+
+class AbstractExecutor;
+
+/**
+ * @brief A chain of executors that tiles flow through one at a time, from a
+ * source executor up to the sink that consumes the output of the chain.
+ */
+struct Pipeline {
+  /** @brief The executors of the pipeline, the source first */
+  std::vector<AbstractExecutor *> executors;
+
+  /** @brief Executor that consumes the output, null for the pipeline of
+   * the root */
+  AbstractExecutor *sink = nullptr;
+
+  /** @brief Whether the sink buffers the whole output before it returns
+   * anything (hash build, aggregation, sort) */
+  bool sink_is_breaker = false;
+};
+
+/**
+ * @brief Splits an executor tree into pipelines at its pipeline breakers and
+ * sets the parallel options of the executors of every pipeline. It does not
+ * run anything: the tree still runs through Execute() as before, and each
+ * executor uses the worker threads within its own Init() or Execute().
+ *
+ * A table scan that is the source of a pipeline scans its tile groups on
+ * the workers (see SeqScanExecutor::UseParallelScan()). The scan keeps the
+ * order of the tile groups unless the pipeline ends in a breaker that does
+ * not depend on the order of its input. Hash builds and probes, merges,
+ * aggregations and sorts use the worker threads for their own work.
+ *
+ * The executors must not be initialized yet.
+ */
+class ParallelismConfigurator {
+ public:
+  ParallelismConfigurator(const ParallelismConfigurator &) = delete;
+  ParallelismConfigurator &operator=(const ParallelismConfigurator &) = delete;
+
+  /** @brief A thread count of 0 picks one thread per hardware thread. */
+  explicit ParallelismConfigurator(size_t thread_count = 0);
+
+  /**
+   * @brief Split the executor tree into pipelines.
+   * @return the pipelines in the order they complete, i.e., every pipeline
+   * after the pipelines that feed its executors
+   */
+  static std::vector<Pipeline> SplitPipelines(AbstractExecutor *root);
+
+  /** @brief Set the parallel options of the executors of every pipeline of
+   * the tree. */
+  void Configure(AbstractExecutor *root);
+
+  size_t GetThreadCount() const { return thread_count_; }
+
+ private:
+  static bool IsPipelineBreaker(const AbstractExecutor *executor);
+
+  static bool NeedsOrderedInput(const Pipeline &pipeline);
+
+  static std::vector<AbstractExecutor *> CollectPipelines(
+      AbstractExecutor *executor, std::vector<Pipeline> &pipelines);
+
+  void ConfigureExecutor(AbstractExecutor *executor);
+
+  size_t thread_count_;
+};
+
+}  // namespace executor
+}  // namespace peloton
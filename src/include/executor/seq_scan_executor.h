@@ -12,8 +12,16 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "planner/seq_scan_plan.h"
 #include "executor/abstract_scan_executor.h"
+#include "executor/compiled_predicate.h"
+#include "executor/vectorized_predicate.h"
 
 namespace peloton {
 namespace executor {
@@ -28,7 +36,36 @@ class SeqScanExecutor : public AbstractScanExecutor {
   explicit SeqScanExecutor(const planner::AbstractPlan *node,
                            ExecutorContext *executor_context);
 
-  void ResetState() { current_tile_group_offset_ = START_OID; }
+  ~SeqScanExecutor();
+
+  void ResetState() {
+    StopParallelScan();
+    current_tile_group_offset_ = START_OID;
+  }
+
+  /**
+   * @brief Scan the tile groups of the table on the shared thread pool.
+   * The workers take the next tile group from a cursor, apply the predicate
+   * to it and push the result into a bounded exchange queue of two tile
+   * groups per thread, while Execute() pops from it. A worker never blocks
+   * its pool thread: it returns when the queue is full, and Execute()
+   * submits it again once it popped a tile group. Execute() scans a tile
+   * group itself when no worker has taken it yet, so the scan also finishes
+   * when the pool is busy.
+   *
+   * The workers only apply the predicate if the vectorized predicate or the
+   * compiled scan loops can evaluate it, which read nothing but the tile
+   * group and the parameters. The visibility checks, the probe filter and
+   * evaluating the predicate tuple at a time use the transaction and the
+   * executor context, so Execute() does them on its own thread, and reads
+   * the selected tuples for the transaction.
+   *
+   * With preserve_order the tiles are returned in tile group order like a
+   * serial scan returns them, e.g., for a merge join. Otherwise they are
+   * returned in the order the workers finish them.
+   * A thread count of 0 picks one thread per hardware thread.
+   */
+  void UseParallelScan(size_t thread_count = 0, bool preserve_order = false);
 
  protected:
   bool DInit();
@@ -36,6 +73,71 @@ class SeqScanExecutor : public AbstractScanExecutor {
   bool DExecute();
 
  private:
+  /** @brief The tuples of a tile group that passed the predicate */
+  struct ScannedTileGroup {
+    oid_t offset;
+    std::shared_ptr<storage::TileGroup> tile_group;
+    std::vector<oid_t> position_list;
+    /** False if a worker could not apply the predicate to position_list */
+    bool predicate_applied = true;
+  };
+
+  /**
+   * @brief Bounded queue between the workers of a parallel scan and
+   * Execute(). The worker tasks share it, so that a task that only starts
+   * after the scan was stopped returns without touching the executor.
+   */
+  struct ScanExchange {
+    std::mutex mutex;
+    std::condition_variable not_empty;
+    std::deque<ScannedTileGroup> tile_groups;
+
+    /** Offset of the next tile group to scan */
+    oid_t cursor = START_OID;
+    /** Number of tile groups Execute() took from the queue */
+    oid_t taken_count = 0;
+    size_t capacity = 0;
+    /** Number of worker tasks to keep submitted */
+    size_t worker_count = 0;
+    /** Worker tasks submitted that have not returned, queued or running */
+    size_t submitted_workers = 0;
+    size_t running_workers = 0;
+    bool stopped = false;
+  };
+
+  void ScanTileGroup(storage::TileGroup *tile_group,
+                     VectorizedPredicate *vectorized_predicate,
+                     std::vector<oid_t> &position_list);
+
+  bool FilterTileGroup(storage::TileGroup *tile_group,
+                       VectorizedPredicate *vectorized_predicate,
+                       const std::vector<oid_t> &candidates,
+                       std::vector<oid_t> &position_list);
+
+  bool FilterInBatch(storage::TileGroup *tile_group,
+                     VectorizedPredicate *vectorized_predicate,
+                     const std::vector<oid_t> &candidates,
+                     std::vector<oid_t> &position_list) const;
+
+  void StartParallelScan();
+
+  void StopParallelScan();
+
+  void SubmitScanWorkers();
+
+  void RunScanWorker(ScanExchange &exchange);
+
+  bool CanTakeMorsel(const ScanExchange &exchange) const;
+
+  void ScanMorsel(oid_t offset, VectorizedPredicate *vectorized_predicate,
+                  ScannedTileGroup &scanned) const;
+
+  bool TakeScannedTileGroup(ScannedTileGroup &scanned);
+
+  void SelectVisibleTuples(ScannedTileGroup &scanned);
+
+  bool ReadTuples(ScannedTileGroup &scanned);
+
   //===--------------------------------------------------------------------===//
   // Executor State
   //===--------------------------------------------------------------------===//
@@ -46,12 +148,31 @@ class SeqScanExecutor : public AbstractScanExecutor {
   /** @brief Keeps track of the number of tile groups to scan. */
   oid_t table_tile_group_count_ = INVALID_OID;
 
+  //===--------------------------------------------------------------------===//
+  // Parallel Scan
+  //===--------------------------------------------------------------------===//
+
+  size_t scan_thread_count_ = 1;
+
+  bool preserve_order_ = false;
+
+  /** @brief Exchange of the running parallel scan, null before it starts */
+  std::shared_ptr<ScanExchange> exchange_;
+
   //===--------------------------------------------------------------------===//
   // Plan Info
   //===--------------------------------------------------------------------===//
 
   /** @brief Pointer to table to scan from. */
   storage::DataTable *target_table_ = nullptr;
+
+  /** @brief predicate_ compiled into scan loops, owned by the plan node. Null
+   * if it can not be compiled. */
+  const CompiledPredicate *compiled_predicate_ = nullptr;
+
+  /** @brief Evaluates predicate_ a tile group at a time, null if the
+   * predicate is evaluated tuple at a time. */
+  std::unique_ptr<VectorizedPredicate> vectorized_predicate_;
 };
 
 }  // namespace executor
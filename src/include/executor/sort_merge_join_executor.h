@@ -0,0 +1,66 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// sort_merge_join_executor.h
+//
+// Identification: src/include/executor/sort_merge_join_executor.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+
+#pragma once
+
+#include <vector>
+
+#include "executor/merge_join_executor.h"
+#include "util/simd_merge_sort.h"
+
+namespace peloton {
+namespace executor {
+
+/**
+ * @brief Merge join over unsorted children, which sorts its inputs itself.
+ *
+ * Instead of sorting each child with an OrderByExecutor, which materializes
+ * the sorted tuples, only (join key, row position) pairs of the buffered
+ * child tiles are sorted, and the merge runs directly on the sorted key
+ * arrays. The output position lists refer to the child tiles.
+ *
+ * @warning This is a pipeline breaker, both children are buffered.
+ */
+class SortMergeJoinExecutor : public MergeJoinExecutor {
+  SortMergeJoinExecutor(const SortMergeJoinExecutor &) = delete;
+  SortMergeJoinExecutor &operator=(const SortMergeJoinExecutor &) = delete;
+
+ public:
+  explicit SortMergeJoinExecutor(const planner::AbstractPlan *node,
+                                 ExecutorContext *executor_context);
+
+ protected:
+  bool DInit();
+
+  bool DExecute();
+
+ private:
+  void SortJoinRows(bool is_left);
+
+  bool SortNormalizedJoinRows(bool is_left);
+
+  int CompareChildJoinKeys(const RowPosition &a, const RowPosition &b,
+                           bool is_left);
+
+  bool HasNullJoinKey(LogicalTile *tile, oid_t row, bool is_left);
+
+  static util::sort_payload_type EncodeRowPayload(size_t tile_itr,
+                                                  oid_t row) {
+    return (static_cast<util::sort_payload_type>(tile_itr) << 32) | row;
+  }
+
+  bool sort_done_ = false;
+};
+
+}  // namespace executor
+}  // namespace peloton
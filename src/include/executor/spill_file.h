@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// spill_file.h
+//
+// Identification: src/include/executor/spill_file.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/serializeio.h"
+#include "common/types.h"
+
+namespace peloton {
+namespace executor {
+
+class LogicalTile;
+
+/**
+ * @brief Temp file of tuples spilled by an executor that runs out of its
+ * memory budget.
+ *
+ * Tuples are appended with WriteTuple(), then read back in tiles after
+ * Rewind(). Every tuple is stored as its serialized size followed by its
+ * serialized values. The file is deleted when it is closed.
+ */
+class SpillFile {
+  SpillFile(const SpillFile &) = delete;
+  SpillFile &operator=(const SpillFile &) = delete;
+
+ public:
+  SpillFile();
+
+  ~SpillFile();
+
+  /** @brief Append all columns of a row of a logical tile */
+  void WriteTuple(LogicalTile *tile, oid_t tuple_id);
+
+  /** @brief Read the file from its start */
+  void Rewind();
+
+  /**
+   * @brief Read the next tuples into a new tile of the given schema, which
+   * must be the schema of the spilled tiles.
+   * @return the tile of at most max_tuple_count tuples, or nullptr at the
+   * end of the file
+   */
+  LogicalTile *ReadTile(const catalog::Schema &schema, size_t max_tuple_count);
+
+  /** @brief Number of tuples written to the file */
+  size_t GetTupleCount() const { return tuple_count_; }
+
+  /** @brief Serialized size of the tuples written to the file, varlen data
+   * included */
+  size_t GetByteCount() const { return byte_count_; }
+
+ private:
+  FILE *file_ = nullptr;
+
+  size_t tuple_count_ = 0;
+
+  size_t byte_count_ = 0;
+
+  CopySerializeOutput output_;
+
+  std::vector<char> tuple_buffer_;
+};
+
+}  // namespace executor
+}  // namespace peloton
@@ -0,0 +1,125 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// vectorized_predicate.h
+//
+// Identification: src/include/executor/vectorized_predicate.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "common/types.h"
+#include "common/value.h"
+
+namespace peloton {
+
+namespace catalog {
+class Schema;
+}
+
+namespace expression {
+class AbstractExpression;
+}
+
+namespace storage {
+class TileGroup;
+}
+
+namespace executor {
+
+class ExecutorContext;
+
+/**
+ * @brief Evaluates a scan predicate over a batch of tuples of a tile group at
+ * a time, instead of calling Evaluate() on every tuple.
+ *
+ * The batch is a selection vector, the sorted ids of the tuples that are
+ * still candidates. A comparison loads the columns it refers to for all the
+ * candidates, compares them with AVX2 kernels four values at a time, and
+ * keeps the candidates that pass. AND filters the survivors of its left side
+ * with its right side, OR unions the survivors of both sides. Arithmetic is
+ * computed a column at a time as well.
+ *
+ * Supported: AND/OR of comparisons (=, <>, <, <=, >, >=) between columns,
+ * constants, parameters and +, -, *, / of them, where the columns are of
+ * fixed-width numeric or timestamp types.
+ *
+ * A batch whose values leave the fast path (overflow, division by zero, or
+ * operands of mixed types) is rejected, and the caller evaluates it tuple at
+ * a time, which gives the exact result or error of the interpreter.
+ */
+class VectorizedPredicate {
+ public:
+  VectorizedPredicate(const VectorizedPredicate &) = delete;
+  VectorizedPredicate &operator=(const VectorizedPredicate &) = delete;
+
+  VectorizedPredicate(const expression::AbstractExpression *predicate,
+                      ExecutorContext *executor_context);
+
+  /** @brief Whether the predicate over tuples of the given schema can be
+   * evaluated in batches. */
+  static bool IsSupported(const expression::AbstractExpression *predicate,
+                          const catalog::Schema *schema);
+
+  /**
+   * @brief Select the tuples of the tile group for which the predicate is
+   * true. selection must be sorted.
+   * @return false if the batch has to be evaluated tuple at a time instead
+   */
+  bool Filter(storage::TileGroup *tile_group,
+              const std::vector<oid_t> &selection, std::vector<oid_t> &result);
+
+ private:
+  /** @brief The values of an expression for the tuples of a selection, or
+   * a single value if it does not depend on the tuple. Integer and timestamp
+   * values are widened to int64_t and decimals are doubles; null is
+   * INT64_MIN or PELOTON_DECIMAL_NULL. */
+  struct VectorOperand {
+    common::Type::TypeId type = common::Type::INVALID;
+
+    bool is_scalar = false;
+    int64_t int_scalar = 0;
+    double double_scalar = 0;
+
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+
+    bool IsDecimal() const { return type == common::Type::DECIMAL; }
+
+    void ConvertToDecimal();
+  };
+
+  bool FilterExpression(const expression::AbstractExpression *expr,
+                        std::vector<oid_t> &selection);
+
+  bool ComputeExpression(const expression::AbstractExpression *expr,
+                         const std::vector<oid_t> &selection,
+                         VectorOperand &result);
+
+  bool LoadColumn(oid_t column_id, const std::vector<oid_t> &selection,
+                  VectorOperand &result);
+
+  bool LoadValue(const common::Value &value, VectorOperand &result);
+
+  bool Compare(ExpressionType compare_type, VectorOperand &left,
+               VectorOperand &right, std::vector<oid_t> &selection);
+
+  bool Compute(ExpressionType operator_type, VectorOperand &left,
+               VectorOperand &right, size_t count, VectorOperand &result);
+
+  const expression::AbstractExpression *predicate_;
+
+  ExecutorContext *executor_context_;
+
+  /** @brief The tile group being filtered */
+  storage::TileGroup *tile_group_ = nullptr;
+};
+
+}  // namespace executor
+}  // namespace peloton
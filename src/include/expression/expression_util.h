@@ -158,6 +158,22 @@ class ExpressionUtil {
     return left;
   }
 
+  /** @brief The comparison with swapped operands, a < b is b > a */
+  inline static ExpressionType SwapComparison(ExpressionType type) {
+    switch (type) {
+      case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+        return EXPRESSION_TYPE_COMPARE_GREATERTHAN;
+      case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+        return EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO;
+      case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+        return EXPRESSION_TYPE_COMPARE_LESSTHAN;
+      case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+        return EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO;
+      default:
+        return type;
+    }
+  }
+
   inline static bool IsAggregateExpression(ExpressionType type) {
     switch (type) {
       case EXPRESSION_TYPE_AGGREGATE_COUNT:
@@ -87,6 +87,10 @@ class SimpleOptimizer : public AbstractOptimizer {
       storage::DataTable *target_table, std::vector<oid_t> &column_ids,
       expression::AbstractExpression *predicate, bool for_update);
 
+  // estimate the number of groups of an aggregation over a table
+  static size_t EstimateGroupCount(storage::DataTable *target_table,
+                                   const std::vector<oid_t> &group_by_columns);
+
   // create a copy plan for a copy statement
   static std::unique_ptr<planner::AbstractPlan> CreateCopyPlan(
       parser::CopyStatement *copy_stmt);
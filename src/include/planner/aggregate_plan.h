@@ -82,6 +82,14 @@ class AggregatePlan : public AbstractPlan {
 
   PelotonAggType GetAggregateStrategy() const { return agg_strategy_; }
 
+  /** @brief Expected number of groups, e.g., from the distinct counts of
+   * the group-by columns. 0 if unknown. */
+  void SetEstimatedGroupCount(size_t group_count) {
+    estimated_group_count_ = group_count;
+  }
+
+  size_t GetEstimatedGroupCount() const { return estimated_group_count_; }
+
   inline PlanNodeType GetPlanNodeType() const {
     return PlanNodeType::PLAN_NODE_TYPE_AGGREGATE_V2;
   }
@@ -115,6 +123,7 @@ class AggregatePlan : public AbstractPlan {
         std::move(project_info_->Copy()), std::move(predicate_copy),
         std::move(copied_agg_terms), std::move(copied_groupby_col_ids),
         output_schema_copy, agg_strategy_);
+    new_plan->SetEstimatedGroupCount(estimated_group_count_);
     return std::unique_ptr<AbstractPlan>(new_plan);
   }
 
@@ -139,6 +148,9 @@ class AggregatePlan : public AbstractPlan {
 
   /** @brief Columns involved */
   std::vector<oid_t> column_ids_;
+
+  /** @brief Expected number of groups, 0 if unknown */
+  size_t estimated_group_count_ = 0;
 };
 }
 }
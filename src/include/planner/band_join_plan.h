@@ -0,0 +1,113 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// band_join_plan.h
+//
+// Identification: src/include/planner/band_join_plan.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "abstract_join_plan.h"
+#include "common/types.h"
+#include "expression/abstract_expression.h"
+#include "planner/project_info.h"
+
+namespace peloton {
+namespace planner {
+
+/**
+ * @brief Join on a range predicate of the form
+ *   lower(right) < (or <=) key(left) < (or <=) upper(right),
+ * e.g., left.ts BETWEEN right.start AND right.end. One of the two bounds may
+ * be missing, which makes it a plain inequality join (left.x > right.y).
+ */
+class BandJoinPlan : public AbstractJoinPlan {
+ public:
+  struct BandClause {
+    BandClause(const expression::AbstractExpression *left,
+               const expression::AbstractExpression *lower,
+               bool lower_inclusive,
+               const expression::AbstractExpression *upper,
+               bool upper_inclusive)
+        : left_(left),
+          lower_(lower),
+          upper_(upper),
+          lower_inclusive_(lower_inclusive),
+          upper_inclusive_(upper_inclusive) {}
+
+    BandClause(const BandClause &other) = delete;
+
+    BandClause(BandClause &&other)
+        : left_(std::move(other.left_)),
+          lower_(std::move(other.lower_)),
+          upper_(std::move(other.upper_)),
+          lower_inclusive_(other.lower_inclusive_),
+          upper_inclusive_(other.upper_inclusive_) {}
+
+    /** Key of the left tuple */
+    std::unique_ptr<const expression::AbstractExpression> left_;
+
+    /** Bounds computed from the right tuple, null if unbounded */
+    std::unique_ptr<const expression::AbstractExpression> lower_;
+    std::unique_ptr<const expression::AbstractExpression> upper_;
+
+    bool lower_inclusive_;
+    bool upper_inclusive_;
+  };
+
+  BandJoinPlan(const BandJoinPlan &) = delete;
+  BandJoinPlan &operator=(const BandJoinPlan &) = delete;
+  BandJoinPlan(BandJoinPlan &&) = delete;
+  BandJoinPlan &operator=(BandJoinPlan &&) = delete;
+
+  BandJoinPlan(
+      PelotonJoinType join_type,
+      std::unique_ptr<const expression::AbstractExpression> &&predicate,
+      std::unique_ptr<const ProjectInfo> &&proj_info,
+      std::shared_ptr<const catalog::Schema> &proj_schema,
+      BandClause &&band_clause)
+      : AbstractJoinPlan(join_type, std::move(predicate), std::move(proj_info),
+                         proj_schema),
+        band_clause_(std::move(band_clause)) {}
+
+  inline PlanNodeType GetPlanNodeType() const {
+    return PLAN_NODE_TYPE_BANDJOIN;
+  }
+
+  const BandClause *GetBandClause() const { return &band_clause_; }
+
+  const std::string GetInfo() const { return "BandJoin"; }
+
+  std::unique_ptr<AbstractPlan> Copy() const {
+    BandClause new_band_clause(
+        band_clause_.left_->Copy(),
+        band_clause_.lower_ ? band_clause_.lower_->Copy() : nullptr,
+        band_clause_.lower_inclusive_,
+        band_clause_.upper_ ? band_clause_.upper_->Copy() : nullptr,
+        band_clause_.upper_inclusive_);
+
+    std::unique_ptr<const expression::AbstractExpression> predicate_copy(
+        GetPredicate() ? GetPredicate()->Copy() : nullptr);
+    std::shared_ptr<const catalog::Schema> schema_copy(
+        catalog::Schema::CopySchema(GetSchema()));
+    BandJoinPlan *new_plan = new BandJoinPlan(
+        GetJoinType(), std::move(predicate_copy),
+        std::move(GetProjInfo()->Copy()), schema_copy,
+        std::move(new_band_clause));
+    return std::unique_ptr<AbstractPlan>(new_plan);
+  }
+
+ private:
+  BandClause band_clause_;
+};
+
+}  // namespace planner
+}  // namespace peloton
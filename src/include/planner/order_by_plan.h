@@ -40,13 +40,26 @@ class OrderByPlan : public AbstractPlan {
     return output_column_ids_;
   }
 
+  /** @brief Only the first limit tuples of the sort order are needed, e.g.,
+   * limit + offset of a LIMIT on top of this node. */
+  void SetLimit(size_t limit) {
+    has_limit_ = true;
+    limit_ = limit;
+  }
+
+  bool HasLimit() const { return has_limit_; }
+
+  size_t GetLimit() const { return limit_; }
+
   inline PlanNodeType GetPlanNodeType() const { return PLAN_NODE_TYPE_ORDERBY; }
 
   const std::string GetInfo() const { return "OrderBy"; }
 
   std::unique_ptr<AbstractPlan> Copy() const {
-    return std::unique_ptr<AbstractPlan>(
-        new OrderByPlan(sort_keys_, descend_flags_, output_column_ids_));
+    OrderByPlan *new_plan =
+        new OrderByPlan(sort_keys_, descend_flags_, output_column_ids_);
+    if (has_limit_) new_plan->SetLimit(limit_);
+    return std::unique_ptr<AbstractPlan>(new_plan);
   }
 
  private:
@@ -63,6 +76,10 @@ class OrderByPlan : public AbstractPlan {
    * Now we just output the same schema as input tiles.
    */
   const std::vector<oid_t> output_column_ids_;
+
+  /** @brief Number of tuples needed from the sort order, if limited. */
+  bool has_limit_ = false;
+  size_t limit_ = 0;
 };
 }
 }
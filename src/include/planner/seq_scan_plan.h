@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,9 @@
 
 namespace peloton {
 
+namespace executor {
+class CompiledPredicate;
+}
 namespace parser {
 struct SelectStatement;
 }
@@ -51,6 +55,8 @@ class SeqScanPlan : public AbstractScan {
 
   SeqScanPlan() : AbstractScan() {}
 
+  ~SeqScanPlan();
+
   inline PlanNodeType GetPlanNodeType() const { return PLAN_NODE_TYPE_SEQSCAN; }
 
   const std::string GetInfo() const { return "SeqScan"; }
@@ -68,6 +74,13 @@ class SeqScanPlan : public AbstractScan {
 
   oid_t GetColumnID(std::string col_name);
 
+  /**
+   * @brief The predicate compiled for the schema of the table, null if it
+   * can not be compiled. It is compiled by the first execution of the plan
+   * and reused by the later ones, e.g., of a prepared statement.
+   */
+  const executor::CompiledPredicate *GetCompiledPredicate() const;
+
   std::unique_ptr<AbstractPlan> Copy() const {
     AbstractPlan *new_plan = new SeqScanPlan(
         this->GetTable(), this->GetPredicate()->Copy(), this->GetColumnIds());
@@ -75,6 +88,8 @@ class SeqScanPlan : public AbstractScan {
   }
 
  private:
+  mutable std::once_flag compile_flag_;
+  mutable std::unique_ptr<executor::CompiledPredicate> compiled_predicate_;
 };
 
 }  // namespace planner
@@ -22,7 +22,8 @@ namespace planner {
  * @brief Plan node for set operation:
  * INTERSECT/INTERSECT ALL/EXPECT/EXCEPT ALL
  *
- * @warning UNION (ALL) is handled differently.
+ * @warning UNION (ALL) is only supported over sorted inputs
+ * (see MergeSetOpExecutor), the hash set-op handles it differently.
  * IMPORTANT: Both children must have the same physical schema.
  */
 class SetOpPlan : public AbstractPlan {
@@ -24,6 +24,7 @@
 #include "common/value.h"
 #include "common/printable.h"
 #include "common/varlen_pool.h"
+#include "storage/zone_map.h"
 
 namespace peloton {
 
@@ -165,6 +166,11 @@ class TileGroup : public Printable {
 
   void SetValue(common::Value &value, oid_t tuple_id, oid_t column_id);
 
+  // Get the bounds of the values written into the tile group
+  const ZoneMap &GetZoneMap() const { return zone_map; }
+
+  ZoneMap &GetZoneMap() { return zone_map; }
+
   double GetSchemaDifference(const storage::column_map_type &new_column_map);
 
   // Sync the contents
@@ -206,6 +212,9 @@ class TileGroup : public Printable {
   // column to tile mapping :
   // <column offset> to <tile offset, tile column offset>
   column_map_type column_map;
+
+  // min/max/null count of every column, kept up to date on every write
+  ZoneMap zone_map;
 };
 
 }  // End storage namespace
@@ -0,0 +1,86 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// zone_map.h
+//
+// Identification: src/include/storage/zone_map.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "common/types.h"
+#include "common/value.h"
+
+namespace peloton {
+namespace storage {
+
+//===--------------------------------------------------------------------===//
+// Zone Map
+//===--------------------------------------------------------------------===//
+
+/**
+ * The minimum, maximum and number of nulls of every column of a tile group.
+ *
+ * The bounds are widened whenever a value is written into the tile group and
+ * are never narrowed, so they cover every version that is or was stored in
+ * it. A scan can skip a tile group if the zone map shows that no value of a
+ * column can satisfy a comparison of the predicate.
+ *
+ * Integer and timestamp columns are tracked as int64_t and decimals as
+ * double. Other columns, and columns that were written a value the bounds
+ * cannot represent, never rule out a tile group.
+ */
+class ZoneMap {
+ public:
+  ZoneMap(ZoneMap const &) = delete;
+  ZoneMap &operator=(ZoneMap const &) = delete;
+
+  explicit ZoneMap(const std::vector<common::Type::TypeId> &column_types);
+
+  ~ZoneMap();
+
+  /** @brief Widen the bounds of the column to include the value */
+  void Update(oid_t column_id, const common::Value &value);
+
+  /** @brief Widen the bounds of every column to include those of the other
+   * zone map, which has the same columns */
+  void Merge(const ZoneMap &other);
+
+  /**
+   * @brief Whether a value of the column may satisfy the comparison
+   * <column> <compare_type> <value>
+   * @return false if the comparison is not true for any value of the column
+   */
+  bool MayMatch(oid_t column_id, ExpressionType compare_type,
+                const common::Value &value) const;
+
+  /** @brief Number of nulls that were written into the column */
+  oid_t GetNullCount(oid_t column_id) const;
+
+  /**
+   * @brief Get the bounds of an integer or timestamp column
+   * @return false if the column is of another type, has no bounds or no value
+   * was written into it
+   */
+  bool GetIntegerBounds(oid_t column_id, int64_t &min, int64_t &max) const;
+
+  oid_t GetColumnCount() const { return column_count_; }
+
+ private:
+  struct ColumnZone;
+
+  oid_t column_count_;
+
+  std::unique_ptr<ColumnZone[]> zones_;
+};
+
+}  // End storage namespace
+}  // End peloton namespace
@@ -0,0 +1,88 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// bloom_filter.h
+//
+// Identification: src/include/util/bloom_filter.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace peloton {
+namespace util {
+
+/**
+ * @brief Blocked Bloom filter over 64-bit hashes.
+ *
+ * A key sets one bit in each of the 8 words of a single 64-byte block, so
+ * every insert and lookup touches exactly one cache line. The block is
+ * picked by the high bits of the hash, which should be mixed (see
+ * MixHash() in flat_hash_table.h).
+ */
+class BloomFilter {
+ public:
+  /** @brief Clear the filter and size it for expected_count keys */
+  void Init(size_t expected_count) {
+    block_bits_ = 0;
+    while ((size_t(1) << block_bits_) * BLOCK_BITS <
+           expected_count * BITS_PER_KEY) {
+      block_bits_++;
+    }
+    words_.assign((size_t(1) << block_bits_) * BLOCK_WORDS, 0);
+  }
+
+  bool IsEmpty() const { return words_.empty(); }
+
+  void Insert(uint64_t hash) {
+    uint64_t *block = &words_[GetBlock(hash) * BLOCK_WORDS];
+    uint64_t bit_hash = GetBitHash(hash);
+    for (size_t word_itr = 0; word_itr < BLOCK_WORDS; word_itr++) {
+      block[word_itr] |= uint64_t(1) << ((bit_hash >> (6 * word_itr)) & 63);
+    }
+  }
+
+  /** @brief false if the key of the hash was surely not inserted */
+  bool MayContain(uint64_t hash) const {
+    const uint64_t *block = &words_[GetBlock(hash) * BLOCK_WORDS];
+    uint64_t bit_hash = GetBitHash(hash);
+    uint64_t missing = 0;
+    for (size_t word_itr = 0; word_itr < BLOCK_WORDS; word_itr++) {
+      missing |= ~block[word_itr] &
+                 (uint64_t(1) << ((bit_hash >> (6 * word_itr)) & 63));
+    }
+    return missing == 0;
+  }
+
+ private:
+  static const size_t BLOCK_WORDS = 8;
+  static const size_t BLOCK_BITS = BLOCK_WORDS * 64;
+
+  // About 0.5% false positives for blocks of 8 probes
+  static const size_t BITS_PER_KEY = 16;
+
+  size_t GetBlock(uint64_t hash) const {
+    if (block_bits_ == 0) return 0;
+    return static_cast<size_t>(hash >> (64 - block_bits_));
+  }
+
+  // The bits within a block come from another multiplicative hash, so they do
+  // not depend on the bits that picked the block
+  static uint64_t GetBitHash(uint64_t hash) {
+    return hash * 0x9e3779b97f4a7c15ULL;
+  }
+
+  std::vector<uint64_t> words_;
+
+  size_t block_bits_ = 0;
+};
+
+}  // namespace util
+}  // namespace peloton
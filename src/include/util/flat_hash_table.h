@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// flat_hash_table.h
+//
+// Identification: src/include/util/flat_hash_table.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace peloton {
+namespace util {
+
+/**
+ * @brief Mix the bits of a hash value (the 64-bit finalizer of MurmurHash3),
+ * so that both its low bits (radix partitions) and its high bits (slots of
+ * FlatHashTable) can be used.
+ */
+inline uint64_t MixHash(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9a64ea53e63ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * @brief Open addressing hash table with linear probing over one flat array
+ * of (hash, payload) entries.
+ *
+ * The table only stores hashes, the keys are compared by the caller, e.g.,
+ * through a payload that locates the key. Several entries may have the same
+ * key. The slot of an entry is taken from the high bits of its hash, which
+ * should be mixed (see MixHash()). The load factor is kept at most 1/2.
+ */
+template <typename Payload>
+class FlatHashTable {
+ public:
+  struct Entry {
+    uint64_t hash;
+    Payload payload;
+  };
+
+  FlatHashTable() { Init(0); }
+
+  explicit FlatHashTable(size_t expected_count) { Init(expected_count); }
+
+  /** @brief Clear the table and size it for expected_count entries */
+  void Init(size_t expected_count) {
+    slot_bits_ = 4;
+    while ((size_t(1) << slot_bits_) < 2 * expected_count) slot_bits_++;
+    slots_.assign(size_t(1) << slot_bits_, Entry());
+    size_ = 0;
+  }
+
+  size_t Size() const { return size_; }
+
+  size_t GetCapacity() const { return slots_.size(); }
+
+  /** @brief Add an entry, even if there are entries with the same key */
+  void Insert(uint64_t hash, const Payload &payload) {
+    if (2 * (size_ + 1) > slots_.size()) Grow();
+    hash = StoredHash(hash);
+    size_t slot = FindEmptySlot(hash);
+    slots_[slot].hash = hash;
+    slots_[slot].payload = payload;
+    size_++;
+  }
+
+  /** @brief Call match(payload) for every entry with the given hash */
+  template <typename Match>
+  void ForEachMatch(uint64_t hash, Match match) const {
+    hash = StoredHash(hash);
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = GetSlot(hash); slots_[slot].hash != EMPTY_HASH;
+         slot = (slot + 1) & mask) {
+      if (slots_[slot].hash == hash) match(slots_[slot].payload);
+    }
+  }
+
+  /** @brief Find the entry with the given hash whose key is equal(payload)
+   * @return its payload, or nullptr */
+  template <typename Equal>
+  Payload *Find(uint64_t hash, Equal equal) {
+    hash = StoredHash(hash);
+    size_t mask = slots_.size() - 1;
+    for (size_t slot = GetSlot(hash); slots_[slot].hash != EMPTY_HASH;
+         slot = (slot + 1) & mask) {
+      if (slots_[slot].hash == hash && equal(slots_[slot].payload)) {
+        return &slots_[slot].payload;
+      }
+    }
+    return nullptr;
+  }
+
+  /** @brief Find the entry of a key, or insert payload for it
+   * @return the payload of the entry, and true if it was inserted */
+  template <typename Equal>
+  std::pair<Payload *, bool> FindOrInsert(uint64_t hash, Equal equal,
+                                          const Payload &payload) {
+    auto found = Find(hash, equal);
+    if (found != nullptr) return std::make_pair(found, false);
+
+    if (2 * (size_ + 1) > slots_.size()) Grow();
+    auto stored_hash = StoredHash(hash);
+    size_t slot = FindEmptySlot(stored_hash);
+    slots_[slot].hash = stored_hash;
+    slots_[slot].payload = payload;
+    size_++;
+    return std::make_pair(&slots_[slot].payload, true);
+  }
+
+  /** @brief Call visit(payload) for every entry, in slot order */
+  template <typename Visit>
+  void ForEach(Visit visit) {
+    for (auto &entry : slots_) {
+      if (entry.hash != EMPTY_HASH) visit(entry.payload);
+    }
+  }
+
+ private:
+  static const uint64_t EMPTY_HASH = 0;
+
+  // The empty marker is never stored as a hash
+  static uint64_t StoredHash(uint64_t hash) {
+    return hash == EMPTY_HASH ? 1 : hash;
+  }
+
+  size_t GetSlot(uint64_t hash) const {
+    return static_cast<size_t>(hash >> (64 - slot_bits_));
+  }
+
+  size_t FindEmptySlot(uint64_t hash) const {
+    size_t mask = slots_.size() - 1;
+    size_t slot = GetSlot(hash);
+    while (slots_[slot].hash != EMPTY_HASH) slot = (slot + 1) & mask;
+    return slot;
+  }
+
+  void Grow() {
+    std::vector<Entry> old_slots;
+    old_slots.swap(slots_);
+    slot_bits_++;
+    slots_.assign(size_t(1) << slot_bits_, Entry());
+    for (auto &entry : old_slots) {
+      if (entry.hash == EMPTY_HASH) continue;
+      slots_[FindEmptySlot(entry.hash)] = entry;
+    }
+  }
+
+  std::vector<Entry> slots_;
+
+  size_t slot_bits_ = 0;
+
+  size_t size_ = 0;
+};
+
+}  // namespace util
+}  // namespace peloton
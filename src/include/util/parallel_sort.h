@@ -0,0 +1,175 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// parallel_sort.h
+//
+// Identification: src/include/util/parallel_sort.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+#include "common/init.h"
+#include "common/thread_pool.h"
+
+namespace peloton {
+namespace util {
+
+// [begin, end) of a sorted run
+template <typename T>
+using sorted_run_type = std::pair<const T *, const T *>;
+
+/**
+ * @brief Merge k sorted runs, calling emit(out_pos, element) for the element
+ * that goes to every output position out_pos.
+ * The output is split into partition_count key ranges using splitters sampled
+ * from the runs, and every range is merged by its own worker of the shared
+ * thread pool with a k-way heap merge, so emit is called concurrently for
+ * disjoint output positions.
+ */
+template <typename T, typename Compare, typename Emit>
+void parallel_multiway_merge_emit(const std::vector<sorted_run_type<T>> &runs,
+                                  Emit emit, Compare comp,
+                                  size_t partition_count) {
+  size_t run_count = runs.size();
+  size_t total_count = 0;
+  for (auto &run : runs) {
+    total_count += run.second - run.first;
+  }
+  if (total_count == 0) return;
+  partition_count = std::max(std::min(partition_count, total_count), size_t(1));
+
+  // Sample every run evenly and pick the splitters from the sorted samples
+  const size_t samples_per_partition = 32;
+  std::vector<T> samples;
+  for (auto &run : runs) {
+    size_t run_size = run.second - run.first;
+    size_t sample_count =
+        std::min(run_size, samples_per_partition * partition_count);
+    for (size_t sample_itr = 0; sample_itr < sample_count; sample_itr++) {
+      samples.push_back(run.first[sample_itr * run_size / sample_count]);
+    }
+  }
+  std::sort(samples.begin(), samples.end(), comp);
+
+  std::vector<T> splitters;
+  for (size_t partition_itr = 1; partition_itr < partition_count;
+       partition_itr++) {
+    splitters.push_back(samples[partition_itr * samples.size() /
+                                partition_count]);
+  }
+
+  // bounds[p][r] is the first element of run r that goes to partition p.
+  // All the elements that are equal to a splitter go to the same partition.
+  std::vector<std::vector<const T *>> bounds(partition_count + 1);
+  for (size_t partition_itr = 0; partition_itr <= partition_count;
+       partition_itr++) {
+    for (auto &run : runs) {
+      if (partition_itr == 0) {
+        bounds[partition_itr].push_back(run.first);
+      } else if (partition_itr == partition_count) {
+        bounds[partition_itr].push_back(run.second);
+      } else {
+        bounds[partition_itr].push_back(std::lower_bound(
+            run.first, run.second, splitters[partition_itr - 1], comp));
+      }
+    }
+  }
+
+  std::vector<std::function<void()>> merge_tasks;
+  size_t partition_out = 0;
+  for (size_t partition_itr = 0; partition_itr < partition_count;
+       partition_itr++) {
+    auto &begins = bounds[partition_itr];
+    auto &ends = bounds[partition_itr + 1];
+    size_t partition_size = 0;
+    for (size_t run_itr = 0; run_itr < run_count; run_itr++) {
+      partition_size += ends[run_itr] - begins[run_itr];
+    }
+    if (partition_size == 0) continue;
+
+    merge_tasks.push_back([&begins, &ends, run_count, partition_out, comp,
+                           emit] {
+      // min-heap of (current position, run) over the non-empty runs
+      typedef std::pair<const T *, size_t> head_type;
+      auto head_greater = [&comp](const head_type &a, const head_type &b) {
+        return comp(*b.first, *a.first);
+      };
+      std::priority_queue<head_type, std::vector<head_type>,
+                          decltype(head_greater)> heads(head_greater);
+      for (size_t run_itr = 0; run_itr < run_count; run_itr++) {
+        if (begins[run_itr] < ends[run_itr]) {
+          heads.emplace(begins[run_itr], run_itr);
+        }
+      }
+
+      size_t out_itr = partition_out;
+      while (!heads.empty()) {
+        auto head = heads.top();
+        heads.pop();
+        emit(out_itr++, head.first);
+        if (++head.first < ends[head.second]) {
+          heads.push(head);
+        }
+      }
+    });
+    partition_out += partition_size;
+  }
+
+  thread_pool.ExecuteTasks(merge_tasks);
+}
+
+/**
+ * @brief Merge k sorted runs into out, which must have room for all of their
+ * elements and must not overlap with them.
+ */
+template <typename T, typename Compare>
+void parallel_multiway_merge(const std::vector<sorted_run_type<T>> &runs,
+                             T *out, Compare comp, size_t partition_count) {
+  parallel_multiway_merge_emit(
+      runs, [out](size_t out_pos, const T *element) { out[out_pos] = *element; },
+      comp, partition_count);
+}
+
+/**
+ * @brief Sort data[0, len) with partition_count workers of the shared thread
+ * pool. Every worker sorts one chunk, and the sorted chunks are merged into
+ * temp with parallel_multiway_merge.
+ * @return the buffer (data or temp) that holds the sorted elements.
+ */
+template <typename T, typename Compare>
+T *parallel_sort(T *data, T *temp, size_t len, Compare comp,
+                 size_t partition_count) {
+  partition_count = std::max(std::min(partition_count, len), size_t(1));
+  if (partition_count == 1) {
+    std::sort(data, data + len, comp);
+    return data;
+  }
+
+  std::vector<sorted_run_type<T>> runs;
+  std::vector<std::function<void()>> sort_tasks;
+  for (size_t chunk_itr = 0; chunk_itr < partition_count; chunk_itr++) {
+    T *chunk_begin = data + len * chunk_itr / partition_count;
+    T *chunk_end = data + len * (chunk_itr + 1) / partition_count;
+    runs.emplace_back(chunk_begin, chunk_end);
+    sort_tasks.push_back([chunk_begin, chunk_end, comp] {
+      std::sort(chunk_begin, chunk_end, comp);
+    });
+  }
+  thread_pool.ExecuteTasks(sort_tasks);
+
+  parallel_multiway_merge(runs, temp, comp, partition_count);
+  return temp;
+}
+
+}  // namespace util
+}  // namespace peloton
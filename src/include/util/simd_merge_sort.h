@@ -10,7 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#pragma once
+
 #include <immintrin.h>
+#include <cstdint>
 #include <utility>
 #include <string>
 #include <vector>
@@ -18,11 +21,35 @@
 #define SIMD_SIZE 8
 #define SORT_SIZE 64
 
+// 64-bit keys: 4 keys per AVX2 register, 16 keys per sorted AVX2 block
+#define SIMD_SIZE64 4
+#define SORT_BLOCK64 16
+
+// 64-bit keys: 8 keys per AVX-512 register, 64 keys per sorted AVX-512 block
+#define SIMD_SIZE64_AVX512 8
+#define SORT_BLOCK64_AVX512 64
+
+// simd_merge_sort64 sorts multiples of the block size of the widest kernel
+#define SORT_SIZE64 SORT_BLOCK64_AVX512
+
 namespace peloton {
 namespace util {
 
 typedef unsigned int sort_ele_type;
 
+// keys are compared as unsigned integers, payloads just follow their keys
+typedef uint64_t sort_key64_type;
+typedef uint64_t sort_payload_type;
+
+typedef std::pair<sort_key64_type *, sort_payload_type *> sort64_result_type;
+
+// Kernels of simd_merge_sort64, from the narrowest to the widest
+enum SimdSortKernel {
+  SIMD_SORT_KERNEL_SCALAR = 0,
+  SIMD_SORT_KERNEL_AVX2 = 1,
+  SIMD_SORT_KERNEL_AVX512 = 2
+};
+
 
 inline __m256i load_reg256(sort_ele_type *a) {
   return *(__m256i*)a;
@@ -32,6 +59,14 @@ inline void store_reg256(sort_ele_type *a, __m256i& b) {
   *((__m256i*)a) = b;
 }
 
+inline __m256i load_reg256(uint64_t *a) {
+  return *(__m256i*)a;
+}
+
+inline void store_reg256(uint64_t *a, __m256i& b) {
+  *((__m256i*)a) = b;
+}
+
 typedef struct masks {
   __m256i rev_idx_mask;
   __m256i swap_128;
@@ -50,5 +85,66 @@ std::pair<sort_ele_type *, sort_ele_type *> simd_merge_sort(sort_ele_type *a,
                                                             sort_ele_type *b,
                                                             size_t len);
 
+/**
+ * @brief Sort len (a multiple of SORT_SIZE64) 64-bit keys together with
+ * their payloads with the widest kernel that this host supports.
+ * All four arrays must be 32-byte aligned; temp_keys and temp_payloads are
+ * used as the ping-pong buffers of the merge passes.
+ * @return the key and payload arrays that hold the sorted output, i.e.,
+ * either (keys, payloads) or (temp_keys, temp_payloads)
+ */
+sort64_result_type simd_merge_sort64(sort_key64_type *keys,
+                                     sort_payload_type *payloads,
+                                     sort_key64_type *temp_keys,
+                                     sort_payload_type *temp_payloads,
+                                     size_t len);
+
+// Payload of the padding that simd_sort_pairs64 appends to the keys, valid
+// payloads must never be equal to it
+const sort_payload_type SORT_PAD_PAYLOAD64 = UINT64_MAX;
+
+/**
+ * @brief Sort count keys together with their payloads in place with
+ * simd_merge_sort64. The pairs are copied into aligned buffers padded to
+ * whole blocks, and copied back without the padding once they are sorted.
+ */
+void simd_sort_pairs64(sort_key64_type *keys, sort_payload_type *payloads,
+                       size_t count);
+
+// The kernels behind simd_merge_sort64. The AVX2 kernel takes multiples of
+// SORT_BLOCK64 keys, the AVX-512 kernel multiples of SORT_BLOCK64_AVX512 keys
+// and must only be called if the host supports AVX-512F.
+sort64_result_type merge_sort64_scalar(sort_key64_type *keys,
+                                       sort_payload_type *payloads,
+                                       sort_key64_type *temp_keys,
+                                       sort_payload_type *temp_payloads,
+                                       size_t len);
+
+sort64_result_type simd_merge_sort64_avx2(sort_key64_type *keys,
+                                          sort_payload_type *payloads,
+                                          sort_key64_type *temp_keys,
+                                          sort_payload_type *temp_payloads,
+                                          size_t len);
+
+sort64_result_type simd_merge_sort64_avx512(sort_key64_type *keys,
+                                            sort_payload_type *payloads,
+                                            sort_key64_type *temp_keys,
+                                            sort_payload_type *temp_payloads,
+                                            size_t len);
+
+/**
+ * @brief The kernel used by simd_merge_sort64, i.e., the widest one that
+ * cpuid reports for this host, detected once at startup.
+ */
+SimdSortKernel GetSimdSortKernel();
+
+/**
+ * @brief Use the given kernel in simd_merge_sort64 (e.g., to compare the
+ * kernels in a benchmark). A sort that already runs may still finish some
+ * of its chunks with the previous kernel.
+ * @return false if this host does not support the kernel.
+ */
+bool SetSimdSortKernel(SimdSortKernel kernel);
+
 }
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// sort_key_normalizer.h
+//
+// Identification: src/include/util/sort_key_normalizer.h
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "common/value.h"
+#include "util/simd_merge_sort.h"
+
+namespace peloton {
+namespace util {
+
+/**
+ * @brief Order-preserving normalization of sort keys into unsigned 64-bit
+ * integers, so that the SIMD sort can order rows by comparing them.
+ *
+ * Every column is encoded into an unsigned integer of its own width: signed
+ * values get their sign bit flipped and descending columns get all of their
+ * bits inverted. The encoded columns are then concatenated, most significant
+ * column first. If they do not fit into 64 bits, only a prefix of the columns
+ * is packed (the last packed column may be truncated to its high bits), and
+ * rows with equal normalized keys have to be ordered with CompareColumn().
+ */
+class SortKeyNormalizer {
+ public:
+  SortKeyNormalizer(const std::vector<common::Type::TypeId> &column_types,
+                    const std::vector<bool> &descend_flags);
+
+  /** @brief Width of the encoding of a column type, 0 if it has none. */
+  static size_t GetColumnBits(common::Type::TypeId type_id);
+
+  /** @brief Whether all the given column types can be normalized. */
+  static bool CanNormalize(const std::vector<common::Type::TypeId> &types);
+
+  /**
+   * @brief Pack the value of the column_itr-th column into key, which holds
+   * the packed values of all the previous columns.
+   */
+  sort_key64_type AddColumn(sort_key64_type key, size_t column_itr,
+                            const common::Value &value) const {
+    auto prefix_bits = prefix_bits_[column_itr];
+    if (prefix_bits == 0) return key;
+    auto column_key =
+        EncodeColumn(column_itr, value) >> (column_bits_[column_itr] -
+                                            prefix_bits);
+    return prefix_bits == 64 ? column_key : (key << prefix_bits) | column_key;
+  }
+
+  /**
+   * @brief Three-way comparison of two values of the column_itr-th column
+   * in sort order (i.e., after applying its descend flag).
+   */
+  int CompareColumn(size_t column_itr, const common::Value &a,
+                    const common::Value &b) const {
+    auto key_a = EncodeColumn(column_itr, a);
+    auto key_b = EncodeColumn(column_itr, b);
+    return key_a < key_b ? -1 : (key_a > key_b ? 1 : 0);
+  }
+
+  /** @brief Whether equal normalized keys imply equal sort keys. */
+  bool IsExact() const { return first_inexact_column_ == column_bits_.size(); }
+
+  /** @brief The first column that is not fully packed into the key. */
+  size_t GetFirstInexactColumn() const { return first_inexact_column_; }
+
+  size_t GetColumnCount() const { return column_bits_.size(); }
+
+ private:
+  sort_key64_type EncodeColumn(size_t column_itr,
+                               const common::Value &value) const;
+
+  std::vector<common::Type::TypeId> column_types_;
+
+  std::vector<bool> descend_flags_;
+
+  /** Width of the encoding of every column */
+  std::vector<size_t> column_bits_;
+
+  /** Number of high bits of every column packed into the key */
+  std::vector<size_t> prefix_bits_;
+
+  size_t first_inexact_column_;
+};
+
+}  // namespace util
+}  // namespace peloton
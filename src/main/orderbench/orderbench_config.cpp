@@ -27,12 +27,18 @@ void Usage(FILE *out) {
           "Command line options : orderbench <options> \n"
               "   -h --help              :  print help message \n"
               "   -s --scale_factor      :  # of K tuples (default: 1)\n"
-              "   -a --avx2              :  Use AVX2 implementation of sort\n");
+              "   -a --avx2              :  Use AVX2 implementation of sort\n"
+              "   -p --partitions        :  # of parallel sort partitions (default: 0, serial)\n"
+              "   -k --kernel            :  SIMD sort kernel, 0: scalar, 1: AVX2, 2: AVX-512 (default: widest supported)\n"
+              "   -m --memory_budget     :  MB of buffered tuples before spilling sorted runs (default: 0, unlimited)\n");
 }
 
 static struct option opts[] = {
   {"scale_factor", optional_argument, NULL, 's'},
   {"avx2", optional_argument, NULL, 'a'},
+  {"partitions", optional_argument, NULL, 'p'},
+  {"kernel", optional_argument, NULL, 'k'},
+  {"memory_budget", optional_argument, NULL, 'm'},
   {NULL, 0, NULL, 0}};
 
 void ValidateScaleFactor(const configuration &state) {
@@ -42,17 +48,35 @@ void ValidateScaleFactor(const configuration &state) {
   }
 
   LOG_TRACE("%s : %d", "scale_factor", state.scale_factor);
+
+  if (state.sort_partitions < 0) {
+    LOG_ERROR("Invalid partitions :: %d", state.sort_partitions);
+    exit(EXIT_FAILURE);
+  }
+
+  if (state.sort_kernel > 2) {
+    LOG_ERROR("Invalid kernel :: %d", state.sort_kernel);
+    exit(EXIT_FAILURE);
+  }
+
+  if (state.sort_memory_budget < 0) {
+    LOG_ERROR("Invalid memory_budget :: %d", state.sort_memory_budget);
+    exit(EXIT_FAILURE);
+  }
 }
 
 void ParseArguments(int argc, char *argv[], configuration &state) {
   // Default Values
   state.scale_factor = 1;
   state.use_avx2_sort = false;
+  state.sort_partitions = 0;
+  state.sort_kernel = -1;
+  state.sort_memory_budget = 0;
 
   // Parse args
   while (1) {
     int idx = 0;
-    int c = getopt_long(argc, argv, "has:", opts, &idx);
+    int c = getopt_long(argc, argv, "hak:m:p:s:", opts, &idx);
 
     if (c == -1) break;
 
@@ -67,6 +91,15 @@ void ParseArguments(int argc, char *argv[], configuration &state) {
       case 's':
         state.scale_factor = atoi(optarg);
         break;
+      case 'p':
+        state.sort_partitions = atoi(optarg);
+        break;
+      case 'k':
+        state.sort_kernel = atoi(optarg);
+        break;
+      case 'm':
+        state.sort_memory_budget = atoi(optarg);
+        break;
       default:
       LOG_ERROR("Unknown option: -%c-", c);
         Usage(stderr);
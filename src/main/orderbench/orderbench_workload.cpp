@@ -40,6 +40,8 @@
 #include "planner/seq_scan_plan.h"
 #include "planner/order_by_plan.h"
 
+#include "util/simd_merge_sort.h"
+
 namespace peloton {
 namespace benchmark {
 namespace orderbench {
@@ -126,6 +128,23 @@ void RunOrderBench() {
     order_executor.UseAVX2Sort();
   }
 
+  if (state.sort_partitions > 0) {
+    order_executor.UseParallelSort(state.sort_partitions);
+  }
+
+  if (state.sort_memory_budget > 0) {
+    order_executor.UseExternalSort(
+        static_cast<size_t>(state.sort_memory_budget) << 20);
+  }
+
+  if (state.sort_kernel >= 0 &&
+      !util::SetSimdSortKernel(
+          static_cast<util::SimdSortKernel>(state.sort_kernel))) {
+    LOG_ERROR("SIMD sort kernel %d is not supported on this host",
+              state.sort_kernel);
+    exit(EXIT_FAILURE);
+  }
+
   int prev_key = INT_MIN;
 
   while (order_executor.Execute() == true) {
@@ -27,12 +27,16 @@ void Usage(FILE *out) {
           "Command line options : orderbench <options> \n"
               "   -h --help              :  print help message \n"
               "   -s --scale_factor      :  # of K tuples (default: 1)\n"
-              "   -a --avx2              :  Use AVX2 implementation of sort\n");
+              "   -a --avx2              :  Use AVX2 implementation of sort\n"
+              "   -p --partitions        :  # of parallel merge partitions (default: 0, serial)\n"
+              "   -i --integrated_sort   :  Sort inside the merge join instead of in order by executors\n");
 }
 
 static struct option opts[] = {
     {"scale_factor", optional_argument, NULL, 's'},
     {"avx2", optional_argument, NULL, 'a'},
+    {"partitions", optional_argument, NULL, 'p'},
+    {"integrated_sort", optional_argument, NULL, 'i'},
     {NULL, 0, NULL, 0}};
 
 void ValidateScaleFactor(const configuration &state) {
@@ -42,17 +46,24 @@ void ValidateScaleFactor(const configuration &state) {
   }
 
   LOG_TRACE("%s : %d", "scale_factor", state.scale_factor);
+
+  if (state.merge_partitions < 0) {
+    LOG_ERROR("Invalid partitions :: %d", state.merge_partitions);
+    exit(EXIT_FAILURE);
+  }
 }
 
 void ParseArguments(int argc, char *argv[], configuration &state) {
   // Default Values
   state.scale_factor = 1;
   state.use_avx2_sort = false;
+  state.merge_partitions = 0;
+  state.integrated_sort = false;
 
   // Parse args
   while (1) {
     int idx = 0;
-    int c = getopt_long(argc, argv, "has:", opts, &idx);
+    int c = getopt_long(argc, argv, "haip:s:", opts, &idx);
 
     if (c == -1) break;
 
@@ -64,9 +75,15 @@ void ParseArguments(int argc, char *argv[], configuration &state) {
       case 'a':
         state.use_avx2_sort = true;
         break;
+      case 'i':
+        state.integrated_sort = true;
+        break;
       case 's':
         state.scale_factor = atoi(optarg);
         break;
+      case 'p':
+        state.merge_partitions = atoi(optarg);
+        break;
       default:
       LOG_ERROR("Unknown option: -%c-", c);
         Usage(stderr);
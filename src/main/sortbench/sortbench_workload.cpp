@@ -33,6 +33,7 @@
 #include "executor/seq_scan_executor.h"
 #include "executor/order_by_executor.h"
 #include "executor/merge_join_executor.h"
+#include "executor/sort_merge_join_executor.h"
 #include "expression/conjunction_expression.h"
 
 #include "benchmark/sortbench/sortbench_workload.h"
@@ -199,31 +200,44 @@ void RunSortMergeJoin() {
 
   std::unique_ptr<executor::ExecutorContext> merge_join_context(
       new executor::ExecutorContext(txn));
-  executor::MergeJoinExecutor merge_join_executor(&merge_join_node,
-                                                  merge_join_context.get());
-
-  merge_join_executor.AddChild(&left_order_executor);
-  merge_join_executor.AddChild(&right_order_executor);
-
-  left_order_executor.AddChild(&left_seq_scan_executor);
-  right_order_executor.AddChild(&right_seq_scan_executor);
+  std::unique_ptr<executor::MergeJoinExecutor> merge_join_executor;
+
+  if (state.integrated_sort == true) {
+    // the join sorts the (key, row) pairs of the scans itself
+    merge_join_executor.reset(new executor::SortMergeJoinExecutor(
+        &merge_join_node, merge_join_context.get()));
+    merge_join_executor->AddChild(&left_seq_scan_executor);
+    merge_join_executor->AddChild(&right_seq_scan_executor);
+  } else {
+    merge_join_executor.reset(new executor::MergeJoinExecutor(
+        &merge_join_node, merge_join_context.get()));
+    merge_join_executor->AddChild(&left_order_executor);
+    merge_join_executor->AddChild(&right_order_executor);
+
+    left_order_executor.AddChild(&left_seq_scan_executor);
+    right_order_executor.AddChild(&right_seq_scan_executor);
+  }
 
-  merge_join_executor.Init();
+  merge_join_executor->Init();
 
   if (state.use_avx2_sort == true) {
     left_order_executor.UseAVX2Sort();
     right_order_executor.UseAVX2Sort();
   }
 
+  if (state.merge_partitions > 0) {
+    merge_join_executor->UseParallelMerge(state.merge_partitions);
+  }
+
   int prev_key = INT_MIN;
 
   auto merge_start = static_cast<double>(
       std::chrono::duration_cast<std::chrono::microseconds>(
           std::chrono::steady_clock::now().time_since_epoch()).count());
 
-  while (merge_join_executor.Execute() == true) {
+  while (merge_join_executor->Execute() == true) {
     std::unique_ptr<executor::LogicalTile> result_logical_tile(
-        merge_join_executor.GetOutput());
+        merge_join_executor->GetOutput());
 
     if (result_logical_tile != nullptr) {
       result_tuple_count += result_logical_tile->GetTupleCount();
@@ -40,10 +40,13 @@
 #include "planner/seq_scan_plan.h"
 #include "planner/update_plan.h"
 #include "storage/data_table.h"
+#include "storage/tile_group.h"
 
 #include "common/logger.h"
 #include "common/value_factory.h"
 
+#include <algorithm>
+#include <limits>
 #include <memory>
 #include <unordered_map>
 
@@ -251,6 +254,10 @@ std::shared_ptr<planner::AbstractPlan> SimpleOptimizer::BuildPelotonPlanTree(
           if (offset < 0) {
             offset = 0;
           }
+          if (select_stmt->limit->limit >= 0) {
+            // The sort only has to produce the tuples returned by the limit
+            order_by_plan->SetLimit(select_stmt->limit->limit + offset);
+          }
           std::unique_ptr<planner::LimitPlan> limit_plan(
               new planner::LimitPlan(select_stmt->limit->limit, offset));
           limit_plan->AddChild(std::move(order_by_plan));
@@ -458,11 +465,13 @@ std::shared_ptr<planner::AbstractPlan> SimpleOptimizer::BuildPelotonPlanTree(
         LOG_TRACE("Output Schema Info: %s",
                   output_table_schema.get()->GetInfo().c_str());
 
+        auto group_count = EstimateGroupCount(target_table, group_by_columns);
         std::unique_ptr<planner::AggregatePlan> child_agg_plan(
             new planner::AggregatePlan(
                 std::move(proj_info), std::move(predicate),
                 std::move(agg_terms), std::move(group_by_columns),
                 output_table_schema, agg_type));
+        child_agg_plan->SetEstimatedGroupCount(group_count);
 
         child_agg_plan->AddChild(std::move(scan_node));
         child_plan = std::move(child_agg_plan);
@@ -731,6 +740,56 @@ std::unique_ptr<planner::AbstractScan> SimpleOptimizer::CreateScanPlan(
   return std::move(node);
 }
 
+/**
+ * The tuple slots of the table bound the number of groups, and so does the
+ * product of the value ranges of the group-by columns in the zone maps, plus
+ * one group for null. Columns whose range is not known leave the estimate at
+ * 0, so those groups keep being hashed.
+ */
+size_t SimpleOptimizer::EstimateGroupCount(
+    storage::DataTable* target_table,
+    const std::vector<oid_t>& group_by_columns) {
+  auto column_count = group_by_columns.size();
+  if (column_count == 0) return 0;
+
+  std::vector<int64_t> column_min(column_count,
+                                  std::numeric_limits<int64_t>::max());
+  std::vector<int64_t> column_max(column_count,
+                                  std::numeric_limits<int64_t>::min());
+  std::vector<bool> column_nulls(column_count, false);
+  size_t tuple_count = 0;
+
+  auto tile_group_count = target_table->GetTileGroupCount();
+  for (size_t tile_group_itr = 0; tile_group_itr < tile_group_count;
+       tile_group_itr++) {
+    auto tile_group = target_table->GetTileGroup(tile_group_itr);
+    if (tile_group == nullptr || tile_group->GetNextTupleSlot() == 0) {
+      continue;
+    }
+    tuple_count += tile_group->GetNextTupleSlot();
+
+    auto& zone_map = tile_group->GetZoneMap();
+    for (size_t column_itr = 0; column_itr < column_count; column_itr++) {
+      auto column_id = group_by_columns[column_itr];
+      int64_t min, max;
+      if (!zone_map.GetIntegerBounds(column_id, min, max)) return 0;
+      column_min[column_itr] = std::min(column_min[column_itr], min);
+      column_max[column_itr] = std::max(column_max[column_itr], max);
+      if (zone_map.GetNullCount(column_id) > 0) column_nulls[column_itr] = true;
+    }
+  }
+
+  // The product can overflow any integer type
+  double group_count = 1;
+  for (size_t column_itr = 0; column_itr < column_count; column_itr++) {
+    group_count *= static_cast<double>(column_max[column_itr]) -
+                   static_cast<double>(column_min[column_itr]) + 1 +
+                   (column_nulls[column_itr] ? 1 : 0);
+    if (group_count >= tuple_count) return tuple_count;
+  }
+  return static_cast<size_t>(group_count);
+}
+
 /**
  * This function replaces all COLUMN_REF expressions with TupleValue
  * expressions
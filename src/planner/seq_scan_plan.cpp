@@ -17,6 +17,7 @@
 #include "common/logger.h"
 #include "common/macros.h"
 #include "common/types.h"
+#include "executor/compiled_predicate.h"
 #include "expression/expression_util.h"
 #include "storage/data_table.h"
 
@@ -251,6 +252,18 @@ oid_t SeqScanPlan::GetColumnID(std::string col_name) {
   return index;
 }
 
+SeqScanPlan::~SeqScanPlan() {}
+
+const executor::CompiledPredicate *SeqScanPlan::GetCompiledPredicate() const {
+  std::call_once(compile_flag_, [this]() {
+    if (GetTable() != nullptr && GetPredicate() != nullptr) {
+      compiled_predicate_ = executor::CompiledPredicate::Compile(
+          GetPredicate(), GetTable()->GetSchema());
+    }
+  });
+  return compiled_predicate_.get();
+}
+
 void SeqScanPlan::SetParameterValues(std::vector<common::Value> *values) {
   LOG_TRACE("Setting parameter values in Sequential Scan");
 
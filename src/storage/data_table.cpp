@@ -1000,6 +1000,9 @@ void SetTransformedTileGroup(storage::TileGroup *orig_tile_group,
     }
   }
 
+  // The new tile group holds the same values
+  new_tile_group->GetZoneMap().Merge(orig_tile_group->GetZoneMap());
+
   // Finally, copy over the tile header
   auto header = orig_tile_group->GetHeader();
   auto new_header = new_tile_group->GetHeader();
@@ -27,6 +27,25 @@
 namespace peloton {
 namespace storage {
 
+namespace {
+
+// Types of the columns of the tile group in the order of the column map
+std::vector<common::Type::TypeId> GetColumnTypes(
+    const std::vector<catalog::Schema> &schemas,
+    const column_map_type &column_map) {
+  std::vector<common::Type::TypeId> column_types(column_map.size(),
+                                                 common::Type::INVALID);
+  for (auto &entry : column_map) {
+    if (entry.first < column_types.size()) {
+      column_types[entry.first] =
+          schemas[entry.second.first].GetType(entry.second.second);
+    }
+  }
+  return column_types;
+}
+
+}  // namespace
+
 TileGroup::TileGroup(BackendType backend_type,
                      TileGroupHeader *tile_group_header, AbstractTable *table,
                      const std::vector<catalog::Schema> &schemas,
@@ -39,7 +58,8 @@ TileGroup::TileGroup(BackendType backend_type,
       tile_group_header(tile_group_header),
       table(table),
       num_tuple_slots(tuple_count),
-      column_map(column_map) {
+      column_map(column_map),
+      zone_map(GetColumnTypes(schemas, column_map)) {
   tile_count = tile_schemas.size();
 
   for (oid_t tile_itr = 0; tile_itr < tile_count; tile_itr++) {
@@ -118,6 +138,7 @@ void TileGroup::CopyTuple(const Tuple *tuple, const oid_t &tuple_slot_id) {
          tile_column_itr++) {
       common::Value val = (tuple->GetValue(column_itr));
       tile_tuple.SetValue(tile_column_itr, val, tile->GetPool());
+      zone_map.Update(column_itr, val);
       column_itr++;
     }
   }
@@ -215,6 +236,7 @@ oid_t TileGroup::InsertTupleFromRecovery(cid_t commit_id, oid_t tuple_slot_id,
          tile_column_itr++) {
       common::Value val = (tuple->GetValue(column_itr));
       tile_tuple.SetValue(tile_column_itr, val, tile->GetPool());
+      zone_map.Update(column_itr, val);
       column_itr++;
     }
   }
@@ -315,6 +337,7 @@ oid_t TileGroup::InsertTupleFromCheckpoint(oid_t tuple_slot_id,
          tile_column_itr++) {
       common::Value val = (tuple->GetValue(column_itr));
       tile_tuple.SetValue(tile_column_itr, val, tile->GetPool());
+      zone_map.Update(column_itr, val);
       column_itr++;
     }
   }
@@ -365,6 +388,7 @@ void TileGroup::SetValue(common::Value &value, oid_t tuple_id,
   oid_t tile_column_id, tile_offset;
   LocateTileAndColumn(column_id, tile_offset, tile_column_id);
   GetTile(tile_offset)->SetValue(value, tuple_id, tile_column_id);
+  zone_map.Update(column_id, value);
 }
 
 Tile *TileGroup::GetTile(const oid_t tile_offset) const {
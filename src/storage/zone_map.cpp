@@ -0,0 +1,262 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// zone_map.cpp
+//
+// Identification: src/storage/zone_map.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/zone_map.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "common/macros.h"
+
+namespace peloton {
+namespace storage {
+
+namespace {
+
+/**
+ * @brief Get an integer or timestamp value as int64_t
+ * @return false if the value is of another type, or a timestamp past
+ * INT64_MAX, which does not compare the same as a signed integer
+ */
+bool GetInteger(const common::Value &value, int64_t &result) {
+  switch (value.GetTypeId()) {
+    case common::Type::TINYINT:
+      result = value.GetAs<int8_t>();
+      return true;
+    case common::Type::SMALLINT:
+      result = value.GetAs<int16_t>();
+      return true;
+    case common::Type::INTEGER:
+      result = value.GetAs<int32_t>();
+      return true;
+    case common::Type::BIGINT:
+      result = value.GetAs<int64_t>();
+      return true;
+    case common::Type::TIMESTAMP: {
+      auto timestamp = value.GetAs<uint64_t>();
+      if (timestamp > static_cast<uint64_t>(INT64_MAX)) return false;
+      result = static_cast<int64_t>(timestamp);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+template <typename T>
+void Widen(std::atomic<T> &min, std::atomic<T> &max, T value) {
+  T current = min.load();
+  while (value < current && !min.compare_exchange_weak(current, value)) {
+  }
+  current = max.load();
+  while (value > current && !max.compare_exchange_weak(current, value)) {
+  }
+}
+
+/** @brief Whether <x> <compare_type> <value> may be true for a x in
+ * [min, max]. An empty range (min > max) matches nothing. */
+template <typename T>
+bool MayMatchRange(ExpressionType compare_type, T min, T max, T value) {
+  if (min > max) return false;
+
+  switch (compare_type) {
+    case EXPRESSION_TYPE_COMPARE_EQUAL:
+      return min <= value && value <= max;
+    case EXPRESSION_TYPE_COMPARE_NOTEQUAL:
+      return !(min == value && max == value);
+    case EXPRESSION_TYPE_COMPARE_LESSTHAN:
+      return min < value;
+    case EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO:
+      return min <= value;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHAN:
+      return max > value;
+    case EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO:
+      return max >= value;
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+/**
+ * The bounds of a column start out empty (min > max). Integer and timestamp
+ * columns use int_min and int_max, decimal columns double_min and double_max,
+ * and the type of other columns is INVALID.
+ */
+struct ZoneMap::ColumnZone {
+  common::Type::TypeId type = common::Type::INVALID;
+
+  std::atomic<int64_t> int_min{std::numeric_limits<int64_t>::max()};
+  std::atomic<int64_t> int_max{std::numeric_limits<int64_t>::min()};
+
+  std::atomic<double> double_min{std::numeric_limits<double>::max()};
+  std::atomic<double> double_max{std::numeric_limits<double>::lowest()};
+
+  std::atomic<oid_t> null_count{0};
+
+  // Set once a value the bounds cannot represent was written
+  std::atomic<bool> unbounded{false};
+};
+
+ZoneMap::ZoneMap(const std::vector<common::Type::TypeId> &column_types)
+    : column_count_(column_types.size()),
+      zones_(new ColumnZone[column_types.size()]) {
+  for (oid_t column_itr = 0; column_itr < column_count_; column_itr++) {
+    auto type = column_types[column_itr];
+    if (common::Type::IsIntegerType(type) || type == common::Type::TIMESTAMP ||
+        type == common::Type::DECIMAL) {
+      zones_[column_itr].type = type;
+    }
+  }
+}
+
+ZoneMap::~ZoneMap() {}
+
+void ZoneMap::Update(oid_t column_id, const common::Value &value) {
+  PL_ASSERT(column_id < column_count_);
+  auto &zone = zones_[column_id];
+  if (zone.type == common::Type::INVALID) return;
+
+  if (value.IsNull()) {
+    zone.null_count++;
+    return;
+  }
+
+  auto value_type = value.GetTypeId();
+  int64_t integer;
+  if (zone.type == common::Type::DECIMAL) {
+    double decimal;
+    if (value_type == common::Type::DECIMAL) {
+      decimal = value.GetAs<double>();
+    } else if (common::Type::IsIntegerType(value_type) &&
+               GetInteger(value, integer)) {
+      decimal = static_cast<double>(integer);
+    } else {
+      zone.unbounded = true;
+      return;
+    }
+
+    if (std::isnan(decimal)) {
+      zone.unbounded = true;
+      return;
+    }
+    Widen(zone.double_min, zone.double_max, decimal);
+    return;
+  }
+
+  // Timestamp columns only hold timestamps and integer columns integers
+  bool is_timestamp = value_type == common::Type::TIMESTAMP;
+  if ((zone.type == common::Type::TIMESTAMP) != is_timestamp ||
+      !GetInteger(value, integer)) {
+    zone.unbounded = true;
+    return;
+  }
+  Widen(zone.int_min, zone.int_max, integer);
+}
+
+void ZoneMap::Merge(const ZoneMap &other) {
+  PL_ASSERT(column_count_ == other.column_count_);
+  for (oid_t column_itr = 0; column_itr < column_count_; column_itr++) {
+    auto &zone = zones_[column_itr];
+    auto &other_zone = other.zones_[column_itr];
+    PL_ASSERT(zone.type == other_zone.type);
+
+    zone.null_count += other_zone.null_count.load();
+    if (other_zone.unbounded) zone.unbounded = true;
+
+    // Widening with both ends of an empty range leaves the bounds as they are
+    auto int_min = other_zone.int_min.load();
+    auto int_max = other_zone.int_max.load();
+    if (int_min <= int_max) {
+      Widen(zone.int_min, zone.int_max, int_min);
+      Widen(zone.int_min, zone.int_max, int_max);
+    }
+    auto double_min = other_zone.double_min.load();
+    auto double_max = other_zone.double_max.load();
+    if (double_min <= double_max) {
+      Widen(zone.double_min, zone.double_max, double_min);
+      Widen(zone.double_min, zone.double_max, double_max);
+    }
+  }
+}
+
+bool ZoneMap::MayMatch(oid_t column_id, ExpressionType compare_type,
+                       const common::Value &value) const {
+  PL_ASSERT(column_id < column_count_);
+  auto &zone = zones_[column_id];
+  if (zone.type == common::Type::INVALID || zone.unbounded) return true;
+
+  // A comparison with null is never true
+  if (value.IsNull()) return false;
+
+  auto value_type = value.GetTypeId();
+  bool is_timestamp_zone = zone.type == common::Type::TIMESTAMP;
+  int64_t integer;
+
+  // Integers and decimals are compared as decimals, like the comparison
+  // operators of the types do
+  if (zone.type == common::Type::DECIMAL ||
+      value_type == common::Type::DECIMAL) {
+    if (is_timestamp_zone) return true;
+
+    double decimal;
+    if (value_type == common::Type::DECIMAL) {
+      decimal = value.GetAs<double>();
+      if (std::isnan(decimal)) return true;
+    } else if (common::Type::IsIntegerType(value_type) &&
+               GetInteger(value, integer)) {
+      decimal = static_cast<double>(integer);
+    } else {
+      return true;
+    }
+
+    if (zone.type == common::Type::DECIMAL) {
+      return MayMatchRange(compare_type, zone.double_min.load(),
+                           zone.double_max.load(), decimal);
+    }
+    return MayMatchRange(compare_type,
+                         static_cast<double>(zone.int_min.load()),
+                         static_cast<double>(zone.int_max.load()), decimal);
+  }
+
+  if (is_timestamp_zone != (value_type == common::Type::TIMESTAMP) ||
+      !GetInteger(value, integer)) {
+    return true;
+  }
+  return MayMatchRange(compare_type, zone.int_min.load(), zone.int_max.load(),
+                       integer);
+}
+
+oid_t ZoneMap::GetNullCount(oid_t column_id) const {
+  PL_ASSERT(column_id < column_count_);
+  return zones_[column_id].null_count;
+}
+
+bool ZoneMap::GetIntegerBounds(oid_t column_id, int64_t &min,
+                               int64_t &max) const {
+  PL_ASSERT(column_id < column_count_);
+  auto &zone = zones_[column_id];
+  if ((!common::Type::IsIntegerType(zone.type) &&
+       zone.type != common::Type::TIMESTAMP) ||
+      zone.unbounded) {
+    return false;
+  }
+
+  min = zone.int_min.load();
+  max = zone.int_max.load();
+  return min <= max;
+}
+
+}  // End storage namespace
+}  // End peloton namespace
@@ -15,7 +15,9 @@
 #include <stdlib.h>
 #include <cassert>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <memory>
 
 namespace peloton {
 namespace util {
@@ -301,5 +303,334 @@ std::pair<sort_ele_type *, sort_ele_type *>
   return merge(a, b, len);
 }
 
+//===--------------------------------------------------------------------===//
+// 64-bit keys with a separate payload array
+//===--------------------------------------------------------------------===//
+
+// _mm256_cmpgt_epi64 is a signed compare, flipping the sign bits of both
+// sides turns it into an unsigned one
+inline __m256i cmpgt_epu64(const __m256i& a, const __m256i& b) {
+  const __m256i sign = _mm256_set1_epi64x(0x8000000000000000LL);
+  return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign),
+                            _mm256_xor_si256(b, sign));
+}
+
+// a (pa) gets the smaller keys (their payloads), b (pb) the larger ones
+inline void minmax64(__m256i& a, __m256i& b, __m256i& pa, __m256i& pb) {
+  auto swap = cmpgt_epu64(a, b);
+  auto t = a;
+  a = _mm256_blendv_epi8(a, b, swap);
+  b = _mm256_blendv_epi8(b, t, swap);
+  auto pt = pa;
+  pa = _mm256_blendv_epi8(pa, pb, swap);
+  pb = _mm256_blendv_epi8(pb, pt, swap);
+}
+
+inline void transpose4x64(__m256i& row0, __m256i& row1,
+                          __m256i& row2, __m256i& row3) {
+  auto t0 = _mm256_unpacklo_epi64(row0, row1);
+  auto t1 = _mm256_unpackhi_epi64(row0, row1);
+  auto t2 = _mm256_unpacklo_epi64(row2, row3);
+  auto t3 = _mm256_unpackhi_epi64(row2, row3);
+  row0 = _mm256_permute2x128_si256(t0, t2, 0x20);
+  row1 = _mm256_permute2x128_si256(t1, t3, 0x20);
+  row2 = _mm256_permute2x128_si256(t0, t2, 0x31);
+  row3 = _mm256_permute2x128_si256(t1, t3, 0x31);
+}
+
+// sort 16 keys into 4 registers holding a sorted run of 4 keys each
+inline void sort16_64(__m256i* row, __m256i* prow) {
+  minmax64(row[0], row[1], prow[0], prow[1]);
+  minmax64(row[2], row[3], prow[2], prow[3]);
+
+  minmax64(row[0], row[2], prow[0], prow[2]);
+  minmax64(row[1], row[3], prow[1], prow[3]);
+
+  minmax64(row[1], row[2], prow[1], prow[2]);
+
+  transpose4x64(row[0], row[1], row[2], row[3]);
+  transpose4x64(prow[0], prow[1], prow[2], prow[3]);
+}
+
+// One step of the in-register bitonic merge: every lane is compared with
+// the lane picked by shuffle_imm; the lanes in lower_mask (a 32-bit blend
+// mask) keep the smaller key and the others keep the larger one.
+// The swap decision of a lane is mirrored to its partner, so equal keys
+// never duplicate or drop a payload.
+template <int shuffle_imm, int lower_mask>
+inline void intra_register_step64(__m256i& a, __m256i& pa) {
+  auto a_1 = _mm256_permute4x64_epi64(a, shuffle_imm);
+  auto pa_1 = _mm256_permute4x64_epi64(pa, shuffle_imm);
+  auto greater = cmpgt_epu64(a, a_1);
+  auto swap = _mm256_blend_epi32(
+      _mm256_permute4x64_epi64(greater, shuffle_imm), greater, lower_mask);
+  a = _mm256_blendv_epi8(a, a_1, swap);
+  pa = _mm256_blendv_epi8(pa, pa_1, swap);
+}
+
+inline void bitonic_merge64(__m256i& a, __m256i& b,
+                            __m256i& pa, __m256i& pb) {
+  // phase 1 - 4 against 4
+  b = _mm256_permute4x64_epi64(b, 0x1b);
+  pb = _mm256_permute4x64_epi64(pb, 0x1b);
+  minmax64(a, b, pa, pb);
+  // phase 2 - lanes 2 apart
+  intra_register_step64<0x4e, 0x0f>(a, pa);
+  intra_register_step64<0x4e, 0x0f>(b, pb);
+  // phase 3 - adjacent lanes
+  intra_register_step64<0xb1, 0x33>(a, pa);
+  intra_register_step64<0xb1, 0x33>(b, pb);
+}
+
+// merge the sorted runs [start, mid) and [mid, end) into out
+void merge_phase64(sort_key64_type *keys, sort_payload_type *payloads,
+                   sort_key64_type *out_keys, sort_payload_type *out_payloads,
+                   size_t start, size_t mid, size_t end) {
+  size_t i = start, j = mid, k = start;
+
+  auto ra = load_reg256(&keys[i]);
+  auto pa = load_reg256(&payloads[i]);
+  auto rb = load_reg256(&keys[j]);
+  auto pb = load_reg256(&payloads[j]);
+  i += SIMD_SIZE64;
+  j += SIMD_SIZE64;
+
+  while (true) {
+    bitonic_merge64(ra, rb, pa, pb);
+
+    // save the smaller half
+    store_reg256(&out_keys[k], ra);
+    store_reg256(&out_payloads[k], pa);
+    k += SIMD_SIZE64;
+
+    // use the larger half for the next comparison
+    ra = rb;
+    pa = pb;
+
+    if (i == mid && j == end) break;
+
+    // select the input with the lowest value at the current pointer
+    if (j == end || (i < mid && keys[i] < keys[j])) {
+      rb = load_reg256(&keys[i]);
+      pb = load_reg256(&payloads[i]);
+      i += SIMD_SIZE64;
+    } else {
+      rb = load_reg256(&keys[j]);
+      pb = load_reg256(&payloads[j]);
+      j += SIMD_SIZE64;
+    }
+  }
+
+  // store the final batch
+  store_reg256(&out_keys[k], ra);
+  store_reg256(&out_payloads[k], pa);
+}
+
+inline void merge_pass64(sort_key64_type *keys, sort_payload_type *payloads,
+                         sort_key64_type *out_keys,
+                         sort_payload_type *out_payloads, size_t len,
+                         size_t merge_size) {
+  for (size_t i = 0; i < len; i += 2 * merge_size) {
+    auto mid = std::min(i + merge_size, len);
+    auto end = std::min(i + 2 * merge_size, len);
+    // check if there are 2 sub-arrays to merge
+    if (mid < end) {
+      merge_phase64(keys, payloads, out_keys, out_payloads, i, mid, end);
+    } else {
+      // copy the leftover data to output
+      std::memcpy(out_keys + i, keys + i, (len - i) * sizeof(sort_key64_type));
+      std::memcpy(out_payloads + i, payloads + i,
+                  (len - i) * sizeof(sort_payload_type));
+    }
+  }
+}
+
+sort64_result_type simd_merge_sort64_avx2(sort_key64_type *keys,
+                                          sort_payload_type *payloads,
+                                          sort_key64_type *temp_keys,
+                                          sort_payload_type *temp_payloads,
+                                          size_t len) {
+  __m256i rows[SORT_BLOCK64 / SIMD_SIZE64], prows[SORT_BLOCK64 / SIMD_SIZE64];
+
+  assert(len % SORT_BLOCK64 == 0);
+
+  for (size_t i = 0; i < len; i += SORT_BLOCK64) {
+    for (int j = 0; j < SORT_BLOCK64 / SIMD_SIZE64; j++) {
+      rows[j] = load_reg256(&keys[i + j * SIMD_SIZE64]);
+      prows[j] = load_reg256(&payloads[i + j * SIMD_SIZE64]);
+    }
+    sort16_64(rows, prows);
+    for (int j = 0; j < SORT_BLOCK64 / SIMD_SIZE64; j++) {
+      store_reg256(&keys[i + j * SIMD_SIZE64], rows[j]);
+      store_reg256(&payloads[i + j * SIMD_SIZE64], prows[j]);
+    }
+  }
+
+  /*
+   * even iterations: keys->temp_keys
+   * odd iterations: temp_keys->keys
+   */
+  int i = 0;
+  for (size_t pass_size = SIMD_SIZE64; pass_size < len; pass_size *= 2, i++) {
+    if (i % 2 == 0) {
+      merge_pass64(keys, payloads, temp_keys, temp_payloads, len, pass_size);
+    } else {
+      merge_pass64(temp_keys, temp_payloads, keys, payloads, len, pass_size);
+    }
+  }
+
+  if (i % 2 == 0) return std::make_pair(keys, payloads);
+  return std::make_pair(temp_keys, temp_payloads);
+}
+
+//===--------------------------------------------------------------------===//
+// Scalar fallback and kernel dispatch
+//===--------------------------------------------------------------------===//
+
+void merge_phase64_scalar(sort_key64_type *keys, sort_payload_type *payloads,
+                          sort_key64_type *out_keys,
+                          sort_payload_type *out_payloads, size_t start,
+                          size_t mid, size_t end) {
+  size_t i = start, j = mid, k = start;
+  while (i < mid && j < end) {
+    if (keys[j] < keys[i]) {
+      out_keys[k] = keys[j];
+      out_payloads[k++] = payloads[j++];
+    } else {
+      out_keys[k] = keys[i];
+      out_payloads[k++] = payloads[i++];
+    }
+  }
+  for (; i < mid; i++, k++) {
+    out_keys[k] = keys[i];
+    out_payloads[k] = payloads[i];
+  }
+  for (; j < end; j++, k++) {
+    out_keys[k] = keys[j];
+    out_payloads[k] = payloads[j];
+  }
+}
+
+sort64_result_type merge_sort64_scalar(sort_key64_type *keys,
+                                       sort_payload_type *payloads,
+                                       sort_key64_type *temp_keys,
+                                       sort_payload_type *temp_payloads,
+                                       size_t len) {
+  /*
+   * even iterations: keys->temp_keys
+   * odd iterations: temp_keys->keys
+   */
+  int i = 0;
+  for (size_t pass_size = 1; pass_size < len; pass_size *= 2, i++) {
+    auto in_keys = (i % 2 == 0) ? keys : temp_keys;
+    auto in_payloads = (i % 2 == 0) ? payloads : temp_payloads;
+    auto out_keys = (i % 2 == 0) ? temp_keys : keys;
+    auto out_payloads = (i % 2 == 0) ? temp_payloads : payloads;
+    for (size_t start = 0; start < len; start += 2 * pass_size) {
+      auto mid = std::min(start + pass_size, len);
+      auto end = std::min(start + 2 * pass_size, len);
+      merge_phase64_scalar(in_keys, in_payloads, out_keys, out_payloads,
+                           start, mid, end);
+    }
+  }
+
+  if (i % 2 == 0) return std::make_pair(keys, payloads);
+  return std::make_pair(temp_keys, temp_payloads);
+}
+
+// cpuid (through the compiler builtins, which also check that the OS saves
+// the wider registers) tells the widest kernel that this host can run
+SimdSortKernel DetectSimdSortKernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SIMD_SORT_KERNEL_AVX512;
+  if (__builtin_cpu_supports("avx2")) return SIMD_SORT_KERNEL_AVX2;
+  return SIMD_SORT_KERNEL_SCALAR;
+}
+
+const SimdSortKernel supported_simd_sort_kernel = DetectSimdSortKernel();
+
+// read by the sort workers of every parallel sort while a benchmark or test
+// may switch the kernel
+std::atomic<SimdSortKernel> simd_sort_kernel(supported_simd_sort_kernel);
+
+SimdSortKernel GetSimdSortKernel() {
+  return simd_sort_kernel.load(std::memory_order_relaxed);
+}
+
+bool SetSimdSortKernel(SimdSortKernel kernel) {
+  if (kernel > supported_simd_sort_kernel) return false;
+  simd_sort_kernel.store(kernel, std::memory_order_relaxed);
+  return true;
+}
+
+sort64_result_type simd_merge_sort64(sort_key64_type *keys,
+                                     sort_payload_type *payloads,
+                                     sort_key64_type *temp_keys,
+                                     sort_payload_type *temp_payloads,
+                                     size_t len) {
+  assert(len % SORT_SIZE64 == 0);
+
+  switch (GetSimdSortKernel()) {
+    case SIMD_SORT_KERNEL_AVX512:
+      return simd_merge_sort64_avx512(keys, payloads, temp_keys,
+                                      temp_payloads, len);
+    case SIMD_SORT_KERNEL_AVX2:
+      return simd_merge_sort64_avx2(keys, payloads, temp_keys, temp_payloads,
+                                    len);
+    default:
+      return merge_sort64_scalar(keys, payloads, temp_keys, temp_payloads,
+                                 len);
+  }
+}
+
+namespace {
+
+// Key of the padding, sorted behind all the valid keys
+const sort_key64_type SORT_PAD_KEY64 = UINT64_MAX;
+
+template <typename T>
+std::unique_ptr<T, decltype(&free)> allocate_sort_array(size_t count) {
+  T *array;
+  if (posix_memalign((void **)&array, 32, count * sizeof(T)) != 0) {
+    throw std::bad_alloc();
+  }
+  return std::unique_ptr<T, decltype(&free)>(array, &free);
+}
+
+}  // namespace
+
+void simd_sort_pairs64(sort_key64_type *keys, sort_payload_type *payloads,
+                       size_t count) {
+  if (count == 0) return;
+
+  // The kernels sort whole blocks, the padding is sorted last
+  size_t padded_count = (count + SORT_SIZE64 - 1) / SORT_SIZE64 * SORT_SIZE64;
+  auto padded_keys = allocate_sort_array<sort_key64_type>(padded_count);
+  auto padded_payloads = allocate_sort_array<sort_payload_type>(padded_count);
+  auto temp_keys = allocate_sort_array<sort_key64_type>(padded_count);
+  auto temp_payloads = allocate_sort_array<sort_payload_type>(padded_count);
+
+  std::copy(keys, keys + count, padded_keys.get());
+  std::copy(payloads, payloads + count, padded_payloads.get());
+  std::fill(padded_keys.get() + count, padded_keys.get() + padded_count,
+            SORT_PAD_KEY64);
+  std::fill(padded_payloads.get() + count,
+            padded_payloads.get() + padded_count, SORT_PAD_PAYLOAD64);
+
+  auto result =
+      simd_merge_sort64(padded_keys.get(), padded_payloads.get(),
+                        temp_keys.get(), temp_payloads.get(), padded_count);
+
+  // Valid keys may be equal to the padding key, so the padding is skipped by
+  // its payload
+  size_t sorted_count = 0;
+  for (size_t entry_itr = 0; entry_itr < padded_count; entry_itr++) {
+    if (result.second[entry_itr] == SORT_PAD_PAYLOAD64) continue;
+    keys[sorted_count] = result.first[entry_itr];
+    payloads[sorted_count++] = result.second[entry_itr];
+  }
+  assert(sorted_count == count);
+}
+
 }  // namespace util
-}  // namespace peloton
\ No newline at end of file
+}  // namespace peloton
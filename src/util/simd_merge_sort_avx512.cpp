@@ -0,0 +1,252 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// simd_merge_sort_avx512.cpp
+//
+// Identification: src/util/simd_merge_sort_avx512.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/simd_merge_sort.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// Only the functions in this file are compiled for AVX-512, so the rest of
+// the binary still runs on hosts without it. simd_merge_sort64 calls them
+// only after cpuid reported AVX-512F.
+#define AVX512_TARGET __attribute__((target("avx512f")))
+
+namespace peloton {
+namespace util {
+
+AVX512_TARGET
+inline __m512i load_reg512(const uint64_t *a) {
+  return _mm512_loadu_si512(a);
+}
+
+AVX512_TARGET
+inline void store_reg512(uint64_t *a, const __m512i& b) {
+  _mm512_storeu_si512(a, b);
+}
+
+// a (pa) gets the smaller keys (their payloads), b (pb) the larger ones
+AVX512_TARGET
+inline void minmax512(__m512i& a, __m512i& b, __m512i& pa, __m512i& pb) {
+  __mmask8 swap = _mm512_cmpgt_epu64_mask(a, b);
+  auto t = a;
+  a = _mm512_mask_blend_epi64(swap, a, b);
+  b = _mm512_mask_blend_epi64(swap, b, t);
+  auto pt = pa;
+  pa = _mm512_mask_blend_epi64(swap, pa, pb);
+  pb = _mm512_mask_blend_epi64(swap, pb, pt);
+}
+
+AVX512_TARGET
+inline void transpose8x64(__m512i* row) {
+  __m512i t[8], u[8];
+  for (int i = 0; i < 8; i += 2) {
+    t[i] = _mm512_unpacklo_epi64(row[i], row[i + 1]);
+    t[i + 1] = _mm512_unpackhi_epi64(row[i], row[i + 1]);
+  }
+  // t[0]: r0[0] r1[0] | r0[2] r1[2] | r0[4] r1[4] | r0[6] r1[6]
+  // t[1]: r0[1] r1[1] | r0[3] r1[3] | r0[5] r1[5] | r0[7] r1[7]
+  u[0] = _mm512_shuffle_i64x2(t[0], t[2], 0x88);
+  u[1] = _mm512_shuffle_i64x2(t[1], t[3], 0x88);
+  u[2] = _mm512_shuffle_i64x2(t[0], t[2], 0xdd);
+  u[3] = _mm512_shuffle_i64x2(t[1], t[3], 0xdd);
+  u[4] = _mm512_shuffle_i64x2(t[4], t[6], 0x88);
+  u[5] = _mm512_shuffle_i64x2(t[5], t[7], 0x88);
+  u[6] = _mm512_shuffle_i64x2(t[4], t[6], 0xdd);
+  u[7] = _mm512_shuffle_i64x2(t[5], t[7], 0xdd);
+  // u[0]: r0[0] r1[0] | r0[4] r1[4] | r2[0] r3[0] | r2[4] r3[4]
+  for (int i = 0; i < 4; i++) {
+    row[i] = _mm512_shuffle_i64x2(u[i], u[i + 4], 0x88);
+    row[i + 4] = _mm512_shuffle_i64x2(u[i], u[i + 4], 0xdd);
+  }
+}
+
+// sort 64 keys into 8 registers holding a sorted run of 8 keys each
+AVX512_TARGET
+inline void sort64_512(__m512i* row, __m512i* prow) {
+  minmax512(row[0], row[1], prow[0], prow[1]);
+  minmax512(row[2], row[3], prow[2], prow[3]);
+  minmax512(row[4], row[5], prow[4], prow[5]);
+  minmax512(row[6], row[7], prow[6], prow[7]);
+
+  minmax512(row[0], row[2], prow[0], prow[2]);
+  minmax512(row[1], row[3], prow[1], prow[3]);
+  minmax512(row[4], row[6], prow[4], prow[6]);
+  minmax512(row[5], row[7], prow[5], prow[7]);
+
+  minmax512(row[1], row[2], prow[1], prow[2]);
+  minmax512(row[0], row[4], prow[0], prow[4]);
+  minmax512(row[5], row[6], prow[5], prow[6]);
+  minmax512(row[3], row[7], prow[3], prow[7]);
+
+  minmax512(row[1], row[5], prow[1], prow[5]);
+  minmax512(row[2], row[6], prow[2], prow[6]);
+
+  minmax512(row[1], row[4], prow[1], prow[4]);
+  minmax512(row[3], row[6], prow[3], prow[6]);
+
+  minmax512(row[2], row[4], prow[2], prow[4]);
+  minmax512(row[3], row[5], prow[3], prow[5]);
+
+  minmax512(row[3], row[4], prow[3], prow[4]);
+
+  transpose8x64(row);
+  transpose8x64(prow);
+}
+
+// One step of the in-register bitonic merge: every lane is compared with the
+// lane distance lanes away; the lanes in lower_mask keep the smaller key and
+// their partners keep the larger one.
+// The swap decision of a lower lane is mirrored to its partner, so equal
+// keys never duplicate or drop a payload.
+template <int distance, int lower_mask>
+AVX512_TARGET
+inline void intra_register_step512(__m512i& a, __m512i& pa,
+                                   const __m512i& partner_idx) {
+  auto a_1 = _mm512_permutexvar_epi64(partner_idx, a);
+  auto pa_1 = _mm512_permutexvar_epi64(partner_idx, pa);
+  unsigned int greater = _mm512_cmpgt_epu64_mask(a, a_1) & lower_mask;
+  __mmask8 swap = static_cast<__mmask8>(greater | (greater << distance));
+  a = _mm512_mask_blend_epi64(swap, a, a_1);
+  pa = _mm512_mask_blend_epi64(swap, pa, pa_1);
+}
+
+AVX512_TARGET
+inline void bitonic_merge512(__m512i& a, __m512i& b, __m512i& pa,
+                             __m512i& pb) {
+  const __m512i reverse_idx = _mm512_set_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m512i swap_4_idx = _mm512_set_epi64(3, 2, 1, 0, 7, 6, 5, 4);
+  const __m512i swap_2_idx = _mm512_set_epi64(5, 4, 7, 6, 1, 0, 3, 2);
+  const __m512i swap_1_idx = _mm512_set_epi64(6, 7, 4, 5, 2, 3, 0, 1);
+
+  // phase 1 - 8 against 8
+  b = _mm512_permutexvar_epi64(reverse_idx, b);
+  pb = _mm512_permutexvar_epi64(reverse_idx, pb);
+  minmax512(a, b, pa, pb);
+  // phase 2 - lanes 4 apart
+  intra_register_step512<4, 0x0f>(a, pa, swap_4_idx);
+  intra_register_step512<4, 0x0f>(b, pb, swap_4_idx);
+  // phase 3 - lanes 2 apart
+  intra_register_step512<2, 0x33>(a, pa, swap_2_idx);
+  intra_register_step512<2, 0x33>(b, pb, swap_2_idx);
+  // phase 4 - adjacent lanes
+  intra_register_step512<1, 0x55>(a, pa, swap_1_idx);
+  intra_register_step512<1, 0x55>(b, pb, swap_1_idx);
+}
+
+// merge the sorted runs [start, mid) and [mid, end) into out
+AVX512_TARGET
+void merge_phase512(sort_key64_type *keys, sort_payload_type *payloads,
+                    sort_key64_type *out_keys, sort_payload_type *out_payloads,
+                    size_t start, size_t mid, size_t end) {
+  size_t i = start, j = mid, k = start;
+
+  auto ra = load_reg512(&keys[i]);
+  auto pa = load_reg512(&payloads[i]);
+  auto rb = load_reg512(&keys[j]);
+  auto pb = load_reg512(&payloads[j]);
+  i += SIMD_SIZE64_AVX512;
+  j += SIMD_SIZE64_AVX512;
+
+  while (true) {
+    bitonic_merge512(ra, rb, pa, pb);
+
+    // save the smaller half
+    store_reg512(&out_keys[k], ra);
+    store_reg512(&out_payloads[k], pa);
+    k += SIMD_SIZE64_AVX512;
+
+    // use the larger half for the next comparison
+    ra = rb;
+    pa = pb;
+
+    if (i == mid && j == end) break;
+
+    // select the input with the lowest value at the current pointer
+    if (j == end || (i < mid && keys[i] < keys[j])) {
+      rb = load_reg512(&keys[i]);
+      pb = load_reg512(&payloads[i]);
+      i += SIMD_SIZE64_AVX512;
+    } else {
+      rb = load_reg512(&keys[j]);
+      pb = load_reg512(&payloads[j]);
+      j += SIMD_SIZE64_AVX512;
+    }
+  }
+
+  // store the final batch
+  store_reg512(&out_keys[k], ra);
+  store_reg512(&out_payloads[k], pa);
+}
+
+AVX512_TARGET
+inline void merge_pass512(sort_key64_type *keys, sort_payload_type *payloads,
+                          sort_key64_type *out_keys,
+                          sort_payload_type *out_payloads, size_t len,
+                          size_t merge_size) {
+  for (size_t i = 0; i < len; i += 2 * merge_size) {
+    auto mid = std::min(i + merge_size, len);
+    auto end = std::min(i + 2 * merge_size, len);
+    // check if there are 2 sub-arrays to merge
+    if (mid < end) {
+      merge_phase512(keys, payloads, out_keys, out_payloads, i, mid, end);
+    } else {
+      // copy the leftover data to output
+      std::memcpy(out_keys + i, keys + i, (len - i) * sizeof(sort_key64_type));
+      std::memcpy(out_payloads + i, payloads + i,
+                  (len - i) * sizeof(sort_payload_type));
+    }
+  }
+}
+
+AVX512_TARGET
+sort64_result_type simd_merge_sort64_avx512(sort_key64_type *keys,
+                                            sort_payload_type *payloads,
+                                            sort_key64_type *temp_keys,
+                                            sort_payload_type *temp_payloads,
+                                            size_t len) {
+  __m512i rows[SORT_BLOCK64_AVX512 / SIMD_SIZE64_AVX512];
+  __m512i prows[SORT_BLOCK64_AVX512 / SIMD_SIZE64_AVX512];
+
+  assert(len % SORT_BLOCK64_AVX512 == 0);
+
+  for (size_t i = 0; i < len; i += SORT_BLOCK64_AVX512) {
+    for (int j = 0; j < SORT_BLOCK64_AVX512 / SIMD_SIZE64_AVX512; j++) {
+      rows[j] = load_reg512(&keys[i + j * SIMD_SIZE64_AVX512]);
+      prows[j] = load_reg512(&payloads[i + j * SIMD_SIZE64_AVX512]);
+    }
+    sort64_512(rows, prows);
+    for (int j = 0; j < SORT_BLOCK64_AVX512 / SIMD_SIZE64_AVX512; j++) {
+      store_reg512(&keys[i + j * SIMD_SIZE64_AVX512], rows[j]);
+      store_reg512(&payloads[i + j * SIMD_SIZE64_AVX512], prows[j]);
+    }
+  }
+
+  /*
+   * even iterations: keys->temp_keys
+   * odd iterations: temp_keys->keys
+   */
+  int i = 0;
+  for (size_t pass_size = SIMD_SIZE64_AVX512; pass_size < len;
+       pass_size *= 2, i++) {
+    if (i % 2 == 0) {
+      merge_pass512(keys, payloads, temp_keys, temp_payloads, len, pass_size);
+    } else {
+      merge_pass512(temp_keys, temp_payloads, keys, payloads, len, pass_size);
+    }
+  }
+
+  if (i % 2 == 0) return std::make_pair(keys, payloads);
+  return std::make_pair(temp_keys, temp_payloads);
+}
+
+}  // namespace util
+}  // namespace peloton
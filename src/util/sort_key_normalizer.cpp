@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// sort_key_normalizer.cpp
+//
+// Identification: src/util/sort_key_normalizer.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/sort_key_normalizer.h"
+
+#include <algorithm>
+
+#include "common/exception.h"
+#include "common/macros.h"
+
+namespace peloton {
+namespace util {
+
+SortKeyNormalizer::SortKeyNormalizer(
+    const std::vector<common::Type::TypeId> &column_types,
+    const std::vector<bool> &descend_flags)
+    : column_types_(column_types),
+      descend_flags_(descend_flags),
+      first_inexact_column_(column_types.size()) {
+  PL_ASSERT(column_types.size() == descend_flags.size());
+
+  size_t used_bits = 0;
+  for (size_t column_itr = 0; column_itr < column_types_.size();
+       column_itr++) {
+    auto bits = GetColumnBits(column_types_[column_itr]);
+    if (bits == 0) {
+      throw Exception("Sort key type can not be normalized :: " +
+                      TypeIdToString(column_types_[column_itr]));
+    }
+
+    auto prefix_bits = std::min(bits, 64 - used_bits);
+    if (prefix_bits < bits && first_inexact_column_ == column_types_.size()) {
+      first_inexact_column_ = column_itr;
+    }
+    column_bits_.push_back(bits);
+    prefix_bits_.push_back(prefix_bits);
+    used_bits += prefix_bits;
+  }
+}
+
+size_t SortKeyNormalizer::GetColumnBits(common::Type::TypeId type_id) {
+  switch (type_id) {
+    case common::Type::TINYINT:
+      return 8;
+    case common::Type::SMALLINT:
+      return 16;
+    case common::Type::INTEGER:
+      return 32;
+    case common::Type::BIGINT:
+    case common::Type::TIMESTAMP:
+      return 64;
+    default:
+      return 0;
+  }
+}
+
+bool SortKeyNormalizer::CanNormalize(
+    const std::vector<common::Type::TypeId> &types) {
+  if (types.empty()) return false;
+  for (auto type_id : types) {
+    if (GetColumnBits(type_id) == 0) return false;
+  }
+  return true;
+}
+
+sort_key64_type SortKeyNormalizer::EncodeColumn(
+    size_t column_itr, const common::Value &value) const {
+  sort_key64_type key;
+  switch (column_types_[column_itr]) {
+    case common::Type::TINYINT:
+      key = static_cast<uint8_t>(value.GetAs<int8_t>()) ^ 0x80u;
+      break;
+    case common::Type::SMALLINT:
+      key = static_cast<uint16_t>(value.GetAs<int16_t>()) ^ 0x8000u;
+      break;
+    case common::Type::INTEGER:
+      key = static_cast<uint32_t>(value.GetAs<int32_t>()) ^ 0x80000000u;
+      break;
+    case common::Type::BIGINT:
+      key = static_cast<uint64_t>(value.GetAs<int64_t>()) ^ (1ull << 63);
+      break;
+    case common::Type::TIMESTAMP:
+      // Null is stored as the largest timestamp, but sorts before all others
+      key = value.IsNull() ? 0 : value.GetAs<uint64_t>() + 1;
+      break;
+    default:
+      throw Exception("Sort key type can not be normalized :: " +
+                      TypeIdToString(column_types_[column_itr]));
+  }
+
+  if (descend_flags_[column_itr]) {
+    auto bits = column_bits_[column_itr];
+    key = ~key & (bits == 64 ? UINT64_MAX : (1ull << bits) - 1);
+  }
+  return key;
+}
+
+}  // namespace util
+}  // namespace peloton
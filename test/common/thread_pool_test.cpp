@@ -74,5 +74,61 @@ TEST_F(ThreadPoolTests, BasicTest) {
   thread_pool.Shutdown();
 }
 
+TEST_F(ThreadPoolTests, ExecuteTasksTest) {
+  ThreadPool thread_pool;
+  thread_pool.Initialize(2, 0);
+
+  std::vector<int> results(16, 0);
+  std::vector<std::function<void()>> tasks;
+  for (size_t task_itr = 0; task_itr < results.size(); task_itr++) {
+    tasks.push_back([&results, task_itr] { results[task_itr] = task_itr * 2; });
+  }
+
+  // Blocks until every task has finished
+  thread_pool.ExecuteTasks(tasks);
+
+  for (size_t task_itr = 0; task_itr < results.size(); task_itr++) {
+    EXPECT_EQ(static_cast<int>(task_itr * 2), results[task_itr]);
+  }
+
+  // A failing task is reported to the caller
+  tasks.push_back([] { throw std::runtime_error("task failed"); });
+  tasks.push_back([] {});
+  EXPECT_THROW(thread_pool.ExecuteTasks(tasks), std::runtime_error);
+
+  thread_pool.Shutdown();
+
+  // Without worker threads the calling thread runs all the tasks
+  int counter = 0;
+  tasks.push_back([&counter] { counter++; });
+  tasks.push_back([&counter] { counter++; });
+  thread_pool.ExecuteTasks(tasks);
+  EXPECT_EQ(2, counter);
+}
+
+TEST_F(ThreadPoolTests, NestedExecuteTasksTest) {
+  ThreadPool thread_pool;
+  thread_pool.Initialize(2, 0);
+  EXPECT_LE(1, thread_pool.GetNodeCount());
+
+  // Tasks that run batches of their own, more of them than there are
+  // workers, finish because waiting threads run the queued tasks
+  std::atomic<int> sum(0);
+  std::vector<std::function<void()>> tasks;
+  for (int outer_itr = 0; outer_itr < 8; outer_itr++) {
+    tasks.push_back([&thread_pool, &sum] {
+      std::vector<std::function<void()>> inner_tasks;
+      for (int inner_itr = 1; inner_itr <= 4; inner_itr++) {
+        inner_tasks.push_back([&sum, inner_itr] { sum += inner_itr; });
+      }
+      thread_pool.ExecuteTasks(inner_tasks);
+    });
+  }
+  thread_pool.ExecuteTasks(tasks);
+  EXPECT_EQ(8 * 10, sum.load());
+
+  thread_pool.Shutdown();
+}
+
 }  // End test namespace
 }  // End peloton namespace
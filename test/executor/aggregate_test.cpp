@@ -18,9 +18,11 @@
 #include "common/harness.h"
 
 #include "common/types.h"
+#include "common/value_factory.h"
 #include "common/value.h"
 #include "concurrency/transaction_manager_factory.h"
 #include "executor/aggregate_executor.h"
+#include "executor/aggregator.h"
 #include "executor/executor_context.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
@@ -28,6 +30,8 @@
 #include "planner/abstract_plan.h"
 #include "planner/aggregate_plan.h"
 #include "storage/data_table.h"
+#include "storage/table_factory.h"
+#include "storage/tile_group.h"
 
 #include "executor/executor_tests_util.h"
 #include "executor/mock_executor.h"
@@ -38,7 +42,19 @@ using ::testing::Return;
 namespace peloton {
 namespace test {
 
-class AggregateTests : public PelotonTest {};
+class AggregateTests : public PelotonTest {
+ protected:
+  // Run the parallel aggregation phases on worker threads
+  virtual void SetUp() {
+    PelotonTest::SetUp();
+    thread_pool.Initialize(4, 0);
+  }
+
+  virtual void TearDown() {
+    thread_pool.Shutdown();
+    PelotonTest::TearDown();
+  }
+};
 
 TEST_F(AggregateTests, SortedDistinctTest) {
   // SELECT d, a, b, c FROM table GROUP BY a, b, c, d;
@@ -750,6 +766,348 @@ TEST_F(AggregateTests, HashCountDistinctGroupByTest) {
   EXPECT_TRUE(cmp.IsTrue());
 }
 
+namespace {
+
+/** Add the rows of a tile, as strings */
+void AddTileRows(executor::LogicalTile *tile,
+                 std::multiset<std::string> &rows) {
+  for (oid_t tuple_id : *tile) {
+    std::string row;
+    for (oid_t col = 0; col < tile->GetColumnCount(); col++) {
+      row += tile->GetValue(tuple_id, col).ToString() + "|";
+    }
+    rows.insert(row);
+  }
+}
+
+/** The rows of the output table of an aggregator, as strings */
+std::multiset<std::string> GetAggregateRows(storage::DataTable *table) {
+  std::multiset<std::string> rows;
+  for (oid_t tile_group_itr = 0; tile_group_itr < table->GetTileGroupCount();
+       tile_group_itr++) {
+    std::unique_ptr<executor::LogicalTile> tile(
+        executor::LogicalTileFactory::WrapTileGroup(
+            table->GetTileGroup(tile_group_itr)));
+    AddTileRows(tile.get(), rows);
+  }
+  return rows;
+}
+
+/** The rows of an aggregate executor over all tile groups of a table */
+std::multiset<std::string> GetExecutorRows(const planner::AggregatePlan &node,
+                                           storage::DataTable *data_table,
+                                           size_t thread_count,
+                                           bool sort_aggregation = false) {
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(txn));
+
+  executor::AggregateExecutor executor(&node, context.get());
+  executor.UseParallelAggregation(thread_count);
+  executor.UseSortAggregation(sort_aggregation);
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+  auto &execute_call = EXPECT_CALL(child_executor, DExecute());
+  auto &output_call = EXPECT_CALL(child_executor, GetOutput());
+  for (oid_t tile_group_itr = 0;
+       tile_group_itr < data_table->GetTileGroupCount(); tile_group_itr++) {
+    execute_call.WillOnce(Return(true));
+    output_call.WillOnce(Return(executor::LogicalTileFactory::WrapTileGroup(
+        data_table->GetTileGroup(tile_group_itr))));
+  }
+  execute_call.WillOnce(Return(false));
+
+  EXPECT_TRUE(executor.Init());
+  std::multiset<std::string> rows;
+  while (executor.Execute()) {
+    std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+    AddTileRows(result_tile.get(), rows);
+  }
+
+  txn_manager.CommitTransaction(txn);
+  return rows;
+}
+
+}  // namespace
+
+TEST_F(AggregateTests, FlatHashGroupByTest) {
+  // SELECT b, COUNT(*), COUNT(a), SUM(a), MIN(c), MAX(a), AVG(a), SUM(c)
+  // from table GROUP BY b;
+  const int tuple_count = 1000;
+  const int tile_group_count = 4;
+
+  auto& txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tuple_count, false));
+  // Random values of b, so that groups have several rows
+  ExecutorTestsUtil::PopulateTable(data_table.get(),
+                                   tile_group_count * tuple_count, false, true,
+                                   false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::vector<oid_t> group_by_columns = {1};
+
+  DirectMapList direct_map_list = {{0, {0, 1}}, {1, {1, 0}}, {2, {1, 1}},
+                                   {3, {1, 2}}, {4, {1, 3}}, {5, {1, 4}},
+                                   {6, {1, 5}}, {7, {1, 6}}};
+  std::unique_ptr<const planner::ProjectInfo> proj_info(
+      new planner::ProjectInfo(TargetList(), std::move(direct_map_list)));
+
+  std::vector<planner::AggregatePlan::AggTerm> agg_terms;
+  agg_terms.emplace_back(EXPRESSION_TYPE_AGGREGATE_COUNT_STAR, nullptr);
+  std::vector<std::pair<ExpressionType, oid_t>> column_aggs = {
+      {EXPRESSION_TYPE_AGGREGATE_COUNT, 0},
+      {EXPRESSION_TYPE_AGGREGATE_SUM, 0},
+      {EXPRESSION_TYPE_AGGREGATE_MIN, 2},
+      {EXPRESSION_TYPE_AGGREGATE_MAX, 0},
+      {EXPRESSION_TYPE_AGGREGATE_AVG, 0},
+      {EXPRESSION_TYPE_AGGREGATE_SUM, 2}};
+  auto data_table_schema = data_table.get()->GetSchema();
+  for (auto &column_agg : column_aggs) {
+    agg_terms.emplace_back(
+        column_agg.first,
+        expression::ExpressionUtil::TupleValueFactory(
+            data_table_schema->GetType(column_agg.second), 0,
+            column_agg.second));
+  }
+
+  std::unique_ptr<const expression::AbstractExpression> predicate(nullptr);
+
+  auto bigint_size = common::Type::GetTypeSize(common::Type::BIGINT);
+  auto decimal_size = common::Type::GetTypeSize(common::Type::DECIMAL);
+  std::vector<catalog::Column> columns = {
+      data_table_schema->GetColumn(1),
+      catalog::Column(common::Type::BIGINT, bigint_size, "count_star", true),
+      catalog::Column(common::Type::BIGINT, bigint_size, "count_a", true),
+      data_table_schema->GetColumn(0),
+      data_table_schema->GetColumn(2),
+      data_table_schema->GetColumn(0),
+      catalog::Column(common::Type::DECIMAL, decimal_size, "avg_a", true),
+      data_table_schema->GetColumn(2)};
+  std::shared_ptr<const catalog::Schema> output_table_schema(
+      new catalog::Schema(columns));
+
+  planner::AggregatePlan node(std::move(proj_info), std::move(predicate),
+                              std::move(agg_terms), std::move(group_by_columns),
+                              output_table_schema, AGGREGATE_TYPE_HASH);
+
+  std::vector<common::Type::TypeId> input_types;
+  for (oid_t col = 0; col < data_table_schema->GetColumnCount(); col++) {
+    input_types.push_back(data_table_schema->GetType(col));
+  }
+  EXPECT_TRUE(executor::FlatHashAggregator::CanAggregate(&node, input_types));
+
+  auto schema = const_cast<catalog::Schema *>(output_table_schema.get());
+  std::unique_ptr<storage::DataTable> flat_table(
+      storage::TableFactory::GetDataTable(INVALID_OID, INVALID_OID, schema,
+                                          "flat_table", tuple_count, false,
+                                          false));
+  std::unique_ptr<storage::DataTable> hash_table(
+      storage::TableFactory::GetDataTable(INVALID_OID, INVALID_OID, schema,
+                                          "hash_table", tuple_count, false,
+                                          false));
+
+  // The flat aggregator gets whole tiles, the other one single tuples
+  executor::FlatHashAggregator flat_aggregator(&node, flat_table.get(),
+                                               nullptr, input_types);
+  executor::HashAggregator hash_aggregator(&node, hash_table.get(), nullptr,
+                                           input_types.size());
+  for (oid_t tile_group_itr = 0; tile_group_itr < tile_group_count;
+       tile_group_itr++) {
+    std::unique_ptr<executor::LogicalTile> tile(
+        executor::LogicalTileFactory::WrapTileGroup(
+            data_table->GetTileGroup(tile_group_itr)));
+    EXPECT_TRUE(flat_aggregator.AdvanceTile(tile.get()));
+    for (oid_t tuple_id : *tile) {
+      expression::ContainerTuple<executor::LogicalTile> tuple(tile.get(),
+                                                              tuple_id);
+      EXPECT_TRUE(hash_aggregator.Advance(&tuple));
+    }
+  }
+  EXPECT_TRUE(flat_aggregator.Finalize());
+  EXPECT_TRUE(hash_aggregator.Finalize());
+
+  auto flat_rows = GetAggregateRows(flat_table.get());
+  EXPECT_GT(flat_rows.size(), 0);
+  EXPECT_LT(flat_rows.size(), tile_group_count * tuple_count);
+  EXPECT_EQ(GetAggregateRows(hash_table.get()), flat_rows);
+
+  // Distinct aggregates are not supported
+  planner::AggregatePlan::AggTerm count_distinct(
+      EXPRESSION_TYPE_AGGREGATE_COUNT,
+      expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER, 0,
+                                                    0),
+      true);
+  std::vector<planner::AggregatePlan::AggTerm> distinct_terms = {
+      count_distinct};
+  std::unique_ptr<const planner::ProjectInfo> distinct_proj_info(
+      new planner::ProjectInfo(TargetList(), DirectMapList()));
+  planner::AggregatePlan distinct_node(
+      std::move(distinct_proj_info), nullptr, std::move(distinct_terms),
+      std::vector<oid_t>({1}), output_table_schema, AGGREGATE_TYPE_HASH);
+  EXPECT_FALSE(
+      executor::FlatHashAggregator::CanAggregate(&distinct_node, input_types));
+}
+
+TEST_F(AggregateTests, ParallelAggregationTest) {
+  // SELECT b, SUM(a), MIN(c), AVG(a), COUNT([DISTINCT] c) from table
+  // [GROUP BY b];
+  const int tuple_count = 500;
+  const int tile_group_count = 8;
+
+  auto& txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tuple_count, false));
+  ExecutorTestsUtil::PopulateTable(data_table.get(),
+                                   tile_group_count * tuple_count, false, true,
+                                   false, txn);
+  txn_manager.CommitTransaction(txn);
+  auto data_table_schema = data_table.get()->GetSchema();
+
+  std::vector<std::pair<ExpressionType, oid_t>> column_aggs = {
+      {EXPRESSION_TYPE_AGGREGATE_SUM, 0},
+      {EXPRESSION_TYPE_AGGREGATE_MIN, 2},
+      {EXPRESSION_TYPE_AGGREGATE_AVG, 0},
+      {EXPRESSION_TYPE_AGGREGATE_COUNT, 2}};
+  auto bigint_size = common::Type::GetTypeSize(common::Type::BIGINT);
+  auto decimal_size = common::Type::GetTypeSize(common::Type::DECIMAL);
+
+  // Without DISTINCT the hash aggregation uses the FlatHashAggregator
+  for (auto strategy : {AGGREGATE_TYPE_HASH, AGGREGATE_TYPE_PLAIN}) {
+    for (bool distinct : {false, true}) {
+      std::vector<oid_t> group_by_columns;
+      DirectMapList direct_map_list;
+      std::vector<catalog::Column> columns;
+      if (strategy == AGGREGATE_TYPE_HASH) {
+        group_by_columns.push_back(1);
+        direct_map_list.push_back({0, {0, 1}});
+        columns.push_back(data_table_schema->GetColumn(1));
+      }
+
+      std::vector<planner::AggregatePlan::AggTerm> agg_terms;
+      for (oid_t aggno = 0; aggno < column_aggs.size(); aggno++) {
+        auto aggtype = column_aggs[aggno].first;
+        auto column = column_aggs[aggno].second;
+        agg_terms.emplace_back(
+            aggtype, expression::ExpressionUtil::TupleValueFactory(
+                         data_table_schema->GetType(column), 0, column),
+            distinct && aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT);
+        direct_map_list.push_back(
+            {static_cast<oid_t>(columns.size()), {1, aggno}});
+        if (aggtype == EXPRESSION_TYPE_AGGREGATE_AVG) {
+          columns.emplace_back(common::Type::DECIMAL, decimal_size, "avg",
+                               true);
+        } else if (aggtype == EXPRESSION_TYPE_AGGREGATE_COUNT) {
+          columns.emplace_back(common::Type::BIGINT, bigint_size, "count",
+                               true);
+        } else {
+          columns.push_back(data_table_schema->GetColumn(column));
+        }
+      }
+
+      std::unique_ptr<const planner::ProjectInfo> proj_info(
+          new planner::ProjectInfo(TargetList(), std::move(direct_map_list)));
+      std::shared_ptr<const catalog::Schema> output_table_schema(
+          new catalog::Schema(columns));
+      planner::AggregatePlan node(std::move(proj_info), nullptr,
+                                  std::move(agg_terms),
+                                  std::move(group_by_columns),
+                                  output_table_schema, strategy);
+
+      auto serial_rows = GetExecutorRows(node, data_table.get(), 1);
+      auto parallel_rows = GetExecutorRows(node, data_table.get(), 4);
+      EXPECT_GT(serial_rows.size(), 0);
+      EXPECT_EQ(serial_rows, parallel_rows);
+    }
+  }
+}
+
+TEST_F(AggregateTests, SortAggregationTest) {
+  // SELECT b, [d,] COUNT(*), SUM(a), MAX(c) from table GROUP BY b[, d];
+  const int tuple_count = 500;
+  const int tile_group_count = 4;
+
+  auto& txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tuple_count, false));
+  ExecutorTestsUtil::PopulateTable(data_table.get(),
+                                   tile_group_count * tuple_count, false, true,
+                                   false, txn);
+  txn_manager.CommitTransaction(txn);
+  auto data_table_schema = data_table.get()->GetSchema();
+  auto bigint_size = common::Type::GetTypeSize(common::Type::BIGINT);
+
+  // The second pass nulls out some of the group keys of b, which must all
+  // land in one group
+  auto null_value =
+      common::ValueFactory::GetNullValueByType(common::Type::INTEGER);
+  for (bool null_keys : {false, true}) {
+    if (null_keys) {
+      for (oid_t tile_group_itr = 0;
+           tile_group_itr < data_table->GetTileGroupCount(); tile_group_itr++) {
+        auto tile_group = data_table->GetTileGroup(tile_group_itr);
+        for (oid_t row = 0; row < tile_group->GetNextTupleSlot(); row += 7) {
+          tile_group->SetValue(null_value, row, 1);
+        }
+      }
+    }
+
+    // The varchar column d can not be sorted on, so those groups are hashed
+    for (auto group_by_columns : {std::vector<oid_t>({1}),
+                                  std::vector<oid_t>({1, 3})}) {
+      DirectMapList direct_map_list;
+      std::vector<catalog::Column> columns;
+      for (auto column_id : group_by_columns) {
+        direct_map_list.push_back(
+            {static_cast<oid_t>(columns.size()), {0, column_id}});
+        columns.push_back(data_table_schema->GetColumn(column_id));
+      }
+      for (oid_t aggno = 0; aggno < 3; aggno++) {
+        direct_map_list.push_back(
+            {static_cast<oid_t>(columns.size()), {1, aggno}});
+      }
+      columns.emplace_back(common::Type::BIGINT, bigint_size, "count_star",
+                           true);
+      columns.push_back(data_table_schema->GetColumn(0));
+      columns.push_back(data_table_schema->GetColumn(2));
+
+      std::vector<planner::AggregatePlan::AggTerm> agg_terms;
+      agg_terms.emplace_back(EXPRESSION_TYPE_AGGREGATE_COUNT_STAR, nullptr);
+      agg_terms.emplace_back(EXPRESSION_TYPE_AGGREGATE_SUM,
+                             expression::ExpressionUtil::TupleValueFactory(
+                                 common::Type::INTEGER, 0, 0));
+      agg_terms.emplace_back(EXPRESSION_TYPE_AGGREGATE_MAX,
+                             expression::ExpressionUtil::TupleValueFactory(
+                                 common::Type::DECIMAL, 0, 2));
+
+      std::unique_ptr<const planner::ProjectInfo> proj_info(
+          new planner::ProjectInfo(TargetList(), std::move(direct_map_list)));
+      std::shared_ptr<const catalog::Schema> output_table_schema(
+          new catalog::Schema(columns));
+      planner::AggregatePlan node(std::move(proj_info), nullptr,
+                                  std::move(agg_terms),
+                                  std::move(group_by_columns),
+                                  output_table_schema, AGGREGATE_TYPE_HASH);
+
+      auto hash_rows = GetExecutorRows(node, data_table.get(), 1);
+      auto sort_rows = GetExecutorRows(node, data_table.get(), 1, true);
+      EXPECT_GT(hash_rows.size(), 0);
+      EXPECT_EQ(hash_rows, sort_rows);
+
+      // Picked for a large estimated group count
+      node.SetEstimatedGroupCount(
+          executor::AggregateExecutor::SORT_AGGREGATION_MIN_GROUPS);
+      EXPECT_EQ(hash_rows, GetExecutorRows(node, data_table.get(), 1));
+    }
+  }
+}
+
 TEST_F(AggregateTests, PlainSumCountDistinctTest) {
   // SELECT SUM(a), COUNT(b), COUNT(DISTINCT b) from table
   const int tuple_count = TESTS_TUPLES_PER_TILEGROUP;
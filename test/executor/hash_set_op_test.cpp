@@ -11,12 +11,15 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
 #include <vector>
 
 #include "common/harness.h"
 
 #include "planner/set_op_plan.h"
 
+#include "common/exception.h"
+
 #include "common/types.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
@@ -33,12 +36,25 @@ using ::testing::Return;
 namespace peloton {
 namespace test {
 
-class HashSetOptTests : public PelotonTest {};
+class HashSetOptTests : public PelotonTest {
+ protected:
+  // Build the hash tables of the parallel tests on worker threads
+  virtual void SetUp() {
+    PelotonTest::SetUp();
+    thread_pool.Initialize(4, 0);
+  }
+
+  virtual void TearDown() {
+    thread_pool.Shutdown();
+    PelotonTest::TearDown();
+  }
+};
 
 namespace {
 
-void RunTest(executor::HashSetOpExecutor &executor,
-             size_t expected_num_tuples) {
+/** @return the sorted values of the first column of the result */
+std::vector<int> RunTest(executor::HashSetOpExecutor &executor,
+                         size_t expected_num_tuples) {
   EXPECT_TRUE(executor.Init());
 
   std::vector<std::unique_ptr<executor::LogicalTile>> result_tiles;
@@ -55,6 +71,15 @@ void RunTest(executor::HashSetOpExecutor &executor,
 
   // In case you want to see it by yourself ...
   ExecutorTestsUtil::PrintTileVector(result_tiles);
+
+  std::vector<int> rows;
+  for (auto &tile : result_tiles) {
+    for (auto tuple_id : *tile) {
+      rows.push_back(tile->GetValue(tuple_id, 0).GetAs<int32_t>());
+    }
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
 }
 
 TEST_F(HashSetOptTests, ExceptTest) {
@@ -371,6 +396,106 @@ TEST_F(HashSetOptTests, IntersectAllTest) {
 
   RunTest(executor, 2 * (tile_size - 2 * (tile_size * 2 / 5)));
 }
+
+TEST_F(HashSetOptTests, UnionTest) {
+  // The result of a union is not a subset of the left child
+  for (auto set_op : {SETOP_TYPE_UNION, SETOP_TYPE_UNION_ALL}) {
+    planner::SetOpPlan node(set_op);
+    executor::HashSetOpExecutor executor(&node, nullptr);
+
+    MockExecutor child_executor1;
+    MockExecutor child_executor2;
+
+    executor.AddChild(&child_executor1);
+    executor.AddChild(&child_executor2);
+
+    EXPECT_CALL(child_executor1, DInit()).WillOnce(Return(true));
+
+    EXPECT_CALL(child_executor2, DInit()).WillOnce(Return(true));
+
+    EXPECT_THROW(executor.Init(), ExecutorException);
+  }
+}
+
+TEST_F(HashSetOptTests, ParallelBuildTest) {
+  // Create three tables with the same data
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  size_t tile_size = 100;
+
+  std::vector<std::unique_ptr<storage::DataTable>> data_tables;
+  for (size_t table_itr = 0; table_itr < 3; table_itr++) {
+    data_tables.emplace_back(ExecutorTestsUtil::CreateTable(tile_size));
+    ExecutorTestsUtil::PopulateTable(data_tables.back().get(), tile_size,
+                                     false, false, false, txn);
+  }
+
+  txn_manager.CommitTransaction(txn);
+
+  // The left child returns the last 3/5 tuples twice,
+  // the right child the first 3/5 tuples once
+  std::vector<std::pair<SetOpType, size_t>> set_ops = {
+      {SETOP_TYPE_INTERSECT, tile_size / 5},
+      {SETOP_TYPE_INTERSECT_ALL, tile_size / 5},
+      {SETOP_TYPE_EXCEPT, tile_size * 2 / 5},
+      {SETOP_TYPE_EXCEPT_ALL, tile_size / 5 + 2 * (tile_size * 2 / 5)}};
+
+  // The parallel build returns the same rows as the serial one
+  for (auto &set_op : set_ops) {
+    std::vector<int> serial_rows;
+    for (bool parallel : {false, true}) {
+      planner::SetOpPlan node(set_op.first);
+      executor::HashSetOpExecutor executor(&node, nullptr);
+      if (parallel) executor.UseParallelBuild(4);
+
+      MockExecutor child_executor1;
+      MockExecutor child_executor2;
+
+      executor.AddChild(&child_executor1);
+      executor.AddChild(&child_executor2);
+
+      EXPECT_CALL(child_executor1, DInit()).WillOnce(Return(true));
+
+      EXPECT_CALL(child_executor2, DInit()).WillOnce(Return(true));
+
+      EXPECT_CALL(child_executor1, DExecute())
+          .WillOnce(Return(true))
+          .WillOnce(Return(true))
+          .WillOnce(Return(false));
+
+      EXPECT_CALL(child_executor2, DExecute())
+          .WillOnce(Return(true))
+          .WillOnce(Return(false));
+
+      std::vector<std::unique_ptr<executor::LogicalTile>> source_logical_tiles;
+      for (auto &data_table : data_tables) {
+        source_logical_tiles.emplace_back(
+            executor::LogicalTileFactory::WrapTileGroup(
+                data_table->GetTileGroup(0)));
+      }
+
+      for (oid_t id = 0; id < tile_size * 2 / 5; id++) {
+        source_logical_tiles[0]->RemoveVisibility(id);
+        source_logical_tiles[1]->RemoveVisibility(id);
+        source_logical_tiles[2]->RemoveVisibility(tile_size - 1 - id);
+      }
+
+      EXPECT_CALL(child_executor1, GetOutput())
+          .WillOnce(Return(source_logical_tiles[0].release()))
+          .WillOnce(Return(source_logical_tiles[1].release()));
+
+      EXPECT_CALL(child_executor2, GetOutput())
+          .WillOnce(Return(source_logical_tiles[2].release()));
+
+      auto rows = RunTest(executor, set_op.second);
+      if (parallel) {
+        EXPECT_EQ(serial_rows, rows);
+      } else {
+        serial_rows = std::move(rows);
+      }
+    }
+  }
+}
 }
 
 }  // namespace test
@@ -10,33 +10,43 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <memory>
+#include <set>
 
 #include "common/harness.h"
 
 #include "common/types.h"
+#include "common/value_factory.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
 
+#include "executor/band_join_executor.h"
 #include "executor/hash_executor.h"
 #include "executor/hash_join_executor.h"
+#include "executor/index_nested_loop_join_executor.h"
 #include "executor/index_scan_executor.h"
 #include "executor/merge_join_executor.h"
 #include "executor/nested_loop_join_executor.h"
+#include "executor/seq_scan_executor.h"
+#include "executor/sort_merge_join_executor.h"
 
 #include "expression/abstract_expression.h"
 #include "expression/tuple_value_expression.h"
 #include "expression/expression_util.h"
 
+#include "planner/band_join_plan.h"
 #include "planner/hash_join_plan.h"
 #include "planner/hash_plan.h"
 #include "planner/merge_join_plan.h"
 #include "planner/nested_loop_join_plan.h"
 #include "planner/order_by_plan.h"
+#include "planner/seq_scan_plan.h"
 
 
 #include "storage/data_table.h"
 #include "storage/tile.h"
+#include "storage/tile_group.h"
 
 #include "concurrency/transaction_manager_factory.h"
 
@@ -54,7 +64,19 @@ namespace peloton {
 namespace test {
 
 int ctr=0;
-class JoinTests : public PelotonTest {};
+class JoinTests : public PelotonTest {
+ protected:
+  // Run the parallel merge and probe phases on worker threads
+  virtual void SetUp() {
+    PelotonTest::SetUp();
+    thread_pool.Initialize(4, 0);
+  }
+
+  virtual void TearDown() {
+    thread_pool.Shutdown();
+    PelotonTest::TearDown();
+  }
+};
 
 std::vector<planner::MergeJoinPlan::JoinClause> CreateJoinClauses() {
   std::vector<planner::MergeJoinPlan::JoinClause> join_clauses;
@@ -83,7 +105,8 @@ std::vector<PelotonJoinType> join_types = {JOIN_TYPE_INNER, JOIN_TYPE_LEFT,
                                            JOIN_TYPE_RIGHT, JOIN_TYPE_OUTER};
 
 void ExecuteJoinTest(PlanNodeType join_algorithm, PelotonJoinType join_type,
-                     oid_t join_test_type);
+                     oid_t join_test_type, bool parallel_merge = false,
+                     bool integrated_sort = false);
 void ExecuteNestedLoopJoinTest(PelotonJoinType join_type);
 
 void PopulateTable(storage::DataTable *table, int num_rows, bool random,
@@ -103,9 +126,19 @@ void ExpectMoreThanOneTileResults(
 
 void ExpectNormalTileResults(
     size_t table_tile_group_count, MockExecutor *table_scan_executor,
+    std::vector<std::unique_ptr<executor::LogicalTile>> &
+        table_logical_tile_ptrs,
+    bool expect_end = true);
+
+void ExpectTableTileResults(
+    storage::DataTable *table, size_t table_tile_group_count,
+    MockExecutor *table_scan_executor,
     std::vector<std::unique_ptr<executor::LogicalTile>> &
         table_logical_tile_ptrs);
 
+std::vector<std::pair<int, int>> CollectJoinRows(
+    executor::AbstractExecutor &join_executor);
+
 enum JOIN_TEST_TYPE {
   BASIC_TEST = 0,
   BOTH_TABLES_EMPTY = 1,
@@ -211,6 +244,203 @@ TEST_F(JoinTests, JoinPredicateTest) {
   }
 }
 
+TEST_F(JoinTests, ParallelSortMergeJoinTest) {
+  std::vector<oid_t> join_test_types = {BASIC_TEST, BOTH_TABLES_EMPTY,
+                                        COMPLICATED_TEST, LEFT_TABLE_EMPTY,
+                                        RIGHT_TABLE_EMPTY};
+
+  // Go over all join test types
+  for (auto join_test_type : join_test_types) {
+    LOG_INFO("JOIN TEST_F ------------------------ :: %u", join_test_type);
+    // Go over all join types
+    for (auto join_type : join_types) {
+      LOG_INFO("JOIN TYPE :: %d", join_type);
+      // Execute the join test with the partitioned merge
+      ExecuteJoinTest(PLAN_NODE_TYPE_SORT_MERGEJOIN, join_type, join_test_type,
+                      true);
+    }
+  }
+}
+
+TEST_F(JoinTests, IntegratedSortMergeJoinTest) {
+  std::vector<oid_t> join_test_types = {BASIC_TEST, BOTH_TABLES_EMPTY,
+                                        COMPLICATED_TEST, LEFT_TABLE_EMPTY,
+                                        RIGHT_TABLE_EMPTY};
+
+  // Go over all join test types
+  for (auto join_test_type : join_test_types) {
+    LOG_INFO("JOIN TEST_F ------------------------ :: %u", join_test_type);
+    // Go over all join types
+    for (auto join_type : join_types) {
+      LOG_INFO("JOIN TYPE :: %d", join_type);
+      // Execute the join test with the sort inside the join, serial and
+      // partitioned merge
+      ExecuteJoinTest(PLAN_NODE_TYPE_SORT_MERGEJOIN, join_type, join_test_type,
+                      false, true);
+      ExecuteJoinTest(PLAN_NODE_TYPE_SORT_MERGEJOIN, join_type, join_test_type,
+                      true, true);
+    }
+  }
+}
+
+TEST_F(JoinTests, ParallelSortMergeJoinMatchesSerialTest) {
+  // Join keys with duplicates, in random order
+  size_t tile_group_size = 1000;
+  size_t tile_group_count = 8;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(left_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   true, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(right_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   true, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  for (auto join_type : join_types) {
+    // The partitioned merge returns the rows of the serial merge
+    std::vector<std::pair<int, int>> serial_rows;
+    for (size_t partition_count : {1, 4}) {
+      MockExecutor left_table_scan_executor, right_table_scan_executor;
+      std::vector<std::unique_ptr<executor::LogicalTile>>
+          left_table_logical_tile_ptrs;
+      std::vector<std::unique_ptr<executor::LogicalTile>>
+          right_table_logical_tile_ptrs;
+      ExpectTableTileResults(left_table.get(), tile_group_count,
+                             &left_table_scan_executor,
+                             left_table_logical_tile_ptrs);
+      ExpectTableTileResults(right_table.get(), tile_group_count,
+                             &right_table_scan_executor,
+                             right_table_logical_tile_ptrs);
+
+      std::unique_ptr<const expression::AbstractExpression> predicate(
+          JoinTestsUtil::CreateJoinPredicate());
+      auto schema = CreateJoinSchema();
+      auto join_clauses = CreateJoinClauses();
+      planner::MergeJoinPlan merge_join_node(
+          join_type, std::move(predicate), JoinTestsUtil::CreateProjection(),
+          schema, join_clauses);
+      executor::SortMergeJoinExecutor sort_merge_join_executor(
+          &merge_join_node, nullptr);
+      sort_merge_join_executor.AddChild(&left_table_scan_executor);
+      sort_merge_join_executor.AddChild(&right_table_scan_executor);
+
+      if (partition_count > 1) {
+        sort_merge_join_executor.UseParallelMerge(partition_count);
+      }
+
+      auto rows = CollectJoinRows(sort_merge_join_executor);
+      std::sort(rows.begin(), rows.end());
+      if (partition_count == 1) {
+        EXPECT_LT(tile_group_size * tile_group_count, rows.size());
+        serial_rows = std::move(rows);
+      } else {
+        EXPECT_EQ(serial_rows, rows);
+      }
+    }
+  }
+}
+
+TEST_F(JoinTests, SortMergeJoinNullKeyTest) {
+  // Join keys with duplicates in random order, every fifth of them null
+  size_t tile_group_size = 100;
+  size_t tile_group_count = 4;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(left_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   true, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(right_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   true, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  // (first column, join key) of every row, -1 for a null key
+  auto null_value =
+      common::ValueFactory::GetNullValueByType(common::Type::INTEGER);
+  std::vector<std::pair<int, int>> left_keys, right_keys;
+  for (auto table : {left_table.get(), right_table.get()}) {
+    auto &keys = (table == left_table.get()) ? left_keys : right_keys;
+    for (size_t tile_group_itr = 0; tile_group_itr < tile_group_count;
+         tile_group_itr++) {
+      auto tile_group = table->GetTileGroup(tile_group_itr);
+      for (oid_t row = 0; row < tile_group_size; row++) {
+        if (row % 5 == 0) tile_group->SetValue(null_value, row, 1);
+        auto key = tile_group->GetValue(row, 1);
+        keys.emplace_back(tile_group->GetValue(row, 0).GetAs<int32_t>(),
+                          key.IsNull() ? -1 : key.GetAs<int32_t>());
+      }
+    }
+  }
+
+  for (auto join_type : join_types) {
+    // Null keys match no row, not even another null key
+    std::vector<std::pair<int, int>> expected_rows;
+    std::set<int> matched_left, matched_right;
+    for (auto &left_key : left_keys) {
+      for (auto &right_key : right_keys) {
+        if (left_key.second != -1 && left_key.second == right_key.second) {
+          expected_rows.emplace_back(left_key.first, right_key.first);
+          matched_left.insert(left_key.first);
+          matched_right.insert(right_key.first);
+        }
+      }
+    }
+    if (join_type == JOIN_TYPE_LEFT || join_type == JOIN_TYPE_OUTER) {
+      for (auto &left_key : left_keys) {
+        if (matched_left.count(left_key.first) == 0) {
+          expected_rows.emplace_back(left_key.first, -1);
+        }
+      }
+    }
+    if (join_type == JOIN_TYPE_RIGHT || join_type == JOIN_TYPE_OUTER) {
+      for (auto &right_key : right_keys) {
+        if (matched_right.count(right_key.first) == 0) {
+          expected_rows.emplace_back(-1, right_key.first);
+        }
+      }
+    }
+    std::sort(expected_rows.begin(), expected_rows.end());
+
+    MockExecutor left_table_scan_executor, right_table_scan_executor;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        left_table_logical_tile_ptrs;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        right_table_logical_tile_ptrs;
+    ExpectTableTileResults(left_table.get(), tile_group_count,
+                           &left_table_scan_executor,
+                           left_table_logical_tile_ptrs);
+    ExpectTableTileResults(right_table.get(), tile_group_count,
+                           &right_table_scan_executor,
+                           right_table_logical_tile_ptrs);
+
+    // Without a predicate, only the join clauses keep out the null keys
+    auto schema = CreateJoinSchema();
+    auto join_clauses = CreateJoinClauses();
+    planner::MergeJoinPlan merge_join_node(join_type, nullptr,
+                                           JoinTestsUtil::CreateProjection(),
+                                           schema, join_clauses);
+    executor::SortMergeJoinExecutor sort_merge_join_executor(&merge_join_node,
+                                                             nullptr);
+    sort_merge_join_executor.AddChild(&left_table_scan_executor);
+    sort_merge_join_executor.AddChild(&right_table_scan_executor);
+
+    auto rows = CollectJoinRows(sort_merge_join_executor);
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(expected_rows, rows);
+  }
+}
+
 TEST_F(JoinTests, SpeedTest) {
   ExecuteJoinTest(PLAN_NODE_TYPE_HASHJOIN, JOIN_TYPE_OUTER, SPEED_TEST);
   ExecuteJoinTest(PLAN_NODE_TYPE_MERGEJOIN, JOIN_TYPE_OUTER, SPEED_TEST);
@@ -218,11 +448,559 @@ TEST_F(JoinTests, SpeedTest) {
   ExecuteNestedLoopJoinTest(JOIN_TYPE_OUTER);
 }
 
+TEST_F(JoinTests, RadixPartitionedHashJoinTest) {
+  // Enough build rows for several radix partitions
+  size_t tile_group_size = 1000;
+  size_t tile_group_count = 20;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(left_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   false, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(right_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   false, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  // Serial and parallel build and probe
+  std::vector<std::pair<int, int>> serial_rows;
+  for (size_t thread_count : {1, 4}) {
+    MockExecutor left_table_scan_executor, right_table_scan_executor;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        left_table_logical_tile_ptrs;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        right_table_logical_tile_ptrs;
+    for (size_t tile_group_itr = 0; tile_group_itr < tile_group_count;
+         tile_group_itr++) {
+      left_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              left_table->GetTileGroup(tile_group_itr)));
+      right_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              right_table->GetTileGroup(tile_group_itr)));
+    }
+
+    EXPECT_CALL(left_table_scan_executor, DInit()).WillOnce(Return(true));
+    EXPECT_CALL(right_table_scan_executor, DInit()).WillOnce(Return(true));
+    ExpectNormalTileResults(tile_group_count, &left_table_scan_executor,
+                            left_table_logical_tile_ptrs);
+    ExpectNormalTileResults(tile_group_count, &right_table_scan_executor,
+                            right_table_logical_tile_ptrs);
+
+    std::vector<std::unique_ptr<const expression::AbstractExpression>>
+        hash_keys;
+    hash_keys.emplace_back(
+        new expression::TupleValueExpression(common::Type::INTEGER, 1, 1));
+    planner::HashPlan hash_plan_node(hash_keys);
+    executor::HashExecutor hash_executor(&hash_plan_node, nullptr);
+
+    std::unique_ptr<const expression::AbstractExpression> predicate(
+        JoinTestsUtil::CreateJoinPredicate());
+    auto schema = CreateJoinSchema();
+    planner::HashJoinPlan hash_join_plan_node(
+        JOIN_TYPE_INNER, std::move(predicate),
+        JoinTestsUtil::CreateProjection(), schema);
+    executor::HashJoinExecutor hash_join_executor(&hash_join_plan_node,
+                                                  nullptr);
+
+    hash_join_executor.AddChild(&left_table_scan_executor);
+    hash_join_executor.AddChild(&hash_executor);
+    hash_executor.AddChild(&right_table_scan_executor);
+
+    if (thread_count > 1) {
+      hash_executor.UseParallelBuild(thread_count);
+      hash_join_executor.UseParallelJoin(thread_count);
+    }
+
+    auto rows = CollectJoinRows(hash_join_executor);
+    std::sort(rows.begin(), rows.end());
+
+    // Every left row matches its copy in the right table, and the parallel
+    // build and probe return the rows of the serial ones
+    EXPECT_GT(hash_executor.GetPartitionCount(), 1);
+    EXPECT_EQ(tile_group_size * tile_group_count, rows.size());
+    if (thread_count == 1) {
+      serial_rows = std::move(rows);
+    } else {
+      EXPECT_EQ(serial_rows, rows);
+    }
+  }
+}
+
+TEST_F(JoinTests, ParallelProbeOverParallelScanTest) {
+  // The probe tasks and the scan workers share a pool with fewer threads
+  // than either of them asks for
+  thread_pool.Shutdown();
+  thread_pool.Initialize(2, 0);
+
+  size_t tile_group_size = 1000;
+  size_t tile_group_count = 10;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(left_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   false, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(right_table.get(),
+                                   tile_group_size * tile_group_count, false,
+                                   false, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::vector<std::pair<int, int>> serial_rows;
+  for (size_t thread_count : {1, 4}) {
+    txn = txn_manager.BeginTransaction();
+    std::unique_ptr<executor::ExecutorContext> context(
+        new executor::ExecutorContext(txn));
+
+    planner::SeqScanPlan left_scan_node(left_table.get(), nullptr,
+                                        {0, 1, 2, 3});
+    executor::SeqScanExecutor left_table_scan_executor(&left_scan_node,
+                                                       context.get());
+
+    MockExecutor right_table_scan_executor;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        right_table_logical_tile_ptrs;
+    for (size_t tile_group_itr = 0; tile_group_itr < tile_group_count;
+         tile_group_itr++) {
+      right_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              right_table->GetTileGroup(tile_group_itr)));
+    }
+    EXPECT_CALL(right_table_scan_executor, DInit()).WillOnce(Return(true));
+    ExpectNormalTileResults(tile_group_count, &right_table_scan_executor,
+                            right_table_logical_tile_ptrs);
+
+    std::vector<std::unique_ptr<const expression::AbstractExpression>>
+        hash_keys;
+    hash_keys.emplace_back(
+        new expression::TupleValueExpression(common::Type::INTEGER, 1, 1));
+    planner::HashPlan hash_plan_node(hash_keys);
+    executor::HashExecutor hash_executor(&hash_plan_node, nullptr);
+
+    std::unique_ptr<const expression::AbstractExpression> predicate(
+        JoinTestsUtil::CreateJoinPredicate());
+    auto schema = CreateJoinSchema();
+    planner::HashJoinPlan hash_join_plan_node(
+        JOIN_TYPE_INNER, std::move(predicate),
+        JoinTestsUtil::CreateProjection(), schema);
+    executor::HashJoinExecutor hash_join_executor(&hash_join_plan_node,
+                                                  nullptr);
+
+    hash_join_executor.AddChild(&left_table_scan_executor);
+    hash_join_executor.AddChild(&hash_executor);
+    hash_executor.AddChild(&right_table_scan_executor);
+
+    if (thread_count > 1) {
+      left_table_scan_executor.UseParallelScan(thread_count);
+      hash_join_executor.UseParallelJoin(thread_count);
+    }
+
+    // The probe must not wait on scan workers that wait on the probe
+    auto rows = CollectJoinRows(hash_join_executor);
+    std::sort(rows.begin(), rows.end());
+    txn_manager.CommitTransaction(txn);
+
+    EXPECT_EQ(tile_group_size * tile_group_count, rows.size());
+    if (thread_count == 1) {
+      serial_rows = std::move(rows);
+    } else {
+      EXPECT_EQ(serial_rows, rows);
+    }
+  }
+}
+
+TEST_F(JoinTests, GraceHashJoinTest) {
+  // The right table matches the first half of the left table
+  size_t tile_group_size = 1000;
+  size_t left_tile_group_count = 20;
+  size_t right_tile_group_count = 10;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(left_table.get(),
+                                   tile_group_size * left_tile_group_count,
+                                   false, false, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  ExecutorTestsUtil::PopulateTable(right_table.get(),
+                                   tile_group_size * right_tile_group_count,
+                                   false, false, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::vector<std::pair<PelotonJoinType, size_t>> join_results = {
+      {JOIN_TYPE_INNER, tile_group_size * right_tile_group_count},
+      {JOIN_TYPE_LEFT, tile_group_size * left_tile_group_count},
+      {JOIN_TYPE_RIGHT, tile_group_size * right_tile_group_count},
+      {JOIN_TYPE_OUTER, tile_group_size * left_tile_group_count}};
+
+  for (auto &join_result : join_results) {
+    MockExecutor left_table_scan_executor, right_table_scan_executor;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        left_table_logical_tile_ptrs;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        right_table_logical_tile_ptrs;
+    for (size_t tile_group_itr = 0; tile_group_itr < left_tile_group_count;
+         tile_group_itr++) {
+      left_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              left_table->GetTileGroup(tile_group_itr)));
+    }
+    for (size_t tile_group_itr = 0; tile_group_itr < right_tile_group_count;
+         tile_group_itr++) {
+      right_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              right_table->GetTileGroup(tile_group_itr)));
+    }
+
+    EXPECT_CALL(left_table_scan_executor, DInit()).WillOnce(Return(true));
+    EXPECT_CALL(right_table_scan_executor, DInit()).WillOnce(Return(true));
+    ExpectNormalTileResults(left_tile_group_count, &left_table_scan_executor,
+                            left_table_logical_tile_ptrs);
+    ExpectNormalTileResults(right_tile_group_count, &right_table_scan_executor,
+                            right_table_logical_tile_ptrs);
+
+    std::vector<std::unique_ptr<const expression::AbstractExpression>>
+        hash_keys;
+    hash_keys.emplace_back(
+        new expression::TupleValueExpression(common::Type::INTEGER, 1, 1));
+    planner::HashPlan hash_plan_node(hash_keys);
+    executor::HashExecutor hash_executor(&hash_plan_node, nullptr);
+
+    std::unique_ptr<const expression::AbstractExpression> predicate(
+        JoinTestsUtil::CreateJoinPredicate());
+    auto schema = CreateJoinSchema();
+    planner::HashJoinPlan hash_join_plan_node(
+        join_result.first, std::move(predicate),
+        JoinTestsUtil::CreateProjection(), schema);
+    executor::HashJoinExecutor hash_join_executor(&hash_join_plan_node,
+                                                  nullptr);
+
+    hash_join_executor.AddChild(&left_table_scan_executor);
+    hash_join_executor.AddChild(&hash_executor);
+    hash_executor.AddChild(&right_table_scan_executor);
+
+    // Small enough for the spilled partitions to be partitioned again
+    hash_join_executor.UseGraceJoin(8 * 1024);
+
+    oid_t result_tuple_count = 0;
+    EXPECT_TRUE(hash_join_executor.Init());
+    while (hash_join_executor.Execute() == true) {
+      std::unique_ptr<executor::LogicalTile> result_logical_tile(
+          hash_join_executor.GetOutput());
+      result_tuple_count += result_logical_tile->GetTupleCount();
+      ValidateJoinLogicalTile(result_logical_tile.get());
+    }
+
+    EXPECT_TRUE(hash_executor.IsSpilled());
+    EXPECT_EQ(join_result.second, result_tuple_count);
+  }
+}
+
 TEST_F(JoinTests, BasicNestedLoopTest) {
   LOG_INFO("PLAN_NODE_TYPE_NESTLOOP");
   ExecuteNestedLoopJoinTest(JOIN_TYPE_INNER);
 }
 
+TEST_F(JoinTests, IndexNestedLoopJoinTest) {
+  size_t tile_group_size = TESTS_TUPLES_PER_TILEGROUP;
+  size_t left_table_tile_group_count = 6;
+  size_t right_table_tile_group_count = 2;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+
+  // Left keys are multiples of 10, right keys multiples of 50
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  size_t left_row_count = tile_group_size * left_table_tile_group_count;
+  ExecutorTestsUtil::PopulateTable(left_table.get(), left_row_count, false,
+                                   false, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  size_t right_row_count = tile_group_size * right_table_tile_group_count;
+  PopulateTable(right_table.get(), right_row_count, false, txn);
+
+  txn_manager.CommitTransaction(txn);
+
+  size_t match_count =
+      std::min((left_row_count + 4) / 5, right_row_count);
+
+  for (auto join_type : {JOIN_TYPE_INNER, JOIN_TYPE_LEFT}) {
+    txn = txn_manager.BeginTransaction();
+    std::unique_ptr<executor::ExecutorContext> context(
+        new executor::ExecutorContext(txn));
+
+    MockExecutor left_table_scan_executor;
+    std::vector<std::unique_ptr<executor::LogicalTile>>
+        left_table_logical_tile_ptrs;
+    for (size_t tile_group_itr = 0;
+         tile_group_itr < left_table_tile_group_count; tile_group_itr++) {
+      left_table_logical_tile_ptrs.emplace_back(
+          executor::LogicalTileFactory::WrapTileGroup(
+              left_table->GetTileGroup(tile_group_itr)));
+    }
+    EXPECT_CALL(left_table_scan_executor, DInit()).WillOnce(Return(true));
+    ExpectNormalTileResults(left_table_tile_group_count,
+                            &left_table_scan_executor,
+                            left_table_logical_tile_ptrs);
+
+    // The join only takes the primary key index of the right table from
+    // the index scan
+    std::vector<oid_t> key_column_ids;
+    std::vector<ExpressionType> expr_types;
+    std::vector<common::Value> values;
+    std::vector<expression::AbstractExpression *> runtime_keys;
+    planner::IndexScanPlan::IndexScanDesc index_scan_desc(
+        right_table->GetIndex(0), key_column_ids, expr_types, values,
+        runtime_keys);
+    planner::IndexScanPlan right_table_node(right_table.get(), nullptr,
+                                            std::vector<oid_t>({0, 1}),
+                                            index_scan_desc);
+    executor::IndexScanExecutor right_table_scan_executor(&right_table_node,
+                                                          context.get());
+
+    auto projection = JoinTestsUtil::CreateProjection();
+    auto schema = CreateJoinSchema();
+    std::vector<oid_t> join_column_ids_left = {0};
+    std::vector<oid_t> join_column_ids_right = {0};
+    planner::NestedLoopJoinPlan index_join_node(
+        join_type, nullptr, std::move(projection), schema,
+        join_column_ids_left, join_column_ids_right);
+
+    executor::IndexNestedLoopJoinExecutor index_join_executor(
+        &index_join_node, context.get());
+    index_join_executor.AddChild(&left_table_scan_executor);
+    index_join_executor.AddChild(&right_table_scan_executor);
+
+    EXPECT_TRUE(index_join_executor.Init());
+    size_t result_tuple_count = 0;
+    size_t tuples_with_null = 0;
+    while (index_join_executor.Execute() == true) {
+      std::unique_ptr<executor::LogicalTile> result_logical_tile(
+          index_join_executor.GetOutput());
+      result_tuple_count += result_logical_tile->GetTupleCount();
+      tuples_with_null += CountTuplesWithNullFields(result_logical_tile.get());
+      ValidateNestedLoopJoinLogicalTile(result_logical_tile.get());
+    }
+
+    if (join_type == JOIN_TYPE_INNER) {
+      EXPECT_EQ(match_count, result_tuple_count);
+      EXPECT_EQ(0, tuples_with_null);
+    } else {
+      EXPECT_EQ(left_row_count, result_tuple_count);
+      EXPECT_EQ(left_row_count - match_count, tuples_with_null);
+    }
+
+    txn_manager.CommitTransaction(txn);
+  }
+
+  // The secondary index on (a, b) is probed with the left keys for a and the
+  // value of the equality condition of the index scan for b, so only the
+  // right row with b = 200 (a = 100) matches
+  txn = txn_manager.BeginTransaction();
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(txn));
+
+  MockExecutor left_table_scan_executor;
+  std::vector<std::unique_ptr<executor::LogicalTile>>
+      left_table_logical_tile_ptrs;
+  ExpectTableTileResults(left_table.get(), left_table_tile_group_count,
+                         &left_table_scan_executor,
+                         left_table_logical_tile_ptrs);
+
+  std::vector<oid_t> key_column_ids = {1};
+  std::vector<ExpressionType> expr_types = {EXPRESSION_TYPE_COMPARE_EQUAL};
+  std::vector<common::Value> values = {
+      common::ValueFactory::GetIntegerValue(200).Copy()};
+  std::vector<expression::AbstractExpression *> runtime_keys;
+  planner::IndexScanPlan::IndexScanDesc index_scan_desc(
+      right_table->GetIndex(1), key_column_ids, expr_types, values,
+      runtime_keys);
+  std::unique_ptr<planner::IndexScanPlan> right_table_node(
+      new planner::IndexScanPlan(right_table.get(), nullptr,
+                                 std::vector<oid_t>({0, 1}), index_scan_desc));
+  executor::IndexScanExecutor right_table_scan_executor(
+      right_table_node.get(), context.get());
+
+  auto projection = JoinTestsUtil::CreateProjection();
+  auto schema = CreateJoinSchema();
+  std::vector<oid_t> join_column_ids_left = {0};
+  std::vector<oid_t> join_column_ids_right = {0};
+  planner::NestedLoopJoinPlan index_join_node(
+      JOIN_TYPE_INNER, nullptr, std::move(projection), schema,
+      join_column_ids_left, join_column_ids_right);
+  index_join_node.AddChild(std::unique_ptr<planner::AbstractPlan>(
+      new planner::SeqScanPlan(left_table.get(), nullptr, {0, 1})));
+  index_join_node.AddChild(std::move(right_table_node));
+  EXPECT_TRUE(
+      executor::IndexNestedLoopJoinExecutor::CanProbeIndex(&index_join_node));
+
+  executor::IndexNestedLoopJoinExecutor index_join_executor(&index_join_node,
+                                                            context.get());
+  index_join_executor.AddChild(&left_table_scan_executor);
+  index_join_executor.AddChild(&right_table_scan_executor);
+
+  std::vector<std::pair<int, int>> expected_rows = {{100, 100}};
+  EXPECT_EQ(expected_rows, CollectJoinRows(index_join_executor));
+
+  txn_manager.CommitTransaction(txn);
+}
+
+TEST_F(JoinTests, BandJoinTest) {
+  size_t tile_group_size = TESTS_TUPLES_PER_TILEGROUP;
+  size_t left_table_tile_group_count = 6;
+  size_t right_table_tile_group_count = 2;
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+
+  // Left rows i have the keys 10 * i (integer) and 10 * i + 2 (double),
+  // right rows j the bounds 50 * j and 100 * j
+  std::unique_ptr<storage::DataTable> left_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  size_t left_row_count = tile_group_size * left_table_tile_group_count;
+  ExecutorTestsUtil::PopulateTable(left_table.get(), left_row_count, false,
+                                   false, false, txn);
+  std::unique_ptr<storage::DataTable> right_table(
+      ExecutorTestsUtil::CreateTable(tile_group_size));
+  size_t right_row_count = tile_group_size * right_table_tile_group_count;
+  PopulateTable(right_table.get(), right_row_count, false, txn);
+
+  txn_manager.CommitTransaction(txn);
+
+  // Integer keys with inclusive bounds are sorted as normalized keys, double
+  // keys with exclusive bounds as values
+  for (oid_t left_key_column : {0, 2}) {
+    bool inclusive = (left_key_column == 0);
+
+    // Count the matches of the band predicate
+    size_t match_count = 0;
+    std::vector<bool> left_matched(left_row_count, false);
+    std::vector<bool> right_matched(right_row_count, false);
+    for (size_t left_itr = 0; left_itr < left_row_count; left_itr++) {
+      size_t key = 10 * left_itr + left_key_column;
+      for (size_t right_itr = 0; right_itr < right_row_count; right_itr++) {
+        size_t lower = 50 * right_itr, upper = 100 * right_itr;
+        bool match = inclusive ? (lower <= key && key <= upper)
+                               : (lower < key && key < upper);
+        if (match) {
+          match_count++;
+          left_matched[left_itr] = true;
+          right_matched[right_itr] = true;
+        }
+      }
+    }
+    size_t left_unmatched_count =
+        std::count(left_matched.begin(), left_matched.end(), false);
+    size_t right_unmatched_count =
+        std::count(right_matched.begin(), right_matched.end(), false);
+
+    for (auto join_type : join_types) {
+      LOG_INFO("BAND JOIN KEY :: %u TYPE :: %d", left_key_column, join_type);
+      txn = txn_manager.BeginTransaction();
+      std::unique_ptr<executor::ExecutorContext> context(
+          new executor::ExecutorContext(txn));
+
+      MockExecutor left_table_scan_executor, right_table_scan_executor;
+      std::vector<std::unique_ptr<executor::LogicalTile>>
+          left_table_logical_tile_ptrs;
+      for (size_t tile_group_itr = 0;
+           tile_group_itr < left_table_tile_group_count; tile_group_itr++) {
+        left_table_logical_tile_ptrs.emplace_back(
+            executor::LogicalTileFactory::WrapTileGroup(
+                left_table->GetTileGroup(tile_group_itr)));
+      }
+      std::vector<std::unique_ptr<executor::LogicalTile>>
+          right_table_logical_tile_ptrs;
+      for (size_t tile_group_itr = 0;
+           tile_group_itr < right_table_tile_group_count; tile_group_itr++) {
+        right_table_logical_tile_ptrs.emplace_back(
+            executor::LogicalTileFactory::WrapTileGroup(
+                right_table->GetTileGroup(tile_group_itr)));
+      }
+      EXPECT_CALL(left_table_scan_executor, DInit()).WillOnce(Return(true));
+      EXPECT_CALL(right_table_scan_executor, DInit()).WillOnce(Return(true));
+      ExpectNormalTileResults(left_table_tile_group_count,
+                              &left_table_scan_executor,
+                              left_table_logical_tile_ptrs);
+      ExpectNormalTileResults(right_table_tile_group_count,
+                              &right_table_scan_executor,
+                              right_table_logical_tile_ptrs);
+
+      planner::BandJoinPlan::BandClause band_clause(
+          expression::ExpressionUtil::TupleValueFactory(
+              left_key_column == 0 ? common::Type::INTEGER
+                                   : common::Type::DECIMAL,
+              0, left_key_column),
+          expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER,
+                                                        1, 0),
+          inclusive, expression::ExpressionUtil::TupleValueFactory(
+                         common::Type::INTEGER, 1, 1),
+          inclusive);
+
+      auto projection = JoinTestsUtil::CreateProjection();
+      auto schema = CreateJoinSchema();
+      planner::BandJoinPlan band_join_node(join_type, nullptr,
+                                           std::move(projection), schema,
+                                           std::move(band_clause));
+
+      executor::BandJoinExecutor band_join_executor(&band_join_node,
+                                                    context.get());
+      band_join_executor.AddChild(&left_table_scan_executor);
+      band_join_executor.AddChild(&right_table_scan_executor);
+
+      EXPECT_TRUE(band_join_executor.Init());
+      size_t result_tuple_count = 0;
+      size_t tuples_with_null = 0;
+      while (band_join_executor.Execute() == true) {
+        std::unique_ptr<executor::LogicalTile> result_logical_tile(
+            band_join_executor.GetOutput());
+        result_tuple_count += result_logical_tile->GetTupleCount();
+        tuples_with_null +=
+            CountTuplesWithNullFields(result_logical_tile.get());
+
+        // Left columns come first, then the right ones
+        for (auto tuple_id : *result_logical_tile) {
+          auto key = result_logical_tile->GetValue(tuple_id, left_key_column);
+          auto lower = result_logical_tile->GetValue(tuple_id, 4);
+          auto upper = result_logical_tile->GetValue(tuple_id, 5);
+          if (key.IsNull() || lower.IsNull()) continue;
+          if (inclusive) {
+            EXPECT_TRUE(key.CompareGreaterThanEquals(lower).IsTrue());
+            EXPECT_TRUE(key.CompareLessThanEquals(upper).IsTrue());
+          } else {
+            EXPECT_TRUE(key.CompareGreaterThan(lower).IsTrue());
+            EXPECT_TRUE(key.CompareLessThan(upper).IsTrue());
+          }
+        }
+      }
+
+      size_t expected_null_count = 0;
+      if (join_type == JOIN_TYPE_LEFT || join_type == JOIN_TYPE_OUTER) {
+        expected_null_count += left_unmatched_count;
+      }
+      if (join_type == JOIN_TYPE_RIGHT || join_type == JOIN_TYPE_OUTER) {
+        expected_null_count += right_unmatched_count;
+      }
+      EXPECT_EQ(match_count + expected_null_count, result_tuple_count);
+      EXPECT_EQ(expected_null_count, tuples_with_null);
+
+      txn_manager.CommitTransaction(txn);
+    }
+  }
+}
+
 void PopulateTable(storage::DataTable *table, int num_rows, bool random,
                    concurrency::Transaction *current_txn) {
   // Random values
@@ -423,7 +1201,8 @@ void ExecuteNestedLoopJoinTest(PelotonJoinType join_type) {
 }
 
 void ExecuteJoinTest(PlanNodeType join_algorithm, PelotonJoinType join_type,
-                     oid_t join_test_type) {
+                     oid_t join_test_type, bool parallel_merge,
+                     bool integrated_sort) {
   //===--------------------------------------------------------------------===//
   // Mock table scan executors
   //===--------------------------------------------------------------------===//
@@ -552,8 +1331,17 @@ void ExecuteJoinTest(PlanNodeType join_algorithm, PelotonJoinType join_type,
   //===--------------------------------------------------------------------===//
   // Setup left table
   //===--------------------------------------------------------------------===//
-  if (join_test_type == BASIC_TEST || join_test_type == COMPLICATED_TEST ||
-      join_test_type == SPEED_TEST) {
+  if (join_test_type == BASIC_TEST &&
+      join_algorithm == PLAN_NODE_TYPE_MERGEJOIN &&
+      (join_type == JOIN_TYPE_INNER || join_type == JOIN_TYPE_RIGHT)) {
+    // The merge join stops reading the left table once the right one ends
+    // after the key group that spans into the last left tile
+    ExpectNormalTileResults(left_table_tile_group_count,
+                            &left_table_scan_executor,
+                            left_table_logical_tile_ptrs, false);
+  } else if (join_test_type == BASIC_TEST ||
+             join_test_type == COMPLICATED_TEST ||
+             join_test_type == SPEED_TEST) {
     ExpectNormalTileResults(left_table_tile_group_count,
                             &left_table_scan_executor,
                             left_table_logical_tile_ptrs);
@@ -701,6 +1489,42 @@ void ExecuteJoinTest(PlanNodeType join_algorithm, PelotonJoinType join_type,
     } break;
 
     case PLAN_NODE_TYPE_SORT_MERGEJOIN: {
+      if (integrated_sort) {
+        // Create join clauses
+        std::vector<planner::MergeJoinPlan::JoinClause> join_clauses;
+        join_clauses = CreateJoinClauses();
+        // Create merge join plan node
+        planner::MergeJoinPlan merge_join_node(join_type, std::move(predicate),
+                                               std::move(projection), schema,
+                                               join_clauses);
+        // Construct the sort merge join executor, which sorts both inputs
+        executor::SortMergeJoinExecutor sort_merge_join_executor(
+            &merge_join_node, nullptr);
+
+        sort_merge_join_executor.AddChild(&left_table_scan_executor);
+        sort_merge_join_executor.AddChild(&right_table_scan_executor);
+
+        if (parallel_merge) {
+          sort_merge_join_executor.UseParallelMerge(4);
+        }
+
+        // Run the sort merge join executor
+        EXPECT_TRUE(sort_merge_join_executor.Init());
+        while (sort_merge_join_executor.Execute() == true) {
+          std::unique_ptr<executor::LogicalTile> result_logical_tile(
+              sort_merge_join_executor.GetOutput());
+
+          if (result_logical_tile != nullptr) {
+            result_tuple_count += result_logical_tile->GetTupleCount();
+            tuples_with_null +=
+                CountTuplesWithNullFields(result_logical_tile.get());
+            ValidateJoinLogicalTile(result_logical_tile.get());
+            LOG_DEBUG("%s", result_logical_tile->GetInfo().c_str());
+          }
+        }
+        break;
+      }
+
       // create the order by plan
       std::vector<oid_t> sort_keys({1});
       std::vector<bool> descend_flags({false});
@@ -742,6 +1566,11 @@ void ExecuteJoinTest(PlanNodeType join_algorithm, PelotonJoinType join_type,
       merge_join_executor.AddChild(&left_order_executor);
       merge_join_executor.AddChild(&right_order_executor);
 
+      // or split them into key ranges that are merged in parallel
+      if (parallel_merge) {
+        merge_join_executor.UseParallelMerge(4);
+      }
+
       // Run the merge join executor
       EXPECT_TRUE(merge_join_executor.Init());
       while (merge_join_executor.Execute() == true) {
@@ -1060,13 +1889,14 @@ void ExpectMoreThanOneTileResults(
 void ExpectNormalTileResults(
     size_t table_tile_group_count, MockExecutor *table_scan_executor,
     std::vector<std::unique_ptr<executor::LogicalTile>> &
-        table_logical_tile_ptrs) {
+        table_logical_tile_ptrs,
+    bool expect_end) {
   // Return true for the first table_tile_group_count times
-  // Then return false after that
+  // Then return false after that, unless the parent stops before the end
   {
     testing::Sequence execute_sequence;
     for (size_t table_tile_group_itr = 0;
-         table_tile_group_itr < table_tile_group_count + 1;
+         table_tile_group_itr < table_tile_group_count + (expect_end ? 1 : 0);
          table_tile_group_itr++) {
       // Return true for the first table_tile_group_count times
       if (table_tile_group_itr < table_tile_group_count) {
@@ -1095,5 +1925,48 @@ void ExpectNormalTileResults(
     }
   }
 }
+
+void ExpectTableTileResults(
+    storage::DataTable *table, size_t table_tile_group_count,
+    MockExecutor *table_scan_executor,
+    std::vector<std::unique_ptr<executor::LogicalTile>> &
+        table_logical_tile_ptrs) {
+  // Wrap every tile group of the table in a logical tile
+  for (size_t tile_group_itr = 0; tile_group_itr < table_tile_group_count;
+       tile_group_itr++) {
+    table_logical_tile_ptrs.emplace_back(
+        executor::LogicalTileFactory::WrapTileGroup(
+            table->GetTileGroup(tile_group_itr)));
+  }
+
+  EXPECT_CALL(*table_scan_executor, DInit()).WillOnce(Return(true));
+  ExpectNormalTileResults(table_tile_group_count, table_scan_executor,
+                          table_logical_tile_ptrs);
+}
+
+/**
+ * @brief Run the join and return its rows as pairs of the first columns of
+ * the left and the right row, which are unique, or -1 for a null row.
+ */
+std::vector<std::pair<int, int>> CollectJoinRows(
+    executor::AbstractExecutor &join_executor) {
+  std::vector<std::pair<int, int>> rows;
+  EXPECT_TRUE(join_executor.Init());
+  while (join_executor.Execute() == true) {
+    std::unique_ptr<executor::LogicalTile> result_logical_tile(
+        join_executor.GetOutput());
+    if (result_logical_tile == nullptr) continue;
+
+    ValidateJoinLogicalTile(result_logical_tile.get());
+    for (auto tuple_id : *result_logical_tile) {
+      auto left_value = result_logical_tile->GetValue(tuple_id, 3);
+      auto right_value = result_logical_tile->GetValue(tuple_id, 2);
+      rows.emplace_back(
+          left_value.IsNull() ? -1 : left_value.GetAs<int32_t>(),
+          right_value.IsNull() ? -1 : right_value.GetAs<int32_t>());
+    }
+  }
+  return rows;
+}
 }  // namespace test
 }  // namespace peloton
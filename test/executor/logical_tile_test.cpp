@@ -141,6 +141,11 @@ TEST_F(LogicalTileTests, TileMaterializationTest) {
   }
 
   LOG_INFO("%s", logical_tile->GetInfo().c_str());
+
+  // The size estimate counts the data of the varchars ("tuple 1" and
+  // "tuple 2") besides the fixed width of the columns
+  EXPECT_LE(2 * schema->GetLength() + 2 * 7,
+            logical_tile->GetEstimatedSize());
 }
 
 }  // End test namespace
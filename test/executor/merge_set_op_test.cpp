@@ -0,0 +1,279 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// merge_set_op_test.cpp
+//
+// Identification: test/executor/merge_set_op_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <utility>
+#include <vector>
+
+#include "common/harness.h"
+
+#include "planner/set_op_plan.h"
+
+#include "common/types.h"
+#include "common/value_factory.h"
+#include "executor/executor_context.h"
+#include "executor/logical_tile.h"
+#include "executor/logical_tile_factory.h"
+#include "executor/merge_set_op_executor.h"
+#include "executor/order_by_executor.h"
+#include "storage/data_table.h"
+#include "concurrency/transaction_manager_factory.h"
+
+#include "executor/executor_tests_util.h"
+#include "executor/mock_executor.h"
+
+using ::testing::NotNull;
+using ::testing::Return;
+
+namespace peloton {
+namespace test {
+
+class MergeSetOpTests : public PelotonTest {};
+
+namespace {
+
+/**
+ * Let the child return the given tiles in order
+ */
+void ExpectTiles(MockExecutor &child_executor,
+                 std::vector<std::unique_ptr<executor::LogicalTile>> &tiles) {
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  testing::Sequence execute_sequence, get_output_sequence;
+  for (auto &tile : tiles) {
+    EXPECT_CALL(child_executor, DExecute())
+        .InSequence(execute_sequence)
+        .WillOnce(Return(true));
+    EXPECT_CALL(child_executor, GetOutput())
+        .InSequence(get_output_sequence)
+        .WillOnce(Return(tile.release()));
+  }
+  EXPECT_CALL(child_executor, DExecute())
+      .InSequence(execute_sequence)
+      .WillOnce(Return(false));
+}
+
+/**
+ * Run the executor and check the number of result tuples, and that they are
+ * sorted on their first column with nulls first
+ */
+void RunTest(executor::MergeSetOpExecutor &executor,
+             size_t expected_num_tuples) {
+  EXPECT_TRUE(executor.Init());
+
+  std::vector<std::unique_ptr<executor::LogicalTile>> result_tiles;
+  while (executor.Execute()) {
+    result_tiles.emplace_back(executor.GetOutput());
+  }
+
+  size_t actual_num_tuples_returned = 0;
+  common::Value last_value;
+  bool has_last_value = false;
+  for (auto &tile : result_tiles) {
+    actual_num_tuples_returned += tile->GetTupleCount();
+    for (oid_t tuple_id : *tile) {
+      auto value = tile->GetValue(tuple_id, 0);
+      if (has_last_value) {
+        EXPECT_LE(0,
+                  executor::OrderByExecutor::CompareSortValues(value,
+                                                               last_value));
+      }
+      last_value = value;
+      has_last_value = true;
+    }
+  }
+
+  EXPECT_EQ(expected_num_tuples, actual_num_tuples_returned);
+}
+
+}  // namespace
+
+TEST_F(MergeSetOpTests, SortedInputTest) {
+  // Create two tables with the same data, sorted on all columns
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  size_t tile_size = 10;
+
+  std::unique_ptr<storage::DataTable> data_table1(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  ExecutorTestsUtil::PopulateTable(data_table1.get(), tile_size * 5, false,
+                                   false, false, txn);
+  std::unique_ptr<storage::DataTable> data_table2(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  ExecutorTestsUtil::PopulateTable(data_table2.get(), tile_size * 5, false,
+                                   false, false, txn);
+
+  txn_manager.CommitTransaction(txn);
+
+  // The left child returns the tuples of the first three tile groups,
+  // the right child those of the second to fourth tile group
+  std::vector<std::pair<SetOpType, size_t>> set_ops = {
+      {SETOP_TYPE_INTERSECT, tile_size * 2},
+      {SETOP_TYPE_INTERSECT_ALL, tile_size * 2},
+      {SETOP_TYPE_EXCEPT, tile_size},
+      {SETOP_TYPE_EXCEPT_ALL, tile_size},
+      {SETOP_TYPE_UNION, tile_size * 4},
+      {SETOP_TYPE_UNION_ALL, tile_size * 6}};
+
+  for (auto &set_op : set_ops) {
+    planner::SetOpPlan node(set_op.first);
+    executor::MergeSetOpExecutor executor(&node, nullptr);
+
+    MockExecutor child_executor1;
+    MockExecutor child_executor2;
+
+    executor.AddChild(&child_executor1);
+    executor.AddChild(&child_executor2);
+
+    std::vector<std::unique_ptr<executor::LogicalTile>> left_tiles;
+    std::vector<std::unique_ptr<executor::LogicalTile>> right_tiles;
+    for (oid_t tile_group_itr = 0; tile_group_itr < 3; tile_group_itr++) {
+      left_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+          data_table1->GetTileGroup(tile_group_itr)));
+      right_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+          data_table2->GetTileGroup(tile_group_itr + 1)));
+    }
+
+    ExpectTiles(child_executor1, left_tiles);
+    ExpectTiles(child_executor2, right_tiles);
+
+    RunTest(executor, set_op.second);
+  }
+}
+
+TEST_F(MergeSetOpTests, InputSortTest) {
+  // Create three tables with the same data
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  size_t tile_size = 100;
+
+  std::vector<std::unique_ptr<storage::DataTable>> data_tables;
+  for (size_t table_itr = 0; table_itr < 3; table_itr++) {
+    data_tables.emplace_back(ExecutorTestsUtil::CreateTable(tile_size));
+    ExecutorTestsUtil::PopulateTable(data_tables.back().get(), tile_size,
+                                     false, false, false, txn);
+  }
+
+  txn_manager.CommitTransaction(txn);
+
+  // The left child returns the last 3/5 tuples twice, which is not sorted,
+  // the right child the first 3/5 tuples once
+  std::vector<std::pair<SetOpType, size_t>> set_ops = {
+      {SETOP_TYPE_INTERSECT, tile_size / 5},
+      {SETOP_TYPE_INTERSECT_ALL, tile_size / 5},
+      {SETOP_TYPE_EXCEPT, tile_size * 2 / 5},
+      {SETOP_TYPE_EXCEPT_ALL, tile_size / 5 + 2 * (tile_size * 2 / 5)},
+      {SETOP_TYPE_UNION, tile_size},
+      {SETOP_TYPE_UNION_ALL, 3 * (tile_size * 3 / 5)}};
+
+  for (auto &set_op : set_ops) {
+    planner::SetOpPlan node(set_op.first);
+    std::unique_ptr<executor::ExecutorContext> context(
+        new executor::ExecutorContext(nullptr));
+    executor::MergeSetOpExecutor executor(&node, context.get());
+
+    MockExecutor child_executor1;
+    MockExecutor child_executor2;
+
+    executor.AddChild(&child_executor1);
+    executor.AddChild(&child_executor2);
+    executor.UseInputSort(4);
+
+    std::vector<std::unique_ptr<executor::LogicalTile>> left_tiles;
+    std::vector<std::unique_ptr<executor::LogicalTile>> right_tiles;
+    for (size_t table_itr = 0; table_itr < 2; table_itr++) {
+      left_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+          data_tables[table_itr]->GetTileGroup(0)));
+    }
+    right_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+        data_tables[2]->GetTileGroup(0)));
+
+    for (oid_t id = 0; id < tile_size * 2 / 5; id++) {
+      left_tiles[0]->RemoveVisibility(id);
+      left_tiles[1]->RemoveVisibility(id);
+      right_tiles[0]->RemoveVisibility(tile_size - 1 - id);
+    }
+
+    ExpectTiles(child_executor1, left_tiles);
+    ExpectTiles(child_executor2, right_tiles);
+
+    RunTest(executor, set_op.second);
+  }
+}
+
+TEST_F(MergeSetOpTests, NullInputSortTest) {
+  // Create two tables with the same data, where the odd rows have a null in
+  // the first column, so that the input is not sorted with nulls first
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  size_t tile_size = 10;
+
+  auto null_value =
+      common::ValueFactory::GetNullValueByType(common::Type::INTEGER);
+  std::vector<std::unique_ptr<storage::DataTable>> data_tables;
+  for (size_t table_itr = 0; table_itr < 2; table_itr++) {
+    data_tables.emplace_back(ExecutorTestsUtil::CreateTable(tile_size));
+    ExecutorTestsUtil::PopulateTable(data_tables.back().get(), tile_size,
+                                     false, false, false, txn);
+    auto tile_group = data_tables.back()->GetTileGroup(0);
+    for (oid_t id = 1; id < tile_size; id += 2) {
+      tile_group->SetValue(null_value, id, 0);
+    }
+  }
+
+  txn_manager.CommitTransaction(txn);
+
+  // The right child misses the last two rows, one of them with a null. The
+  // sort and the merge have to agree on where the nulls go for the rows
+  // with nulls to match.
+  std::vector<std::pair<SetOpType, size_t>> set_ops = {
+      {SETOP_TYPE_INTERSECT, tile_size - 2},
+      {SETOP_TYPE_INTERSECT_ALL, tile_size - 2},
+      {SETOP_TYPE_EXCEPT, 2},
+      {SETOP_TYPE_EXCEPT_ALL, 2},
+      {SETOP_TYPE_UNION, tile_size},
+      {SETOP_TYPE_UNION_ALL, 2 * tile_size - 2}};
+
+  // Sort on the normalized keys of the two integer columns, and on the
+  // values of all four columns
+  for (oid_t column_count : {2, 4}) {
+    for (auto &set_op : set_ops) {
+      planner::SetOpPlan node(set_op.first);
+      std::unique_ptr<executor::ExecutorContext> context(
+          new executor::ExecutorContext(nullptr));
+      executor::MergeSetOpExecutor executor(&node, context.get());
+
+      MockExecutor child_executor1;
+      MockExecutor child_executor2;
+
+      executor.AddChild(&child_executor1);
+      executor.AddChild(&child_executor2);
+      executor.UseInputSort(column_count);
+
+      std::vector<std::unique_ptr<executor::LogicalTile>> left_tiles;
+      std::vector<std::unique_ptr<executor::LogicalTile>> right_tiles;
+      left_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+          data_tables[0]->GetTileGroup(0)));
+      right_tiles.emplace_back(executor::LogicalTileFactory::WrapTileGroup(
+          data_tables[1]->GetTileGroup(0)));
+      right_tiles[0]->RemoveVisibility(tile_size - 2);
+      right_tiles[0]->RemoveVisibility(tile_size - 1);
+
+      ExpectTiles(child_executor1, left_tiles);
+      ExpectTiles(child_executor2, right_tiles);
+
+      RunTest(executor, set_op.second);
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace peloton
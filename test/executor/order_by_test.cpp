@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 
+#include <algorithm>
 #include <memory>
 #include <set>
 #include <string>
@@ -38,7 +39,19 @@ using ::testing::Return;
 namespace peloton {
 namespace test {
 
-class OrderByTests : public PelotonTest {};
+class OrderByTests : public PelotonTest {
+ protected:
+  // Run the parallel run generation and merge on worker threads
+  virtual void SetUp() {
+    PelotonTest::SetUp();
+    thread_pool.Initialize(4, 0);
+  }
+
+  virtual void TearDown() {
+    thread_pool.Shutdown();
+    PelotonTest::TearDown();
+  }
+};
 
 namespace {
 
@@ -62,9 +75,27 @@ void RunTest(executor::OrderByExecutor &executor, size_t expected_num_tuples,
   EXPECT_GT(sort_keys.size(), 0);
   EXPECT_GT(descend_flags.size(), 0);
 
-  // TODO: Verify
+  // Verify that every tuple is ordered w.r.t. the previous one
+  std::vector<common::Value> prev_keys;
+  for (auto &tile : result_tiles) {
+    for (oid_t tuple_id : *tile) {
+      std::vector<common::Value> keys;
+      for (auto sort_key : sort_keys) {
+        keys.push_back(tile->GetValue(tuple_id, sort_key));
+      }
+      for (size_t key_itr = 0; key_itr < prev_keys.size(); key_itr++) {
+        bool descend = descend_flags[key_itr];
+        auto &low = descend ? keys[key_itr] : prev_keys[key_itr];
+        auto &high = descend ? prev_keys[key_itr] : keys[key_itr];
+        if (low.CompareLessThan(high).IsTrue()) break;
+        EXPECT_TRUE(low.CompareEquals(high).IsTrue());
+      }
+      prev_keys = keys;
+    }
+  }
+
   for (UNUSED_ATTRIBUTE auto &tile : result_tiles) {
-    LOG_INFO("%s", tile->GetInfo().c_str());
+    LOG_TRACE("%s", tile->GetInfo().c_str());
   }
 }
 
@@ -300,6 +331,374 @@ TEST_F(OrderByTests, StringDescIntAscTest) {
 
   RunTest(executor, tile_size * 2, sort_keys, descend_flags);
 }
+/**
+ * Both sort keys are integers, so they are normalized into one SIMD sort key
+ */
+TEST_F(OrderByTests, IntDescIntAscTest) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1, 0});
+  std::vector<bool> descend_flags({true, false});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  executor.UseAVX2Sort();
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 20;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+
+  // Init() keeps the SIMD kernel
+  EXPECT_TRUE(executor.UsesAVX2Sort());
+}
+
+TEST_F(OrderByTests, IntAscParallelTest) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1});
+  std::vector<bool> descend_flags({false});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  executor.UseParallelSort(4);
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+}
+
+TEST_F(OrderByTests, IntAscAVX2Test) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1});
+  std::vector<bool> descend_flags({false});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  executor.UseAVX2Sort();
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+
+  // Init() keeps the SIMD kernel
+  EXPECT_TRUE(executor.UsesAVX2Sort());
+}
+
+TEST_F(OrderByTests, IntAscStringDescParallelTest) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1, 3});
+  std::vector<bool> descend_flags({false, true});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  executor.UseParallelSort(4);
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+}
+
+TEST_F(OrderByTests, IntAscStringDescLimitTest) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1, 3});
+  std::vector<bool> descend_flags({false, true});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+  size_t limit = 50;
+  node.SetLimit(limit);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  // The first sort key of the limit-th tuple in a full sort
+  std::vector<int32_t> input_keys;
+  for (oid_t tile_group_itr = 0; tile_group_itr < 2; tile_group_itr++) {
+    auto tile_group = data_table->GetTileGroup(tile_group_itr);
+    for (oid_t tuple_id = 0; tuple_id < tile_size; tuple_id++) {
+      input_keys.push_back(tile_group->GetValue(tuple_id, 1).GetAs<int32_t>());
+    }
+  }
+  std::sort(input_keys.begin(), input_keys.end());
+  auto limit_key = input_keys[limit - 1];
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  // Only the top tuples are returned, in sort order
+  EXPECT_TRUE(executor.Init());
+  size_t tuple_count = 0;
+  int32_t prev_key = INT32_MIN;
+  while (executor.Execute()) {
+    std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+    for (oid_t tuple_id : *result_tile) {
+      auto key = result_tile->GetValue(tuple_id, 1).GetAs<int32_t>();
+      EXPECT_LE(prev_key, key);
+      EXPECT_LE(key, limit_key);
+      prev_key = key;
+      tuple_count++;
+    }
+  }
+  EXPECT_EQ(limit, tuple_count);
+}
+
+TEST_F(OrderByTests, IntAscStringDescExternalTest) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1, 3});
+  std::vector<bool> descend_flags({false, true});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  // Spill every input tile to its own sorted run
+  executor.UseExternalSort(1);
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+}
+
+TEST_F(OrderByTests, IntAscExternalAVX2Test) {
+  // Create the plan node
+  std::vector<oid_t> sort_keys({1});
+  std::vector<bool> descend_flags({false});
+  std::vector<oid_t> output_columns({0, 1, 2, 3});
+  planner::OrderByPlan node(sort_keys, descend_flags, output_columns);
+
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(nullptr));
+
+  // Create and set up executor
+  executor::OrderByExecutor executor(&node, context.get());
+  executor.UseAVX2Sort();
+  executor.UseExternalSort(1);
+  MockExecutor child_executor;
+  executor.AddChild(&child_executor);
+
+  EXPECT_CALL(child_executor, DInit()).WillOnce(Return(true));
+
+  EXPECT_CALL(child_executor, DExecute())
+      .WillOnce(Return(true))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+
+  // Create a table and wrap it in logical tile
+  size_t tile_size = 200;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> data_table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  bool random = true;
+  ExecutorTestsUtil::PopulateTable(data_table.get(), tile_size * 2, false,
+                                   random, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile1(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(0)));
+
+  std::unique_ptr<executor::LogicalTile> source_logical_tile2(
+      executor::LogicalTileFactory::WrapTileGroup(data_table->GetTileGroup(1)));
+
+  EXPECT_CALL(child_executor, GetOutput())
+      .WillOnce(Return(source_logical_tile1.release()))
+      .WillOnce(Return(source_logical_tile2.release()));
+
+  RunTest(executor, tile_size * 2, sort_keys, descend_flags);
+
+  // Init() keeps the SIMD kernel
+  EXPECT_TRUE(executor.UsesAVX2Sort());
+}
 }
 
 }  // namespace test
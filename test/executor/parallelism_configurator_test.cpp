@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// parallelism_configurator_test.cpp
+//
+// Identification: test/executor/parallelism_configurator_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <vector>
+
+#include "common/harness.h"
+
+#include "executor/hash_executor.h"
+#include "executor/hash_join_executor.h"
+#include "executor/order_by_executor.h"
+#include "executor/parallelism_configurator.h"
+
+#include "executor/mock_executor.h"
+
+namespace peloton {
+namespace test {
+
+//===--------------------------------------------------------------------===//
+// Parallelism Configurator Tests
+//===--------------------------------------------------------------------===//
+
+class ParallelismConfiguratorTests : public PelotonTest {};
+
+TEST_F(ParallelismConfiguratorTests, SplitPipelinesTest) {
+  // ORDER BY over (left HASH JOIN HASH(right))
+  MockExecutor left_executor, right_executor;
+  executor::HashExecutor hash_executor(nullptr, nullptr);
+  executor::HashJoinExecutor hash_join_executor(nullptr, nullptr);
+  executor::OrderByExecutor order_by_executor(nullptr, nullptr);
+
+  hash_executor.AddChild(&right_executor);
+  hash_join_executor.AddChild(&left_executor);
+  hash_join_executor.AddChild(&hash_executor);
+  order_by_executor.AddChild(&hash_join_executor);
+
+  auto pipelines =
+      executor::ParallelismConfigurator::SplitPipelines(&order_by_executor);
+  ASSERT_EQ(4, pipelines.size());
+
+  // The right input is hashed first
+  std::vector<executor::AbstractExecutor *> expected_executors = {
+      &right_executor};
+  EXPECT_EQ(expected_executors, pipelines[0].executors);
+  EXPECT_EQ(&hash_executor, pipelines[0].sink);
+  EXPECT_TRUE(pipelines[0].sink_is_breaker);
+
+  // The hash join reads the hash table
+  expected_executors = {&hash_executor};
+  EXPECT_EQ(expected_executors, pipelines[1].executors);
+  EXPECT_EQ(&hash_join_executor, pipelines[1].sink);
+  EXPECT_FALSE(pipelines[1].sink_is_breaker);
+
+  // The left input streams through the probe into the sort
+  expected_executors = {&left_executor, &hash_join_executor};
+  EXPECT_EQ(expected_executors, pipelines[2].executors);
+  EXPECT_EQ(&order_by_executor, pipelines[2].sink);
+  EXPECT_TRUE(pipelines[2].sink_is_breaker);
+
+  // The sorted output goes to the caller
+  expected_executors = {&order_by_executor};
+  EXPECT_EQ(expected_executors, pipelines[3].executors);
+  EXPECT_EQ(nullptr, pipelines[3].sink);
+
+  EXPECT_TRUE(
+      executor::ParallelismConfigurator::SplitPipelines(nullptr).empty());
+
+  // Configuring only sets the options of the executors, nothing runs
+  executor::ParallelismConfigurator configurator(4);
+  EXPECT_EQ(4, configurator.GetThreadCount());
+  configurator.Configure(&order_by_executor);
+}
+
+}  // End test namespace
+}  // End peloton namespace
@@ -10,6 +10,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <set>
 #include <string>
@@ -18,6 +20,7 @@
 #include "common/harness.h"
 
 #include "catalog/schema.h"
+#include "common/init.h"
 #include "common/types.h"
 #include "common/value.h"
 #include "common/value_factory.h"
@@ -27,12 +30,17 @@
 #include "executor/executor_context.h"
 #include "executor/logical_tile.h"
 #include "executor/logical_tile_factory.h"
+#include "executor/compiled_predicate.h"
 #include "executor/seq_scan_executor.h"
+#include "executor/vectorized_predicate.h"
 #include "expression/abstract_expression.h"
 #include "expression/expression_util.h"
+#include "expression/parameter_value_expression.h"
 #include "planner/seq_scan_plan.h"
 #include "storage/data_table.h"
 #include "storage/tile_group_factory.h"
+#include "util/bloom_filter.h"
+#include "util/flat_hash_table.h"
 
 #include "common/harness.h"
 #include "executor/executor_tests_util.h"
@@ -44,7 +52,19 @@ using ::testing::Return;
 namespace peloton {
 namespace test {
 
-class SeqScanTests : public PelotonTest {};
+class SeqScanTests : public PelotonTest {
+ protected:
+  // The parallel scan runs its workers on the shared thread pool
+  virtual void SetUp() {
+    PelotonTest::SetUp();
+    thread_pool.Initialize(4, 0);
+  }
+
+  virtual void TearDown() {
+    thread_pool.Shutdown();
+    PelotonTest::TearDown();
+  }
+};
 
 namespace {
 
@@ -319,6 +339,436 @@ TEST_F(SeqScanTests, NonLeafNodePredicateTest) {
 
   txn_manager.CommitTransaction(txn);
 }
+
+// Sequential scan of table with a probe filter instead of a predicate.
+TEST_F(SeqScanTests, ProbeFilterTest) {
+  std::unique_ptr<storage::DataTable> table(CreateTable());
+
+  // The filter is keyed on the second output column, i.e., table column 1
+  std::vector<oid_t> column_ids({0, 1, 3});
+  planner::SeqScanPlan node(table.get(), nullptr, column_ids);
+
+  util::BloomFilter filter;
+  filter.Init(g_tuple_ids.size());
+  for (auto tuple_id : g_tuple_ids) {
+    size_t hash = 0;
+    common::ValueFactory::GetIntegerValue(
+        ExecutorTestsUtil::PopulatedValue(tuple_id, 1)).HashCombine(hash);
+    filter.Insert(util::MixHash(hash));
+  }
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(txn));
+
+  executor::SeqScanExecutor executor(&node, context.get());
+  EXPECT_TRUE(executor.Init());
+  executor.SetProbeFilter(&filter, {1});
+
+  size_t tile_count = 0;
+  while (executor.Execute()) {
+    std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+    tile_count++;
+
+    // The filter has no false positives for so few keys
+    std::set<oid_t> expected_tuples_left(g_tuple_ids);
+    for (oid_t tuple_id : *result_tile) {
+      int old_tuple_id =
+          result_tile->GetValue(tuple_id, 0).GetAs<int32_t>() / 10;
+      EXPECT_EQ(1, expected_tuples_left.erase(old_tuple_id));
+    }
+    EXPECT_EQ(0, expected_tuples_left.size());
+  }
+  EXPECT_EQ(table->GetTileGroupCount(), tile_count);
+
+  txn_manager.CommitTransaction(txn);
+}
+
+// Sequential scan with predicates that are evaluated a tile group at a time.
+TEST_F(SeqScanTests, VectorizedPredicateTest) {
+  std::unique_ptr<storage::DataTable> table(CreateTable());
+  std::vector<oid_t> column_ids({0, 1, 2});
+
+  auto column = [](int column_id) {
+    return expression::ExpressionUtil::TupleValueFactory(
+        column_id == 2 ? common::Type::DECIMAL : common::Type::INTEGER, 0,
+        column_id);
+  };
+  auto integer = [](int value) {
+    return expression::ExpressionUtil::ConstantValueFactory(
+        common::ValueFactory::GetIntegerValue(value));
+  };
+  auto compare = [](ExpressionType type,
+                    expression::AbstractExpression *left,
+                    expression::AbstractExpression *right) {
+    return expression::ExpressionUtil::ComparisonFactory(type, left, right);
+  };
+  auto conjunction = [](ExpressionType type,
+                        expression::AbstractExpression *left,
+                        expression::AbstractExpression *right) {
+    return expression::ExpressionUtil::ConjunctionFactory(type, left, right);
+  };
+  auto arithmetic = [](ExpressionType type,
+                       expression::AbstractExpression *left,
+                       expression::AbstractExpression *right) {
+    return expression::ExpressionUtil::OperatorFactory(
+        type, common::Type::INTEGER, left, right);
+  };
+
+  // Column c of tuple t holds 10 * t + c
+  std::vector<std::pair<expression::AbstractExpression *,
+                        std::function<bool(int)>>> predicates;
+
+  // 20 <= a AND a < 60
+  predicates.emplace_back(
+      conjunction(EXPRESSION_TYPE_CONJUNCTION_AND,
+                  compare(EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+                          column(0), integer(20)),
+                  compare(EXPRESSION_TYPE_COMPARE_LESSTHAN, column(0),
+                          integer(60))),
+      [](int t) { return t >= 2 && t < 6; });
+
+  // (b + a) * 2 > c + 100 OR a = 0
+  predicates.emplace_back(
+      conjunction(
+          EXPRESSION_TYPE_CONJUNCTION_OR,
+          compare(EXPRESSION_TYPE_COMPARE_GREATERTHAN,
+                  arithmetic(EXPRESSION_TYPE_OPERATOR_MULTIPLY,
+                             arithmetic(EXPRESSION_TYPE_OPERATOR_PLUS,
+                                        column(1), column(0)),
+                             integer(2)),
+                  arithmetic(EXPRESSION_TYPE_OPERATOR_PLUS, column(2),
+                             integer(100))),
+          compare(EXPRESSION_TYPE_COMPARE_EQUAL, column(0), integer(0))),
+      [](int t) { return 40 * t + 2 > 10 * t + 102 || t == 0; });
+
+  // c <= 31.5 AND 5 < b
+  predicates.emplace_back(
+      conjunction(EXPRESSION_TYPE_CONJUNCTION_AND,
+                  compare(EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+                          column(2),
+                          expression::ExpressionUtil::ConstantValueFactory(
+                              common::ValueFactory::GetDoubleValue(31.5))),
+                  compare(EXPRESSION_TYPE_COMPARE_LESSTHAN, integer(5),
+                          column(1))),
+      [](int t) { return t >= 1 && t <= 2; });
+
+  // a <> b - 1
+  predicates.emplace_back(
+      compare(EXPRESSION_TYPE_COMPARE_NOTEQUAL, column(0),
+              arithmetic(EXPRESSION_TYPE_OPERATOR_MINUS, column(1),
+                         integer(1))),
+      [](int) { return false; });
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+
+  for (auto &predicate : predicates) {
+    EXPECT_TRUE(executor::VectorizedPredicate::IsSupported(
+        predicate.first, table->GetSchema()));
+
+    planner::SeqScanPlan node(table.get(), predicate.first, column_ids);
+
+    auto txn = txn_manager.BeginTransaction();
+    std::unique_ptr<executor::ExecutorContext> context(
+        new executor::ExecutorContext(txn));
+    executor::SeqScanExecutor executor(&node, context.get());
+    EXPECT_TRUE(executor.Init());
+
+    size_t expected_tuple_count = 0;
+    for (int t = 0; t < TESTS_TUPLES_PER_TILEGROUP; t++) {
+      if (predicate.second(t)) expected_tuple_count++;
+    }
+    expected_tuple_count *= table->GetTileGroupCount();
+
+    size_t tuple_count = 0;
+    while (executor.Execute()) {
+      std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+      for (oid_t tuple_id : *result_tile) {
+        int old_tuple_id =
+            result_tile->GetValue(tuple_id, 0).GetAs<int32_t>() / 10;
+        EXPECT_TRUE(predicate.second(old_tuple_id));
+        tuple_count++;
+      }
+    }
+    EXPECT_EQ(expected_tuple_count, tuple_count);
+
+    txn_manager.CommitTransaction(txn);
+  }
+}
+
+// Sequential scan with a compiled predicate, executed repeatedly with
+// different parameters like a prepared statement.
+TEST_F(SeqScanTests, CompiledPredicateTest) {
+  std::unique_ptr<storage::DataTable> table(CreateTable());
+  std::vector<oid_t> column_ids({0, 1, 2});
+
+  // (a >= $0 AND c < 32.5) OR a = b
+  auto predicate = expression::ExpressionUtil::ConjunctionFactory(
+      EXPRESSION_TYPE_CONJUNCTION_OR,
+      expression::ExpressionUtil::ConjunctionFactory(
+          EXPRESSION_TYPE_CONJUNCTION_AND,
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+              expression::ExpressionUtil::TupleValueFactory(
+                  common::Type::INTEGER, 0, 0),
+              new expression::ParameterValueExpression(0)),
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_LESSTHAN,
+              expression::ExpressionUtil::TupleValueFactory(
+                  common::Type::DECIMAL, 0, 2),
+              expression::ExpressionUtil::ConstantValueFactory(
+                  common::ValueFactory::GetDoubleValue(32.5)))),
+      expression::ExpressionUtil::ComparisonFactory(
+          EXPRESSION_TYPE_COMPARE_EQUAL,
+          expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER,
+                                                        0, 0),
+          expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER,
+                                                        0, 1)));
+  planner::SeqScanPlan node(table.get(), predicate, column_ids);
+
+  auto compiled_predicate = node.GetCompiledPredicate();
+  EXPECT_THAT(compiled_predicate, NotNull());
+
+  // Column c of tuple t holds 10 * t + c, so the tuples 2 and 3 pass with
+  // $0 = 20, the tuples 0 to 3 with $0 = 0, and the tuple 3 with $0 = 25.0
+  std::vector<std::pair<common::Value, std::set<oid_t>>> executions = {
+      {common::ValueFactory::GetIntegerValue(20), {2, 3}},
+      {common::ValueFactory::GetIntegerValue(0), {0, 1, 2, 3}},
+      {common::ValueFactory::GetDoubleValue(25.0), {3}}};
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  for (auto &execution : executions) {
+    auto txn = txn_manager.BeginTransaction();
+    std::unique_ptr<executor::ExecutorContext> context(
+        new executor::ExecutorContext(txn, {execution.first}));
+    executor::SeqScanExecutor executor(&node, context.get());
+    EXPECT_TRUE(executor.Init());
+
+    size_t tile_count = 0;
+    while (executor.Execute()) {
+      std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+      tile_count++;
+
+      std::set<oid_t> expected_tuples_left(execution.second);
+      for (oid_t tuple_id : *result_tile) {
+        int old_tuple_id =
+            result_tile->GetValue(tuple_id, 0).GetAs<int32_t>() / 10;
+        EXPECT_EQ(1, expected_tuples_left.erase(old_tuple_id));
+      }
+      EXPECT_EQ(0, expected_tuples_left.size());
+    }
+    EXPECT_EQ(table->GetTileGroupCount(), tile_count);
+
+    txn_manager.CommitTransaction(txn);
+  }
+
+  // The plan is compiled only once
+  EXPECT_EQ(compiled_predicate, node.GetCompiledPredicate());
+}
+
+TEST_F(SeqScanTests, ZoneMapTest) {
+  // Column a of row r holds 10 * r, so tile group g holds 100 * g to
+  // 100 * g + 90 in a, and 100 * g + 2 to 100 * g + 92 in c
+  const int tile_size = 10;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  ExecutorTestsUtil::PopulateTable(table.get(), tile_size * 5, false, false,
+                                   false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  for (oid_t tile_group_itr = 0; tile_group_itr < 5; tile_group_itr++) {
+    auto &zone_map = table->GetTileGroup(tile_group_itr)->GetZoneMap();
+    int min = 100 * tile_group_itr;
+    int max = min + 90;
+
+    EXPECT_TRUE(zone_map.MayMatch(0, EXPRESSION_TYPE_COMPARE_EQUAL,
+                                  common::ValueFactory::GetIntegerValue(min)));
+    EXPECT_FALSE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_EQUAL,
+        common::ValueFactory::GetIntegerValue(max + 1)));
+    EXPECT_FALSE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_LESSTHAN,
+        common::ValueFactory::GetIntegerValue(min)));
+    EXPECT_TRUE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_LESSTHANOREQUALTO,
+        common::ValueFactory::GetIntegerValue(min)));
+    EXPECT_FALSE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_GREATERTHAN,
+        common::ValueFactory::GetBigIntValue(max)));
+    EXPECT_TRUE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_GREATERTHAN,
+        common::ValueFactory::GetDoubleValue(max - 0.5)));
+    EXPECT_FALSE(zone_map.MayMatch(
+        2, EXPRESSION_TYPE_COMPARE_LESSTHAN,
+        common::ValueFactory::GetDoubleValue(min + 2)));
+    EXPECT_TRUE(zone_map.MayMatch(
+        2, EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+        common::ValueFactory::GetIntegerValue(max + 2)));
+    EXPECT_FALSE(zone_map.MayMatch(
+        0, EXPRESSION_TYPE_COMPARE_EQUAL,
+        common::ValueFactory::GetNullValueByType(common::Type::INTEGER)));
+
+    // Varchar columns are not tracked
+    EXPECT_TRUE(zone_map.MayMatch(
+        3, EXPRESSION_TYPE_COMPARE_EQUAL,
+        common::ValueFactory::GetVarcharValue("none")));
+    EXPECT_EQ(0, zone_map.GetNullCount(0));
+
+    int64_t bound_min, bound_max;
+    EXPECT_TRUE(zone_map.GetIntegerBounds(0, bound_min, bound_max));
+    EXPECT_EQ(min, bound_min);
+    EXPECT_EQ(max, bound_max);
+    EXPECT_FALSE(zone_map.GetIntegerBounds(2, bound_min, bound_max));
+    EXPECT_FALSE(zone_map.GetIntegerBounds(3, bound_min, bound_max));
+  }
+
+  // a >= $0 AND 250 > a only matches tile groups 1 and 2 with $0 = 150
+  std::vector<oid_t> column_ids({0, 1, 2});
+  auto predicate = expression::ExpressionUtil::ConjunctionFactory(
+      EXPRESSION_TYPE_CONJUNCTION_AND,
+      expression::ExpressionUtil::ComparisonFactory(
+          EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+          expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER,
+                                                        0, 0),
+          new expression::ParameterValueExpression(0)),
+      expression::ExpressionUtil::ComparisonFactory(
+          EXPRESSION_TYPE_COMPARE_GREATERTHAN,
+          expression::ExpressionUtil::ConstantValueFactory(
+              common::ValueFactory::GetIntegerValue(250)),
+          expression::ExpressionUtil::TupleValueFactory(common::Type::INTEGER,
+                                                        0, 0)));
+  planner::SeqScanPlan node(table.get(), predicate, column_ids);
+
+  txn = txn_manager.BeginTransaction();
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(
+          txn, {common::ValueFactory::GetIntegerValue(150)}));
+  executor::SeqScanExecutor executor(&node, context.get());
+  EXPECT_TRUE(executor.Init());
+
+  std::set<int> expected_rows;
+  for (int row = 15; row < 25; row++) expected_rows.insert(row);
+  while (executor.Execute()) {
+    std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+    for (oid_t tuple_id : *result_tile) {
+      int row = result_tile->GetValue(tuple_id, 0).GetAs<int32_t>() / 10;
+      EXPECT_EQ(1, expected_rows.erase(row));
+    }
+  }
+  EXPECT_EQ(0, expected_rows.size());
+  txn_manager.CommitTransaction(txn);
+
+  // Writes widen the bounds
+  auto tile_group = table->GetTileGroup(0);
+  auto value = common::ValueFactory::GetIntegerValue(1000);
+  EXPECT_FALSE(tile_group->GetZoneMap().MayMatch(
+      0, EXPRESSION_TYPE_COMPARE_EQUAL, value));
+  tile_group->SetValue(value, 0, 0);
+  EXPECT_TRUE(tile_group->GetZoneMap().MayMatch(
+      0, EXPRESSION_TYPE_COMPARE_EQUAL, value));
+
+  auto null_value =
+      common::ValueFactory::GetNullValueByType(common::Type::INTEGER);
+  tile_group->SetValue(null_value, 1, 1);
+  EXPECT_EQ(1, tile_group->GetZoneMap().GetNullCount(1));
+}
+
+/**
+ * @brief Scan the table with the given number of threads and return the
+ * rows r of the result tiles, where column a of row r holds 10 * r.
+ */
+std::vector<int> ScanRows(storage::DataTable *table,
+                          const expression::AbstractExpression *predicate,
+                          size_t thread_count, bool preserve_order) {
+  std::vector<oid_t> column_ids({0, 1});
+  planner::SeqScanPlan node(table, predicate->Copy(), column_ids);
+
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<executor::ExecutorContext> context(
+      new executor::ExecutorContext(txn));
+  executor::SeqScanExecutor executor(&node, context.get());
+  if (thread_count > 1) {
+    executor.UseParallelScan(thread_count, preserve_order);
+  }
+  EXPECT_TRUE(executor.Init());
+
+  std::vector<int> rows;
+  while (executor.Execute()) {
+    std::unique_ptr<executor::LogicalTile> result_tile(executor.GetOutput());
+    for (oid_t tuple_id : *result_tile) {
+      rows.push_back(result_tile->GetValue(tuple_id, 0).GetAs<int32_t>() / 10);
+    }
+  }
+  txn_manager.CommitTransaction(txn);
+  return rows;
+}
+
+TEST_F(SeqScanTests, ParallelScanTest) {
+  const int tile_size = 10;
+  const int tile_group_count = 20;
+  auto &txn_manager = concurrency::TransactionManagerFactory::GetInstance();
+  auto txn = txn_manager.BeginTransaction();
+  std::unique_ptr<storage::DataTable> table(
+      ExecutorTestsUtil::CreateTable(tile_size));
+  ExecutorTestsUtil::PopulateTable(table.get(), tile_size * tile_group_count,
+                                   false, false, false, txn);
+  txn_manager.CommitTransaction(txn);
+
+  // a % 30 = 0 OR a >= 1500, the workers can't evaluate the modulo
+  std::unique_ptr<expression::AbstractExpression> mod_predicate(
+      expression::ExpressionUtil::ConjunctionFactory(
+          EXPRESSION_TYPE_CONJUNCTION_OR,
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_EQUAL,
+              expression::ExpressionUtil::OperatorFactory(
+                  EXPRESSION_TYPE_OPERATOR_MOD, common::Type::INTEGER,
+                  expression::ExpressionUtil::TupleValueFactory(
+                      common::Type::INTEGER, 0, 0),
+                  expression::ExpressionUtil::ConstantValueFactory(
+                      common::ValueFactory::GetIntegerValue(30))),
+              expression::ExpressionUtil::ConstantValueFactory(
+                  common::ValueFactory::GetIntegerValue(0))),
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+              expression::ExpressionUtil::TupleValueFactory(
+                  common::Type::INTEGER, 0, 0),
+              expression::ExpressionUtil::ConstantValueFactory(
+                  common::ValueFactory::GetIntegerValue(1500)))));
+
+  // a < 500 OR a >= 1500, the workers evaluate it in batches
+  std::unique_ptr<expression::AbstractExpression> range_predicate(
+      expression::ExpressionUtil::ConjunctionFactory(
+          EXPRESSION_TYPE_CONJUNCTION_OR,
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_LESSTHAN,
+              expression::ExpressionUtil::TupleValueFactory(
+                  common::Type::INTEGER, 0, 0),
+              expression::ExpressionUtil::ConstantValueFactory(
+                  common::ValueFactory::GetIntegerValue(500))),
+          expression::ExpressionUtil::ComparisonFactory(
+              EXPRESSION_TYPE_COMPARE_GREATERTHANOREQUALTO,
+              expression::ExpressionUtil::TupleValueFactory(
+                  common::Type::INTEGER, 0, 0),
+              expression::ExpressionUtil::ConstantValueFactory(
+                  common::ValueFactory::GetIntegerValue(1500)))));
+
+  for (auto predicate : {mod_predicate.get(), range_predicate.get()}) {
+    auto serial_rows = ScanRows(table.get(), predicate, 1, false);
+    EXPECT_FALSE(serial_rows.empty());
+
+    // The tiles come back in tile group order
+    EXPECT_EQ(serial_rows, ScanRows(table.get(), predicate, 4, true));
+
+    // The tiles come back in any order
+    auto rows = ScanRows(table.get(), predicate, 4, false);
+    std::sort(rows.begin(), rows.end());
+    EXPECT_EQ(serial_rows, rows);
+  }
+}
 }
 
 }  // namespace test
@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// bloom_filter_test.cpp
+//
+// Identification: test/util/bloom_filter_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/bloom_filter.h"
+#include "util/flat_hash_table.h"
+#include "common/harness.h"
+
+namespace peloton {
+namespace test {
+
+//===--------------------------------------------------------------------===//
+// BloomFilter Test
+//===--------------------------------------------------------------------===//
+
+class BloomFilterTests : public PelotonTest {};
+
+TEST_F(BloomFilterTests, MayContainTest) {
+  const uint64_t key_count = 10000;
+  util::BloomFilter filter;
+  EXPECT_TRUE(filter.IsEmpty());
+
+  filter.Init(key_count);
+  EXPECT_FALSE(filter.IsEmpty());
+  for (uint64_t key = 0; key < key_count; key++) {
+    filter.Insert(util::MixHash(key));
+  }
+
+  // No false negatives
+  for (uint64_t key = 0; key < key_count; key++) {
+    EXPECT_TRUE(filter.MayContain(util::MixHash(key)));
+  }
+
+  // Few false positives
+  size_t false_positive_count = 0;
+  for (uint64_t key = key_count; key < 11 * key_count; key++) {
+    if (filter.MayContain(util::MixHash(key))) false_positive_count++;
+  }
+  EXPECT_LT(false_positive_count, key_count / 10);
+}
+
+}  // namespace test
+}  // namespace peloton
@@ -0,0 +1,83 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// flat_hash_table_test.cpp
+//
+// Identification: test/util/flat_hash_table_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/flat_hash_table.h"
+#include "common/harness.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace peloton {
+namespace test {
+
+//===--------------------------------------------------------------------===//
+// FlatHashTable Test
+//===--------------------------------------------------------------------===//
+
+class FlatHashTableTests : public PelotonTest {};
+
+TEST_F(FlatHashTableTests, DuplicateKeyTest) {
+  // Starts small, so the table grows while inserting
+  util::FlatHashTable<uint64_t> table;
+  const uint64_t key_count = 1000;
+  for (uint64_t key = 0; key < key_count; key++) {
+    // Every key is stored key % 3 + 1 times
+    for (uint64_t copy = 0; copy <= key % 3; copy++) {
+      table.Insert(util::MixHash(key), key);
+    }
+  }
+  EXPECT_GE(table.GetCapacity(), 2 * table.Size());
+
+  for (uint64_t key = 0; key < key_count; key++) {
+    size_t match_count = 0;
+    table.ForEachMatch(util::MixHash(key), [&](uint64_t payload) {
+      if (payload == key) match_count++;
+    });
+    EXPECT_EQ(key % 3 + 1, match_count);
+  }
+
+  // The hash 0 marks empty slots, so it is stored as another hash
+  table.Insert(0, key_count);
+  size_t match_count = 0;
+  table.ForEachMatch(0, [&](uint64_t payload) {
+    if (payload == key_count) match_count++;
+  });
+  EXPECT_EQ(1, match_count);
+}
+
+TEST_F(FlatHashTableTests, FindOrInsertTest) {
+  // Payload: index of the key in keys
+  std::vector<uint64_t> keys = {7, 42, 7, 1 << 20, 42, 7};
+  std::vector<uint64_t> distinct_keys;
+  util::FlatHashTable<size_t> table(2);
+
+  for (auto key : keys) {
+    auto equal = [&](size_t payload) { return distinct_keys[payload] == key; };
+    auto result =
+        table.FindOrInsert(util::MixHash(key), equal, distinct_keys.size());
+    if (result.second) distinct_keys.push_back(key);
+    EXPECT_EQ(key, distinct_keys[*result.first]);
+  }
+
+  EXPECT_EQ(3, table.Size());
+  EXPECT_EQ(nullptr, table.Find(util::MixHash(8), [](size_t) { return true; }));
+
+  std::vector<uint64_t> visited_keys;
+  table.ForEach([&](size_t payload) {
+    visited_keys.push_back(distinct_keys[payload]);
+  });
+  std::sort(visited_keys.begin(), visited_keys.end());
+  EXPECT_EQ(std::vector<uint64_t>({7, 42, 1 << 20}), visited_keys);
+}
+
+}  // namespace test
+}  // namespace peloton
@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// simd_merge_sort_test.cpp
+//
+// Identification: test/util/simd_merge_sort_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/simd_merge_sort.h"
+#include "common/harness.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace peloton {
+namespace test {
+
+//===--------------------------------------------------------------------===//
+// SIMD Merge Sort Test
+//===--------------------------------------------------------------------===//
+
+class SimdMergeSortTests : public PelotonTest {};
+
+namespace {
+
+template <typename T>
+T *AllocateAligned(size_t count) {
+  T *array = nullptr;
+  EXPECT_EQ(0, posix_memalign((void **)&array, 64, count * sizeof(T)));
+  return array;
+}
+
+// Sort len keys drawn from [0, key_range) with the given kernel, and check
+// that the keys are sorted and every payload still belongs to its key
+void SortAndCheck(util::SimdSortKernel kernel, size_t len,
+                  uint64_t key_range) {
+  std::mt19937_64 rng(len);
+  auto keys = AllocateAligned<util::sort_key64_type>(len);
+  auto payloads = AllocateAligned<util::sort_payload_type>(len);
+  auto temp_keys = AllocateAligned<util::sort_key64_type>(len);
+  auto temp_payloads = AllocateAligned<util::sort_payload_type>(len);
+
+  std::vector<util::sort_key64_type> input_keys(len);
+  for (size_t key_itr = 0; key_itr < len; key_itr++) {
+    // the top bit is set on half of the keys, which are larger unsigned keys
+    keys[key_itr] = input_keys[key_itr] =
+        (rng() % key_range) | ((rng() & 1) << 63);
+    payloads[key_itr] = key_itr;
+  }
+
+  EXPECT_TRUE(util::SetSimdSortKernel(kernel));
+  auto result =
+      util::simd_merge_sort64(keys, payloads, temp_keys, temp_payloads, len);
+
+  std::vector<bool> seen(len, false);
+  for (size_t key_itr = 0; key_itr < len; key_itr++) {
+    if (key_itr > 0) {
+      EXPECT_LE(result.first[key_itr - 1], result.first[key_itr]);
+    }
+    auto payload = result.second[key_itr];
+    ASSERT_LT(payload, len);
+    EXPECT_FALSE(seen[payload]);
+    seen[payload] = true;
+    EXPECT_EQ(input_keys[payload], result.first[key_itr]);
+  }
+
+  free(keys);
+  free(payloads);
+  free(temp_keys);
+  free(temp_payloads);
+}
+
+}  // namespace
+
+TEST_F(SimdMergeSortTests, KernelTest) {
+  auto widest_kernel = util::GetSimdSortKernel();
+  std::vector<util::SimdSortKernel> kernels = {util::SIMD_SORT_KERNEL_SCALAR,
+                                               util::SIMD_SORT_KERNEL_AVX2,
+                                               util::SIMD_SORT_KERNEL_AVX512};
+
+  for (auto kernel : kernels) {
+    if (kernel > widest_kernel) {
+      EXPECT_FALSE(util::SetSimdSortKernel(kernel));
+      continue;
+    }
+    for (size_t len : {SORT_SIZE64, 3 * SORT_SIZE64, 64 * SORT_SIZE64}) {
+      SortAndCheck(kernel, len, UINT64_MAX >> 1);
+      // many equal keys
+      SortAndCheck(kernel, len, 4);
+    }
+  }
+
+  EXPECT_TRUE(util::SetSimdSortKernel(widest_kernel));
+}
+
+}  // namespace test
+}  // namespace peloton
@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+//                         Peloton
+//
+// sort_key_normalizer_test.cpp
+//
+// Identification: test/util/sort_key_normalizer_test.cpp
+//
+// Copyright (c) 2015-16, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "util/sort_key_normalizer.h"
+#include "common/harness.h"
+#include "common/value_factory.h"
+
+#include <vector>
+
+namespace peloton {
+namespace test {
+
+//===--------------------------------------------------------------------===//
+// SortKeyNormalizer Test
+//===--------------------------------------------------------------------===//
+
+class SortKeyNormalizerTests : public PelotonTest {};
+
+TEST_F(SortKeyNormalizerTests, SignedAndDescendTest) {
+  std::vector<int32_t> values = {INT32_MIN + 1, -100, -1, 0, 1, 100, INT32_MAX};
+
+  util::SortKeyNormalizer asc_normalizer({common::Type::INTEGER}, {false});
+  util::SortKeyNormalizer desc_normalizer({common::Type::INTEGER}, {true});
+  EXPECT_TRUE(asc_normalizer.IsExact());
+
+  for (size_t value_itr = 1; value_itr < values.size(); value_itr++) {
+    auto lower = common::ValueFactory::GetIntegerValue(values[value_itr - 1]);
+    auto higher = common::ValueFactory::GetIntegerValue(values[value_itr]);
+    EXPECT_LT(asc_normalizer.AddColumn(0, 0, lower),
+              asc_normalizer.AddColumn(0, 0, higher));
+    EXPECT_GT(desc_normalizer.AddColumn(0, 0, lower),
+              desc_normalizer.AddColumn(0, 0, higher));
+  }
+
+  util::SortKeyNormalizer bigint_normalizer({common::Type::BIGINT}, {false});
+  EXPECT_LT(bigint_normalizer.AddColumn(
+                0, 0, common::ValueFactory::GetBigIntValue(-5000000000LL)),
+            bigint_normalizer.AddColumn(
+                0, 0, common::ValueFactory::GetBigIntValue(5000000000LL)));
+}
+
+TEST_F(SortKeyNormalizerTests, MultiColumnTest) {
+  // ORDER BY a DESC, b
+  util::SortKeyNormalizer normalizer(
+      {common::Type::INTEGER, common::Type::SMALLINT}, {true, false});
+  EXPECT_TRUE(normalizer.IsExact());
+
+  auto key = [&normalizer](int32_t a, int16_t b) {
+    auto packed =
+        normalizer.AddColumn(0, 0, common::ValueFactory::GetIntegerValue(a));
+    return normalizer.AddColumn(packed, 1,
+                                common::ValueFactory::GetSmallIntValue(b));
+  };
+
+  EXPECT_LT(key(10, 0), key(9, 0));
+  EXPECT_LT(key(10, -3), key(10, 2));
+  EXPECT_LT(key(10, 32767), key(-10, -32767));
+  EXPECT_EQ(key(7, 7), key(7, 7));
+}
+
+TEST_F(SortKeyNormalizerTests, NullTest) {
+  // Nulls sort before every other value
+  for (auto type_id : {common::Type::INTEGER, common::Type::TIMESTAMP}) {
+    util::SortKeyNormalizer normalizer({type_id}, {false});
+    auto null_value = common::ValueFactory::GetNullValueByType(type_id);
+    auto zero = (type_id == common::Type::INTEGER)
+                    ? common::ValueFactory::GetIntegerValue(0)
+                    : common::ValueFactory::GetTimestampValue(0);
+    EXPECT_LT(normalizer.AddColumn(0, 0, null_value),
+              normalizer.AddColumn(0, 0, zero));
+  }
+}
+
+TEST_F(SortKeyNormalizerTests, PrefixTest) {
+  // Two BIGINT columns do not fit, only the first one is packed
+  util::SortKeyNormalizer normalizer(
+      {common::Type::BIGINT, common::Type::BIGINT}, {false, true});
+  EXPECT_FALSE(normalizer.IsExact());
+  EXPECT_EQ(1, normalizer.GetFirstInexactColumn());
+
+  auto a = common::ValueFactory::GetBigIntValue(42);
+  auto b1 = common::ValueFactory::GetBigIntValue(1);
+  auto b2 = common::ValueFactory::GetBigIntValue(2);
+  EXPECT_EQ(normalizer.AddColumn(normalizer.AddColumn(0, 0, a), 1, b1),
+            normalizer.AddColumn(normalizer.AddColumn(0, 0, a), 1, b2));
+
+  // The second column decides the ties in descending order
+  EXPECT_GT(normalizer.CompareColumn(1, b1, b2), 0);
+  EXPECT_EQ(0, normalizer.CompareColumn(1, b1, b1));
+
+  EXPECT_FALSE(util::SortKeyNormalizer::CanNormalize(
+      {common::Type::INTEGER, common::Type::VARCHAR}));
+  EXPECT_TRUE(util::SortKeyNormalizer::CanNormalize(
+      {common::Type::SMALLINT, common::Type::TIMESTAMP}));
+}
+
+}  // namespace test
+}  // namespace peloton